@@ -0,0 +1,110 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "ARDebugDraw.h"
+
+#if AR_DEBUG_DRAW_ENABLED
+
+ARDebugDraw& ARDebugDraw::Get()
+{
+	static ARDebugDraw DebugDraw;
+	return DebugDraw;
+}
+
+ARDebugDraw::ARDebugDraw()
+{
+	EnabledCategories = ARDebugCategory::All;
+	ValueDisplaySeconds = 0.5f;
+}
+
+ARDebugDraw::Command& ARDebugDraw::Add(Command::CommandType Type)
+{
+	Command& NewCommand = Commands[Commands.AddUninitialized()];
+	NewCommand.Type = Type;
+	NewCommand.Seconds = 0.f;
+	NewCommand.Label = NULL;
+	return NewCommand;
+}
+
+void ARDebugDraw::Sphere(uint32 Category, const FVector& Center, float Radius, const FColor& Color, float Seconds)
+{
+	if (!IsEnabled(Category)) return;
+	Command& NewCommand = Add(Command::SphereCommand);
+	NewCommand.A = Center;
+	NewCommand.Radius = Radius;
+	NewCommand.Color = Color;
+	NewCommand.Seconds = Seconds;
+}
+
+void ARDebugDraw::Line(uint32 Category, const FVector& Start, const FVector& End, const FColor& Color)
+{
+	if (!IsEnabled(Category)) return;
+	Command& NewCommand = Add(Command::LineCommand);
+	NewCommand.A = Start;
+	NewCommand.B = End;
+	NewCommand.Color = Color;
+}
+
+void ARDebugDraw::Cylinder(uint32 Category, const FVector& Start, const FVector& End, float Radius, const FColor& Color)
+{
+	if (!IsEnabled(Category)) return;
+	Command& NewCommand = Add(Command::CylinderCommand);
+	NewCommand.A = Start;
+	NewCommand.B = End;
+	NewCommand.Radius = Radius;
+	NewCommand.Color = Color;
+}
+
+void ARDebugDraw::Value(uint32 Category, const TCHAR* Label, const FVector& Value, float Seconds)
+{
+	if (!IsEnabled(Category)) return;
+	Command& NewCommand = Add(Command::VectorValue);
+	NewCommand.Label = Label;
+	NewCommand.A = Value;
+	NewCommand.Color = FColor::Yellow;
+	NewCommand.Seconds = Seconds;
+}
+
+void ARDebugDraw::Value(uint32 Category, const TCHAR* Label, const FRotator& Value, float Seconds)
+{
+	if (!IsEnabled(Category)) return;
+	Command& NewCommand = Add(Command::RotatorValue);
+	NewCommand.Label = Label;
+	NewCommand.A = FVector(Value.Pitch, Value.Yaw, Value.Roll);
+	NewCommand.Color = FColor::Yellow;
+	NewCommand.Seconds = Seconds;
+}
+
+void ARDebugDraw::Flush(UWorld* World)
+{
+	if (Commands.Num() == 0) return;
+	Draw(World);
+	Commands.Reset(); // keeps the memory for the next frame
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+/*
+ Debug visualization is compiled out of shipping builds entirely: the AR_DEBUG_* macros expand to nothing, so neither
+ the calls nor their arguments cost anything.  Otherwise draws and values are recorded as plain commands into an array
+ that keeps its memory between frames, only for the categories enabled at runtime, and turned into DrawDebug calls and
+ on-screen strings once per frame by Flush.  Values are formatted only then, and each label keeps a single on-screen
+ line instead of stacking a new message every frame.
+ */
+#define AR_DEBUG_DRAW_ENABLED !UE_BUILD_SHIPPING
+
+/**
+ * Debug draw categories, combined into the bitmask of enabled categories
+ */
+namespace ARDebugCategory
+{
+	enum Type
+	{
+		Hands = 1 << 0,        // Leap hands (palm and fingertips)
+		Touch = 1 << 1,        // finger against the UI surfaces
+		Gaze = 1 << 2,         // the gaze ray and its hit on a UI surface
+		Markers = 1 << 3,      // detected marker locations and normals
+		MarkerValues = 1 << 4, // marker, camera and spawn poses as text
+		All = 0xff
+	};
+}
+
+#if AR_DEBUG_DRAW_ENABLED
+
+/**
+ * Per-frame debug draw channel.  Game thread only.
+ */
+class ARDebugDraw
+{
+public:
+
+	static ARDebugDraw& Get();
+
+	FORCEINLINE bool IsEnabled(uint32 Category) const { return (EnabledCategories & Category) != 0; }
+
+	uint32 GetEnabledCategories() const { return EnabledCategories; }
+
+	void SetEnabledCategories(uint32 Categories) { EnabledCategories = Categories; }
+
+	void Sphere(uint32 Category, const FVector& Center, float Radius, const FColor& Color, float Seconds = 0.f);
+
+	void Line(uint32 Category, const FVector& Start, const FVector& End, const FColor& Color);
+
+	void Cylinder(uint32 Category, const FVector& Start, const FVector& End, float Radius, const FColor& Color);
+
+	/* Shows "Label: Value" on screen.  Label must be a string literal; it also identifies the line. */
+	void Value(uint32 Category, const TCHAR* Label, const FVector& Value, float Seconds = 0.f);
+
+	void Value(uint32 Category, const TCHAR* Label, const FRotator& Value, float Seconds = 0.f);
+
+	/*
+	 Draws and prints everything recorded since the last flush, then empties the channel.  Called once per frame at the
+	 end of the character's Tick, so its own commands show the frame they're recorded in; commands of actors ticking
+	 after it are drawn by the next one.
+	 */
+	void Flush(UWorld* World);
+
+	// how long a value recorded with Seconds = 0 stays on screen; it is replaced as long as it's recorded every frame
+	float ValueDisplaySeconds;
+
+private:
+
+	ARDebugDraw();
+
+	struct Command
+	{
+		enum CommandType : uint8 { SphereCommand, LineCommand, CylinderCommand, VectorValue, RotatorValue };
+
+		CommandType Type;
+		FColor Color;
+		float Radius;
+		float Seconds;
+		FVector A;  // center, start or value (a rotator as pitch, yaw, roll)
+		FVector B;  // end
+		const TCHAR* Label;
+	};
+
+	Command& Add(Command::CommandType Type);
+
+	/* Makes the DrawDebug calls and on-screen messages for the recorded commands.  The only part that needs the engine, in ARDebugDrawOutput.cpp. */
+	void Draw(UWorld* World) const;
+
+	uint32 EnabledCategories;
+
+	TArray<Command> Commands;
+};
+
+#define AR_DEBUG_DRAW_IS_ENABLED(Category) ARDebugDraw::Get().IsEnabled(ARDebugCategory::Category)
+// statements (do/while) so they nest safely under an if/else
+#define AR_DEBUG_SPHERE(Category, Center, Radius, Color, ...) do { if (AR_DEBUG_DRAW_IS_ENABLED(Category)) { ARDebugDraw::Get().Sphere(ARDebugCategory::Category, Center, Radius, Color, ##__VA_ARGS__); } } while (0)
+#define AR_DEBUG_LINE(Category, Start, End, Color) do { if (AR_DEBUG_DRAW_IS_ENABLED(Category)) { ARDebugDraw::Get().Line(ARDebugCategory::Category, Start, End, Color); } } while (0)
+#define AR_DEBUG_CYLINDER(Category, Start, End, Radius, Color) do { if (AR_DEBUG_DRAW_IS_ENABLED(Category)) { ARDebugDraw::Get().Cylinder(ARDebugCategory::Category, Start, End, Radius, Color); } } while (0)
+#define AR_DEBUG_VALUE(Category, Label, InValue, ...) do { if (AR_DEBUG_DRAW_IS_ENABLED(Category)) { ARDebugDraw::Get().Value(ARDebugCategory::Category, TEXT(Label), InValue, ##__VA_ARGS__); } } while (0)
+#define AR_DEBUG_DRAW_FLUSH(World) ARDebugDraw::Get().Flush(World)
+
+#else
+
+#define AR_DEBUG_DRAW_IS_ENABLED(Category) false
+#define AR_DEBUG_SPHERE(Category, Center, Radius, Color, ...) do { } while (0)
+#define AR_DEBUG_LINE(Category, Start, End, Color) do { } while (0)
+#define AR_DEBUG_CYLINDER(Category, Start, End, Radius, Color) do { } while (0)
+#define AR_DEBUG_VALUE(Category, Label, InValue, ...) do { } while (0)
+#define AR_DEBUG_DRAW_FLUSH(World) do { } while (0)
+
+#endif
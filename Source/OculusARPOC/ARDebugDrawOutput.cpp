@@ -0,0 +1,65 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "ARDebugDraw.h"
+#include "ARTraceRecorder.h"
+
+#if AR_DEBUG_DRAW_ENABLED
+
+#include "DrawDebugHelpers.h"
+
+void ARDebugDraw::Draw(UWorld* World) const
+{
+	AR_TRACE_SCOPE("ARDebugDraw::Flush");
+	for (int32 i = 0; i < Commands.Num(); i++) {
+		const Command& Current = Commands[i];
+		switch (Current.Type) {
+		case Command::SphereCommand:
+			DrawDebugSphere(World, Current.A, Current.Radius, 12, Current.Color, false, Current.Seconds > 0.f ? Current.Seconds : -1.f);
+			break;
+		case Command::LineCommand:
+			DrawDebugLine(World, Current.A, Current.B, Current.Color);
+			break;
+		case Command::CylinderCommand:
+			DrawDebugCylinder(World, Current.A, Current.B, Current.Radius, 12, Current.Color);
+			break;
+		case Command::VectorValue:
+		case Command::RotatorValue:
+			if (GEngine) {
+				FString Text = Current.Type == Command::VectorValue
+					? FString::Printf(TEXT("%s: %s"), Current.Label, *Current.A.ToCompactString())
+					: FString::Printf(TEXT("%s: %s"), Current.Label, *FRotator(Current.A.X, Current.A.Y, Current.A.Z).ToCompactString());
+				// keyed by the label, so the line is replaced rather than a new message added every frame
+				GEngine->AddOnScreenDebugMessage((int32)PointerHash(Current.Label), Current.Seconds > 0.f ? Current.Seconds : ValueDisplaySeconds, Current.Color, Text);
+			}
+			break;
+		}
+	}
+}
+
+#endif
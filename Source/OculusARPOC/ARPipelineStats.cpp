@@ -0,0 +1,80 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "ARPipelineStats.h"
+
+ARPipelineStats& ARPipelineStats::Get()
+{
+	static ARPipelineStats Stats;
+	return Stats;
+}
+
+ARPipelineStats::ARPipelineStats()
+{
+	for (int32 i = 0; i < NumStats; i++) {
+		Set((Stat)i, 0.f);
+	}
+	double Never = -1.0;
+	for (int32 i = 0; i < NumTimestamps; i++) {
+		Timestamps[i] = *(int64*)&Never;
+	}
+}
+
+float ARPipelineStats::GetAge(Timestamp Which, double Now) const
+{
+	int64 Bits = Timestamps[Which];
+	double Seconds = *(double*)&Bits;
+	return Seconds < 0.0 ? -1.f : (float)(Now - Seconds);
+}
+
+void ARPipelineStats::GetSnapshot(ARPipelineStatsSnapshot& OutSnapshot) const
+{
+	OutSnapshot.CaptureFps = GetValue(CaptureFps);
+	OutSnapshot.CaptureMs = GetValue(CaptureMs);
+	OutSnapshot.ConvertMs = GetValue(ConvertMs);
+	OutSnapshot.DetectGreyMs = GetValue(DetectGreyMs);
+	OutSnapshot.DetectThresholdMs = GetValue(DetectThresholdMs);
+	OutSnapshot.DetectRectanglesMs = GetValue(DetectRectanglesMs);
+	OutSnapshot.DetectIdentifyMs = GetValue(DetectIdentifyMs);
+	OutSnapshot.DetectRefinementMs = GetValue(DetectRefinementMs);
+	OutSnapshot.PoseMs = GetValue(PoseMs);
+	OutSnapshot.DetectionTotalMs = GetValue(DetectionTotalMs);
+	OutSnapshot.CandidatesPerFrame = GetValue(CandidatesPerFrame);
+	OutSnapshot.MarkersTracked = GetValue(MarkersTracked);
+	OutSnapshot.DroppedFrames = GetValue(DroppedFrames);
+	OutSnapshot.TextureUploadMs = GetValue(TextureUploadMs);
+	OutSnapshot.DetectionQualityLevel = GetValue(DetectionQualityLevel);
+	OutSnapshot.PlaneReprojectionError = GetValue(PlaneReprojectionError);
+	OutSnapshot.LeapInputLatencyMs = GetValue(LeapInputLatencyMs);
+	OutSnapshot.UIEventsGenerated = GetValue(UIEventsGenerated);
+	OutSnapshot.UIEventsDispatched = GetValue(UIEventsDispatched);
+	double Now = FPlatformTime::Seconds();
+	OutSnapshot.PoseAgeSeconds = GetAge(LastPoseTime, Now);
+	OutSnapshot.LeapFrameAgeSeconds = GetAge(LastLeapFrameTime, Now);
+}
@@ -0,0 +1,132 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+/**
+ * Plain copy of the pipeline counters, taken by ARPipelineStats::GetSnapshot().
+ */
+struct ARPipelineStatsSnapshot
+{
+	float CaptureFps;
+	float CaptureMs;
+	float ConvertMs;
+	float DetectGreyMs;
+	float DetectThresholdMs;
+	float DetectRectanglesMs;
+	float DetectIdentifyMs;
+	float DetectRefinementMs;
+	float PoseMs;
+	float DetectionTotalMs;
+	float CandidatesPerFrame;
+	float MarkersTracked;
+	float DroppedFrames;
+	float TextureUploadMs;
+	float DetectionQualityLevel;
+	float PlaneReprojectionError;
+	float LeapInputLatencyMs;
+	float UIEventsGenerated;
+	float UIEventsDispatched;
+
+	// ages in seconds, -1 if the event never happened
+	float PoseAgeSeconds;
+	float LeapFrameAgeSeconds;
+};
+
+/**
+ * Lock-free health counters for the AR pipeline.
+ * Producers (capture, detection, Leap, render thread upload) overwrite individual values with single atomic stores,
+ * so publishing costs a store per value and readers never block a producer.  A snapshot can mix values from
+ * consecutive frames, which is fine for display purposes.
+ */
+class ARPipelineStats
+{
+public:
+
+	enum Stat
+	{
+		CaptureFps,
+		CaptureMs,
+		ConvertMs,
+		DetectGreyMs,
+		DetectThresholdMs,
+		DetectRectanglesMs,
+		DetectIdentifyMs,
+		DetectRefinementMs,
+		PoseMs,
+		DetectionTotalMs,
+		CandidatesPerFrame,
+		MarkersTracked,
+		DroppedFrames,
+		TextureUploadMs,
+		DetectionQualityLevel,
+		PlaneReprojectionError,
+		LeapInputLatencyMs,
+		UIEventsGenerated, // mouse events queued for the UI views since startup, before coalescing (see UIInputDispatcher)
+		UIEventsDispatched, // and forwarded to them
+		NumStats
+	};
+
+	enum Timestamp
+	{
+		LastPoseTime,
+		LastLeapFrameTime,
+		NumTimestamps
+	};
+
+	static ARPipelineStats& Get();
+
+	FORCEINLINE void Set(Stat Which, float Value)
+	{
+		FPlatformAtomics::InterlockedExchange(&Values[Which], *(int32*)&Value);
+	}
+
+	FORCEINLINE float GetValue(Stat Which) const
+	{
+		int32 Bits = Values[Which];
+		return *(float*)&Bits;
+	}
+
+	/* Records FPlatformTime::Seconds() as the time of the event */
+	FORCEINLINE void MarkNow(Timestamp Which)
+	{
+		double Now = FPlatformTime::Seconds();
+		FPlatformAtomics::InterlockedExchange(&Timestamps[Which], *(int64*)&Now);
+	}
+
+	void GetSnapshot(ARPipelineStatsSnapshot& OutSnapshot) const;
+
+private:
+
+	ARPipelineStats();
+
+	float GetAge(Timestamp Which, double Now) const;
+
+	volatile int32 Values[NumStats];
+	volatile int64 Timestamps[NumTimestamps];
+};
@@ -0,0 +1,142 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "Engine.h"
+#include "ARSubsystemInitializer.h"
+#include "ARTraceRecorder.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogARSubsystems, Log, All);
+
+ARSubsystemInitializer::ARSubsystemInitializer(IVideoSource* videoSource, ArucoMarkerDetector* markerDetector)
+{
+	this->VideoSource = videoSource;
+	this->MarkerDetector = markerDetector;
+	LeapController = NULL;
+	StartSeconds = 0.0;
+	Timeouts[Camera] = 10.f;
+	Timeouts[Calibration] = 5.f;
+	Timeouts[LeapService] = 5.f;
+	for (int32 i = 0; i < NumSubsystems; i++) {
+		States[i] = Pending;
+		ReportedStates[i] = Pending;
+		Tasks[i] = NULL;
+		Threads[i] = NULL;
+	}
+}
+
+ARSubsystemInitializer::~ARSubsystemInitializer()
+{
+	for (int32 i = 0; i < NumSubsystems; i++) {
+		if (Threads[i] != NULL) {
+			Threads[i]->WaitForCompletion();
+			delete Threads[i];
+			delete Tasks[i];
+		}
+	}
+	// the controller is owned by whoever took it once it was ready
+}
+
+const TCHAR* ARSubsystemInitializer::GetSubsystemName(Subsystem Which)
+{
+	switch (Which) {
+	case Camera: return TEXT("Camera");
+	case Calibration: return TEXT("Calibration");
+	case LeapService: return TEXT("Leap");
+	default: return TEXT("Unknown");
+	}
+}
+
+const TCHAR* ARSubsystemInitializer::GetStateName(State Which)
+{
+	switch (Which) {
+	case Pending: return TEXT("Pending");
+	case Initializing: return TEXT("Initializing");
+	case Ready: return TEXT("Ready");
+	case Failed: return TEXT("Failed");
+	case TimedOut: return TEXT("TimedOut");
+	default: return TEXT("Unknown");
+	}
+}
+
+void ARSubsystemInitializer::Start()
+{
+	StartSeconds = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumSubsystems; i++) {
+		FPlatformAtomics::InterlockedExchange(&States[i], Initializing);
+		Tasks[i] = new InitTask(this, (Subsystem)i);
+		Threads[i] = FRunnableThread::Create(Tasks[i], *FString::Printf(TEXT("ARInit%s"), GetSubsystemName((Subsystem)i)), 0, TPri_BelowNormal);
+	}
+}
+
+uint32 ARSubsystemInitializer::InitTask::Run()
+{
+	bool Succeeded = Owner->InitializeSubsystem(Which);
+	// full barrier: everything the subsystem initialized is visible before the game thread can observe Ready
+	FPlatformAtomics::InterlockedExchange(&Owner->States[Which], Succeeded ? Ready : Failed);
+	return 0;
+}
+
+bool ARSubsystemInitializer::InitializeSubsystem(Subsystem Which)
+{
+	switch (Which) {
+	case Camera: {
+		AR_TRACE_SCOPE("InitCamera");
+		return VideoSource->Init();
+	}
+	case Calibration: {
+		AR_TRACE_SCOPE("InitCalibration");
+		return MarkerDetector->Init();
+	}
+	case LeapService: {
+		AR_TRACE_SCOPE("InitLeap");
+		LeapController = new Leap::Controller();
+		LeapController->setPolicy(Leap::Controller::POLICY_OPTIMIZE_HMD);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+void ARSubsystemInitializer::Update()
+{
+	double Elapsed = FPlatformTime::Seconds() - StartSeconds;
+	for (int32 i = 0; i < NumSubsystems; i++) {
+		if (Elapsed > Timeouts[i]) {
+			FPlatformAtomics::InterlockedCompareExchange(&States[i], TimedOut, Initializing);
+		}
+		State Current = GetState((Subsystem)i);
+		if (Current == ReportedStates[i]) continue;
+		ReportedStates[i] = Current;
+		UE_LOG(LogARSubsystems, Log, TEXT("%s: %s after %.2f s"), GetSubsystemName((Subsystem)i), GetStateName(Current), Elapsed);
+		if (Current == Failed || Current == TimedOut) {
+			GEngine->AddOnScreenDebugMessage(-1, 10.0f, FColor::Red, FString(GetSubsystemName((Subsystem)i)) + TEXT(" ") + (Current == Failed ? TEXT("failed to initialize") : TEXT("is taking too long to initialize")));
+		}
+	}
+}
@@ -0,0 +1,124 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+#include "Leap.h"
+#include "IVideoSource.h"
+#include "ArucoMarkerDetector.h"
+
+/**
+ * Brings up the slow AR subsystems (opening the camera, loading the calibration, connecting to the Leap service)
+ * on background threads so BeginPlay returns immediately.  Each subsystem goes Pending -> Initializing -> Ready or Failed;
+ * Update() marks a subsystem TimedOut once it is overdue, which is reported but doesn't stop it from becoming
+ * Ready later (a slow webcam is still worth having).
+ * A subsystem's objects must not be touched by the game thread until its state is Ready.
+ */
+class ARSubsystemInitializer
+{
+public:
+
+	enum Subsystem
+	{
+		Camera,
+		Calibration,
+		LeapService,
+		NumSubsystems
+	};
+
+	enum State
+	{
+		Pending,
+		Initializing,
+		Ready,
+		Failed,
+		TimedOut
+	};
+
+	/*
+	 VideoSource and MarkerDetector are configured by the caller and initialized here; the Leap::Controller is created here.
+	 */
+	ARSubsystemInitializer(IVideoSource* VideoSource, ArucoMarkerDetector* MarkerDetector);
+
+	/*
+	 Waits for any subsystem still initializing.
+	 */
+	~ARSubsystemInitializer();
+
+	void Start();
+
+	/*
+	 Game thread, once per tick: applies timeouts and reports state changes.
+	 */
+	void Update();
+
+	State GetState(Subsystem Which) const { return (State)States[Which]; }
+
+	bool IsReady(Subsystem Which) const { return GetState(Which) == Ready; }
+
+	/* Valid once LeapService is Ready */
+	Leap::Controller* GetLeapController() const { return LeapController; }
+
+	static const TCHAR* GetSubsystemName(Subsystem Which);
+
+	static const TCHAR* GetStateName(State Which);
+
+	// seconds after Start before a subsystem that is still initializing is reported as TimedOut
+	float Timeouts[NumSubsystems];
+
+private:
+
+	class InitTask : public FRunnable
+	{
+	public:
+		InitTask(ARSubsystemInitializer* Owner, Subsystem Which) : Owner(Owner), Which(Which) {}
+		virtual uint32 Run() override;
+	private:
+		ARSubsystemInitializer* Owner;
+		Subsystem Which;
+	};
+
+	/* Runs on the subsystem's thread */
+	bool InitializeSubsystem(Subsystem Which);
+
+	IVideoSource* VideoSource;
+
+	ArucoMarkerDetector* MarkerDetector;
+
+	Leap::Controller* LeapController;
+
+	volatile int32 States[NumSubsystems];
+
+	State ReportedStates[NumSubsystems]; // last state logged by Update
+
+	double StartSeconds;
+
+	InitTask* Tasks[NumSubsystems];
+
+	FRunnableThread* Threads[NumSubsystems];
+};
@@ -0,0 +1,237 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "ARTraceRecorder.h"
+
+#if AR_TRACE_ENABLED
+
+ARTraceThreadBuffer::ARTraceThreadBuffer(uint32 threadId, const FString& threadName)
+{
+	WriteIndex = 0;
+	ReadIndex = 0;
+	DroppedEvents = 0;
+	ThreadId = threadId;
+	ThreadName = threadName;
+}
+
+ARTraceRecorder& ARTraceRecorder::Get()
+{
+	static ARTraceRecorder Recorder;
+	return Recorder;
+}
+
+ARTraceRecorder::ARTraceRecorder()
+{
+	Recording = 0;
+	SessionStartSeconds = 0.0;
+	TlsSlot = FPlatformTLS::AllocTlsSlot();
+	Worker = nullptr;
+	WorkerThread = nullptr;
+}
+
+ARTraceRecorder::~ARTraceRecorder()
+{
+	if (WorkerThread != nullptr) {
+		WorkerThread->Kill(true);
+		delete WorkerThread;
+		delete Worker;
+	}
+	for (int32 i = 0; i < ThreadBuffers.Num(); i++) {
+		delete ThreadBuffers[i];
+	}
+	FPlatformTLS::FreeTlsSlot(TlsSlot);
+}
+
+void ARTraceRecorder::Start()
+{
+	if (IsRecording()) return;
+	{
+		FScopeLock Lock(&ThreadBuffersLock);
+		for (int32 i = 0; i < ThreadBuffers.Num(); i++) { // drop anything left over from a previous session
+			ThreadBuffers[i]->ReadIndex = ThreadBuffers[i]->WriteIndex;
+			ThreadBuffers[i]->DroppedEvents = 0;
+		}
+	}
+	{
+		FScopeLock Lock(&FlushLock);
+		FlushedEvents.Reset();
+	}
+	SessionStartSeconds = FPlatformTime::Seconds();
+	Worker = new FlushWorker(this);
+	WorkerThread = FRunnableThread::Create(Worker, TEXT("ARTraceFlush"), 0, TPri_BelowNormal);
+	FPlatformAtomics::InterlockedExchange(&Recording, 1);
+}
+
+bool ARTraceRecorder::StopAndExport(const FString& FilePath)
+{
+	if (!IsRecording()) return false;
+	FPlatformAtomics::InterlockedExchange(&Recording, 0);
+	if (WorkerThread != nullptr) {
+		Worker->Stop();
+		WorkerThread->WaitForCompletion();
+		delete WorkerThread;
+		delete Worker;
+		WorkerThread = nullptr;
+		Worker = nullptr;
+	}
+	Flush(); // pick up whatever was recorded after the last background flush
+	return WriteChromeTrace(FilePath);
+}
+
+void ARTraceRecorder::RecordZone(const TCHAR* Name, double StartSeconds, double EndSeconds)
+{
+	if (!IsRecording()) return;
+	ARTraceEvent Event;
+	Event.Name = Name;
+	Event.StartSeconds = StartSeconds;
+	Event.EndSeconds = EndSeconds;
+	Event.Type = ARTraceEvent::Zone;
+	Push(Event);
+}
+
+void ARTraceRecorder::RecordCounter(const TCHAR* Name, double Value)
+{
+	if (!IsRecording()) return;
+	ARTraceEvent Event;
+	Event.Name = Name;
+	Event.StartSeconds = FPlatformTime::Seconds();
+	Event.EndSeconds = Value;
+	Event.Type = ARTraceEvent::Counter;
+	Push(Event);
+}
+
+void ARTraceRecorder::SetCurrentThreadName(const TCHAR* Name)
+{
+	GetThreadBuffer()->ThreadName = Name;
+}
+
+ARTraceThreadBuffer* ARTraceRecorder::GetThreadBuffer()
+{
+	ARTraceThreadBuffer* Buffer = (ARTraceThreadBuffer*)FPlatformTLS::GetTlsValue(TlsSlot);
+	if (Buffer == nullptr) {
+		uint32 ThreadId = FPlatformTLS::GetCurrentThreadId();
+		FString ThreadName;
+		if (IsInGameThread()) {
+			ThreadName = TEXT("GameThread");
+		}
+		else if (IsInRenderingThread()) {
+			ThreadName = TEXT("RenderThread");
+		}
+		else {
+			ThreadName = FString::Printf(TEXT("Thread %u"), ThreadId);
+		}
+		Buffer = new ARTraceThreadBuffer(ThreadId, ThreadName);
+		FPlatformTLS::SetTlsValue(TlsSlot, Buffer);
+		FScopeLock Lock(&ThreadBuffersLock);
+		ThreadBuffers.Add(Buffer);
+	}
+	return Buffer;
+}
+
+void ARTraceRecorder::Push(const ARTraceEvent& Event)
+{
+	ARTraceThreadBuffer* Buffer = GetThreadBuffer();
+	int32 Write = Buffer->WriteIndex;
+	if (Write - Buffer->ReadIndex >= ARTraceThreadBuffer::Capacity) { // flush thread fell behind, drop rather than block
+		FPlatformAtomics::InterlockedIncrement(&Buffer->DroppedEvents);
+		return;
+	}
+	Buffer->Events[Write & (ARTraceThreadBuffer::Capacity - 1)] = Event;
+	FPlatformMisc::MemoryBarrier(); // publish the event before the index
+	Buffer->WriteIndex = Write + 1;
+}
+
+void ARTraceRecorder::Flush()
+{
+	// copy the buffer list so producers registering new threads are never blocked behind a flush
+	TArray<ARTraceThreadBuffer*> Buffers;
+	{
+		FScopeLock Lock(&ThreadBuffersLock);
+		Buffers = ThreadBuffers;
+	}
+	FScopeLock Lock(&FlushLock);
+	for (int32 i = 0; i < Buffers.Num(); i++) {
+		ARTraceThreadBuffer* Buffer = Buffers[i];
+		int32 Write = Buffer->WriteIndex;
+		FPlatformMisc::MemoryBarrier();
+		int32 Read = Buffer->ReadIndex;
+		for (; Read != Write; Read++) {
+			FlushedEvent Flushed;
+			Flushed.Event = Buffer->Events[Read & (ARTraceThreadBuffer::Capacity - 1)];
+			Flushed.ThreadId = Buffer->ThreadId;
+			FlushedEvents.Add(Flushed);
+		}
+		FPlatformMisc::MemoryBarrier();
+		Buffer->ReadIndex = Read;
+	}
+}
+
+uint32 ARTraceRecorder::FlushWorker::Run()
+{
+	while (StopRequested.GetValue() == 0) {
+		Recorder->Flush();
+		FPlatformProcess::Sleep(0.005f);
+	}
+	return 0;
+}
+
+bool ARTraceRecorder::WriteChromeTrace(const FString& FilePath)
+{
+	// timestamps are in microseconds relative to the start of the session, as expected by the trace viewer
+	FString Json;
+	Json.Reserve(FlushedEvents.Num() * 96 + 1024);
+	Json += TEXT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	{
+		FScopeLock Lock(&ThreadBuffersLock);
+		for (int32 i = 0; i < ThreadBuffers.Num(); i++) {
+			Json += FString::Printf(TEXT("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n"),
+				ThreadBuffers[i]->ThreadId, *ThreadBuffers[i]->ThreadName);
+			if (ThreadBuffers[i]->DroppedEvents > 0) {
+				UE_LOG(LogTemp, Warning, TEXT("ARTraceRecorder: %d events dropped on %s"), ThreadBuffers[i]->DroppedEvents, *ThreadBuffers[i]->ThreadName);
+			}
+		}
+	}
+	FScopeLock Lock(&FlushLock);
+	for (int32 i = 0; i < FlushedEvents.Num(); i++) {
+		const ARTraceEvent& Event = FlushedEvents[i].Event;
+		double Timestamp = (Event.StartSeconds - SessionStartSeconds) * 1000000.0;
+		if (Event.Type == ARTraceEvent::Zone) {
+			Json += FString::Printf(TEXT("{\"name\":\"%s\",\"cat\":\"AR\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n"),
+				Event.Name, FlushedEvents[i].ThreadId, Timestamp, (Event.EndSeconds - Event.StartSeconds) * 1000000.0);
+		}
+		else {
+			Json += FString::Printf(TEXT("{\"name\":\"%s\",\"cat\":\"AR\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%f}},\n"),
+				Event.Name, FlushedEvents[i].ThreadId, Timestamp, Event.EndSeconds);
+		}
+	}
+	Json += TEXT("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"OculusARPOC\"}}\n]}\n");
+	return FFileHelper::SaveStringToFile(Json, *FilePath);
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+/*
+ Tracing is compiled out of shipping builds entirely.  Zones are recorded into per-thread ring buffers
+ (single producer, single consumer) and drained by a background thread, so a zone costs two timer reads and a
+ couple of stores on the hot path.  The session is exported in the Chrome trace JSON format, which can be opened
+ directly in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ */
+#define AR_TRACE_ENABLED !UE_BUILD_SHIPPING
+
+#if AR_TRACE_ENABLED
+
+/**
+ * A single recorded event.  Names must be string literals (or otherwise outlive the recording session).
+ */
+struct ARTraceEvent
+{
+	enum EventType : uint8 { Zone, Counter };
+
+	const TCHAR* Name;
+	double StartSeconds;
+	double EndSeconds;  // for counters this holds the counter value
+	EventType Type;
+};
+
+/**
+ * Per-thread ring buffer.  Only the owning thread writes, only the flush thread reads.
+ */
+struct ARTraceThreadBuffer
+{
+	static const int32 Capacity = 8192;
+
+	ARTraceEvent Events[Capacity];
+	volatile int32 WriteIndex;
+	volatile int32 ReadIndex;
+	volatile int32 DroppedEvents;
+	uint32 ThreadId;
+	FString ThreadName;
+
+	ARTraceThreadBuffer(uint32 threadId, const FString& threadName);
+};
+
+/**
+ * Thread-aware event recorder for the AR frame pipeline (capture, detection, pose, Leap, raytrace, texture upload).
+ */
+class ARTraceRecorder
+{
+public:
+
+	static ARTraceRecorder& Get();
+
+	/*
+	 Starts a new recording session, discarding anything recorded before.
+	 */
+	void Start();
+
+	/*
+	 Stops the session and writes it to FilePath in Chrome trace JSON format.  Returns false if the file could not be written.
+	 */
+	bool StopAndExport(const FString& FilePath);
+
+	bool IsRecording() const { return Recording != 0; }
+
+	void RecordZone(const TCHAR* Name, double StartSeconds, double EndSeconds);
+
+	void RecordCounter(const TCHAR* Name, double Value);
+
+	/*
+	 Optional human readable name for the calling thread (shown as the track name in Perfetto).
+	 */
+	void SetCurrentThreadName(const TCHAR* Name);
+
+private:
+
+	ARTraceRecorder();
+	~ARTraceRecorder();
+
+	ARTraceThreadBuffer* GetThreadBuffer();
+
+	void Push(const ARTraceEvent& Event);
+
+	/* Drains all thread buffers into FlushedEvents.  Called from the flush thread, and once more after it stops. */
+	void Flush();
+
+	bool WriteChromeTrace(const FString& FilePath);
+
+	struct FlushedEvent
+	{
+		ARTraceEvent Event;
+		uint32 ThreadId;
+	};
+
+	class FlushWorker : public FRunnable
+	{
+	public:
+		FlushWorker(ARTraceRecorder* Recorder) : Recorder(Recorder), StopRequested(0) {}
+		virtual uint32 Run() override;
+		virtual void Stop() override { StopRequested.Increment(); }
+	private:
+		ARTraceRecorder* Recorder;
+		FThreadSafeCounter StopRequested;
+	};
+
+	volatile int32 Recording;
+	double SessionStartSeconds;
+	uint32 TlsSlot;
+
+	FCriticalSection ThreadBuffersLock;
+	TArray<ARTraceThreadBuffer*> ThreadBuffers;
+
+	FCriticalSection FlushLock;
+	TArray<FlushedEvent> FlushedEvents;
+
+	FlushWorker* Worker;
+	FRunnableThread* WorkerThread;
+};
+
+/**
+ * Records the enclosing scope as a zone on the calling thread's track.
+ */
+class ARTraceScope
+{
+public:
+	FORCEINLINE ARTraceScope(const TCHAR* name)
+		: Name(name)
+		, StartSeconds(ARTraceRecorder::Get().IsRecording() ? FPlatformTime::Seconds() : -1.0)
+	{
+	}
+
+	FORCEINLINE ~ARTraceScope()
+	{
+		if (StartSeconds >= 0.0)
+		{
+			ARTraceRecorder::Get().RecordZone(Name, StartSeconds, FPlatformTime::Seconds());
+		}
+	}
+
+private:
+	const TCHAR* Name;
+	double StartSeconds;
+};
+
+#define AR_TRACE_SCOPE(Name) ARTraceScope PREPROCESSOR_JOIN(ARTraceScope_, __LINE__)(TEXT(Name))
+#define AR_TRACE_COUNTER(Name, Value) do { if (ARTraceRecorder::Get().IsRecording()) { ARTraceRecorder::Get().RecordCounter(TEXT(Name), (double)(Value)); } } while (0)
+#define AR_TRACE_THREAD_NAME(Name) ARTraceRecorder::Get().SetCurrentThreadName(TEXT(Name))
+
+#else
+
+#define AR_TRACE_SCOPE(Name)
+#define AR_TRACE_COUNTER(Name, Value) do { } while (0)
+#define AR_TRACE_THREAD_NAME(Name)
+
+#endif
@@ -0,0 +1,104 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "ActorPool.h"
+
+ActorPool::ActorPool()
+{
+	SpawnMisses = 0;
+}
+
+void ActorPool::RemoveDestroyed(TArray<TWeakObjectPtr<AActor> >& Actors)
+{
+	for (int32 i = Actors.Num() - 1; i >= 0; i--) {
+		if (!Actors[i].IsValid()) {
+			Actors.RemoveAtSwap(i);
+		}
+	}
+}
+
+void ActorPool::Prewarm(UWorld* World, UClass* Class, int32 Count, APawn* Instigator)
+{
+	if (World == NULL || Class == NULL) return;
+	TArray<TWeakObjectPtr<AActor> >& Free = FreeActors.FindOrAdd(Class);
+	RemoveDestroyed(Free); // so they are replaced
+	while (Free.Num() < Count) {
+		AActor* Actor = Spawn(World, Class, FVector::ZeroVector, FRotator::ZeroRotator, Instigator);
+		if (Actor == NULL) break;
+		Deactivate(Actor);
+		Free.Add(Actor);
+	}
+}
+
+AActor* ActorPool::Acquire(UWorld* World, UClass* Class, const FVector& Location, const FRotator& Rotation, APawn* Instigator)
+{
+	if (World == NULL || Class == NULL) return NULL;
+	AActor* Actor = NULL;
+	TArray<TWeakObjectPtr<AActor> >* Free = FreeActors.Find(Class);
+	while (Actor == NULL && Free != NULL && Free->Num() > 0) {
+		Actor = Free->Pop().Get(); // NULL if it was destroyed behind the pool's back
+	}
+	if (Actor != NULL) {
+		Activate(Actor, Location, Rotation);
+	}
+	else {
+		Actor = Spawn(World, Class, Location, Rotation, Instigator);
+		if (Actor == NULL) return NULL;
+		SpawnMisses++;
+	}
+	ActiveActors.Add(Actor);
+	return Actor;
+}
+
+void ActorPool::Release(AActor* Actor)
+{
+	if (Actor == NULL) return;
+	RemoveDestroyed(ActiveActors); // destroyed while in use, Actor included
+	int32 Index = ActiveActors.Find(Actor);
+	if (Index == INDEX_NONE) return;
+	ActiveActors.RemoveAtSwap(Index);
+	Deactivate(Actor);
+	FreeActors.FindOrAdd(Actor->GetClass()).Add(Actor);
+}
+
+void ActorPool::Empty()
+{
+	FreeActors.Empty();
+	ActiveActors.Empty();
+}
+
+int32 ActorPool::GetNumFree(UClass* Class) const
+{
+	const TArray<TWeakObjectPtr<AActor> >* Free = FreeActors.Find(Class);
+	if (Free == NULL) return 0;
+	int32 Num = 0;
+	for (int32 i = 0; i < Free->Num(); i++) {
+		if ((*Free)[i].IsValid()) Num++;
+	}
+	return Num;
+}
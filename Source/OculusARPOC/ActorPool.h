@@ -0,0 +1,78 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+/**
+ * Pool of spawned actors, keyed by (blueprint) class, so actors that come and go with the markers or the user's windows
+ * are recycled instead of spawned and destroyed: spawning a Coherent UI view or a mesh hitches the HMD.
+ * Free actors stay in the world hidden, without collision and without ticking.  Prewarm spawns them up front, Acquire
+ * takes a free one (spawning only if there is none) and Release hands one back.  UI surfaces are reset as they go in
+ * and out of the pool (see AUISurfaceActor::OnAcquiredFromPool / OnReleasedToPool).
+ * The bookkeeping is in ActorPool.cpp; Spawn, Activate and Deactivate, which act on the actors, are in ActorPoolActors.cpp.
+ */
+class ActorPool
+{
+public:
+
+	ActorPool();
+
+	/* Spawns free actors of Class until there are at least Count */
+	void Prewarm(UWorld* World, UClass* Class, int32 Count, APawn* Instigator);
+
+	/* A free actor of Class moved to Location and Rotation and made visible, or a newly spawned one.  NULL if spawning fails. */
+	AActor* Acquire(UWorld* World, UClass* Class, const FVector& Location, const FRotator& Rotation, APawn* Instigator);
+
+	/* Hides Actor and keeps it for the next Acquire of its class.  Actors the pool didn't hand out are ignored. */
+	void Release(AActor* Actor);
+
+	/* Forgets all actors (the world destroys them) */
+	void Empty();
+
+	int32 GetNumFree(UClass* Class) const;
+
+	/* Actors spawned because the pool had no free one of the class */
+	int32 GetNumSpawnMisses() const { return SpawnMisses; }
+
+private:
+
+	static AActor* Spawn(UWorld* World, UClass* Class, const FVector& Location, const FRotator& Rotation, APawn* Instigator);
+
+	/* Moves a free actor to Location and Rotation and makes it visible */
+	static void Activate(AActor* Actor, const FVector& Location, const FRotator& Rotation);
+
+	static void Deactivate(AActor* Actor);
+
+	static void RemoveDestroyed(TArray<TWeakObjectPtr<AActor> >& Actors);
+
+	// weak, so an actor destroyed behind the pool's back (level streaming, Blueprint DestroyActor) is never handed out
+	TMap<UClass*, TArray<TWeakObjectPtr<AActor> > > FreeActors;
+
+	TArray<TWeakObjectPtr<AActor> > ActiveActors;
+
+	int32 SpawnMisses;
+};
@@ -7,23 +7,25 @@
 #include "opencv2/imgproc/imgproc.hpp"
 #include "aruco/aruco.h"
 #include "ArucoMarkerDetector.h"
+#include "ARTraceRecorder.h"
+#include "ARPipelineStats.h"
+#include "CalibrationCache.h"
 
 ArucoMarkerDetector::ArucoMarkerDetector()
 {
     DetectMarkers = false;
 	DetectSingleMarkerId = -1;
     DetectBoard = false;
+    CameraCalibrationFile = TEXT("camera.yml");
+    BoardConfigurationFiles.Add(TEXT("board_meters.yml"));
+    Boards.SetReprojectionThreshold(4.f); // pixels; enables robust board pose estimation with outlier markers rejected
     MarkersAreDetected = false;
 	Detected = false;
-	PlaneMarker1Id = -1;
-	PlaneMarker2Id = -1;
-	PlaneMarker3Id = -1;
-	PlaneMarker4Id = -1;
-	PlaneMarker1Translation = FVector::ZeroVector;
-	PlaneMarker2Translation = FVector::ZeroVector;
-	PlaneMarker3Translation = FVector::ZeroVector;
-	PlaneMarker4Translation = FVector::ZeroVector;
+	DetectionFrameTime = 0.0;
+	DetectPlaneMarkers = false;
+	BuildMarkerMap = false;
 	UseAveragePlaneMarkerRoll = false;
+	AveragePlaneMarkerRoll = 0.f;
 }
 
 ArucoMarkerDetector::~ArucoMarkerDetector()
@@ -31,145 +33,201 @@ ArucoMarkerDetector::~ArucoMarkerDetector()
 }
 
 cv::vector<aruco::Marker>* ArucoMarkerDetector::GetDetectedMarkers() {
+    aruco::toMarkers(DetectedRecords, DetectedMarkers); // converting into the markers of the last call reuses their memory
     return &DetectedMarkers;
 }
 
 aruco::Board* ArucoMarkerDetector::GetDetectedBoard() {
-    return &DetectedBoard;
+    int32 Board = GetBoardIndex(0);
+    return Board >= 0 ? &Boards.GetDetectedBoard(Board) : NULL;
+}
+
+int32 ArucoMarkerDetector::GetBoardIndex(int32 BoardFile) const {
+    return BoardIndices.IsValidIndex(BoardFile) ? BoardIndices[BoardFile] : -1;
 }
 
 bool ArucoMarkerDetector::IsDetected() {
 	return Detected;
 }
 
-void ArucoMarkerDetector::Init() {
-    GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("About to read YAML file"));
-    CameraParams.readFromXMLFile("D:/Projects/OculusARPOC/Config/camera.yml");
-    GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("Read YAML file!!"));
-    CameraParams.resize(cv::Size(1280, 720));
-    BoardConfig.readFromFile("D:/Projects/OculusARPOC/Config/board_meters.yml");
+bool ArucoMarkerDetector::Init() {
+    InitErrors.Reset();
+    QualityController.SetMarkerDetector(&MarkerDetector);
+    FString ConfigDir = FPaths::GameConfigDir();
+    bool UseBoards = DetectBoard && BoardConfigurationFiles.Num() > 0;
+    FString BoardFile = UseBoards ? ConfigDir / BoardConfigurationFiles[0] : FString();
+    aruco::BoardConfiguration BoardConfig;
+    if (!CalibrationCache::Load(ConfigDir / CameraCalibrationFile, BoardFile, CameraParams, BoardConfig)) {
+        InitErrors.Add(TEXT("Could not load camera calibration ") + CameraCalibrationFile + TEXT(", marker detection disabled"));
+        return false;
+    }
+    Boards.ClearBoards();
+    BoardIndices.Init(-1, BoardConfigurationFiles.Num()); // boards that don't load would shift the ones after them
+    if (UseBoards) {
+        BoardIndices[0] = Boards.AddBoard(BoardConfig, 0.034f);
+        for (int32 i = 1; i < BoardConfigurationFiles.Num(); i++) {
+            try {
+                BoardConfig.readFromFile(TCHAR_TO_UTF8(*(ConfigDir / BoardConfigurationFiles[i])));
+                BoardIndices[i] = Boards.AddBoard(BoardConfig, 0.034f);
+            }
+            catch (cv::Exception&) {
+                InitErrors.Add(TEXT("Could not load board configuration ") + BoardConfigurationFiles[i]);
+            }
+        }
+    }
+    return true;
 	
 }
 
 void ArucoMarkerDetector::ProcessMarkerDetection(cv::Mat Frame) {
+	AR_TRACE_SCOPE("ArucoMarkerDetector::ProcessMarkerDetection");
 	//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("In ProcessMarkerDetection"));
 	Detected = false;
-    if (DetectMarkers) {
+    if (DetectMarkers && CameraParams.isValid()) {
+		if (Frame.size() != CameraParams.CamSize) {
+			CameraParams.resize(Frame.size()); // intrinsics follow the detection resolution
+		}
 		//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("DetectMarkers is true"));
-		MarkerDetector.detect(Frame, this->DetectedMarkers); // don't calculate extrinsics - should be done based on marker id
-		uint16 numPlaneMarkersDetected = 0;
-		AveragePlaneMarkerRoll = 0.f;
-		for (uint16 i = 0; i < this->DetectedMarkers.size(); i++)
+		double DetectionStart = FPlatformTime::Seconds();
+		DetectionFrameTime = DetectionStart;
+		MarkerDetector.detect(Frame, this->DetectedRecords); // don't calculate extrinsics - should be done based on marker id
+		MarkerPoseTracker.newFrame();
+		double PoseStart = FPlatformTime::Seconds();
+		for (uint16 i = 0; i < this->DetectedRecords.size(); i++)
 		{
-			//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("Found Marker: ") + FString::FromInt(this->DetectedMarkers[i].id));
+			//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("Found Marker: ") + FString::FromInt(this->DetectedRecords[i].id));
 			float markerSize = 0.034;
-			int markerId = this->DetectedMarkers[i].id;
-			if (markerId == 666 || markerId == 683 || markerId == 775 || markerId == 819)  {
+			int markerId = this->DetectedRecords[i].id;
+			bool isPlaneMarker = this->DetectPlaneMarkers && PlaneEstimator.IsInGroup(markerId);
+			if (isPlaneMarker) {
+				markerSize = PlaneEstimator.GetMarkerSize();
+			}
+			else if (markerId == 666 || markerId == 683 || markerId == 775 || markerId == 819)  {
 				markerSize = 0.176;
 			}
-			this->DetectedMarkers[i].calculateExtrinsics(markerSize, CameraParams);
-			if (this->DetectedMarkers[i].id == DetectSingleMarkerId) {
+			// plane markers whose placement on the plane is known get their pose from the joint plane solve below
+			if (!isPlaneMarker || PlaneEstimator.NeedsMarkerPose(markerId)) {
+				AR_TRACE_SCOPE("MarkerPose");
+				this->DetectedRecords[i].calculateExtrinsics(markerSize, CameraParams, MarkerPoseTracker);
+			}
+			if (this->DetectedRecords[i].id == DetectSingleMarkerId) {
 				Detected = true;
 				//aruco::CvDrawingUtils::draw3dAxis(Frame, this->DetectedMarkers[i], CameraParams);
 			}
-			if (this->DetectPlaneMarkers) {
-				if (this->DetectedMarkers[i].id == PlaneMarker1Id) {
-					//aruco::CvDrawingUtils::draw3dAxis(Frame, this->DetectedMarkers[i], CameraParams);
-					PlaneMarker1Translation = GetVectorFromTVec(this->DetectedMarkers[i].Tvec);
-					//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("PlaneMarker1Translation: ") + PlaneMarker1Translation.ToCompactString());
-					PlaneMarker1Rotation = GetMarkerRotatorFromRVec(this->DetectedMarkers[i].Rvec);
-					AveragePlaneMarkerRoll += PlaneMarker1Rotation.Roll;
-					numPlaneMarkersDetected++;
-				}
-				else if (this->DetectedMarkers[i].id == PlaneMarker2Id) {
-					//aruco::CvDrawingUtils::draw3dAxis(Frame, this->DetectedMarkers[i], CameraParams);
-					PlaneMarker2Translation = GetVectorFromTVec(this->DetectedMarkers[i].Tvec);
-					//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("PlaneMarker2Translation: ") + PlaneMarker2Translation.ToCompactString());
-					PlaneMarker2Rotation = GetMarkerRotatorFromRVec(this->DetectedMarkers[i].Rvec);
-					AveragePlaneMarkerRoll += PlaneMarker2Rotation.Roll;
-					numPlaneMarkersDetected++;
-				}
-				else if (this->DetectedMarkers[i].id == PlaneMarker3Id) {
-					//aruco::CvDrawingUtils::draw3dAxis(Frame, this->DetectedMarkers[i], CameraParams);
-					PlaneMarker3Translation = GetVectorFromTVec(this->DetectedMarkers[i].Tvec);
-					//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("PlaneMarker3Translation: ") + PlaneMarker3Translation.ToCompactString());
-					PlaneMarker3Rotation = GetMarkerRotatorFromRVec(this->DetectedMarkers[i].Rvec);
-					AveragePlaneMarkerRoll += PlaneMarker3Rotation.Roll;
-					numPlaneMarkersDetected++;
-				}
-				else if (this->DetectedMarkers[i].id == PlaneMarker4Id) {
-					//aruco::CvDrawingUtils::draw3dAxis(Frame, this->DetectedMarkers[i], CameraParams);
-					PlaneMarker4Translation = GetVectorFromTVec(this->DetectedMarkers[i].Tvec);
-					//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("PlaneMarker4Translation: ") + PlaneMarker4Translation.ToCompactString());
-					PlaneMarker4Rotation = GetMarkerRotatorFromRVec(this->DetectedMarkers[i].Rvec);
-					AveragePlaneMarkerRoll += PlaneMarker4Rotation.Roll;
-					numPlaneMarkersDetected++;
-				}
-				//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("numPlaneMarkersDetected: ") + FString::FromInt(numPlaneMarkersDetected));
-			}
 			//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("Found Marker!!"));
-			this->DetectedMarkers[i].draw(Frame, cv::Scalar(0, 0, 255), 2);
 			//aruco::CvDrawingUtils::draw3dAxis(Frame,this->DetectedMarkers[i],CameraParams);
-			// TODO: put these calculated values into a hashmap
-			FVector TranslationVector(this->DetectedMarkers[i].Tvec.at<float>(0, 0), this->DetectedMarkers[i].Tvec.at<float>(1, 0), this->DetectedMarkers[i].Tvec.at<float>(2, 0));
-			FVector RotationVector(this->DetectedMarkers[i].Rvec.at<float>(0, 0), this->DetectedMarkers[i].Rvec.at<float>(1, 0), this->DetectedMarkers[i].Rvec.at<float>(2, 0));
-			//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("TranslationVector: ") + TranslationVector.ToString());
-			//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("RotationVector: ") + RotationVector.ToString());
 			//aruco::CvDrawingUtils::draw3dCube(Frame, this->DetectedMarkers[i], CameraParams); 
 		}
-		AveragePlaneMarkerRoll = AveragePlaneMarkerRoll / numPlaneMarkersDetected;
-		//GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("AveragePlaneMarkerRoll: ") + FString::SanitizeFloat(AveragePlaneMarkerRoll));
-		if (numPlaneMarkersDetected >= 3) {
-			Detected = true;
+		if (this->DetectPlaneMarkers) {
+			AR_TRACE_SCOPE("PlanePose");
+			if (PlaneEstimator.Estimate(this->DetectedRecords, CameraParams, MarkerPoseTracker)) {
+				Detected = true;
+			}
+			UpdatePlaneMarkerRoll();
 		}
+		if (BuildMarkerMap) {
+			WorldMap.Update(this->DetectedRecords, CameraParams);
+		}
+		AR_TRACE_COUNTER("MarkersDetected", this->DetectedRecords.size());
 		if (DetectBoard) {
-            float probDetect= BoardDetector.detect( this->DetectedMarkers, BoardConfig,this->DetectedBoard, CameraParams,0.034);
-            if (probDetect > 0.f) {
+            AR_TRACE_SCOPE("BoardPose");
+            if (Boards.Detect(this->DetectedRecords, CameraParams) > 0) {
 				Detected = true;
-				//aruco::CvDrawingUtils::draw3dAxis(Frame,this->DetectedBoard,CameraParams);
-                FVector TranslationVector(this->DetectedBoard.Tvec.at<float>(0,0), this->DetectedBoard.Tvec.at<float>(1,0), this->DetectedBoard.Tvec.at<float>(2,0));
-                FVector RotationVector(this->DetectedBoard.Rvec.at<float>(0,0), this->DetectedBoard.Rvec.at<float>(1,0), this->DetectedBoard.Rvec.at<float>(2,0));
-                //GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("TranslationVector: ") + TranslationVector.ToString());
-                //GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("RotationVector: ") + RotationVector.ToString());
-				
-				}
+				//aruco::CvDrawingUtils::draw3dAxis(Frame,Boards.GetDetectedBoard(0),CameraParams);
+			}
         } 
-		
+		double DetectionEnd = FPlatformTime::Seconds();
+		PublishDetectionStats(DetectionStart, PoseStart, DetectionEnd);
+		QualityController.Update((DetectionEnd - DetectionStart) * 1000.0);
     }
     //GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("Num Markers found: ") + FString::FromInt(Markers.size()));
     // end aruco speed test
 	
 }
 
+void ArucoMarkerDetector::DrawDetectedMarkers(cv::Mat& Image) {
+	if (!CameraParams.isValid() || CameraParams.CamSize.width <= 0) return;
+	// detection may run on a smaller image than the one displayed, so map the corners into the display image
+	float ScaleX = float(Image.cols) / float(CameraParams.CamSize.width);
+	float ScaleY = float(Image.rows) / float(CameraParams.CamSize.height);
+	int LineWidth = FMath::Max(1, FMath::RoundToInt(2 * ScaleX));
+	char IdText[16];
+	for (uint16 i = 0; i < this->DetectedRecords.size(); i++) {
+		// same drawing as aruco::Marker::draw, straight from the record
+		const aruco::MarkerRecord& Record = this->DetectedRecords[i];
+		cv::Point2f Corners[4];
+		cv::Point2f Center(0.f, 0.f);
+		for (int32 c = 0; c < 4; c++) {
+			Corners[c] = cv::Point2f(Record.corners[c][0] * ScaleX, Record.corners[c][1] * ScaleY);
+			Center += Corners[c] * 0.25f;
+		}
+		for (int32 c = 0; c < 4; c++) {
+			cv::line(Image, Corners[c], Corners[(c + 1) % 4], cv::Scalar(0, 0, 255), LineWidth, CV_AA);
+		}
+		sprintf(IdText, "id=%d", Record.id);
+		cv::putText(Image, IdText, Center, cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 0, 255), 2);
+	}
+}
+
+void ArucoMarkerDetector::PublishDetectionStats(double DetectionStart, double PoseStart, double DetectionEnd) {
+	ARPipelineStats& Stats = ARPipelineStats::Get();
+	const aruco::MarkerDetector::DetectionTimes& Times = MarkerDetector.getLastDetectionTimes();
+	Stats.Set(ARPipelineStats::DetectGreyMs, Times.grey);
+	Stats.Set(ARPipelineStats::DetectThresholdMs, Times.threshold);
+	Stats.Set(ARPipelineStats::DetectRectanglesMs, Times.rectangles);
+	Stats.Set(ARPipelineStats::DetectIdentifyMs, Times.identify);
+	Stats.Set(ARPipelineStats::DetectRefinementMs, Times.refinement);
+	Stats.Set(ARPipelineStats::CandidatesPerFrame, Times.nCandidates);
+	Stats.Set(ARPipelineStats::MarkersTracked, this->DetectedRecords.size());
+	Stats.Set(ARPipelineStats::PoseMs, (DetectionEnd - PoseStart) * 1000.0);
+	Stats.Set(ARPipelineStats::DetectionTotalMs, (DetectionEnd - DetectionStart) * 1000.0);
+	if (DetectPlaneMarkers && PlaneEstimator.IsValid()) {
+		Stats.Set(ARPipelineStats::PlaneReprojectionError, PlaneEstimator.GetReprojectionError());
+	}
+	if (Detected) {
+		Stats.MarkNow(ARPipelineStats::LastPoseTime);
+	}
+}
+
 FVector ArucoMarkerDetector::GetDetectedBoardTranslation() {
-    if (&DetectedBoard != NULL) {
-        return GetVectorFromTVec(DetectedBoard.Tvec);
+    return GetBoardTranslation(0);
+}
+
+FRotator ArucoMarkerDetector::GetDetectedBoardRotation() {
+    return GetBoardRotation(0);
+}
+
+FVector ArucoMarkerDetector::GetBoardTranslation(int32 BoardFile) {
+    int32 Board = GetBoardIndex(BoardFile);
+    if (Board >= 0 && Board < Boards.GetNumBoards() && !Boards.GetPose(Board).Tvec.empty()) {
+        return GetVectorFromTVec(Boards.GetPose(Board).Tvec);
     }
     return FVector::ZeroVector;
 }
 
-FRotator ArucoMarkerDetector::GetDetectedBoardRotation() {
-    if (&DetectedBoard != NULL) {
-        return GetBoardRotatorFromRVec(DetectedBoard.Rvec);
+FRotator ArucoMarkerDetector::GetBoardRotation(int32 BoardFile) {
+    int32 Board = GetBoardIndex(BoardFile);
+    if (Board >= 0 && Board < Boards.GetNumBoards() && !Boards.GetPose(Board).Rvec.empty()) {
+        return GetBoardRotatorFromRVec(Boards.GetPose(Board).Rvec);
     }
     return FRotator::ZeroRotator;
 }
 
 FVector ArucoMarkerDetector::GetDetectedMarkerTranslation(uint16 markerId) {  // TODO: fix horrible implementation
-	for (uint16 i = 0; i < this->DetectedMarkers.size(); i++)
+	for (uint16 i = 0; i < this->DetectedRecords.size(); i++)
 	{
-		if (this->DetectedMarkers[i].id == markerId) {
-			return GetVectorFromTVec(this->DetectedMarkers[i].Tvec);
+		if (this->DetectedRecords[i].id == markerId) {
+			return GetVectorFromTVec(cv::Mat(3, 1, CV_32F, this->DetectedRecords[i].tvec));
 		}
 	}
 	return FVector::ZeroVector;
 }
 
 FRotator ArucoMarkerDetector::GetDetectedMarkerRotation(uint16 markerId) {
-	for (uint16 i = 0; i < this->DetectedMarkers.size(); i++)
+	for (uint16 i = 0; i < this->DetectedRecords.size(); i++)
 	{
-		if (this->DetectedMarkers[i].id == markerId) {
-			return GetMarkerRotatorFromRVec(this->DetectedMarkers[i].Rvec);
+		if (this->DetectedRecords[i].id == markerId) {
+			return GetMarkerRotatorFromRVec(cv::Mat(3, 1, CV_32F, this->DetectedRecords[i].rvec));
 		}
 	}
 	return FRotator::ZeroRotator;
@@ -229,19 +287,33 @@ FRotator ArucoMarkerDetector::GetMarkerRotatorFromRVec(cv::Mat Rvec) {
 	return Rotation;
 }
 
+void ArucoMarkerDetector::UpdatePlaneMarkerRoll() {
+	float RollSum = 0.f;
+	int32 NumPlaneMarkers = 0;
+	for (uint16 i = 0; i < this->DetectedRecords.size(); i++) {
+		aruco::MarkerRecord& Marker = this->DetectedRecords[i];
+		if (!PlaneEstimator.IsInGroup(Marker.id)) continue;
+		if (!Marker.hasPose()) {
+			// the plane could not be solved, so the markers placed on it have no pose yet
+			Marker.calculateExtrinsics(PlaneEstimator.GetMarkerSize(), CameraParams, MarkerPoseTracker);
+		}
+		RollSum += GetMarkerRotatorFromRVec(cv::Mat(3, 1, CV_32F, Marker.rvec)).Roll;
+		NumPlaneMarkers++;
+	}
+	if (NumPlaneMarkers > 0) {
+		AveragePlaneMarkerRoll = RollSum / NumPlaneMarkers;
+	}
+}
+
 FVector ArucoMarkerDetector::GetPlaneMarkersNormalVector() {
-	FVector Vector12 = PlaneMarker2Translation - PlaneMarker1Translation;
-	FVector Vector13 = PlaneMarker3Translation - PlaneMarker1Translation;
-	FVector NormalVector = FVector::CrossProduct(Vector12, Vector13);
+	cv::Point3f Normal = PlaneEstimator.GetNormal();
+	FVector NormalVector(Normal.z, Normal.x, -Normal.y); // same axes as GetVectorFromTVec
 	NormalVector.Normalize();
 	return NormalVector;
 }
 
 FRotator ArucoMarkerDetector::GetPlaneMarkersRotation() {
-	FVector Vector12 = PlaneMarker2Translation - PlaneMarker1Translation;
-	FVector Vector13 = PlaneMarker3Translation - PlaneMarker1Translation;
-	FVector NormalVector = FVector::CrossProduct(Vector12, Vector13);
-	FRotator Rotation = NormalVector.Rotation(); // not sure if this is equivalent to the rotation calculated from Rvec;
+	FRotator Rotation = GetPlaneMarkersNormalVector().Rotation(); // not sure if this is equivalent to the rotation calculated from Rvec;
 	if (UseAveragePlaneMarkerRoll) {
 		Rotation.Roll = AveragePlaneMarkerRoll;
 	}
@@ -249,6 +321,5 @@ FRotator ArucoMarkerDetector::GetPlaneMarkersRotation() {
 }
 
 FVector ArucoMarkerDetector::GetPlaneMarkersMidpoint() {
-	FVector Vector23 = PlaneMarker3Translation - PlaneMarker2Translation;
-	return PlaneMarker2Translation + (Vector23 * 0.5f);
+	return GetVectorFromTVec(cv::Mat(PlaneEstimator.GetMidpoint()));
 }
\ No newline at end of file
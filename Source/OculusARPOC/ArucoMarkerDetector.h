@@ -4,6 +4,10 @@
 
 #include "opencv2/highgui/highgui.hpp"
 #include "aruco/aruco.h"
+#include "DetectionQualityController.h"
+#include "MarkerPlaneEstimator.h"
+#include "MarkerMap.h"
+#include "MultiBoardDetector.h"
 
 /**
  * 
@@ -27,6 +31,11 @@ public:
     FVector GetDetectedBoardTranslation();
 
 	FRotator GetDetectedBoardRotation();
+
+	/* Pose of any of the configured boards (index in BoardConfigurationFiles) */
+	FVector GetBoardTranslation(int32 BoardFile);
+
+	FRotator GetBoardRotation(int32 BoardFile);
 	
 	FVector GetDetectedMarkerTranslation(uint16 markerId);
 
@@ -52,45 +61,83 @@ public:
 		
 	FVector GetPlaneMarkersMidpoint();
 
-	void Init();
+	/* Loads the calibration (and board configuration if DetectBoard is set) through CalibrationCache; returns false if it couldn't.
+	   May run on a background thread, so problems are collected in GetInitErrors for the game thread to show. */
+	bool Init();
+
+	/* What went wrong in the last Init; read it only after Init has returned */
+	const TArray<FString>& GetInitErrors() const { return InitErrors; }
+
+	/* Calibration, with the intrinsics scaled to the last detection image */
+	const aruco::CameraParameters& GetCameraParameters() const { return CameraParams; }
+
+	/* FPlatformTime::Seconds() when the last frame was handed to detection, i.e. right after it was captured; used to time-stamp poses for filtering */
+	double GetDetectionFrameTime() const { return DetectionFrameTime; }
+
+	/* Draws the outlines of the last detected markers onto Image, which may have a different resolution than the detection image */
+	void DrawDetectedMarkers(cv::Mat& Image);
 
     bool DetectMarkers;
 
 	bool DetectBoard;
 
+	// files in the game Config directory
+	FString CameraCalibrationFile;
+
+	// one per board; the first goes through the calibration cache
+	TArray<FString> BoardConfigurationFiles;
+
+	/* Boards loaded from BoardConfigurationFiles, detected if DetectBoard is set */
+	MultiBoardDetector Boards;
+
+	TArray<FString> InitErrors;
+
+	/* Index in Boards of each of BoardConfigurationFiles, -1 for a file that failed to load or was rejected */
+	TArray<int32> BoardIndices;
+
+	/* Index in Boards of the board from BoardConfigurationFiles[BoardFile], -1 if there is none */
+	int32 GetBoardIndex(int32 BoardFile) const;
+
 	int DetectSingleMarkerId; // if looking for single marker instead of board
 
 	bool DetectPlaneMarkers;
-	int PlaneMarker1Id;
-	int PlaneMarker2Id;
-	int PlaneMarker3Id;
-	int PlaneMarker4Id;
-    
-	FVector PlaneMarker1Translation;
-	FVector PlaneMarker2Translation;
-	FVector PlaneMarker3Translation;
-	FVector PlaneMarker4Translation;
-	FRotator PlaneMarker1Rotation;
-	FRotator PlaneMarker2Rotation;
-	FRotator PlaneMarker3Rotation;
-	FRotator PlaneMarker4Rotation;
+
+	/* Plane (normal, midpoint) of the group of plane markers, configured with PlaneEstimator.SetMarkerGroup */
+	MarkerPlaneEstimator PlaneEstimator;
+
+	/* If true, every detected marker with a pose is added to WorldMap and the camera localized in it */
+	bool BuildMarkerMap;
+
+	MarkerMap WorldMap;
 
 	bool UseAveragePlaneMarkerRoll; 
 
+	/* Steps the detector settings down/up to keep detection within its time budget (see DetectionQualityController) */
+	DetectionQualityController QualityController;
+
 protected:
+
+	/* Publishes the timings and counts of the last detection to ARPipelineStats */
+	void PublishDetectionStats(double DetectionStart, double PoseStart, double DetectionEnd);
+
+	/* Averages the roll of the visible plane markers, solving the pose of any the plane estimator didn't */
+	void UpdatePlaneMarkerRoll();
    		
 	aruco::CameraParameters CameraParams;
     aruco::MarkerDetector MarkerDetector;
-    aruco::BoardConfiguration BoardConfig;
-    aruco::BoardDetector BoardDetector;
 
-    cv::vector<aruco::Marker> DetectedMarkers;
-    
-    aruco::Board DetectedBoard;
+    // seeds each marker's pose with its pose in the previous frames (faster, and no flipping between ambiguous solutions)
+    aruco::PoseTracker MarkerPoseTracker;
+
+    cv::vector<aruco::MarkerRecord> DetectedRecords; // what detection and the pose estimators work with
 
+    cv::vector<aruco::Marker> DetectedMarkers; // the same markers for GetDetectedMarkers, converted when it is called
+    
     bool MarkersAreDetected;
     
     bool Detected;
 
 	float AveragePlaneMarkerRoll;
+
+	double DetectionFrameTime;
 };
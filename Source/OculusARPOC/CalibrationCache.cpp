@@ -0,0 +1,172 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "CalibrationCache.h"
+#include "MappedFile.h"
+#include "ARTraceRecorder.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCalibrationCache, Log, All);
+
+static const uint32 CalibrationCacheMagic = 0x43435241; // "ARCC"
+static const uint32 CalibrationCacheVersion = 1;
+
+/*
+ File layout: the header, then NumMarkers records of { int32 Id, int32 NumCorners, float[3] * NumCorners }.
+ */
+struct CalibrationCacheHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint8 CameraHash[16];
+	uint8 BoardHash[16];
+	int32 CameraWidth;
+	int32 CameraHeight;
+	float CameraMatrix[9];
+	float Distortion[5];
+	int32 BoardInfoType;
+	int32 NumMarkers;
+};
+
+FString CalibrationCache::GetCachePath()
+{
+	return FPaths::GameSavedDir() / TEXT("Calibration") / TEXT("CalibrationCache.bin");
+}
+
+bool CalibrationCache::HashFile(const FString& FilePath, uint8 OutHash[16])
+{
+	TArray<uint8> Contents;
+	if (!FFileHelper::LoadFileToArray(Contents, *FilePath, FILEREAD_Silent)) return false;
+	FMD5 Md5;
+	Md5.Update(Contents.GetData(), Contents.Num());
+	Md5.Final(OutHash);
+	return true;
+}
+
+bool CalibrationCache::Load(const FString& CameraFile, const FString& BoardFile, aruco::CameraParameters& CameraParams, aruco::BoardConfiguration& BoardConfig)
+{
+	AR_TRACE_SCOPE("CalibrationCache::Load");
+	uint8 CameraHash[16];
+	uint8 BoardHash[16] = { 0 };
+	if (!HashFile(CameraFile, CameraHash)) {
+		UE_LOG(LogCalibrationCache, Error, TEXT("Camera calibration %s not found"), *CameraFile);
+		return false;
+	}
+	if (!BoardFile.IsEmpty() && !HashFile(BoardFile, BoardHash)) {
+		UE_LOG(LogCalibrationCache, Error, TEXT("Board configuration %s not found"), *BoardFile);
+		return false;
+	}
+	if (ReadCache(CameraHash, BoardHash, CameraParams, BoardConfig)) {
+		return true;
+	}
+
+	UE_LOG(LogCalibrationCache, Log, TEXT("Calibration cache is stale, parsing %s"), *CameraFile);
+	try {
+		CameraParams.readFromXMLFile(TCHAR_TO_UTF8(*CameraFile));
+		if (!BoardFile.IsEmpty()) {
+			BoardConfig.readFromFile(TCHAR_TO_UTF8(*BoardFile));
+		}
+	}
+	catch (cv::Exception& Exception) {
+		UE_LOG(LogCalibrationCache, Error, TEXT("Could not parse calibration: %s"), UTF8_TO_TCHAR(Exception.what()));
+		return false;
+	}
+	WriteCache(CameraHash, BoardHash, CameraParams, BoardConfig);
+	return true;
+}
+
+bool CalibrationCache::ReadCache(const uint8 CameraHash[16], const uint8 BoardHash[16], aruco::CameraParameters& CameraParams, aruco::BoardConfiguration& BoardConfig)
+{
+	MappedFile File;
+	if (!File.Open(GetCachePath()) || File.GetSize() < (int64)sizeof(CalibrationCacheHeader)) return false;
+	const CalibrationCacheHeader* Header = (const CalibrationCacheHeader*)File.GetData();
+	if (Header->Magic != CalibrationCacheMagic || Header->Version != CalibrationCacheVersion
+		|| FMemory::Memcmp(Header->CameraHash, CameraHash, 16) != 0 || FMemory::Memcmp(Header->BoardHash, BoardHash, 16) != 0) {
+		return false;
+	}
+
+	// parse the board into a temporary so a truncated file leaves the caller's configuration untouched
+	aruco::BoardConfiguration Board;
+	Board.mInfoType = Header->BoardInfoType;
+	Board.resize(Header->NumMarkers);
+	const uint8* Cursor = File.GetData() + sizeof(CalibrationCacheHeader);
+	const uint8* End = File.GetData() + File.GetSize();
+	for (int32 i = 0; i < Header->NumMarkers; i++) {
+		if (Cursor + 2 * sizeof(int32) > End) return false;
+		int32 Id = ((const int32*)Cursor)[0];
+		int32 NumCorners = ((const int32*)Cursor)[1];
+		Cursor += 2 * sizeof(int32);
+		if (NumCorners < 0 || Cursor + NumCorners * sizeof(cv::Point3f) > End) return false;
+		const cv::Point3f* Corners = (const cv::Point3f*)Cursor;
+		Board[i].id = Id;
+		Board[i].assign(Corners, Corners + NumCorners);
+		Cursor += NumCorners * sizeof(cv::Point3f);
+	}
+	Board.updateIdIndex();
+
+	cv::Mat CameraMatrix(3, 3, CV_32FC1);
+	cv::Mat Distortion(1, 5, CV_32FC1);
+	FMemory::Memcpy(CameraMatrix.ptr<float>(), Header->CameraMatrix, sizeof(Header->CameraMatrix));
+	FMemory::Memcpy(Distortion.ptr<float>(), Header->Distortion, sizeof(Header->Distortion));
+	CameraParams.setParams(CameraMatrix, Distortion, cv::Size(Header->CameraWidth, Header->CameraHeight));
+	BoardConfig = Board;
+	return true;
+}
+
+void CalibrationCache::WriteCache(const uint8 CameraHash[16], const uint8 BoardHash[16], const aruco::CameraParameters& CameraParams, const aruco::BoardConfiguration& BoardConfig)
+{
+	CalibrationCacheHeader Header;
+	FMemory::Memzero(&Header, sizeof(Header));
+	Header.Magic = CalibrationCacheMagic;
+	Header.Version = CalibrationCacheVersion;
+	FMemory::Memcpy(Header.CameraHash, CameraHash, 16);
+	FMemory::Memcpy(Header.BoardHash, BoardHash, 16);
+	Header.CameraWidth = CameraParams.CamSize.width;
+	Header.CameraHeight = CameraParams.CamSize.height;
+	for (int32 i = 0; i < 9; i++) {
+		Header.CameraMatrix[i] = CameraParams.CameraMatrix.at<float>(i / 3, i % 3);
+	}
+	for (int32 i = 0; i < 5 && i < (int32)CameraParams.Distorsion.total(); i++) {
+		Header.Distortion[i] = CameraParams.Distorsion.ptr<float>(0)[i];
+	}
+	Header.BoardInfoType = BoardConfig.mInfoType;
+	Header.NumMarkers = BoardConfig.size();
+
+	TArray<uint8> Data;
+	Data.Append((const uint8*)&Header, sizeof(Header));
+	for (size_t i = 0; i < BoardConfig.size(); i++) {
+		int32 Record[2] = { BoardConfig[i].id, (int32)BoardConfig[i].size() };
+		Data.Append((const uint8*)Record, sizeof(Record));
+		if (BoardConfig[i].size() > 0) {
+			Data.Append((const uint8*)&BoardConfig[i][0], BoardConfig[i].size() * sizeof(cv::Point3f));
+		}
+	}
+	if (!FFileHelper::SaveArrayToFile(Data, *GetCachePath())) {
+		UE_LOG(LogCalibrationCache, Warning, TEXT("Could not write calibration cache %s"), *GetCachePath());
+	}
+}
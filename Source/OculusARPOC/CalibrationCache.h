@@ -0,0 +1,58 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+#include "aruco/aruco.h"
+
+/**
+ * Binary cache of the camera calibration and board configuration, so startup doesn't parse YAML through cv::FileStorage.
+ * The cache (Saved/Calibration/CalibrationCache.bin) records the MD5 of both source files; when either changes the
+ * YAML is parsed once and the cache rewritten.  Intrinsics for other resolutions are derived from the cached
+ * calibration with CameraParameters::resize, and the undistortion tables have their own cache (see UndistortionMap).
+ */
+class CalibrationCache
+{
+public:
+
+	/*
+	 Fills CameraParams and BoardConfig from the cache if it matches the source files, otherwise from the source files
+	 (refreshing the cache).  BoardFile may be empty if no board is used.  Returns false if the calibration couldn't be loaded.
+	 */
+	static bool Load(const FString& CameraFile, const FString& BoardFile, aruco::CameraParameters& CameraParams, aruco::BoardConfiguration& BoardConfig);
+
+	static FString GetCachePath();
+
+private:
+
+	static bool HashFile(const FString& FilePath, uint8 OutHash[16]);
+
+	static bool ReadCache(const uint8 CameraHash[16], const uint8 BoardHash[16], aruco::CameraParameters& CameraParams, aruco::BoardConfiguration& BoardConfig);
+
+	static void WriteCache(const uint8 CameraHash[16], const uint8 BoardHash[16], const aruco::CameraParameters& CameraParams, const aruco::BoardConfiguration& BoardConfig);
+};
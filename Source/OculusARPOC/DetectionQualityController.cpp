@@ -0,0 +1,148 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "DetectionQualityController.h"
+#include "ARTraceRecorder.h"
+#include "ARPipelineStats.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDetectionQuality, Log, All);
+
+// Ordered from full quality to cheapest.  Corner precision goes first (LINES -> SUBPIX costs little accuracy),
+// then the canonical warp size, then resolution (keeping SUBPIX on the full resolution image for as long as possible),
+// and the fixed threshold, which is the least robust to lighting changes, is the last resort.
+const DetectionQualityController::QualitySettings DetectionQualityController::Levels[] =
+{
+	{ TEXT("Full"),              56, aruco::MarkerDetector::LINES,  aruco::MarkerDetector::ADPT_THRES,  0 },
+	{ TEXT("SubpixCorners"),     56, aruco::MarkerDetector::SUBPIX, aruco::MarkerDetector::ADPT_THRES,  0 },
+	{ TEXT("SmallWarp"),         28, aruco::MarkerDetector::SUBPIX, aruco::MarkerDetector::ADPT_THRES,  0 },
+	{ TEXT("HalfResolution"),    28, aruco::MarkerDetector::SUBPIX, aruco::MarkerDetector::ADPT_THRES,  1 },
+	{ TEXT("NoCornerRefine"),    28, aruco::MarkerDetector::NONE,   aruco::MarkerDetector::ADPT_THRES,  1 },
+	{ TEXT("QuarterResolution"), 28, aruco::MarkerDetector::NONE,   aruco::MarkerDetector::ADPT_THRES,  2 },
+	{ TEXT("FixedThreshold"),    28, aruco::MarkerDetector::NONE,   aruco::MarkerDetector::FIXED_THRES, 2 },
+};
+
+static const double FixedThresholdValue = 100.0;
+
+DetectionQualityController::DetectionQualityController()
+{
+	Enabled = true;
+	BudgetMs = 4.f;
+	UpgradeFraction = 0.7f;
+	FramesBeforeDegrade = 5;
+	FramesBeforeUpgrade = 60;
+	Detector = nullptr;
+	QualityLevel = 0;
+	AverageMs = 0.f;
+	OverBudgetFrames = 0;
+	UnderBudgetFrames = 0;
+	FrameCounter = 0;
+	LastUpgradeFrame = -1;
+	UpgradeBackoff = 1;
+	AdaptiveThresholdParam1 = AdaptiveThresholdParam2 = 7;
+}
+
+int32 DetectionQualityController::GetNumQualityLevels()
+{
+	return ARRAY_COUNT(Levels);
+}
+
+const TCHAR* DetectionQualityController::GetQualityLevelName(int32 Level)
+{
+	if (Level < 0 || Level >= GetNumQualityLevels()) return TEXT("Unknown");
+	return Levels[Level].Name;
+}
+
+void DetectionQualityController::SetMarkerDetector(aruco::MarkerDetector* detector)
+{
+	Detector = detector;
+	Detector->getThresholdParams(AdaptiveThresholdParam1, AdaptiveThresholdParam2);
+	ApplyQualityLevel(QualityLevel, TEXT("initial"));
+}
+
+void DetectionQualityController::SetQualityLevel(int32 Level)
+{
+	ApplyQualityLevel(FMath::Clamp(Level, 0, GetNumQualityLevels() - 1), TEXT("forced"));
+}
+
+void DetectionQualityController::Update(float DetectionMs)
+{
+	if (!Enabled || Detector == nullptr) return;
+	FrameCounter++;
+	AverageMs = (AverageMs <= 0.f) ? DetectionMs : AverageMs * 0.8f + DetectionMs * 0.2f;
+
+	if (AverageMs > BudgetMs) {
+		UnderBudgetFrames = 0;
+		if (++OverBudgetFrames >= FramesBeforeDegrade && QualityLevel < GetNumQualityLevels() - 1) {
+			// an upgrade that didn't hold: wait longer before trying again so we don't oscillate
+			if (LastUpgradeFrame >= 0 && FrameCounter - LastUpgradeFrame < FramesBeforeUpgrade * 2) {
+				UpgradeBackoff = FMath::Min(UpgradeBackoff * 2, 16);
+			}
+			ApplyQualityLevel(QualityLevel + 1, TEXT("over budget"));
+		}
+	}
+	else if (AverageMs < BudgetMs * UpgradeFraction) {
+		OverBudgetFrames = 0;
+		if (++UnderBudgetFrames >= FramesBeforeUpgrade * UpgradeBackoff && QualityLevel > 0) {
+			LastUpgradeFrame = FrameCounter;
+			ApplyQualityLevel(QualityLevel - 1, TEXT("headroom"));
+		}
+	}
+	else { // inside the hysteresis band: hold
+		OverBudgetFrames = 0;
+		UnderBudgetFrames = 0;
+	}
+	// a long stable stretch at full quality means the backoff can be forgotten
+	if (QualityLevel == 0 && LastUpgradeFrame >= 0 && FrameCounter - LastUpgradeFrame > FramesBeforeUpgrade * 16) {
+		UpgradeBackoff = 1;
+	}
+}
+
+void DetectionQualityController::ApplyQualityLevel(int32 Level, const TCHAR* Reason)
+{
+	const QualitySettings& Settings = Levels[Level];
+	Detector->setWarpSize(Settings.WarpSize);
+	Detector->setCornerRefinementMethod(Settings.CornerMethod);
+	Detector->pyrDown(Settings.PyrDownLevel);
+	Detector->setThresholdMethod(Settings.ThresholdMethod);
+	if (Settings.ThresholdMethod == aruco::MarkerDetector::FIXED_THRES) {
+		Detector->setThresholdParams(FixedThresholdValue, FixedThresholdValue);
+	}
+	else {
+		Detector->setThresholdParams(AdaptiveThresholdParam1, AdaptiveThresholdParam2);
+	}
+	if (Level != QualityLevel) {
+		UE_LOG(LogDetectionQuality, Log, TEXT("Detection quality %s -> %s (%s, %.2f ms average, %.2f ms budget)"),
+			GetQualityLevelName(QualityLevel), Settings.Name, Reason, AverageMs, BudgetMs);
+	}
+	QualityLevel = Level;
+	OverBudgetFrames = 0;
+	UnderBudgetFrames = 0;
+	ARPipelineStats::Get().Set(ARPipelineStats::DetectionQualityLevel, Level);
+	AR_TRACE_COUNTER("DetectionQualityLevel", Level);
+}
@@ -0,0 +1,114 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+#include "aruco/aruco.h"
+
+/**
+ * Closed-loop controller that keeps marker detection under a time budget.
+ * Every frame it is fed the measured detection time.  When the smoothed time stays over budget it steps down a
+ * ladder of detector settings, ordered so that the accuracy that is cheapest to lose goes first, and when there is
+ * enough headroom for long enough it steps back up.  The two thresholds plus the frame counts give hysteresis, and
+ * an upgrade that has to be undone soon after doubles the time before the next upgrade attempt.
+ */
+class DetectionQualityController
+{
+public:
+
+	DetectionQualityController();
+
+	/*
+	 The detector whose knobs (warp size, corner refinement, pyrDown level and threshold method) are driven by this controller.
+	 Note that this supersedes MarkerDetector::setDesiredSpeed, which would fight over the same settings.
+	 */
+	void SetMarkerDetector(aruco::MarkerDetector* Detector);
+
+	/*
+	 Feeds the detection time of the last frame, in milliseconds, and adjusts the detector if needed.
+	 */
+	void Update(float DetectionMs);
+
+	/*
+	 Forces a quality level (0 = full quality) and applies it.
+	 */
+	void SetQualityLevel(int32 Level);
+
+	int32 GetQualityLevel() const { return QualityLevel; }
+
+	static int32 GetNumQualityLevels();
+
+	static const TCHAR* GetQualityLevelName(int32 Level);
+
+	bool Enabled;
+
+	// detection time budget per frame
+	float BudgetMs;
+
+	// quality is only restored when the smoothed time is below BudgetMs * UpgradeFraction
+	float UpgradeFraction;
+
+	// consecutive over-budget frames before degrading
+	int32 FramesBeforeDegrade;
+
+	// consecutive frames with headroom before upgrading (multiplied by the current backoff)
+	int32 FramesBeforeUpgrade;
+
+protected:
+
+	struct QualitySettings
+	{
+		const TCHAR* Name;
+		int WarpSize;
+		aruco::MarkerDetector::CornerRefinementMethod CornerMethod;
+		aruco::MarkerDetector::ThresholdMethods ThresholdMethod;
+		unsigned int PyrDownLevel;
+	};
+
+	static const QualitySettings Levels[];
+
+	void ApplyQualityLevel(int32 Level, const TCHAR* Reason);
+
+	aruco::MarkerDetector* Detector;
+
+	int32 QualityLevel;
+
+	float AverageMs;
+
+	int32 OverBudgetFrames;
+
+	int32 UnderBudgetFrames;
+
+	int32 FrameCounter;
+
+	int32 LastUpgradeFrame;
+
+	int32 UpgradeBackoff;
+
+	double AdaptiveThresholdParam1, AdaptiveThresholdParam2;
+};
@@ -0,0 +1,219 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "GestureRecognizer.h"
+
+SlidingMotionWindow::SlidingMotionWindow()
+{
+	WindowSeconds = 0.1f;
+	Reset();
+}
+
+void SlidingMotionWindow::Reset()
+{
+	First = 0;
+	Count = 0;
+	Origin = 0.0;
+	SumT = SumTT = 0.0;
+	SumX = SumTX = 0.0;
+	SumY = SumTY = 0.0;
+}
+
+void SlidingMotionWindow::Add(double Time, const FVector2D& Position)
+{
+	if (Count == 0) {
+		Reset();
+		Origin = Time;
+	}
+	if (Count == Capacity) {
+		RemoveOldest();
+	}
+	int32 Index = (First + Count) & (Capacity - 1);
+	Times[Index] = Time;
+	Positions[Index] = Position;
+	Count++;
+	double T = Time - Origin;
+	SumT += T;
+	SumTT += T * T;
+	SumX += Position.X;
+	SumTX += T * Position.X;
+	SumY += Position.Y;
+	SumTY += T * Position.Y;
+	// keep the newest two samples even if they are far apart, so there is always a velocity
+	while (Count > 2 && Time - Times[First] > WindowSeconds) {
+		RemoveOldest();
+	}
+	// the window never empties during a touch: re-center every second, at most Capacity samples each time
+	if (Times[First] - Origin > 1.0) {
+		Rebase();
+	}
+}
+
+void SlidingMotionWindow::Rebase()
+{
+	Origin = Times[First];
+	SumT = SumTT = 0.0;
+	SumX = SumTX = 0.0;
+	SumY = SumTY = 0.0;
+	for (int32 i = 0; i < Count; i++) {
+		int32 Index = (First + i) & (Capacity - 1);
+		double T = Times[Index] - Origin;
+		SumT += T;
+		SumTT += T * T;
+		SumX += Positions[Index].X;
+		SumTX += T * Positions[Index].X;
+		SumY += Positions[Index].Y;
+		SumTY += T * Positions[Index].Y;
+	}
+}
+
+void SlidingMotionWindow::RemoveOldest()
+{
+	double T = Times[First] - Origin;
+	const FVector2D& Position = Positions[First];
+	SumT -= T;
+	SumTT -= T * T;
+	SumX -= Position.X;
+	SumTX -= T * Position.X;
+	SumY -= Position.Y;
+	SumTY -= T * Position.Y;
+	First = (First + 1) & (Capacity - 1);
+	Count--;
+}
+
+FVector2D SlidingMotionWindow::GetVelocity() const
+{
+	if (Count < 2) return FVector2D::ZeroVector;
+	double Denominator = Count * SumTT - SumT * SumT;
+	if (Denominator <= 1e-12) return FVector2D::ZeroVector;
+	return FVector2D((float)((Count * SumTX - SumT * SumX) / Denominator), (float)((Count * SumTY - SumT * SumY) / Denominator));
+}
+
+FVector2D SlidingMotionWindow::GetDisplacement() const
+{
+	if (Count < 2) return FVector2D::ZeroVector;
+	return GetLatest() - Positions[First];
+}
+
+GestureRecognizer::GestureRecognizer()
+{
+	TapSlopPixels = 8.f;
+	TapMaxSeconds = 0.3f;
+	ScrollStepPixels = 3.f;
+	SwipeLengthPixels = 40.f;
+	SwipeMinVelocity = 400.f;
+	MinSecondsBetweenSwipes = 0.5f;
+	FlingMinVelocity = 800.f;
+	Reset();
+}
+
+void GestureRecognizer::Reset()
+{
+	Events.Reset();
+	FingerMotion.Reset();
+	PalmMotion.Reset();
+	Touching = false;
+	Dragging = false;
+	TouchStartTime = 0.0;
+	LastSwipeTime[0] = LastSwipeTime[1] = -1e9;
+}
+
+GestureEvent& GestureRecognizer::AddEvent(GestureEvent::EventType Type, double Time, const FVector2D& Position)
+{
+	GestureEvent& Event = Events[Events.AddUninitialized()];
+	Event.Type = Type;
+	Event.Time = Time;
+	Event.Position = Position;
+	Event.Delta = FVector2D::ZeroVector;
+	Event.Velocity = FVector2D::ZeroVector;
+	return Event;
+}
+
+void GestureRecognizer::AddSample(double Time, const FVector2D& FingerPosition, const FVector2D& PalmPosition, bool IsTouching)
+{
+	Events.Reset();
+	if (!IsTouching) {
+		if (Touching) {
+			// release: a short touch that didn't move is a tap, a fast moving one a fling
+			if (!Dragging && Time - TouchStartTime <= TapMaxSeconds) {
+				AddEvent(GestureEvent::Tap, Time, TouchStartPosition);
+			}
+			else if (Dragging) {
+				FVector2D Velocity = FingerMotion.GetVelocity();
+				if (Velocity.Size() >= FlingMinVelocity) {
+					AddEvent(GestureEvent::Fling, Time, LastFingerPosition).Velocity = Velocity;
+				}
+			}
+			Touching = false;
+			Dragging = false;
+		}
+		return;
+	}
+
+	if (!Touching) {
+		Touching = true;
+		Dragging = false;
+		TouchStartTime = Time;
+		TouchStartPosition = FingerPosition;
+		LastFingerPosition = FingerPosition;
+		LastScrollPalmY = PalmPosition.Y;
+		FingerMotion.Reset();
+		PalmMotion.Reset();
+	}
+	FingerMotion.Add(Time, FingerPosition);
+	PalmMotion.Add(Time, PalmPosition);
+
+	if (!Dragging && FVector2D::Distance(FingerPosition, TouchStartPosition) > TapSlopPixels) {
+		Dragging = true;
+	}
+	if (Dragging && FingerPosition != LastFingerPosition) {
+		AddEvent(GestureEvent::Drag, Time, FingerPosition).Delta = FingerPosition - LastFingerPosition;
+	}
+	LastFingerPosition = FingerPosition;
+
+	// scrolling follows the palm, in steps so slow movements add up instead of being lost under a per-frame threshold
+	float ScrollDelta = PalmPosition.Y - LastScrollPalmY;
+	if (FMath::Abs(ScrollDelta) >= ScrollStepPixels) {
+		AddEvent(GestureEvent::Scroll, Time, PalmPosition).Delta = FVector2D(0.f, ScrollDelta);
+		LastScrollPalmY = PalmPosition.Y;
+	}
+
+	// swipes are fast, mostly horizontal palm movements
+	FVector2D PalmVelocity = PalmMotion.GetVelocity();
+	FVector2D PalmDisplacement = PalmMotion.GetDisplacement();
+	if (FMath::Abs(PalmVelocity.X) >= SwipeMinVelocity && FMath::Abs(PalmVelocity.X) > 2.f * FMath::Abs(PalmVelocity.Y)
+		&& FMath::Abs(PalmDisplacement.X) >= SwipeLengthPixels && PalmDisplacement.X * PalmVelocity.X > 0.f) {
+		int32 Direction = PalmVelocity.X < 0.f ? 0 : 1;
+		if (Time - LastSwipeTime[Direction] >= MinSecondsBetweenSwipes) {
+			LastSwipeTime[Direction] = Time;
+			GestureEvent& Event = AddEvent(GestureEvent::Swipe, Time, PalmPosition);
+			Event.Delta = PalmDisplacement;
+			Event.Velocity = PalmVelocity;
+		}
+	}
+}
@@ -0,0 +1,159 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+/*
+ Streaming gesture recognition for UI surfaces.  Samples are fingertip and palm positions in surface space (view
+ pixels) with their times in seconds; each sample costs O(1), and the gestures found are reported as events.
+ Motion is measured over a short sliding time window with a least-squares fit, rather than against the previous frame
+ only, so fast swipes aren't missed between frames and slow ones aren't dominated by tracking noise.
+ Nothing here depends on the engine beyond math types, so recorded hand streams can be fed through it offline.
+ */
+
+/*
+ Least-squares line fit of a 2D position over time, over the samples of the last WindowSeconds.
+ Running sums are updated as samples enter and leave the window, so adding a sample is O(1) (amortized).
+ */
+class SlidingMotionWindow
+{
+public:
+
+	SlidingMotionWindow();
+
+	void Reset();
+
+	void Add(double Time, const FVector2D& Position);
+
+	int32 Num() const { return Count; }
+
+	/* Fitted velocity in units/s, zero with fewer than two samples */
+	FVector2D GetVelocity() const;
+
+	/* Position of the newest sample minus that of the oldest one in the window */
+	FVector2D GetDisplacement() const;
+
+	FVector2D GetLatest() const { return Positions[(First + Count - 1) & (Capacity - 1)]; }
+
+	float WindowSeconds;
+
+private:
+
+	static const int32 Capacity = 64; // power of two; more than a window's worth of frames at Leap rates
+
+	void RemoveOldest();
+
+	/* Moves Origin to the oldest sample and recomputes the sums, which otherwise lose precision as a touch goes on */
+	void Rebase();
+
+	double Times[Capacity];
+	FVector2D Positions[Capacity];
+	int32 First;
+	int32 Count;
+	double Origin; // sums use times relative to this, for precision
+
+	// running sums over the window
+	double SumT, SumTT;
+	double SumX, SumTX;
+	double SumY, SumTY;
+};
+
+struct GestureEvent
+{
+	enum EventType
+	{
+		Tap,    // touched and released without moving
+		Drag,   // finger moved while touching; Delta is the movement since the previous sample
+		Scroll, // palm moved vertically while touching; Delta.Y is the movement since the previous scroll event
+		Fling,  // released while moving fast; Velocity is the finger velocity at release
+		Swipe   // fast horizontal palm movement while touching; Velocity.X gives the direction
+	};
+
+	EventType Type;
+	double Time;
+	FVector2D Position;
+	FVector2D Delta;
+	FVector2D Velocity;
+};
+
+class GestureRecognizer
+{
+public:
+
+	GestureRecognizer();
+
+	void Reset();
+
+	/*
+	 Adds a sample; Touching is true while the finger is across the surface.
+	 The events found in this sample replace those of the previous one (see GetEvents).
+	 */
+	void AddSample(double Time, const FVector2D& FingerPosition, const FVector2D& PalmPosition, bool Touching);
+
+	const TArray<GestureEvent>& GetEvents() const { return Events; }
+
+	bool IsTouching() const { return Touching; }
+
+	// finger movement (pixels) under which a touch is still a tap
+	float TapSlopPixels;
+
+	// longest touch that counts as a tap
+	float TapMaxSeconds;
+
+	// palm movement (pixels) that makes up one scroll event
+	float ScrollStepPixels;
+
+	// horizontal palm movement within the window needed for a swipe
+	float SwipeLengthPixels;
+
+	// horizontal palm speed needed for a swipe
+	float SwipeMinVelocity;
+
+	// a swipe in the same direction is not reported again within this time
+	float MinSecondsBetweenSwipes;
+
+	// finger speed at release needed for a fling
+	float FlingMinVelocity;
+
+	SlidingMotionWindow FingerMotion;
+
+	SlidingMotionWindow PalmMotion;
+
+private:
+
+	GestureEvent& AddEvent(GestureEvent::EventType Type, double Time, const FVector2D& Position);
+
+	TArray<GestureEvent> Events;
+
+	bool Touching;
+	bool Dragging;
+	double TouchStartTime;
+	FVector2D TouchStartPosition;
+	FVector2D LastFingerPosition;
+	float LastScrollPalmY;
+	double LastSwipeTime[2]; // left, right
+};
@@ -0,0 +1,108 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "HandSkeleton.h"
+
+/* Out = In * M, with W = 1 for positions and W = 0 for directions */
+template<int32 N>
+static void TransformVectors(const FMatrix& M, float W, const HandVectorArray<N>& In, HandVectorArray<N>& Out)
+{
+	for (int32 Column = 0; Column < 3; Column++) {
+		float* Result = Column == 0 ? Out.X : (Column == 1 ? Out.Y : Out.Z);
+		const float AX = M.M[0][Column];
+		const float AY = M.M[1][Column];
+		const float AZ = M.M[2][Column];
+		const float Offset = M.M[3][Column] * W;
+		for (int32 i = 0; i < N; i++) {
+			Result[i] = In.X[i] * AX + In.Y[i] * AY + In.Z[i] * AZ + Offset;
+		}
+	}
+}
+
+HandSkeleton::HandSkeleton()
+{
+	FMemory::Memzero(this, sizeof(HandSkeleton));
+}
+
+void HandSkeleton::SetFromSample(const LeapHandSample& Sample)
+{
+	HandsPresent = Sample.HandsPresent;
+	for (int32 Side = 0; Side < NumSides; Side++) {
+		if (!HasHand(Side)) continue;
+		const LeapHandSample::Hand& Hand = Sample.Hands[Side];
+		int32 Point = PalmIndex(Side);
+		LeapPositions.X[Point] = Hand.PalmPosition[0];
+		LeapPositions.Y[Point] = Hand.PalmPosition[1];
+		LeapPositions.Z[Point] = Hand.PalmPosition[2];
+		for (int32 Finger = 0; Finger < NumFingers; Finger++) {
+			for (int32 Joint = 0; Joint < NumJoints; Joint++) {
+				Point++;
+				LeapPositions.X[Point] = Hand.Joints[Finger][Joint][0];
+				LeapPositions.Y[Point] = Hand.Joints[Finger][Joint][1];
+				LeapPositions.Z[Point] = Hand.Joints[Finger][Joint][2];
+			}
+		}
+		int32 Velocity = PalmVelocityIndex(Side);
+		LeapVelocities.X[Velocity] = Hand.PalmVelocity[0];
+		LeapVelocities.Y[Velocity] = Hand.PalmVelocity[1];
+		LeapVelocities.Z[Velocity] = Hand.PalmVelocity[2];
+		for (int32 Finger = 0; Finger < NumFingers; Finger++) {
+			Velocity++;
+			LeapVelocities.X[Velocity] = Hand.TipVelocity[Finger][0];
+			LeapVelocities.Y[Velocity] = Hand.TipVelocity[Finger][1];
+			LeapVelocities.Z[Velocity] = Hand.TipVelocity[Finger][2];
+		}
+		Confidence[Side] = Hand.Confidence;
+		PinchStrength[Side] = Hand.PinchStrength;
+		GrabStrength[Side] = Hand.GrabStrength;
+	}
+}
+
+FMatrix HandSkeleton::MakeLeapToWorldTransform(const FRotator& HMDRotation, const FVector& CharacterLocation, const FVector& Forward,
+	const FVector& Right, const FVector& Up, const FVector& MountOffset, const FVector& HandOffset, float Scale)
+{
+	// the mapping is affine, so it's fully described by where the origin and the three Leap axes end up
+	FVector CorrectedAxes[4] = { MountOffset, FVector(0.f, 1.f, 0.f), FVector(1.f, 0.f, 0.f), FVector(0.f, 0.f, 1.f) }; // NOTE: reverse X and Y because of different coordinate systems
+	FVector WorldAxes[4];
+	for (int32 i = 0; i < 4; i++) {
+		FVector Scaled = HMDRotation.UnrotateVector(CorrectedAxes[i]) * Scale;  // TODO: adjust for leap rotation not being the same as HMD rotation
+		WorldAxes[i] = Forward * Scaled.X - Right * Scaled.Y - Up * Scaled.Z;
+	}
+	FVector Origin = CharacterLocation + WorldAxes[0] + Forward * HandOffset.X + Up * HandOffset.Z;
+	return FMatrix(WorldAxes[1], WorldAxes[2], WorldAxes[3], Origin);
+}
+
+void HandSkeleton::UpdateTransforms(const FMatrix& LeapToWorld, const FMatrix& WorldToCharacter)
+{
+	// character space straight from Leap coordinates, rather than going through world space point by point
+	FMatrix LeapToCharacter = LeapToWorld * WorldToCharacter;
+	TransformVectors(LeapToWorld, 1.f, LeapPositions, WorldPositions);
+	TransformVectors(LeapToCharacter, 1.f, LeapPositions, CharacterPositions);
+	TransformVectors(LeapToWorld, 0.f, LeapVelocities, WorldVelocities);
+	TransformVectors(LeapToCharacter, 0.f, LeapVelocities, CharacterVelocities);
+}
@@ -0,0 +1,107 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "IHandTrackingSource.h"
+
+/**
+ * N vectors stored as separate X, Y and Z arrays, so they can be transformed in one pass the compiler can vectorize
+ */
+template<int32 N>
+struct HandVectorArray
+{
+	float X[N];
+	float Y[N];
+	float Z[N];
+
+	FVector Get(int32 i) const { return FVector(X[i], Y[i], Z[i]); }
+};
+
+/**
+ * Skeleton of both hands for the current frame in a flat structure-of-arrays layout: the palm and the 5 joints of each
+ * finger (4 bones), the palm and fingertip velocities, and confidence, pinch and grab strength per hand.  It is filled
+ * from a LeapHandSample in one pass and every point is transformed to world and character space in one batch, so
+ * interactions read plain arrays instead of going through the Leap object model.
+ * A hand that is not present keeps its last known Leap coordinates.
+ */
+class HandSkeleton
+{
+public:
+
+	static const int32 NumSides = LeapHandSample::NumSides;
+	static const int32 NumFingers = LeapHandSample::NumFingers;
+	static const int32 NumJoints = LeapHandSample::NumJoints;
+	static const int32 PointsPerHand = 1 + NumFingers * NumJoints;
+	static const int32 NumPoints = NumSides * PointsPerHand;
+	static const int32 VelocitiesPerHand = 1 + NumFingers;
+	static const int32 NumVelocities = NumSides * VelocitiesPerHand;
+
+	/* Indices into the position arrays */
+	static int32 PalmIndex(int32 Side) { return Side * PointsPerHand; }
+	static int32 JointIndex(int32 Side, int32 Finger, int32 Joint) { return Side * PointsPerHand + 1 + Finger * NumJoints + Joint; }
+	static int32 TipIndex(int32 Side, int32 Finger) { return JointIndex(Side, Finger, LeapHandSample::TipJoint); }
+
+	/* Indices into the velocity arrays */
+	static int32 PalmVelocityIndex(int32 Side) { return Side * VelocitiesPerHand; }
+	static int32 TipVelocityIndex(int32 Side, int32 Finger) { return Side * VelocitiesPerHand + 1 + Finger; }
+
+	HandSkeleton();
+
+	void SetFromSample(const LeapHandSample& Sample);
+
+	/*
+	 Computes the world and character space positions and velocities from the Leap ones.
+	 Matrices follow the Unreal convention (row vectors, V * M).
+	 */
+	void UpdateTransforms(const FMatrix& LeapToWorld, const FMatrix& WorldToCharacter);
+
+	/*
+	 Leap to world transform of a head mounted Leap for one frame: Leap millimeters (Y forward) are offset by the mount,
+	 unrotated by the HMD orientation, scaled to Unreal units and placed along the character's axes, plus the hand offset.
+	 */
+	static FMatrix MakeLeapToWorldTransform(const FRotator& HMDRotation, const FVector& CharacterLocation, const FVector& Forward,
+		const FVector& Right, const FVector& Up, const FVector& MountOffset, const FVector& HandOffset, float Scale);
+
+	bool HasHand(int32 Side) const { return (HandsPresent & (1 << Side)) != 0; }
+
+	uint8 HandsPresent; // bit per LeapHandSample::Side
+
+	// millimeters, Leap coordinates
+	HandVectorArray<NumPoints> LeapPositions;
+	HandVectorArray<NumVelocities> LeapVelocities;
+
+	// Unreal units
+	HandVectorArray<NumPoints> WorldPositions;
+	HandVectorArray<NumVelocities> WorldVelocities;
+	HandVectorArray<NumPoints> CharacterPositions;
+	HandVectorArray<NumVelocities> CharacterVelocities;
+
+	float Confidence[NumSides];
+	float PinchStrength[NumSides];
+	float GrabStrength[NumSides];
+};
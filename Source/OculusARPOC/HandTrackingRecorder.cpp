@@ -0,0 +1,161 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "HandTrackingRecorder.h"
+#include "MappedFile.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogHandTracking, Log, All);
+
+static const uint32 HandLogMagic = 0x43455248; // "HREC"
+static const int32 HandLogVersion = 2;
+
+struct HandLogHeader
+{
+	uint32 Magic;
+	int32 Version;
+	int32 NumSamples;
+};
+
+struct HandLogRecord
+{
+	float Time; // seconds since the first frame
+	uint32 FrameId;
+	uint8 HandsPresent;
+};
+
+static const int32 HandLogRecordSize = sizeof(float) + sizeof(uint32) + sizeof(uint8); // records are packed, not padded
+
+HandTrackingRecorder::HandTrackingRecorder()
+{
+	Recording = false;
+	FirstSampleTime = 0.0;
+	NumSamples = 0;
+}
+
+FString HandTrackingRecorder::GetRecordingPath(const FString& Name)
+{
+	return FPaths::GameSavedDir() / TEXT("HandRecordings") / (Name + TEXT(".hand"));
+}
+
+void HandTrackingRecorder::Start()
+{
+	FScopeLock ScopeLock(&Lock);
+	Data.Reset();
+	Data.AddZeroed(sizeof(HandLogHeader));
+	NumSamples = 0;
+	Recording = true;
+}
+
+void HandTrackingRecorder::Record(const LeapHandSample& Sample)
+{
+	FScopeLock ScopeLock(&Lock);
+	if (!Recording) return;
+	if (NumSamples == 0) {
+		FirstSampleTime = Sample.Time;
+	}
+	HandLogRecord Record;
+	Record.Time = (float)(Sample.Time - FirstSampleTime);
+	Record.FrameId = (uint32)Sample.FrameId;
+	Record.HandsPresent = Sample.HandsPresent;
+	Data.Append((const uint8*)&Record.Time, sizeof(Record.Time));
+	Data.Append((const uint8*)&Record.FrameId, sizeof(Record.FrameId));
+	Data.Append(&Record.HandsPresent, sizeof(Record.HandsPresent));
+	for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+		if (!Sample.HasHand((LeapHandSample::Side)Side)) continue;
+		Data.Append((const uint8*)&Sample.Hands[Side], sizeof(LeapHandSample::Hand));
+	}
+	NumSamples++;
+}
+
+bool HandTrackingRecorder::StopAndSave(const FString& FilePath)
+{
+	FScopeLock ScopeLock(&Lock);
+	Recording = false;
+	if (NumSamples == 0) {
+		UE_LOG(LogHandTracking, Warning, TEXT("No hand frames recorded, %s not written"), *FilePath);
+		return false;
+	}
+	HandLogHeader Header;
+	Header.Magic = HandLogMagic;
+	Header.Version = HandLogVersion;
+	Header.NumSamples = NumSamples;
+	FMemory::Memcpy(Data.GetData(), &Header, sizeof(Header));
+	bool Saved = FFileHelper::SaveArrayToFile(Data, *FilePath);
+	if (Saved) {
+		UE_LOG(LogHandTracking, Log, TEXT("Saved hand recording %s (%d frames)"), *FilePath, NumSamples);
+	}
+	else {
+		UE_LOG(LogHandTracking, Warning, TEXT("Could not write hand recording %s"), *FilePath);
+	}
+	Data.Empty();
+	NumSamples = 0;
+	return Saved;
+}
+
+bool HandTrackingRecorder::Load(const FString& FilePath, TArray<LeapHandSample>& OutSamples)
+{
+	MappedFile File;
+	if (!File.Open(FilePath) || File.GetSize() < (int64)sizeof(HandLogHeader)) {
+		UE_LOG(LogHandTracking, Warning, TEXT("Hand recording %s not found"), *FilePath);
+		return false;
+	}
+	const HandLogHeader* Header = (const HandLogHeader*)File.GetData();
+	if (Header->Magic != HandLogMagic || Header->Version != HandLogVersion || Header->NumSamples <= 0) {
+		UE_LOG(LogHandTracking, Warning, TEXT("Hand recording %s is invalid"), *FilePath);
+		return false;
+	}
+	const uint8* Read = File.GetData() + sizeof(HandLogHeader);
+	const uint8* End = File.GetData() + File.GetSize();
+	OutSamples.Reset();
+	OutSamples.Reserve(Header->NumSamples);
+	for (int32 i = 0; i < Header->NumSamples; i++) {
+		if (End - Read < HandLogRecordSize) break;
+		HandLogRecord Record;
+		FMemory::Memcpy(&Record.Time, Read, sizeof(Record.Time));
+		FMemory::Memcpy(&Record.FrameId, Read + sizeof(Record.Time), sizeof(Record.FrameId));
+		Record.HandsPresent = Read[sizeof(Record.Time) + sizeof(Record.FrameId)];
+		int32 NumHands = (Record.HandsPresent & 1) + ((Record.HandsPresent >> 1) & 1);
+		if (End - Read < HandLogRecordSize + NumHands * (int64)sizeof(LeapHandSample::Hand)) break;
+		Read += HandLogRecordSize;
+		LeapHandSample& Sample = OutSamples[OutSamples.AddZeroed()];
+		Sample.Time = Record.Time;
+		Sample.FrameId = Record.FrameId;
+		Sample.HandsPresent = Record.HandsPresent & ((1 << LeapHandSample::NumSides) - 1);
+		for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+			if (!Sample.HasHand((LeapHandSample::Side)Side)) continue;
+			FMemory::Memcpy(&Sample.Hands[Side], Read, sizeof(LeapHandSample::Hand));
+			Read += sizeof(LeapHandSample::Hand);
+		}
+	}
+	if (OutSamples.Num() != Header->NumSamples) {
+		UE_LOG(LogHandTracking, Warning, TEXT("Hand recording %s is truncated"), *FilePath);
+		return false;
+	}
+	UE_LOG(LogHandTracking, Log, TEXT("Loaded hand recording %s (%d frames)"), *FilePath, OutSamples.Num());
+	return true;
+}
@@ -0,0 +1,67 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "IHandTrackingSource.h"
+
+/**
+ * Records hand tracking frames to a compact binary log that HandTrackingReplay plays back.
+ * The log is a header followed by one record per frame: time since the first frame, frame id, the hands present, then
+ * the skeleton (LeapHandSample::Hand) of each hand present only.  Frames are collected in memory and written when recording stops.
+ */
+class HandTrackingRecorder
+{
+public:
+
+	HandTrackingRecorder();
+
+	/* Starts a new recording, discarding anything recorded before */
+	void Start();
+
+	/* Adds a frame; safe to call from any thread.  Ignored unless recording. */
+	void Record(const LeapHandSample& Sample);
+
+	/* Stops recording and writes the log to FilePath.  Returns false if nothing was recorded or the file could not be written. */
+	bool StopAndSave(const FString& FilePath);
+
+	bool IsRecording() const { return Recording; }
+
+	/* Saved/HandRecordings/<Name>.hand */
+	static FString GetRecordingPath(const FString& Name);
+
+	/* Reads a log written by StopAndSave into OutSamples (times relative to the first frame); returns false if it is invalid */
+	static bool Load(const FString& FilePath, TArray<LeapHandSample>& OutSamples);
+
+private:
+
+	FCriticalSection Lock;
+	bool Recording;
+	double FirstSampleTime;
+	int32 NumSamples;
+	TArray<uint8> Data;
+};
@@ -0,0 +1,113 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "HandTrackingReplay.h"
+#include "HandTrackingRecorder.h"
+
+HandTrackingReplay::HandTrackingReplay()
+{
+	Looping = true;
+	MaxExtrapolationSeconds = 0.05f;
+	StartTime = -1.0;
+}
+
+HandTrackingReplay::~HandTrackingReplay()
+{
+}
+
+bool HandTrackingReplay::Load(const FString& FilePath)
+{
+	Stop();
+	return HandTrackingRecorder::Load(FilePath, Samples);
+}
+
+bool HandTrackingReplay::Start()
+{
+	return StartAt(FPlatformTime::Seconds());
+}
+
+bool HandTrackingReplay::StartAt(double Time)
+{
+	if (Samples.Num() == 0) return false;
+	StartTime = Time;
+	return true;
+}
+
+void HandTrackingReplay::Stop()
+{
+	StartTime = -1.0;
+}
+
+double HandTrackingReplay::GetRecordingTime(double Time) const
+{
+	if (StartTime < 0.0 || Samples.Num() == 0) return -1.0;
+	double RecordingTime = FMath::Max(0.0, Time - StartTime);
+	double Duration = Samples.Last().Time;
+	if (Looping && Duration > 0.0) {
+		RecordingTime = FMath::Fmod(RecordingTime, Duration);
+	}
+	return RecordingTime;
+}
+
+int32 HandTrackingReplay::FindSample(double RecordingTime) const
+{
+	// binary search for the last frame at or before RecordingTime
+	int32 Low = 0;
+	int32 High = Samples.Num();
+	while (Low < High) {
+		int32 Middle = (Low + High) / 2;
+		if (Samples[Middle].Time <= RecordingTime) {
+			Low = Middle + 1;
+		}
+		else {
+			High = Middle;
+		}
+	}
+	return Low - 1;
+}
+
+bool HandTrackingReplay::GetSampleAt(double Time, LeapHandSample& OutSample) const
+{
+	double RecordingTime = GetRecordingTime(Time);
+	if (RecordingTime < 0.0) return false;
+	// frames up to RecordingTime have "arrived"; interpolate between the two around it, like the live source does
+	int32 Last = FindSample(RecordingTime);
+	int32 First = FMath::Max(0, Last - 1);
+	int32 Count = FMath::Min(Last + 2, Samples.Num()) - First;
+	if (!InterpolateSamples(&Samples[First], Count, RecordingTime, MaxExtrapolationSeconds, OutSample)) return false;
+	OutSample.Time = Time;
+	return true;
+}
+
+float HandTrackingReplay::GetLatencySeconds(double Time) const
+{
+	double RecordingTime = GetRecordingTime(Time);
+	if (RecordingTime < 0.0) return -1.f;
+	int32 Last = FindSample(RecordingTime);
+	return Last < 0 ? 0.f : (float)(RecordingTime - Samples[Last].Time);
+}
@@ -0,0 +1,73 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "IHandTrackingSource.h"
+
+/**
+ * Hand tracking source that plays back a session written by HandTrackingRecorder, so the hand interaction code can be
+ * run and profiled without a Leap device.  The recording starts playing when Start is called.
+ */
+class HandTrackingReplay : public IHandTrackingSource
+{
+public:
+
+	HandTrackingReplay();
+	virtual ~HandTrackingReplay();
+
+	/* Loads a recording; returns false if it couldn't be read */
+	bool Load(const FString& FilePath);
+
+	virtual bool Start() override;
+
+	/* Starts playing as if Start had been called at Time (FPlatformTime::Seconds() clock), e.g. to step through a recording offline */
+	bool StartAt(double Time);
+
+	virtual void Stop() override;
+
+	virtual bool GetSampleAt(double Time, LeapHandSample& OutSample) const override;
+
+	virtual float GetLatencySeconds(double Time) const override;
+
+	/* If true the recording starts over when it ends, otherwise the last frame is held */
+	bool Looping;
+
+	/* How far past the last frame played GetSampleAt extrapolates, in seconds */
+	float MaxExtrapolationSeconds;
+
+private:
+
+	/* Time in the recording at game time Time; -1 if not playing */
+	double GetRecordingTime(double Time) const;
+
+	/* Index of the last frame at or before RecordingTime, -1 if RecordingTime is before the first frame */
+	int32 FindSample(double RecordingTime) const;
+
+	TArray<LeapHandSample> Samples; // times relative to the first frame
+	double StartTime; // game time the recording started playing, -1 if stopped
+};
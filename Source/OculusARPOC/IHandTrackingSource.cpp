@@ -0,0 +1,85 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "IHandTrackingSource.h"
+
+
+IHandTrackingSource::IHandTrackingSource()
+{
+}
+
+IHandTrackingSource::~IHandTrackingSource()
+{
+}
+
+bool IHandTrackingSource::InterpolateSamples(const LeapHandSample* Samples, int32 Count, double Time, float MaxExtrapolationSeconds, LeapHandSample& OutSample)
+{
+	if (Count == 0) return false;
+	const LeapHandSample& Newest = Samples[Count - 1];
+	if (Count == 1 || Time <= Samples[0].Time) {
+		OutSample = Time <= Samples[0].Time ? Samples[0] : Newest;
+		return true;
+	}
+	if (Time >= Newest.Time) {
+		// extrapolate along the last two samples
+		const LeapHandSample& Previous = Samples[Count - 2];
+		double Span = Newest.Time - Previous.Time;
+		double Lead = FMath::Min(Time - Newest.Time, (double)MaxExtrapolationSeconds);
+		float Alpha = Span > 0.0 ? (float)(1.0 + Lead / Span) : 1.f;
+		BlendSamples(Previous, Newest, Alpha, OutSample);
+		OutSample.Time = Newest.Time + Lead;
+		return true;
+	}
+	int32 After = Count - 1;
+	while (Samples[After - 1].Time > Time) {
+		After--;
+	}
+	const LeapHandSample& A = Samples[After - 1];
+	const LeapHandSample& B = Samples[After];
+	double Span = B.Time - A.Time;
+	BlendSamples(A, B, Span > 0.0 ? (float)((Time - A.Time) / Span) : 1.f, OutSample);
+	OutSample.Time = Time;
+	return true;
+}
+
+void IHandTrackingSource::BlendSamples(const LeapHandSample& A, const LeapHandSample& B, float Alpha, LeapHandSample& OutSample)
+{
+	// hands are taken from the nearer sample; a hand present in both is blended, one that appears or disappears is not
+	const LeapHandSample& Nearer = Alpha < 0.5f ? A : B;
+	OutSample = Nearer;
+	uint8 Both = A.HandsPresent & B.HandsPresent;
+	for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+		if ((Both & (1 << Side)) == 0) continue;
+		const float* FromA = (const float*)&A.Hands[Side];
+		const float* FromB = (const float*)&B.Hands[Side];
+		float* To = (float*)&OutSample.Hands[Side];
+		for (int32 k = 0; k < LeapHandSample::FloatsPerHand; k++) {
+			To[k] = FMath::Lerp(FromA[k], FromB[k], Alpha);
+		}
+	}
+}
@@ -0,0 +1,91 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+/**
+ * Compact copy of the hand data of one tracking frame, in Leap coordinates (millimeters).
+ */
+struct LeapHandSample
+{
+	enum Side { Left, Right, NumSides };
+	enum { NumFingers = 5, NumJoints = 5, TipJoint = NumJoints - 1 };
+
+	/* Only floats, so a hand can be blended or serialized as a flat array */
+	struct Hand
+	{
+		float PalmPosition[3];
+		float PalmVelocity[3];      // millimeters per second
+		float Joints[NumFingers][NumJoints][3]; // fingers by Leap::Finger::Type, joints from the base of the metacarpal to the tip
+		float TipVelocity[NumFingers][3];
+		float Confidence;
+		float PinchStrength;
+		float GrabStrength;
+	};
+
+	static const int32 FloatsPerHand = sizeof(Hand) / sizeof(float);
+
+	double Time;      // FPlatformTime::Seconds() clock
+	int64 FrameId;
+	uint8 HandsPresent; // bit per Side
+	Hand Hands[NumSides];
+
+	bool HasHand(Side Which) const { return (HandsPresent & (1 << Which)) != 0; }
+};
+
+/**
+ *  This is an interface representing a source of hand tracking frames to be used with a LeapInputReader:
+ *  the live Leap controller, or a recorded session replayed without the device.
+ */
+class IHandTrackingSource
+{
+public:
+
+	IHandTrackingSource();
+	virtual ~IHandTrackingSource();
+
+	/* Starts delivering frames; returns false if the source couldn't be started */
+	virtual bool Start() = 0;
+
+	virtual void Stop() = 0;
+
+	/* Hand state at Time (FPlatformTime::Seconds() clock).  Returns false if there is no frame yet. */
+	virtual bool GetSampleAt(double Time, LeapHandSample& OutSample) const = 0;
+
+	/* Time between the newest frame and Time, which is the input latency if Time is the display time; -1 if there is no frame yet */
+	virtual float GetLatencySeconds(double Time) const = 0;
+
+protected:
+
+	/*
+	 Hand state at Time from Samples (oldest first): interpolated between the two samples around Time, or extrapolated along
+	 the last two for at most MaxExtrapolationSeconds.  Returns false if Count is 0.
+	 */
+	static bool InterpolateSamples(const LeapHandSample* Samples, int32 Count, double Time, float MaxExtrapolationSeconds, LeapHandSample& OutSample);
+
+	static void BlendSamples(const LeapHandSample& A, const LeapHandSample& B, float Alpha, LeapHandSample& OutSample);
+};
@@ -41,7 +41,8 @@ public:
 	IVideoSource();
 	~IVideoSource();
 
-	virtual void GetFrameImage(uint8* DestinationImageBuffer) = 0;
+	/* Writes the next frame as BGRA into DestinationImageBuffer; returns false if no new frame was available (buffer untouched) */
+	virtual bool GetFrameImage(uint8* DestinationImageBuffer) = 0;
 
     virtual uint16 GetVideoWidth() = 0;
 
@@ -61,7 +62,8 @@ public:
 
 	virtual void  SetIsCameraUpsideDown(bool CameraUpsideDown) = 0;
 
-	virtual void Init() = 0;
+	/* Opens the source; may block for a while, so it is run off the game thread.  Returns false if the source couldn't be opened. */
+	virtual bool Init() = 0;
 
 	virtual void Close() = 0;
 
@@ -0,0 +1,74 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "ImageDownscaler.h"
+#include "ARTraceRecorder.h"
+#include "opencv2/imgproc/imgproc.hpp"
+
+void ImageDownscaler::Resize(const cv::Mat& Source, cv::Mat& Destination, cv::Size DestinationSize)
+{
+	AR_TRACE_SCOPE("ImageDownscaler::Resize");
+	if (Source.size() == DestinationSize) {
+		Source.copyTo(Destination);
+	}
+	else if (Source.depth() == CV_8U && Source.cols == DestinationSize.width * 2 && Source.rows == DestinationSize.height * 2) {
+		HalveAreaAverage(Source, Destination);
+	}
+	else if (DestinationSize.width < Source.cols && DestinationSize.height < Source.rows) {
+		cv::resize(Source, Destination, DestinationSize, 0, 0, cv::INTER_AREA);
+	}
+	else {
+		cv::resize(Source, Destination, DestinationSize, 0, 0, cv::INTER_LINEAR);
+	}
+}
+
+void ImageDownscaler::HalveAreaAverage(const cv::Mat& Source, cv::Mat& Destination)
+{
+	check(Source.depth() == CV_8U && Source.cols % 2 == 0 && Source.rows % 2 == 0);
+	const int Channels = Source.channels();
+	const int DestinationWidth = Source.cols / 2;
+	const int DestinationHeight = Source.rows / 2;
+	Destination.create(DestinationHeight, DestinationWidth, Source.type());
+	for (int y = 0; y < DestinationHeight; y++)
+	{
+		const uint8* Row0 = Source.ptr<uint8>(2 * y);
+		const uint8* Row1 = Source.ptr<uint8>(2 * y + 1);
+		uint8* DestinationPointer = Destination.ptr<uint8>(y);
+		for (int x = 0; x < DestinationWidth; x++)
+		{
+			for (int c = 0; c < Channels; c++)
+			{
+				// +2 rounds to nearest
+				*DestinationPointer++ = (uint8)((Row0[c] + Row0[c + Channels] + Row1[c] + Row1[c + Channels] + 2) >> 2);
+			}
+			Row0 += 2 * Channels;
+			Row1 += 2 * Channels;
+		}
+	}
+}
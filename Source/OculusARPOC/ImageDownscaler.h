@@ -0,0 +1,52 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+#include "opencv2/core/core.hpp"
+
+/**
+ * Resamples camera frames to the resolution a consumer needs (the marker detector or the display texture).
+ * Halving an 8 bit image, the common case, goes through a hand written 2x2 box filter; other reductions use
+ * OpenCV area interpolation and enlargements use bilinear interpolation.
+ * Destination images are reused, so with a fixed size there are no allocations after the first frame.
+ */
+class ImageDownscaler
+{
+public:
+
+	/*
+	 Resizes Source into Destination (allocated only if its size or type differ).  Source and Destination must not share data.
+	 */
+	static void Resize(const cv::Mat& Source, cv::Mat& Destination, cv::Size DestinationSize);
+
+	/*
+	 Averages every 2x2 block of Source into one pixel of Destination.  Source must be 8 bit with even width and height.
+	 */
+	static void HalveAreaAverage(const cv::Mat& Source, cv::Mat& Destination);
+};
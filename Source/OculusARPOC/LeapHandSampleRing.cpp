@@ -0,0 +1,62 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "LeapHandSampleRing.h"
+
+LeapHandSampleRing::LeapHandSampleRing()
+{
+	WriteIndex = 0;
+}
+
+void LeapHandSampleRing::Push(const LeapHandSample& Sample)
+{
+	// the reader only looks at the newest samples, so the oldest is overwritten rather than waiting for it
+	int32 Write = WriteIndex;
+	Samples[Write & (Capacity - 1)] = Sample;
+	FPlatformMisc::MemoryBarrier(); // publish the sample before the index
+	WriteIndex = Write + 1;
+}
+
+int32 LeapHandSampleRing::CopyNewest(LeapHandSample* OutSamples, int32 Count) const
+{
+	Count = FMath::Min(Count, Capacity - 1);
+	for (;;) {
+		int32 Write = WriteIndex;
+		FPlatformMisc::MemoryBarrier();
+		int32 First = FMath::Max(0, Write - Count);
+		for (int32 i = First; i < Write; i++) {
+			OutSamples[i - First] = Samples[i & (Capacity - 1)];
+		}
+		FPlatformMisc::MemoryBarrier();
+		// retry if the producer wrapped around onto a slot while it was being copied; with WriteIndex at First + Capacity
+		// it is already writing the slot of First
+		if (WriteIndex - First < Capacity) {
+			return Write - First;
+		}
+	}
+}
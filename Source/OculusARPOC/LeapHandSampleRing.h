@@ -0,0 +1,58 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "IHandTrackingSource.h"
+
+/**
+ * Lock-free ring of the newest LeapHandSamples, for one producer thread (LeapHandSampler's polling thread) and one
+ * consumer thread (the game thread).  The producer never waits: it overwrites the oldest sample, and a reader that
+ * was copying that slot copies again.
+ */
+class LeapHandSampleRing
+{
+public:
+
+	static const int32 Capacity = 256; // power of two; a couple of seconds of frames
+
+	LeapHandSampleRing();
+
+	/* Producer only */
+	void Push(const LeapHandSample& Sample);
+
+	/*
+	 Copies the Count newest samples into OutSamples (oldest first); returns the number copied.  At most Capacity - 1
+	 are copied: the producer may be writing the slot of the oldest one.
+	 */
+	int32 CopyNewest(LeapHandSample* OutSamples, int32 Count) const;
+
+private:
+
+	LeapHandSample Samples[Capacity];
+	volatile int32 WriteIndex;
+};
@@ -0,0 +1,194 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "LeapHandSampler.h"
+#include "HandTrackingRecorder.h"
+#include "ARTraceRecorder.h"
+#include "ARPipelineStats.h"
+
+static const int32 LeapHistorySize = 60;       // frames kept by the Leap service
+static const int32 InterpolationWindow = 16;   // newest samples searched by GetSampleAt, well over 100 ms at full rate
+static const double ClockDriftPerFrame = 1e-6; // lets the clock offset follow a device clock running faster than ours
+
+LeapHandSampler::LeapHandSampler(Leap::Controller* Controller)
+{
+	this->Controller = Controller;
+	MaxExtrapolationSeconds = 0.05f;
+	PollIntervalSeconds = 0.002f;
+	LastFrameId = -1;
+	ClockOffset = 0.0;
+	HasClockOffset = false;
+	StopRequested = 0;
+	Recorder = NULL;
+	Task = NULL;
+	Thread = NULL;
+}
+
+LeapHandSampler::~LeapHandSampler()
+{
+	Stop();
+}
+
+bool LeapHandSampler::Start()
+{
+	if (Thread == NULL) {
+		Task = new PollingTask(this);
+		Thread = FRunnableThread::Create(Task, TEXT("LeapHandSampler"), 0, TPri_AboveNormal);
+	}
+	return Thread != NULL;
+}
+
+void LeapHandSampler::SetRecorder(HandTrackingRecorder* Recorder)
+{
+	FPlatformAtomics::InterlockedExchangePtr((void**)&this->Recorder, Recorder);
+}
+
+void LeapHandSampler::Stop()
+{
+	if (Thread != NULL) {
+		Thread->Kill(true); // calls PollingTask::Stop and waits
+		delete Thread;
+		delete Task;
+		Thread = NULL;
+		Task = NULL;
+		StopRequested = 0;
+	}
+}
+
+uint32 LeapHandSampler::PollingTask::Run()
+{
+	AR_TRACE_THREAD_NAME("LeapHandSampler");
+	while (!Owner->StopRequested) {
+		Owner->Poll();
+		FPlatformProcess::Sleep(Owner->PollIntervalSeconds);
+	}
+	return 0;
+}
+
+void LeapHandSampler::PollingTask::Stop()
+{
+	FPlatformAtomics::InterlockedExchange(&Owner->StopRequested, 1);
+}
+
+void LeapHandSampler::Poll()
+{
+	Leap::Frame Latest = Controller->frame();
+	if (!Latest.isValid() || Latest.id() == LastFrameId) return;
+	AR_TRACE_SCOPE("LeapHandSampler::Poll");
+	double Now = FPlatformTime::Seconds();
+	ARPipelineStats::Get().MarkNow(ARPipelineStats::LastLeapFrameTime);
+
+	// the newest frame arrived just now; the smallest arrival - device time seen is the best estimate of the clock offset
+	double Observed = Now - Latest.timestamp() * 1e-6;
+	ClockOffset = HasClockOffset ? FMath::Min(ClockOffset + ClockDriftPerFrame, Observed) : Observed;
+	HasClockOffset = true;
+
+	// frames that arrived since the last poll are still in the controller's history
+	int32 Missed = 0;
+	if (LastFrameId >= 0) {
+		while (Missed + 1 < LeapHistorySize) {
+			Leap::Frame Older = Controller->frame(Missed + 1);
+			if (!Older.isValid() || Older.id() <= LastFrameId) break;
+			Missed++;
+		}
+	}
+	LeapHandSample Sample;
+	for (int32 History = Missed; History > 0; History--) {
+		ConvertFrame(Controller->frame(History), Now, Sample);
+		Push(Sample);
+	}
+	ConvertFrame(Latest, Now, Sample);
+	Push(Sample);
+	LastFrameId = Latest.id();
+}
+
+void LeapHandSampler::ConvertFrame(const Leap::Frame& Frame, double ArrivalTime, LeapHandSample& OutSample)
+{
+	OutSample.Time = FMath::Min(ArrivalTime, Frame.timestamp() * 1e-6 + ClockOffset);
+	OutSample.FrameId = Frame.id();
+	OutSample.HandsPresent = 0;
+	const Leap::HandList Hands = Frame.hands();
+	for (Leap::HandList::const_iterator HandsIter = Hands.begin(); HandsIter != Hands.end(); HandsIter++) {
+		const Leap::Hand Hand = *HandsIter;
+		int32 Side = Hand.isLeft() ? LeapHandSample::Left : LeapHandSample::Right;
+		OutSample.HandsPresent |= 1 << Side;
+		LeapHandSample::Hand& Out = OutSample.Hands[Side];
+		CopyVector(Hand.palmPosition(), Out.PalmPosition);
+		CopyVector(Hand.palmVelocity(), Out.PalmVelocity);
+		Out.Confidence = Hand.confidence();
+		Out.PinchStrength = Hand.pinchStrength();
+		Out.GrabStrength = Hand.grabStrength();
+		const Leap::FingerList Fingers = Hand.fingers();
+		for (Leap::FingerList::const_iterator FingersIter = Fingers.begin(); FingersIter != Fingers.end(); FingersIter++) {
+			const Leap::Finger Finger = *FingersIter;
+			int32 Type = Finger.type();
+			// joint 0 is the base of the metacarpal, joint b + 1 the end of bone b; the tip is the finger's own tip position
+			CopyVector(Finger.bone(Leap::Bone::TYPE_METACARPAL).prevJoint(), Out.Joints[Type][0]);
+			for (int32 Bone = Leap::Bone::TYPE_METACARPAL; Bone < Leap::Bone::TYPE_DISTAL; Bone++) {
+				CopyVector(Finger.bone((Leap::Bone::Type)Bone).nextJoint(), Out.Joints[Type][Bone + 1]);
+			}
+			CopyVector(Finger.tipPosition(), Out.Joints[Type][LeapHandSample::TipJoint]);
+			CopyVector(Finger.tipVelocity(), Out.TipVelocity[Type]);
+		}
+	}
+}
+
+void LeapHandSampler::CopyVector(const Leap::Vector& In, float* Out)
+{
+	Out[0] = In.x;
+	Out[1] = In.y;
+	Out[2] = In.z;
+}
+
+void LeapHandSampler::Push(const LeapHandSample& Sample)
+{
+	Ring.Push(Sample);
+	HandTrackingRecorder* ActiveRecorder = Recorder;
+	if (ActiveRecorder != NULL) {
+		ActiveRecorder->Record(Sample);
+	}
+}
+
+bool LeapHandSampler::GetLatestSample(LeapHandSample& OutSample) const
+{
+	return Ring.CopyNewest(&OutSample, 1) == 1;
+}
+
+float LeapHandSampler::GetLatencySeconds(double Time) const
+{
+	LeapHandSample Latest;
+	if (!GetLatestSample(Latest)) return -1.f;
+	return (float)(Time - Latest.Time);
+}
+
+bool LeapHandSampler::GetSampleAt(double Time, LeapHandSample& OutSample) const
+{
+	LeapHandSample Window[InterpolationWindow];
+	int32 Count = Ring.CopyNewest(Window, InterpolationWindow);
+	return InterpolateSamples(Window, Count, Time, MaxExtrapolationSeconds, OutSample);
+}
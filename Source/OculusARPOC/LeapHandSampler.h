@@ -0,0 +1,108 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "Leap.h"
+#include "IHandTrackingSource.h"
+#include "LeapHandSampleRing.h"
+
+class HandTrackingRecorder;
+
+/**
+ * The live hand tracking source.  Polls the Leap controller on a background thread so every frame the service delivers
+ * is kept, not just the one that happens to be current when the game thread ticks.  Frames are stored as LeapHandSamples in a LeapHandSampleRing
+ * and the game thread asks for the hand state at the time the frame will be displayed,
+ * interpolated between the two samples around it or extrapolated from the last two.
+ *
+ * Device timestamps keep the spacing between samples exact.  They are mapped to the game clock with the smallest
+ * offset seen between arrival time and device time, so latencies are measured from the moment a frame reaches us.
+ */
+class LeapHandSampler : public IHandTrackingSource
+{
+public:
+
+	LeapHandSampler(Leap::Controller* Controller);
+	virtual ~LeapHandSampler();
+
+	virtual bool Start() override;
+
+	/* Stops the polling thread, waiting for it to exit */
+	virtual void Stop() override;
+
+	virtual bool GetSampleAt(double Time, LeapHandSample& OutSample) const override;
+
+	virtual float GetLatencySeconds(double Time) const override;
+
+	/* Newest sample received; returns false if none yet */
+	bool GetLatestSample(LeapHandSample& OutSample) const;
+
+	/* Every frame received from now on is also handed to Recorder (on the polling thread); NULL stops recording */
+	void SetRecorder(HandTrackingRecorder* Recorder);
+
+	/* How far past the newest sample GetSampleAt extrapolates, in seconds.  Later queries hold the extrapolated state. */
+	float MaxExtrapolationSeconds;
+
+	/* Sleep between polls of the controller, in seconds.  The Leap service runs at up to ~120 Hz. */
+	float PollIntervalSeconds;
+
+private:
+
+	class PollingTask : public FRunnable
+	{
+	public:
+		PollingTask(LeapHandSampler* Owner) : Owner(Owner) {}
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+	private:
+		LeapHandSampler* Owner;
+	};
+
+	/* Pushes the frames received since the last poll, oldest first */
+	void Poll();
+
+	void ConvertFrame(const Leap::Frame& Frame, double ArrivalTime, LeapHandSample& OutSample);
+
+	static void CopyVector(const Leap::Vector& In, float* Out);
+
+	void Push(const LeapHandSample& Sample);
+
+	Leap::Controller* Controller;
+
+	LeapHandSampleRing Ring;
+
+	HandTrackingRecorder* volatile Recorder;
+
+	// polling thread only
+	int64 LastFrameId;
+	double ClockOffset; // game clock - device clock, in seconds
+	bool HasClockOffset;
+
+	volatile int32 StopRequested;
+	PollingTask* Task;
+	FRunnableThread* Thread;
+};
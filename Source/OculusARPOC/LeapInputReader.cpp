@@ -30,17 +30,22 @@ or implied, of Leonardo Malave.
 #include "Engine.h"
 #include "IHeadMountedDisplay.h"
 #include "LeapInputReader.h"
+#include "ARTraceRecorder.h"
+#include "ARPipelineStats.h"
+#include "ARDebugDraw.h"
 
-LeapInputReader::LeapInputReader(Leap::Controller* Controller, ACharacter* Character)
+LeapInputReader::LeapInputReader(IHandTrackingSource* Source, ACharacter* Character)
 {
-    this->Controller = Controller;
+    this->Source = Source;
     this->Character = Character;
     LeapDrawSimpleHands = true;
     LeapToUnrealScalingFactor = 0.1;  // Leap Unit is a millimiter and Unreal units are centimeters
     // NOTE: Mount offset is still in Leap coordinates, not Unreal units!!
     LeapMountOffset = FVector(150.f, 0.f, -20.f);
     LeapHandOffset = FVector(10.0, 0.0, 45.0); // note: x=forward, y=right, z=up
+    MaxSampleAgeSeconds = 0.25f;
     ValidInputLastFrame = false;
+    InputLatencySeconds = -1.f;
 }
 
 LeapInputReader::~LeapInputReader()
@@ -51,116 +56,99 @@ bool LeapInputReader::IsValidInputLastFrame() {
     return ValidInputLastFrame;
 }
 
+float LeapInputReader::GetInputLatencySeconds() {
+    return InputLatencySeconds;
+}
+
 
+// only the middle finger is used for leap input
 FVector LeapInputReader::GetLeftPalmLocation_WorldSpace() {
-    return LeftPalmLocation_WorldSpace;
+    return Skeleton.WorldPositions.Get(HandSkeleton::PalmIndex(LeapHandSample::Left));
 }
 
 FVector LeapInputReader::GetLeftFingerLocation_WorldSpace() {
-    return LeftFingerLocation_WorldSpace;
+    return Skeleton.WorldPositions.Get(HandSkeleton::TipIndex(LeapHandSample::Left, Leap::Finger::TYPE_MIDDLE));
 }
 
 FVector LeapInputReader::GetRightPalmLocation_WorldSpace() {
-    return RightPalmLocation_WorldSpace;
+    return Skeleton.WorldPositions.Get(HandSkeleton::PalmIndex(LeapHandSample::Right));
 }
 
 FVector LeapInputReader::GetRightFingerLocation_WorldSpace() {
-    return RightFingerLocation_WorldSpace;
+    return Skeleton.WorldPositions.Get(HandSkeleton::TipIndex(LeapHandSample::Right, Leap::Finger::TYPE_MIDDLE));
 }
 
 FVector LeapInputReader::GetLeftPalmLocation_CharacterSpace() {
-    return LeftPalmLocation_CharacterSpace;
+    return Skeleton.CharacterPositions.Get(HandSkeleton::PalmIndex(LeapHandSample::Left));
 }
 
 FVector LeapInputReader::GetLeftFingerLocation_CharacterSpace() {
-    return LeftFingerLocation_CharacterSpace;
+    return Skeleton.CharacterPositions.Get(HandSkeleton::TipIndex(LeapHandSample::Left, Leap::Finger::TYPE_MIDDLE));
 }
 
 FVector LeapInputReader::GetRightPalmLocation_CharacterSpace() {
-    return RightPalmLocation_CharacterSpace;
+    return Skeleton.CharacterPositions.Get(HandSkeleton::PalmIndex(LeapHandSample::Right));
 }
 
 FVector LeapInputReader::GetRightFingerLocation_CharacterSpace() {
-    return RightFingerLocation_CharacterSpace;
+    return Skeleton.CharacterPositions.Get(HandSkeleton::TipIndex(LeapHandSample::Right, Leap::Finger::TYPE_MIDDLE));
 }
 
-void LeapInputReader::UpdateHandLocations()
+void LeapInputReader::UpdateHandLocations(double DisplayTime)
 {
-    // First just get hand and finger positions and draw the hands
-    Leap::Frame Frame = Controller->frame();
-    Leap::HandList Hands = Frame.hands();
-    Leap::PointableList Pointables = Frame.pointables();
-    Leap::GestureList gestures = Frame.gestures();
-    FColor handColor = FColor::Magenta;
-    FColor fingertipColor = handColor;
-    
-    UWorld* World = Character->GetWorld();
-   
+    AR_TRACE_SCOPE("LeapInputReader::UpdateHandLocations");
+    // First just get hand and finger positions (as they will be when this frame is displayed) and draw the hands
     ValidInputLastFrame = false;
-    for (Leap::HandList::const_iterator HandsIter = Hands.begin(); HandsIter != Hands.end(); HandsIter++) {
-        ValidInputLastFrame = true; // for now valid if hands detected.  in future, will check if movement is "natural"
-        Leap::Hand Hand = (Leap::Hand)(*HandsIter);
-        Leap::Vector palmPosition = Hand.palmPosition();
-        FVector palmLocation = LeapPositionToUnrealLocation(palmPosition, LeapHandOffset);
-        if (Hand.isLeft()) {
-            LeftPalmLocation_WorldSpace = palmLocation;
-        }
-        else {
-            RightPalmLocation_WorldSpace = palmLocation;
-        }
-        if (LeapDrawSimpleHands) {
-            DrawDebugSphere(World, palmLocation, 1.0, 12, handColor);
-        }
-        Leap::FingerList Fingers = Hand.fingers();
-        for (Leap::FingerList::const_iterator FingersIter = Fingers.begin(); FingersIter != Fingers.end(); FingersIter++) {
-            Leap::Finger finger = (Leap::Finger)(*FingersIter);
-            Leap::Vector tipPosition = finger.tipPosition();
-            FString fingerPosition(tipPosition.toString().c_str());
-            FVector fingerLocation = LeapPositionToUnrealLocation(tipPosition, LeapHandOffset);
-            if (finger.type() == Leap::Finger::TYPE_MIDDLE) { // only middle finger used for leap input
-                fingertipColor = FColor::Red;
-               if (Hand.isLeft()) {
-                    LeftFingerLocation_WorldSpace = fingerLocation;
-                }
-                else {
-                    RightFingerLocation_WorldSpace = fingerLocation;
-                }
-            }
-            else {
-                fingertipColor = handColor;
-            }
-            if (LeapDrawSimpleHands) {
-                DrawDebugSphere(World, fingerLocation, 0.5, 12, fingertipColor);
-                DrawDebugLine(World, palmLocation, fingerLocation, handColor);
-            }
+    InputLatencySeconds = Source->GetLatencySeconds(DisplayTime);
+    if (!Source->GetSampleAt(DisplayTime, Sample) || InputLatencySeconds > MaxSampleAgeSeconds) {
+        return;
+    }
+    ARPipelineStats::Get().Set(ARPipelineStats::LeapInputLatencyMs, InputLatencySeconds * 1000.f);
+    AR_TRACE_COUNTER("LeapInputLatencyMs", InputLatencySeconds * 1000.f);
+    ValidInputLastFrame = Sample.HandsPresent != 0; // for now valid if hands detected.  in future, will check if movement is "natural"
+    if (!ValidInputLastFrame) {
+        return;
+    }
+
+    // the whole skeleton goes through the same transforms, so they're set up once and applied in one batch
+    Skeleton.SetFromSample(Sample);
+    Skeleton.UpdateTransforms(GetLeapToWorldTransform(), Character->GetTransform().ToInverseMatrixWithScale());
+    if (LeapDrawSimpleHands && AR_DEBUG_DRAW_IS_ENABLED(Hands)) {
+        DrawSimpleHands();
+    }
+}
+
+void LeapInputReader::DrawSimpleHands()
+{
+    FColor handColor = FColor::Magenta;
+    for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+        if (!Skeleton.HasHand(Side)) continue;
+        FVector palmLocation = Skeleton.WorldPositions.Get(HandSkeleton::PalmIndex(Side));
+        AR_DEBUG_SPHERE(Hands, palmLocation, 1.0, handColor);
+        for (int32 FingerType = 0; FingerType < LeapHandSample::NumFingers; FingerType++) {
+            FVector fingerLocation = Skeleton.WorldPositions.Get(HandSkeleton::TipIndex(Side, FingerType));
+            FColor fingertipColor = FingerType == Leap::Finger::TYPE_MIDDLE ? FColor::Red : handColor;
+            AR_DEBUG_SPHERE(Hands, fingerLocation, 0.5, fingertipColor);
+            AR_DEBUG_LINE(Hands, palmLocation, fingerLocation, handColor);
         }
     }
-    // end result: get hand/finger locations in Character space
-    FTransform CharacterTransform = Character->GetTransform();
-    LeftPalmLocation_CharacterSpace = CharacterTransform.InverseTransformPosition(LeftPalmLocation_WorldSpace);
-    LeftFingerLocation_CharacterSpace = CharacterTransform.InverseTransformPosition(LeftFingerLocation_WorldSpace);
-    RightPalmLocation_CharacterSpace = CharacterTransform.InverseTransformPosition(RightPalmLocation_WorldSpace);
-    RightFingerLocation_CharacterSpace = CharacterTransform.InverseTransformPosition(RightFingerLocation_WorldSpace);
-    
 }
 
 // NOTE: because of the different coordinate systems for Leap forward = Y whereas for a character Forward = X
-FVector LeapInputReader::LeapPositionToUnrealLocation(Leap::Vector LeapVector, FVector UnrealOffset) {
+FMatrix LeapInputReader::GetLeapToWorldTransform() const {
     
-    // Adjust for mount offset and also current HMD orientation
-    // NOTE: reverse X and Y because of different coordinate systems
-    FVector LeapVectorCorrected = FVector(LeapVector.y, LeapVector.x, LeapVector.z) + LeapMountOffset;
-    if (GEngine->HMDDevice.IsValid() && GEngine->HMDDevice->IsHeadTrackingAllowed())
+    // Adjust for mount offset and also current HMD orientation (queried once for all the points of the frame)
+    bool UseHMDOrientation = GEngine->HMDDevice.IsValid() && GEngine->HMDDevice->IsHeadTrackingAllowed();
+    FRotator HMDRotator = FRotator::ZeroRotator;
+    if (UseHMDOrientation)
     {
         FQuat HMDOrientation;
         FVector HMDPosition;
         
         GEngine->HMDDevice->GetCurrentOrientationAndPosition(HMDOrientation, HMDPosition);
         
-        FRotator HMDRotator = HMDOrientation.Rotator();
-        LeapVectorCorrected = HMDRotator.UnrotateVector(LeapVectorCorrected);  // TODO: adjust for leap rotation not being the same as HMD rotation
+        HMDRotator = HMDOrientation.Rotator();
     }
-    FVector ScaledLeapVector = LeapVectorCorrected * LeapToUnrealScalingFactor;
-    FVector UnrealLocation = Character->GetActorLocation() - (Character->GetActorRightVector() * ScaledLeapVector.Y) + (Character->GetActorForwardVector() * (ScaledLeapVector.X + UnrealOffset.X)) - (Character->GetActorUpVector() * (ScaledLeapVector.Z - UnrealOffset.Z));
-    return UnrealLocation;
-}
\ No newline at end of file
+    return HandSkeleton::MakeLeapToWorldTransform(HMDRotator, Character->GetActorLocation(), Character->GetActorForwardVector(),
+        Character->GetActorRightVector(), Character->GetActorUpVector(), LeapMountOffset, LeapHandOffset, LeapToUnrealScalingFactor);
+}
@@ -26,6 +26,8 @@ authors and should not be interpreted as representing official policies, either
 or implied, of Leonardo Malave.
 ********************************/
 #include "Leap.h"
+#include "IHandTrackingSource.h"
+#include "HandSkeleton.h"
 
 #pragma once
 
@@ -36,18 +38,19 @@ class LeapInputReader
 {
 public:
     /* 
-     Constructor takes two parameters:  a Leap::Controller and a Character
-     -- the Leap::Controller parameter is so that the controller can be initialized outside of this class, since the Leap::Controller should only be initialized once in an application
+     Constructor takes two parameters:  a hand tracking source and a Character
+     -- the source parameter is so that the source can be created and started outside of this class: the live Leap controller (which should only be initialized once in an application) or a recorded session being replayed
      -- the Character parameter is so that the position of the Leap hands/fingers can be returned in the coordinate space of the Character.  This makes it easier to calculate the desired movement based on these character-space coordinates.
      */
-    LeapInputReader(Leap::Controller* Controller,  ACharacter* Character);
+    LeapInputReader(IHandTrackingSource* Source,  ACharacter* Character);
 	~LeapInputReader();
     
     /*
      As the method name implies, this method calculates the location coordinates in world space of the Leap hand and finger coordinates.  Note that for now this assumes a scaling factor of 0.1, since Leap coordinates are always in millimeters and the default Unreal world scale is 1 Unreal Unit = 1 centimeter.  
      Note that the intention is that this method should be called first, and then the values retrieved through the available Getter methods. 
+     Hands are sampled at DisplayTime (FPlatformTime::Seconds() clock), interpolated between the Leap frames around it or extrapolated from the newest ones.
      */
-    void UpdateHandLocations();
+    void UpdateHandLocations(double DisplayTime);
     
     FVector GetLeftPalmLocation_WorldSpace();
     FVector GetLeftFingerLocation_WorldSpace();
@@ -58,6 +61,12 @@ public:
     FVector GetRightPalmLocation_CharacterSpace();
     FVector GetRightFingerLocation_CharacterSpace();
     bool IsValidInputLastFrame();
+
+    /* Both hands for the last update, with every joint in Leap, world and Character space */
+    const HandSkeleton& GetHandSkeleton() const { return Skeleton; }
+
+    /* Time from the newest Leap frame to the display time of the last update, in seconds; -1 before the first frame */
+    float GetInputLatencySeconds();
     
     
     /*
@@ -81,26 +90,28 @@ public:
      Offset to account for the fact the Leap is head mounted so the proper location to draw the hand to look natural will require some trial and error.
      */
     FVector LeapHandOffset;
+
+    /*
+     Hands are treated as lost if the newest Leap frame is older than this (seconds), e.g. when the service stops sending frames
+     */
+    float MaxSampleAgeSeconds;
     
     
 protected:
 
     /*
-     Translates the Leap coordinates to Unreal location coordinates. 
+     Translation of Leap coordinates to Unreal location coordinates for this frame (character pose, HMD orientation and offsets).
      */
-    FVector LeapPositionToUnrealLocation(Leap::Vector LeapVector, FVector UnrealOffset);
+    FMatrix GetLeapToWorldTransform() const;
+
+    void DrawSimpleHands();
     
     ACharacter* Character;
-    Leap::Controller* Controller;
+    IHandTrackingSource* Source;
 
     bool ValidInputLastFrame;
-    FVector LeftPalmLocation_WorldSpace;
-    FVector LeftFingerLocation_WorldSpace;
-    FVector RightPalmLocation_WorldSpace;
-    FVector RightFingerLocation_WorldSpace;
-    FVector LeftPalmLocation_CharacterSpace;
-    FVector LeftFingerLocation_CharacterSpace;
-    FVector RightPalmLocation_CharacterSpace;
-    FVector RightFingerLocation_CharacterSpace;
+    float InputLatencySeconds;
+    LeapHandSample Sample;
+    HandSkeleton Skeleton;
 
 };
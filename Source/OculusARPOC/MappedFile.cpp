@@ -0,0 +1,125 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "MappedFile.h"
+
+#if PLATFORM_WINDOWS
+#include "AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "HideWindowsPlatformTypes.h"
+#elif PLATFORM_MAC || PLATFORM_LINUX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MAPPED_FILE_POSIX 1
+#endif
+
+MappedFile::MappedFile()
+	: Data(NULL), Size(0), IsMapped(false)
+{
+#if PLATFORM_WINDOWS
+	FileHandle = NULL;
+	MappingHandle = NULL;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const FString& FilePath)
+{
+	Close();
+	FString FullPath = FPaths::ConvertRelativePathToFull(FilePath);
+#if PLATFORM_WINDOWS
+	HANDLE File = CreateFileW(*FullPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (File != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER FileSize;
+		HANDLE Mapping = NULL;
+		if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0) {
+			Mapping = CreateFileMappingW(File, NULL, PAGE_READONLY, 0, 0, NULL);
+		}
+		void* View = Mapping ? MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (View != NULL) {
+			FileHandle = File;
+			MappingHandle = Mapping;
+			Data = (const uint8*)View;
+			Size = FileSize.QuadPart;
+			IsMapped = true;
+			return true;
+		}
+		if (Mapping) CloseHandle(Mapping);
+		CloseHandle(File);
+	}
+#elif MAPPED_FILE_POSIX
+	int Descriptor = open(TCHAR_TO_UTF8(*FullPath), O_RDONLY);
+	if (Descriptor >= 0) {
+		struct stat FileStat;
+		void* View = MAP_FAILED;
+		if (fstat(Descriptor, &FileStat) == 0 && FileStat.st_size > 0) {
+			View = mmap(NULL, FileStat.st_size, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+		}
+		close(Descriptor); // the mapping stays valid without the descriptor
+		if (View != MAP_FAILED) {
+			Data = (const uint8*)View;
+			Size = FileStat.st_size;
+			IsMapped = true;
+			return true;
+		}
+	}
+#endif
+	if (!FFileHelper::LoadFileToArray(FallbackData, *FullPath, FILEREAD_Silent) || FallbackData.Num() == 0) {
+		FallbackData.Empty();
+		return false;
+	}
+	Data = FallbackData.GetData();
+	Size = FallbackData.Num();
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (IsMapped) {
+#if PLATFORM_WINDOWS
+		UnmapViewOfFile(Data);
+		CloseHandle(MappingHandle);
+		CloseHandle(FileHandle);
+		MappingHandle = NULL;
+		FileHandle = NULL;
+#elif MAPPED_FILE_POSIX
+		munmap((void*)Data, Size);
+#endif
+	}
+	FallbackData.Empty();
+	Data = NULL;
+	Size = 0;
+	IsMapped = false;
+}
@@ -0,0 +1,602 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "MarkerMap.h"
+#include "ARTraceRecorder.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMarkerMap, Log, All);
+
+// the camera has its own tracker, so any key will do
+static const int CameraTrackerKey = 0;
+
+// Levenberg-Marquardt iterations per marker and alternation
+static const int32 MarkerIterations = 5;
+
+// corner offsets from the marker center in units of half the marker side, in the order used by aruco::Marker::calculateExtrinsics
+static const float CornerOffsets[4][2] = { { -1, -1 }, { -1, 1 }, { 1, 1 }, { 1, -1 } };
+
+/* aruco rotates the X axis of a marker's pose so that Y is perpendicular to it (Marker::rotateXAxis); this undoes that */
+static void GetRawMarkerPose(const aruco::MarkerRecord& Marker, cv::Mat& OutRvec, cv::Mat& OutTvec)
+{
+	static const cv::Mat UndoRotation = (cv::Mat_<double>(3, 1) << -CV_PI / 2, 0, 0);
+	static const cv::Mat NoTranslation = cv::Mat::zeros(3, 1, CV_64F);
+	cv::Mat MarkerRvec, MarkerTvec;
+	cv::Mat(3, 1, CV_32F, (void*)Marker.rvec).convertTo(MarkerRvec, CV_64F);
+	cv::Mat(3, 1, CV_32F, (void*)Marker.tvec).convertTo(MarkerTvec, CV_64F);
+	cv::composeRT(UndoRotation, NoTranslation, MarkerRvec, MarkerTvec, OutRvec, OutTvec);
+}
+
+/* Inverse of a rigid transform given as rvec/tvec */
+static void InvertPose(const cv::Mat& InRvec, const cv::Mat& InTvec, cv::Mat& OutRvec, cv::Mat& OutTvec)
+{
+	cv::Mat Rotation;
+	cv::Rodrigues(InRvec, Rotation);
+	Rotation = Rotation.t();
+	OutTvec = -Rotation * InTvec;
+	cv::Rodrigues(Rotation, OutRvec);
+}
+
+static double HuberCost(double Error, double Threshold)
+{
+	return Error <= Threshold ? 0.5 * Error * Error : Threshold * (Error - 0.5 * Threshold);
+}
+
+MarkerMap::MarkerMap()
+{
+	MaxReprojectionError = 4.f;
+	KeyframeDistance = 0.1f;
+	KeyframeAngle = 10.f;
+	MaxKeyframes = 500;
+	RefinementIterations = 10;
+	RobustThreshold = 2.f;
+	Localized = false;
+	ReprojectionError = 0.f;
+	RefinedError = 0.f;
+	FocalLength = 1.0;
+	AddedMarkerThisFrame = false;
+	KeyframesSinceRefinement = 0;
+	Task = NULL;
+	Thread = NULL;
+	HasPending = false;
+	HasResult = false;
+	ResultError = 0.0;
+	PendingThreshold = 0.0;
+	Generation = 0;
+	PendingGeneration = 0;
+	ResultGeneration = 0;
+	StopRequested = 0;
+	WorkEvent = FPlatformProcess::CreateSynchEvent();
+}
+
+MarkerMap::~MarkerMap()
+{
+	StopRefinement();
+	delete WorkEvent;
+}
+
+void MarkerMap::StopRefinement()
+{
+	if (Thread != NULL) {
+		Thread->Kill(true); // calls RefinementTask::Stop and waits
+		delete Thread;
+		delete Task;
+		Thread = NULL;
+		Task = NULL;
+		StopRequested = 0;
+	}
+}
+
+FString MarkerMap::GetMapPath(const FString& Name)
+{
+	return FPaths::GameSavedDir() / TEXT("MarkerMaps") / (Name + TEXT(".bin"));
+}
+
+void MarkerMap::Clear()
+{
+	Map.Empty();
+	IdToIndex.Empty();
+	CameraTracker.reset();
+	Localized = false;
+	RefinedError = 0.f;
+	KeyframesSinceRefinement = 0;
+	FScopeLock ScopeLock(&Lock);
+	Generation++; // a refinement in progress belongs to the old map
+	HasPending = false;
+	HasResult = false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Localization and mapping (game thread)
+
+bool MarkerMap::Update(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams)
+{
+	AR_TRACE_SCOPE("MarkerMap::Update");
+	CameraTracker.newFrame();
+	FocalLength = CameraParams.CameraMatrix.at<float>(0, 0);
+	AddedMarkerThisFrame = false;
+	Localized = Localize(Markers, CameraParams);
+	if (!Localized && Map.Markers.Num() == 0) {
+		// the first marker with a pose becomes the origin of the map
+		for (size_t i = 0; i < Markers.size(); i++) {
+			if (Markers[i].hasPose()) {
+				GetRawMarkerPose(Markers[i], Rvec, Tvec);
+				AddMarker(Markers[i]);
+				CameraTracker.setPose(CameraTrackerKey, Rvec, Tvec);
+				Localized = Localize(Markers, CameraParams);
+				break;
+			}
+		}
+	}
+	if (Localized) {
+		for (size_t i = 0; i < Markers.size(); i++) {
+			if (Markers[i].hasPose() && !ContainsMarker(Markers[i].id)) {
+				AddMarker(Markers[i]);
+			}
+		}
+		if (ShouldAddKeyframe()) {
+			AddKeyframe(Markers, CameraParams);
+		}
+	}
+	ExchangeWithRefinement();
+	return Localized;
+}
+
+bool MarkerMap::Localize(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams)
+{
+	VisibleMarkers.Reset();
+	for (int32 i = 0; i < (int32)Markers.size(); i++) {
+		if (ContainsMarker(Markers[i].id)) {
+			VisibleMarkers.Add(i);
+		}
+	}
+	if (VisibleMarkers.Num() == 0) return false;
+	SolveCamera(Markers, CameraParams);
+
+	// a marker that disagrees with the others (misidentified, or moved since it was mapped) is left out and the pose solved again
+	if (VisibleMarkers.Num() >= 3) {
+		SortedResiduals = MarkerResiduals;
+		SortedResiduals.Sort();
+		float Median = SortedResiduals[SortedResiduals.Num() / 2];
+		int32 Worst = 0;
+		for (int32 k = 1; k < MarkerResiduals.Num(); k++) {
+			if (MarkerResiduals[k] > MarkerResiduals[Worst]) Worst = k;
+		}
+		if (MarkerResiduals[Worst] > FMath::Max(3.f * Median, MaxReprojectionError)) {
+			VisibleMarkers.RemoveAt(Worst);
+			SolveCamera(Markers, CameraParams);
+		}
+	}
+	return ReprojectionError <= MaxReprojectionError;
+}
+
+void MarkerMap::SolveCamera(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams)
+{
+	ObjPoints.clear();
+	ImagePoints.clear();
+	cv::Point3f Corners[4];
+	for (int32 k = 0; k < VisibleMarkers.Num(); k++) {
+		const aruco::MarkerRecord& Marker = Markers[VisibleMarkers[k]];
+		GetMarkerCorners(Map.Markers[IdToIndex[Marker.id]], Corners);
+		for (int32 c = 0; c < 4; c++) {
+			ObjPoints.push_back(Corners[c]);
+			ImagePoints.push_back(Marker.corner(c));
+		}
+	}
+	ReprojectionError = (float)CameraTracker.estimate(CameraTrackerKey, ObjPoints, ImagePoints, CameraParams.CameraMatrix, CameraParams.Distorsion, Rvec, Tvec);
+
+	cv::projectPoints(ObjPoints, Rvec, Tvec, CameraParams.CameraMatrix, CameraParams.Distorsion, Projected);
+	MarkerResiduals.Reset();
+	for (int32 k = 0; k < VisibleMarkers.Num(); k++) {
+		float SquaredSum = 0.f;
+		for (int32 c = 0; c < 4; c++) {
+			cv::Point2f Difference = Projected[k * 4 + c] - ImagePoints[k * 4 + c];
+			SquaredSum += Difference.dot(Difference);
+		}
+		MarkerResiduals.Add(FMath::Sqrt(SquaredSum / 4.f));
+	}
+}
+
+void MarkerMap::AddMarker(const aruco::MarkerRecord& Marker)
+{
+	// marker -> camera from its own pose, then camera -> map from the localized pose
+	cv::Mat MarkerRvec, MarkerTvec, CameraRvec, CameraTvec, MapRvec, MapTvec;
+	GetRawMarkerPose(Marker, MarkerRvec, MarkerTvec);
+	InvertPose(Rvec, Tvec, CameraRvec, CameraTvec);
+	cv::composeRT(MarkerRvec, MarkerTvec, CameraRvec, CameraTvec, MapRvec, MapTvec);
+	MapMarker Added;
+	Added.Id = Marker.id;
+	Added.Size = Marker.ssize;
+	for (int32 i = 0; i < 3; i++) {
+		Added.Rvec[i] = MapRvec.at<double>(i);
+		Added.Tvec[i] = MapTvec.at<double>(i);
+	}
+	IdToIndex.Add(Marker.id, Map.Markers.Add(Added));
+	AddedMarkerThisFrame = true;
+	UE_LOG(LogMarkerMap, Log, TEXT("Added marker %d to the map (%d markers)"), Marker.id, Map.Markers.Num());
+}
+
+bool MarkerMap::ShouldAddKeyframe() const
+{
+	if (Map.Keyframes.Num() >= MaxKeyframes) return false;
+	if (Map.Keyframes.Num() == 0 || AddedMarkerThisFrame) return true;
+	const Keyframe& Last = Map.Keyframes.Last();
+	cv::Matx33d LastRotation, Rotation;
+	cv::Rodrigues(cv::Mat(3, 1, CV_64F, (void*)Last.Rvec), LastRotation);
+	cv::Rodrigues(Rvec, Rotation);
+	cv::Vec3d LastCenter = -(LastRotation.t() * cv::Vec3d(Last.Tvec[0], Last.Tvec[1], Last.Tvec[2]));
+	cv::Vec3d Center = -(Rotation.t() * cv::Vec3d(Tvec.at<double>(0), Tvec.at<double>(1), Tvec.at<double>(2)));
+	if (cv::norm(Center - LastCenter) > KeyframeDistance) return true;
+	cv::Matx33d Relative = LastRotation * Rotation.t();
+	double CosAngle = FMath::Clamp((Relative(0, 0) + Relative(1, 1) + Relative(2, 2) - 1.0) * 0.5, -1.0, 1.0);
+	return FMath::RadiansToDegrees(acos(CosAngle)) > KeyframeAngle;
+}
+
+void MarkerMap::AddKeyframe(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams)
+{
+	// a keyframe relates markers to each other, so it needs at least two of them
+	int32 NumMapMarkers = 0;
+	for (size_t i = 0; i < Markers.size(); i++) {
+		if (ContainsMarker(Markers[i].id)) NumMapMarkers++;
+	}
+	if (NumMapMarkers < 2) return;
+
+	Keyframe Added;
+	for (int32 i = 0; i < 3; i++) {
+		Added.Rvec[i] = Rvec.at<double>(i);
+		Added.Tvec[i] = Tvec.at<double>(i);
+	}
+	Added.FirstObservation = Map.Observations.Num();
+	Added.NumObservations = 0;
+	int32 KeyframeIndex = Map.Keyframes.Num();
+	cv::vector<cv::Point2f> Normalized;
+	for (size_t i = 0; i < Markers.size(); i++) {
+		const int32* MarkerIndex = IdToIndex.Find(Markers[i].id);
+		if (MarkerIndex == NULL) continue;
+		cv::undistortPoints(cv::Mat(4, 1, CV_32FC2, (void*)Markers[i].corners), Normalized, CameraParams.CameraMatrix, CameraParams.Distorsion);
+		Observation Observed;
+		Observed.MarkerIndex = *MarkerIndex;
+		Observed.KeyframeIndex = KeyframeIndex;
+		for (int32 c = 0; c < 4; c++) {
+			Observed.Corners[c][0] = Normalized[c].x;
+			Observed.Corners[c][1] = Normalized[c].y;
+		}
+		Map.Observations.Add(Observed);
+		Added.NumObservations++;
+	}
+	Map.Keyframes.Add(Added);
+	KeyframesSinceRefinement++;
+	if (Map.Keyframes.Num() == MaxKeyframes) {
+		UE_LOG(LogMarkerMap, Log, TEXT("Marker map reached %d keyframes, only new markers are added from now on"), MaxKeyframes);
+	}
+}
+
+void MarkerMap::ExchangeWithRefinement()
+{
+	bool Posted = false;
+	{
+		FScopeLock ScopeLock(&Lock);
+		if (HasResult) {
+			HasResult = false;
+			if (ResultGeneration == Generation) {
+				// the map only grows while a refinement runs, so the refined entries are the first ones of the current map
+				for (int32 i = 0; i < Result.Markers.Num() && i < Map.Markers.Num(); i++) {
+					FMemory::Memcpy(Map.Markers[i].Rvec, Result.Markers[i].Rvec, sizeof(Map.Markers[i].Rvec));
+					FMemory::Memcpy(Map.Markers[i].Tvec, Result.Markers[i].Tvec, sizeof(Map.Markers[i].Tvec));
+				}
+				for (int32 i = 0; i < Result.Keyframes.Num() && i < Map.Keyframes.Num(); i++) {
+					FMemory::Memcpy(Map.Keyframes[i].Rvec, Result.Keyframes[i].Rvec, sizeof(Map.Keyframes[i].Rvec));
+					FMemory::Memcpy(Map.Keyframes[i].Tvec, Result.Keyframes[i].Tvec, sizeof(Map.Keyframes[i].Tvec));
+				}
+				RefinedError = (float)(ResultError * FocalLength);
+			}
+		}
+		// only one copy waits at a time; keyframes added meanwhile go with the next one
+		if (KeyframesSinceRefinement > 0 && !HasPending) {
+			Pending = Map;
+			PendingGeneration = Generation;
+			PendingThreshold = RobustThreshold / FocalLength;
+			HasPending = true;
+			KeyframesSinceRefinement = 0;
+			Posted = true;
+		}
+	}
+	if (Posted) {
+		if (Thread == NULL) {
+			Task = new RefinementTask(this);
+			Thread = FRunnableThread::Create(Task, TEXT("MarkerMapRefinement"), 0, TPri_BelowNormal);
+		}
+		WorkEvent->Trigger();
+	}
+}
+
+FTransform MarkerMap::GetCameraTransform() const
+{
+	return ToUnrealTransform(Rvec, Tvec).Inverse();
+}
+
+FTransform MarkerMap::ToUnrealTransform(const cv::Mat& InRvec, const cv::Mat& InTvec)
+{
+	cv::Mat Rotation, Translation;
+	cv::Rodrigues(InRvec, Rotation);
+	Rotation.convertTo(Rotation, CV_64F);
+	InTvec.convertTo(Translation, CV_64F);
+	// Unreal axes from OpenCV camera axes, as in ArucoMarkerDetector::GetVectorFromTVec: x = z, y = x, z = -y
+	static const int32 Axis[3] = { 2, 0, 1 };
+	static const double Sign[3] = { 1.0, 1.0, -1.0 };
+	FMatrix Matrix = FMatrix::Identity;
+	for (int32 Row = 0; Row < 3; Row++) {
+		for (int32 Column = 0; Column < 3; Column++) {
+			// FMatrix transforms row vectors, so row j holds the image of axis j
+			Matrix.M[Column][Row] = Sign[Row] * Sign[Column] * Rotation.at<double>(Axis[Row], Axis[Column]);
+		}
+		Matrix.M[3][Row] = Sign[Row] * Translation.at<double>(Axis[Row]) * 100.0; // meters to centimeters
+	}
+	return FTransform(Matrix);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Persistence
+
+bool MarkerMap::Save(const FString& Path) const
+{
+	if (!Map.Save(Path)) {
+		UE_LOG(LogMarkerMap, Warning, TEXT("Could not write marker map %s"), *Path);
+		return false;
+	}
+	UE_LOG(LogMarkerMap, Log, TEXT("Saved marker map %s (%d markers, %d keyframes)"), *Path, Map.Markers.Num(), Map.Keyframes.Num());
+	return true;
+}
+
+bool MarkerMap::Load(const FString& Path)
+{
+	AR_TRACE_SCOPE("MarkerMap::Load");
+	MapData Loaded;
+	if (!Loaded.Load(Path)) {
+		UE_LOG(LogMarkerMap, Warning, TEXT("Marker map %s is missing or invalid"), *Path);
+		return false;
+	}
+	Clear();
+	Map = Loaded;
+	for (int32 i = 0; i < Map.Markers.Num(); i++) {
+		IdToIndex.Add(Map.Markers[i].Id, i);
+	}
+	UE_LOG(LogMarkerMap, Log, TEXT("Loaded marker map %s (%d markers, %d keyframes)"), *Path, Map.Markers.Num(), Map.Keyframes.Num());
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Refinement (background thread)
+
+uint32 MarkerMap::RefinementTask::Run()
+{
+	MapData Working;
+	while (!Owner->StopRequested) {
+		Owner->WorkEvent->Wait(100);
+		int32 WorkingGeneration;
+		double Threshold;
+		{
+			FScopeLock ScopeLock(&Owner->Lock);
+			if (!Owner->HasPending) continue;
+			Working = Owner->Pending;
+			Owner->HasPending = false;
+			WorkingGeneration = Owner->PendingGeneration;
+			Threshold = Owner->PendingThreshold;
+		}
+		double Error;
+		{
+			AR_TRACE_SCOPE("MarkerMap::Refine");
+			Error = RefineMap(Working, Owner->RefinementIterations, Threshold);
+		}
+		FScopeLock ScopeLock(&Owner->Lock);
+		Owner->Result = Working;
+		Owner->ResultError = Error;
+		Owner->ResultGeneration = WorkingGeneration;
+		Owner->HasResult = true;
+	}
+	return 0;
+}
+
+void MarkerMap::RefinementTask::Stop()
+{
+	FPlatformAtomics::InterlockedExchange(&Owner->StopRequested, 1);
+	Owner->WorkEvent->Trigger();
+}
+
+void MarkerMap::GetLocalCorners(float Size, cv::vector<cv::Point3f>& Corners)
+{
+	float HalfSize = Size / 2.f;
+	Corners.resize(4);
+	for (int32 c = 0; c < 4; c++) {
+		Corners[c] = cv::Point3f(CornerOffsets[c][0] * HalfSize, CornerOffsets[c][1] * HalfSize, 0.f);
+	}
+}
+
+void MarkerMap::GetMarkerCorners(const MapMarker& Marker, cv::Point3f* Corners)
+{
+	cv::Matx33d Rotation;
+	cv::Rodrigues(cv::Mat(3, 1, CV_64F, (void*)Marker.Rvec), Rotation);
+	cv::Vec3d Translation(Marker.Tvec[0], Marker.Tvec[1], Marker.Tvec[2]);
+	double HalfSize = Marker.Size / 2.0;
+	for (int32 c = 0; c < 4; c++) {
+		cv::Vec3d Corner = Rotation * cv::Vec3d(CornerOffsets[c][0] * HalfSize, CornerOffsets[c][1] * HalfSize, 0.0) + Translation;
+		Corners[c] = cv::Point3f((float)Corner[0], (float)Corner[1], (float)Corner[2]);
+	}
+}
+
+double MarkerMap::RefineMap(MapData& Data, int32 Iterations, double RobustThreshold)
+{
+	TArray<TArray<int32> > ObservationsByMarker;
+	ObservationsByMarker.AddDefaulted(Data.Markers.Num());
+	for (int32 o = 0; o < Data.Observations.Num(); o++) {
+		ObservationsByMarker[Data.Observations[o].MarkerIndex].Add(o);
+	}
+	// the observations are normalized, so the camera is the identity
+	cv::Mat Identity = cv::Mat::eye(3, 3, CV_64F);
+	cv::Mat NoDistortion;
+	cv::vector<cv::Point3f> Obj;
+	cv::vector<cv::Point2f> Img;
+	cv::Point3f Corners[4];
+	for (int32 Iteration = 0; Iteration < Iterations; Iteration++) {
+		// keyframe poses with the markers fixed
+		for (int32 k = 0; k < Data.Keyframes.Num(); k++) {
+			Keyframe& Frame = Data.Keyframes[k];
+			Obj.clear();
+			Img.clear();
+			for (int32 o = Frame.FirstObservation; o < Frame.FirstObservation + Frame.NumObservations; o++) {
+				const Observation& Observed = Data.Observations[o];
+				GetMarkerCorners(Data.Markers[Observed.MarkerIndex], Corners);
+				for (int32 c = 0; c < 4; c++) {
+					Obj.push_back(Corners[c]);
+					Img.push_back(GetObservedCorner(Observed, c));
+				}
+			}
+			cv::Mat FrameRvec = cv::Mat(3, 1, CV_64F, Frame.Rvec).clone();
+			cv::Mat FrameTvec = cv::Mat(3, 1, CV_64F, Frame.Tvec).clone();
+			cv::solvePnP(Obj, Img, Identity, NoDistortion, FrameRvec, FrameTvec, true, CV_ITERATIVE);
+			for (int32 i = 0; i < 3; i++) {
+				Frame.Rvec[i] = FrameRvec.at<double>(i);
+				Frame.Tvec[i] = FrameTvec.at<double>(i);
+			}
+		}
+		// marker poses with the keyframes fixed; marker 0 defines the map frame and stays put
+		for (int32 m = 1; m < Data.Markers.Num(); m++) {
+			RefineMarker(Data, m, ObservationsByMarker[m], RobustThreshold);
+		}
+	}
+
+	double SquaredSum = 0.0;
+	int32 NumCorners = 0;
+	cv::vector<cv::Point2f> Projected;
+	for (int32 o = 0; o < Data.Observations.Num(); o++) {
+		const Observation& Observed = Data.Observations[o];
+		const Keyframe& Frame = Data.Keyframes[Observed.KeyframeIndex];
+		GetMarkerCorners(Data.Markers[Observed.MarkerIndex], Corners);
+		Obj.assign(Corners, Corners + 4);
+		cv::projectPoints(Obj, cv::Mat(3, 1, CV_64F, (void*)Frame.Rvec), cv::Mat(3, 1, CV_64F, (void*)Frame.Tvec), Identity, NoDistortion, Projected);
+		for (int32 c = 0; c < 4; c++) {
+			cv::Point2f Difference = Projected[c] - GetObservedCorner(Observed, c);
+			SquaredSum += Difference.dot(Difference);
+			NumCorners++;
+		}
+	}
+	return NumCorners > 0 ? sqrt(SquaredSum / NumCorners) : 0.0;
+}
+
+double MarkerMap::MarkerCost(const MapData& Data, const cv::Mat& MarkerRvec, const cv::Mat& MarkerTvec, float Size, const TArray<int32>& MarkerObservations, double RobustThreshold)
+{
+	cv::Mat Identity = cv::Mat::eye(3, 3, CV_64F);
+	cv::Mat NoDistortion, CameraRvec, CameraTvec;
+	cv::vector<cv::Point3f> LocalCorners;
+	cv::vector<cv::Point2f> Projected;
+	GetLocalCorners(Size, LocalCorners);
+	double Cost = 0.0;
+	for (int32 i = 0; i < MarkerObservations.Num(); i++) {
+		const Observation& Observed = Data.Observations[MarkerObservations[i]];
+		const Keyframe& Frame = Data.Keyframes[Observed.KeyframeIndex];
+		cv::composeRT(MarkerRvec, MarkerTvec, cv::Mat(3, 1, CV_64F, (void*)Frame.Rvec), cv::Mat(3, 1, CV_64F, (void*)Frame.Tvec), CameraRvec, CameraTvec);
+		cv::projectPoints(LocalCorners, CameraRvec, CameraTvec, Identity, NoDistortion, Projected);
+		for (int32 c = 0; c < 4; c++) {
+			cv::Point2f Difference = Projected[c] - GetObservedCorner(Observed, c);
+			Cost += HuberCost(sqrt(Difference.dot(Difference)), RobustThreshold);
+		}
+	}
+	return Cost;
+}
+
+double MarkerMap::RefineMarker(MapData& Data, int32 MarkerIndex, const TArray<int32>& MarkerObservations, double RobustThreshold)
+{
+	MapMarker& Marker = Data.Markers[MarkerIndex];
+	if (MarkerObservations.Num() == 0) return 0.0;
+	cv::Mat MarkerRvec = cv::Mat(3, 1, CV_64F, Marker.Rvec).clone();
+	cv::Mat MarkerTvec = cv::Mat(3, 1, CV_64F, Marker.Tvec).clone();
+	cv::Mat Identity = cv::Mat::eye(3, 3, CV_64F);
+	cv::Mat NoDistortion;
+	cv::vector<cv::Point3f> LocalCorners;
+	cv::vector<cv::Point2f> Projected;
+	GetLocalCorners(Marker.Size, LocalCorners);
+	cv::Mat CameraRvec, CameraTvec, Jacobian;
+	cv::Mat dr3dr1, dr3dt1, dr3dr2, dr3dt2, dt3dr1, dt3dt1, dt3dr2, dt3dt2;
+	cv::Mat MarkerJacobian(8, 6, CV_64F);
+	double Cost = MarkerCost(Data, MarkerRvec, MarkerTvec, Marker.Size, MarkerObservations, RobustThreshold);
+	double Lambda = 1e-3;
+	for (int32 Iteration = 0; Iteration < MarkerIterations; Iteration++) {
+		cv::Matx66d JtJ = cv::Matx66d::zeros();
+		cv::Matx61d Jtr = cv::Matx61d::zeros();
+		for (int32 i = 0; i < MarkerObservations.Num(); i++) {
+			const Observation& Observed = Data.Observations[MarkerObservations[i]];
+			const Keyframe& Frame = Data.Keyframes[Observed.KeyframeIndex];
+			cv::composeRT(MarkerRvec, MarkerTvec, cv::Mat(3, 1, CV_64F, (void*)Frame.Rvec), cv::Mat(3, 1, CV_64F, (void*)Frame.Tvec), CameraRvec, CameraTvec,
+				dr3dr1, dr3dt1, dr3dr2, dr3dt2, dt3dr1, dt3dt1, dt3dr2, dt3dt2);
+			cv::projectPoints(LocalCorners, CameraRvec, CameraTvec, Identity, NoDistortion, Projected, Jacobian);
+			// chain rule from the marker -> camera pose to the marker -> map pose
+			cv::Mat DProjectedDRotation = Jacobian.colRange(0, 3);
+			cv::Mat DProjectedDTranslation = Jacobian.colRange(3, 6);
+			cv::Mat(DProjectedDRotation * dr3dr1 + DProjectedDTranslation * dt3dr1).copyTo(MarkerJacobian.colRange(0, 3));
+			cv::Mat(DProjectedDRotation * dr3dt1 + DProjectedDTranslation * dt3dt1).copyTo(MarkerJacobian.colRange(3, 6));
+			for (int32 c = 0; c < 4; c++) {
+				cv::Point2f Difference = Projected[c] - GetObservedCorner(Observed, c);
+				double Error = sqrt(Difference.dot(Difference));
+				double Weight = Error <= RobustThreshold ? 1.0 : RobustThreshold / Error; // Huber
+				double Residuals[2] = { Difference.x, Difference.y };
+				for (int32 Axis = 0; Axis < 2; Axis++) {
+					const double* Row = MarkerJacobian.ptr<double>(c * 2 + Axis);
+					for (int32 a = 0; a < 6; a++) {
+						Jtr(a) += Weight * Row[a] * Residuals[Axis];
+						for (int32 b = 0; b < 6; b++) {
+							JtJ(a, b) += Weight * Row[a] * Row[b];
+						}
+					}
+				}
+			}
+		}
+		cv::Matx66d Damped = JtJ;
+		for (int32 a = 0; a < 6; a++) {
+			Damped(a, a) *= 1.0 + Lambda;
+		}
+		cv::Matx61d Step = Damped.solve(-Jtr, cv::DECOMP_CHOLESKY);
+		cv::Mat TryRvec = MarkerRvec + cv::Mat(cv::Vec3d(Step(0), Step(1), Step(2)));
+		cv::Mat TryTvec = MarkerTvec + cv::Mat(cv::Vec3d(Step(3), Step(4), Step(5)));
+		double TryCost = MarkerCost(Data, TryRvec, TryTvec, Marker.Size, MarkerObservations, RobustThreshold);
+		if (TryCost < Cost) {
+			MarkerRvec = TryRvec;
+			MarkerTvec = TryTvec;
+			Cost = TryCost;
+			Lambda *= 0.1;
+			if (cv::norm(cv::Mat(Step)) < 1e-9) break;
+		}
+		else {
+			Lambda *= 10.0;
+		}
+	}
+	for (int32 i = 0; i < 3; i++) {
+		Marker.Rvec[i] = MarkerRvec.at<double>(i);
+		Marker.Tvec[i] = MarkerTvec.at<double>(i);
+	}
+	return Cost;
+}
@@ -0,0 +1,196 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+#include "aruco/aruco.h"
+#include "MarkerMapData.h"
+
+/**
+ * Map of the poses of all markers seen, used to localize the camera from whichever of them are visible.
+ * The map frame is the frame of the first marker added.  While the camera is localized, every new marker is placed in the
+ * map from its own pose, and keyframes (camera poses plus the corners of the map markers they saw) are kept whenever the
+ * camera has moved enough.  The keyframes and markers form the pose graph that a background thread refines with bundle
+ * adjustment: it alternates between solving every keyframe pose with the markers fixed and every marker pose with the
+ * keyframes fixed, each a small independent problem, so the cost grows linearly with the size of the map.
+ * Corners are stored undistorted and normalized, so a map doesn't depend on the camera resolution.
+ * Maps are saved to a compact binary file and can be loaded to localize in a known room straight away.
+ */
+class MarkerMap
+{
+public:
+
+	MarkerMap();
+	~MarkerMap();
+
+	/*
+	 Localizes the camera from the visible map markers and extends the map with the rest; call once per detection frame,
+	 after the extrinsics of the markers have been calculated.  Returns true if the camera was localized.
+	 */
+	bool Update(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams);
+
+	/* Stops the refinement thread, waiting for a refinement in progress */
+	void StopRefinement();
+
+	void Clear();
+
+	bool Save(const FString& Path) const;
+
+	bool Load(const FString& Path);
+
+	/* Saved/MarkerMaps/<Name>.bin */
+	static FString GetMapPath(const FString& Name);
+
+	bool IsLocalized() const { return Localized; }
+
+	/* Pose of the map in the camera as returned by solvePnP (valid if IsLocalized) */
+	const cv::Mat& GetRvec() const { return Rvec; }
+	const cv::Mat& GetTvec() const { return Tvec; }
+
+	/* Transform from the camera to the map, in Unreal axes (x forward, y right, z up) and centimeters */
+	FTransform GetCameraTransform() const;
+
+	/* Converts a pose as returned by solvePnP (source frame to OpenCV camera, meters) to an Unreal transform */
+	static FTransform ToUnrealTransform(const cv::Mat& Rvec, const cv::Mat& Tvec);
+
+	bool ContainsMarker(int32 Id) const { return IdToIndex.Contains(Id); }
+
+	int32 GetNumMarkers() const { return Map.Markers.Num(); }
+
+	int32 GetNumKeyframes() const { return Map.Keyframes.Num(); }
+
+	/* RMS reprojection error of the last localization, in pixels */
+	float GetReprojectionError() const { return ReprojectionError; }
+
+	/* RMS reprojection error over all keyframes after the last refinement, in pixels */
+	float GetRefinedError() const { return RefinedError; }
+
+	// localizations that reproject worse than this (pixels, RMS) are rejected
+	float MaxReprojectionError;
+
+	// a keyframe is added when the camera moved this far (meters) or turned this much (degrees) since the last one
+	float KeyframeDistance;
+	float KeyframeAngle;
+
+	int32 MaxKeyframes;
+
+	// alternations per refinement
+	int32 RefinementIterations;
+
+	// reprojection error (pixels) beyond which an observation is down-weighted during refinement
+	float RobustThreshold;
+
+protected:
+
+	typedef MarkerMapData MapData;
+	typedef MarkerMapData::Marker MapMarker;
+	typedef MarkerMapData::Keyframe Keyframe;
+	typedef MarkerMapData::Observation Observation;
+
+	class RefinementTask : public FRunnable
+	{
+	public:
+		RefinementTask(MarkerMap* Owner) : Owner(Owner) {}
+		virtual uint32 Run() override;
+		virtual void Stop() override;
+	private:
+		MarkerMap* Owner;
+	};
+
+	/* Refines Data in place; returns the RMS reprojection error in normalized units */
+	static double RefineMap(MapData& Data, int32 Iterations, double RobustThreshold);
+
+	static double RefineMarker(MapData& Data, int32 MarkerIndex, const TArray<int32>& MarkerObservations, double RobustThreshold);
+
+	static double MarkerCost(const MapData& Data, const cv::Mat& MarkerRvec, const cv::Mat& MarkerTvec, float Size, const TArray<int32>& MarkerObservations, double RobustThreshold);
+
+	static void GetMarkerCorners(const MapMarker& Marker, cv::Point3f* Corners);
+
+	static void GetLocalCorners(float Size, cv::vector<cv::Point3f>& Corners);
+
+	static cv::Point2f GetObservedCorner(const Observation& Observed, int32 Corner) { return cv::Point2f(Observed.Corners[Corner][0], Observed.Corners[Corner][1]); }
+
+	bool Localize(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams);
+
+	/* Solves the camera pose from the markers in VisibleMarkers and their residuals */
+	void SolveCamera(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams);
+
+	void AddMarker(const aruco::MarkerRecord& Marker);
+
+	void AddKeyframe(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams);
+
+	bool ShouldAddKeyframe() const;
+
+	/* Hands a copy of the map to the refinement thread (starting it if needed) and takes back the last result */
+	void ExchangeWithRefinement();
+
+	MapData Map;
+
+	TMap<int32, int32> IdToIndex; // marker id -> index in Map.Markers
+
+	aruco::PoseTracker CameraTracker;
+
+	bool Localized;
+
+	cv::Mat Rvec, Tvec;
+
+	float ReprojectionError;
+
+	float RefinedError;
+
+	// focal length of the last camera parameters, to convert pixel thresholds to normalized units
+	double FocalLength;
+
+	bool AddedMarkerThisFrame;
+
+	int32 KeyframesSinceRefinement;
+
+	// refinement thread; Pending/Result are guarded by Lock, Generation tells results of a cleared map apart
+	RefinementTask* Task;
+	FRunnableThread* Thread;
+	FCriticalSection Lock;
+	MapData Pending;
+	MapData Result;
+	bool HasPending;
+	bool HasResult;
+	double ResultError;
+	double PendingThreshold;
+	int32 Generation;
+	int32 PendingGeneration;
+	int32 ResultGeneration;
+	volatile int32 StopRequested;
+	FEvent* WorkEvent;
+
+	// buffers reused between frames
+	cv::vector<cv::Point3f> ObjPoints;
+	cv::vector<cv::Point2f> ImagePoints;
+	cv::vector<cv::Point2f> Projected;
+	TArray<int32> VisibleMarkers; // indices into the marker list of the visible map markers
+	TArray<float> MarkerResiduals;
+	TArray<float> SortedResiduals;
+};
@@ -0,0 +1,113 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "MarkerMapData.h"
+#include "MappedFile.h"
+
+static const uint32 MarkerMapMagic = 0x50414D41; // "AMAP"
+static const uint32 MarkerMapVersion = 1;
+
+struct MarkerMapHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	int32 NumMarkers;
+	int32 NumKeyframes;
+	int32 NumObservations;
+};
+
+void MarkerMapData::Empty()
+{
+	Markers.Empty();
+	Keyframes.Empty();
+	Observations.Empty();
+}
+
+bool MarkerMapData::Save(const FString& Path) const
+{
+	TArray<uint8> Data;
+	Write(Data);
+	return FFileHelper::SaveArrayToFile(Data, *Path);
+}
+
+bool MarkerMapData::Load(const FString& Path)
+{
+	MappedFile File;
+	return File.Open(Path) && Read(File.GetData(), File.GetSize());
+}
+
+void MarkerMapData::Write(TArray<uint8>& OutData) const
+{
+	MarkerMapHeader Header;
+	Header.Magic = MarkerMapMagic;
+	Header.Version = MarkerMapVersion;
+	Header.NumMarkers = Markers.Num();
+	Header.NumKeyframes = Keyframes.Num();
+	Header.NumObservations = Observations.Num();
+	OutData.Reset();
+	OutData.Reserve(sizeof(Header) + Markers.Num() * sizeof(Marker) + Keyframes.Num() * sizeof(Keyframe) + Observations.Num() * sizeof(Observation));
+	OutData.Append((const uint8*)&Header, sizeof(Header));
+	OutData.Append((const uint8*)Markers.GetData(), Markers.Num() * sizeof(Marker));
+	OutData.Append((const uint8*)Keyframes.GetData(), Keyframes.Num() * sizeof(Keyframe));
+	OutData.Append((const uint8*)Observations.GetData(), Observations.Num() * sizeof(Observation));
+}
+
+bool MarkerMapData::Read(const uint8* Data, int64 Size)
+{
+	if (Data == NULL || Size < (int64)sizeof(MarkerMapHeader)) return false;
+	MarkerMapHeader Header;
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+	if (Header.Magic != MarkerMapMagic || Header.Version != MarkerMapVersion
+		|| Header.NumMarkers < 0 || Header.NumKeyframes < 0 || Header.NumObservations < 0) return false;
+	int64 ExpectedSize = sizeof(MarkerMapHeader) + (int64)Header.NumMarkers * sizeof(Marker)
+		+ (int64)Header.NumKeyframes * sizeof(Keyframe) + (int64)Header.NumObservations * sizeof(Observation);
+	if (Size != ExpectedSize) return false;
+	// copied out rather than used in place: the records after the header aren't aligned for their doubles
+	MarkerMapData Loaded;
+	const uint8* Records = Data + sizeof(MarkerMapHeader);
+	Loaded.Markers.AddUninitialized(Header.NumMarkers);
+	FMemory::Memcpy(Loaded.Markers.GetData(), Records, Header.NumMarkers * sizeof(Marker));
+	Records += Header.NumMarkers * sizeof(Marker);
+	Loaded.Keyframes.AddUninitialized(Header.NumKeyframes);
+	FMemory::Memcpy(Loaded.Keyframes.GetData(), Records, Header.NumKeyframes * sizeof(Keyframe));
+	Records += Header.NumKeyframes * sizeof(Keyframe);
+	Loaded.Observations.AddUninitialized(Header.NumObservations);
+	FMemory::Memcpy(Loaded.Observations.GetData(), Records, Header.NumObservations * sizeof(Observation));
+	for (int32 i = 0; i < Header.NumKeyframes; i++) {
+		const Keyframe& Frame = Loaded.Keyframes[i];
+		if (Frame.FirstObservation < 0 || Frame.NumObservations < 0
+			|| (int64)Frame.FirstObservation + Frame.NumObservations > Header.NumObservations) return false;
+	}
+	for (int32 i = 0; i < Header.NumObservations; i++) {
+		const Observation& Observed = Loaded.Observations[i];
+		if (Observed.MarkerIndex < 0 || Observed.MarkerIndex >= Header.NumMarkers
+			|| Observed.KeyframeIndex < 0 || Observed.KeyframeIndex >= Header.NumKeyframes) return false;
+	}
+	*this = Loaded;
+	return true;
+}
@@ -0,0 +1,81 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+/**
+ * What a MarkerMap holds, and its compact binary file: the header, then the marker, keyframe and observation records as
+ * they are in memory.  Kept apart from MarkerMap, which needs OpenCV, so the file handling can be tested on its own.
+ */
+struct MarkerMapData
+{
+	/* Pose of a marker in the map (marker to map) */
+	struct Marker
+	{
+		int32 Id;
+		float Size;
+		double Rvec[3];
+		double Tvec[3];
+	};
+
+	/* Pose of the map in the camera (map to camera) and the range of its observations */
+	struct Keyframe
+	{
+		double Rvec[3];
+		double Tvec[3];
+		int32 FirstObservation;
+		int32 NumObservations;
+	};
+
+	/* Undistorted, normalized corners of a map marker seen in a keyframe */
+	struct Observation
+	{
+		int32 MarkerIndex;
+		int32 KeyframeIndex;
+		float Corners[4][2];
+	};
+
+	TArray<Marker> Markers;
+	TArray<Keyframe> Keyframes;
+	TArray<Observation> Observations;
+
+	void Empty();
+
+	bool Save(const FString& Path) const;
+
+	/* Replaces the data with the file's; returns false, leaving the data as it was, if the file is missing or invalid */
+	bool Load(const FString& Path);
+
+	/* The file image */
+	void Write(TArray<uint8>& OutData) const;
+
+	/*
+	 Replaces the data with a file image; returns false, leaving the data as it was, if the image is truncated, isn't a
+	 marker map of this version, or has a keyframe or observation that refers outside the map.
+	 */
+	bool Read(const uint8* Data, int64 Size);
+};
@@ -0,0 +1,357 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "MarkerPlaneEstimator.h"
+#include <algorithm>
+
+// the plane has its own tracker, so any key will do
+static const int PlaneTrackerKey = 0;
+
+static const int32 RobustFitIterations = 5;
+
+// corner offsets from the marker center in units of half the marker side, in the order used by aruco::Marker::calculateExtrinsics
+static const double CornerOffsets[4][2] = { { -1, -1 }, { -1, 1 }, { 1, 1 }, { 1, -1 } };
+
+static cv::Matx33d RotationMatrix(const cv::Mat& Rvec, cv::Mat& Buffer)
+{
+	cv::Rodrigues(Rvec, Buffer);
+	Buffer.convertTo(Buffer, CV_64F);
+	return cv::Matx33d((const double*)Buffer.data);
+}
+
+static cv::Vec3d TranslationVector(const cv::Mat& Tvec)
+{
+	cv::Mat_<double> T;
+	Tvec.convertTo(T, CV_64F);
+	return cv::Vec3d(T(0), T(1), T(2));
+}
+
+MarkerPlaneEstimator::MarkerPlaneEstimator()
+{
+	MinMarkers = 2;
+	LayoutSamples = 30;
+	OutlierFactor = 3.f;
+	MinOutlierPixels = 3.f;
+	MarkerSize = 0.f;
+	HasLayout = false;
+	Valid = false;
+	ReprojectionError = 0.f;
+	PlaneFitError = 0.f;
+}
+
+void MarkerPlaneEstimator::SetMarkerGroup(const TArray<int32>& Ids, float InMarkerSize)
+{
+	MarkerSize = InMarkerSize;
+	IdToIndex.Empty();
+	Layout.Empty(Ids.Num());
+	for (int32 i = 0; i < Ids.Num(); i++) {
+		if (IdToIndex.Contains(Ids[i])) continue;
+		Placement Placed;
+		FMemory::Memzero(&Placed, sizeof(Placed));
+		Placed.Id = Ids[i];
+		IdToIndex.Add(Ids[i], Layout.Add(Placed));
+	}
+	ResetLayout();
+}
+
+void MarkerPlaneEstimator::ResetLayout()
+{
+	for (int32 i = 0; i < Layout.Num(); i++) {
+		int32 Id = Layout[i].Id;
+		FMemory::Memzero(&Layout[i], sizeof(Placement));
+		Layout[i].Id = Id;
+	}
+	HasLayout = false;
+	Valid = false;
+	PlaneTracker.reset();
+}
+
+bool MarkerPlaneEstimator::NeedsMarkerPose(int32 Id) const
+{
+	const int32* Index = IdToIndex.Find(Id);
+	return Index != NULL && Layout[*Index].Samples < LayoutSamples;
+}
+
+/* Corners of a marker in camera coordinates from the pose the tracker has for it this frame */
+static bool GetMarkerCorners(int32 Id, float MarkerSize, const aruco::PoseTracker& Tracker, cv::Mat& Rvec, cv::Mat& Tvec, cv::Mat& Buffer, cv::Point3d* Corners)
+{
+	if (!Tracker.getPose(Id, Rvec, Tvec)) return false;
+	cv::Matx33d R = RotationMatrix(Rvec, Buffer);
+	cv::Vec3d T = TranslationVector(Tvec);
+	double HalfSize = MarkerSize / 2.0;
+	for (int32 c = 0; c < 4; c++) {
+		cv::Vec3d Corner = R * cv::Vec3d(CornerOffsets[c][0] * HalfSize, CornerOffsets[c][1] * HalfSize, 0.0) + T;
+		Corners[c] = cv::Point3d(Corner[0], Corner[1], Corner[2]);
+	}
+	return true;
+}
+
+bool MarkerPlaneEstimator::Estimate(cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams, const aruco::PoseTracker& MarkerTracker)
+{
+	Valid = false;
+	PlaneTracker.newFrame();
+	if (Layout.Num() == 0 || MarkerSize <= 0.f) return false;
+	Visible.Reset();
+	for (int32 i = 0; i < (int32)Markers.size(); i++) {
+		if (IsInGroup(Markers[i].id)) {
+			Visible.Add(i);
+		}
+	}
+	bool Refined = false;
+	if (!HasLayout) {
+		if (Visible.Num() < 3 || !InitializeLayout(Markers, MarkerTracker)) return false;
+		RefineLayout(Markers, MarkerTracker);
+		Refined = true;
+	}
+
+	SolveIndices.Reset();
+	for (int32 v = 0; v < Visible.Num(); v++) {
+		if (Layout[IdToIndex[Markers[Visible[v]].id]].Samples > 0) {
+			SolveIndices.Add(Visible[v]);
+		}
+	}
+	if (SolveIndices.Num() < MinMarkers) return false;
+	SolvePose(Markers, CameraParams);
+
+	// a marker that disagrees with the others (misidentified, or moved since it was placed) is left out and the pose solved again
+	if (SolveIndices.Num() >= 3) {
+		SortedResiduals = SolvedResiduals;
+		SortedResiduals.Sort();
+		float Median = SortedResiduals[SortedResiduals.Num() / 2];
+		int32 Worst = 0;
+		for (int32 k = 1; k < SolvedResiduals.Num(); k++) {
+			if (SolvedResiduals[k] > SolvedResiduals[Worst]) Worst = k;
+		}
+		if (SolvedResiduals[Worst] > FMath::Max(OutlierFactor * Median, MinOutlierPixels)) {
+			SolveIndices.RemoveAt(Worst);
+			if (SolveIndices.Num() < MinMarkers) return false;
+			SolvePose(Markers, CameraParams);
+		}
+	}
+
+	if (!Refined) {
+		RefineLayout(Markers, MarkerTracker);
+	}
+
+	// the group markers get their poses from the plane pose and their placement
+	cv::Matx33d PlaneR = RotationMatrix(Rvec, PlaneRotation);
+	cv::Vec3d PlaneT = TranslationVector(Tvec);
+	for (int32 v = 0; v < Visible.Num(); v++) {
+		aruco::MarkerRecord& Marker = Markers[Visible[v]];
+		const Placement& Placed = Layout[IdToIndex[Marker.id]];
+		if (Placed.Samples == 0) continue;
+		double Cos = FMath::Cos(Placed.Angle), Sin = FMath::Sin(Placed.Angle);
+		// marker axes in the plane frame: X at the placement angle, Y = (sin, -cos) and Z = -Z (see GetPlacementCorners)
+		cv::Matx33d InPlane(Cos, Sin, 0.0, Sin, -Cos, 0.0, 0.0, 0.0, -1.0);
+		cv::Vec3d MarkerT = PlaneR * cv::Vec3d(Placed.X, Placed.Y, 0.0) + PlaneT;
+		cv::Matx33d MarkerR = PlaneR * InPlane;
+		cv::Rodrigues(cv::Mat(3, 3, CV_64F, MarkerR.val), MarkerRvec);
+		Marker.setExtrinsics(MarkerRvec, cv::Mat(3, 1, CV_64F, MarkerT.val), MarkerSize);
+	}
+	UpdateOutputs();
+	Valid = true;
+	return true;
+}
+
+bool MarkerPlaneEstimator::InitializeLayout(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::PoseTracker& MarkerTracker)
+{
+	FitPoints.clear();
+	cv::Point3d FirstAxis(0, 0, 0);
+	for (int32 v = 0; v < Visible.Num(); v++) {
+		cv::Point3d Corners[4];
+		if (!GetMarkerCorners(Markers[Visible[v]].id, MarkerSize, MarkerTracker, MarkerRvec, MarkerTvec, Rotation, Corners)) continue;
+		if (FitPoints.empty()) {
+			FirstAxis = (Corners[3] - Corners[0]) + (Corners[2] - Corners[1]);
+		}
+		for (int32 c = 0; c < 4; c++) {
+			FitPoints.push_back(Corners[c]);
+		}
+	}
+	if (FitPoints.size() < 12) return false;
+	FitPlane(FitPoints);
+
+	// plane frame: Z is the normal pointing away from the camera, X is the X axis of the first marker projected onto the plane
+	cv::Point3d Z = PlaneNormal;
+	if (Z.dot(PlaneCentroid) < 0.0) Z = -Z;
+	cv::Point3d X = FirstAxis - Z * FirstAxis.dot(Z);
+	double XLength = cv::norm(X);
+	if (XLength < 1e-9) return false;
+	X *= 1.0 / XLength;
+	cv::Point3d Y = Z.cross(X);
+	cv::Matx33d R(X.x, Y.x, Z.x,
+	              X.y, Y.y, Z.y,
+	              X.z, Y.z, Z.z);
+	cv::Rodrigues(cv::Mat(R), Rvec);
+	Tvec = (cv::Mat_<double>(3, 1) << PlaneCentroid.x, PlaneCentroid.y, PlaneCentroid.z);
+	PlaneTracker.setPose(PlaneTrackerKey, Rvec, Tvec);
+	HasLayout = true;
+	return true;
+}
+
+void MarkerPlaneEstimator::FitPlane(const cv::vector<cv::Point3d>& Points)
+{
+	// iteratively reweighted least squares with Huber weights, so a marker whose pose is off does not tilt the plane
+	size_t NumPoints = Points.size();
+	FitWeights.assign(NumPoints, 1.0);
+	FitResiduals.resize(NumPoints);
+	for (int32 Iteration = 0; Iteration < RobustFitIterations; Iteration++) {
+		double WeightSum = 0.0;
+		cv::Point3d Centroid(0, 0, 0);
+		for (size_t i = 0; i < NumPoints; i++) {
+			Centroid += Points[i] * FitWeights[i];
+			WeightSum += FitWeights[i];
+		}
+		Centroid *= 1.0 / WeightSum;
+		cv::Matx33d Covariance = cv::Matx33d::zeros();
+		for (size_t i = 0; i < NumPoints; i++) {
+			cv::Matx31d D(Points[i].x - Centroid.x, Points[i].y - Centroid.y, Points[i].z - Centroid.z);
+			Covariance += (D * D.t()) * FitWeights[i];
+		}
+		// the normal is the direction of least spread (eigen returns the eigenvalues in descending order)
+		cv::Mat EigenValues, EigenVectors;
+		cv::eigen(cv::Mat(Covariance), EigenValues, EigenVectors);
+		PlaneNormal = cv::Point3d(EigenVectors.at<double>(2, 0), EigenVectors.at<double>(2, 1), EigenVectors.at<double>(2, 2));
+		PlaneCentroid = Centroid;
+
+		for (size_t i = 0; i < NumPoints; i++) {
+			FitResiduals[i] = fabs(PlaneNormal.dot(Points[i] - Centroid));
+		}
+		FitSorted = FitResiduals;
+		std::nth_element(FitSorted.begin(), FitSorted.begin() + NumPoints / 2, FitSorted.end());
+		double Scale = FMath::Max(1.4826 * FitSorted[NumPoints / 2], 1e-4); // median absolute deviation, at least 0.1 mm
+		double HuberThreshold = 1.345 * Scale;
+		for (size_t i = 0; i < NumPoints; i++) {
+			FitWeights[i] = FitResiduals[i] <= HuberThreshold ? 1.0 : HuberThreshold / FitResiduals[i];
+		}
+	}
+}
+
+bool MarkerPlaneEstimator::RefineLayout(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::PoseTracker& MarkerTracker)
+{
+	cv::Matx33d PlaneR = RotationMatrix(Rvec, PlaneRotation);
+	cv::Matx33d PlaneRInverse = PlaneR.t();
+	cv::Vec3d PlaneT = TranslationVector(Tvec);
+	double SquaredDistanceSum = 0.0;
+	int32 NumCorners = 0;
+	bool Added = false;
+	for (int32 v = 0; v < Visible.Num(); v++) {
+		Placement& Placed = Layout[IdToIndex[Markers[Visible[v]].id]];
+		if (Placed.Samples >= LayoutSamples) continue;
+		cv::Point3d Corners[4];
+		if (!GetMarkerCorners(Placed.Id, MarkerSize, MarkerTracker, MarkerRvec, MarkerTvec, Rotation, Corners)) continue;
+		cv::Vec3d Local[4];
+		double MarkerSquaredDistance = 0.0;
+		for (int32 c = 0; c < 4; c++) {
+			Local[c] = PlaneRInverse * (cv::Vec3d(Corners[c].x, Corners[c].y, Corners[c].z) - PlaneT);
+			MarkerSquaredDistance += Local[c][2] * Local[c][2];
+		}
+		SquaredDistanceSum += MarkerSquaredDistance;
+		NumCorners += 4;
+		// a marker that is off the plane is misdetected or not part of it after all, so it is not placed
+		if (sqrt(MarkerSquaredDistance / 4.0) > MarkerSize * 0.25) continue;
+		cv::Vec3d Center = (Local[0] + Local[1] + Local[2] + Local[3]) * 0.25;
+		cv::Vec3d Axis = (Local[3] - Local[0]) + (Local[2] - Local[1]);
+		double Angle = atan2(Axis[1], Axis[0]);
+		Placed.Samples++;
+		Placed.SumX += Center[0];
+		Placed.SumY += Center[1];
+		Placed.SumCos += cos(Angle);
+		Placed.SumSin += sin(Angle);
+		Placed.X = (float)(Placed.SumX / Placed.Samples);
+		Placed.Y = (float)(Placed.SumY / Placed.Samples);
+		Placed.Angle = (float)atan2(Placed.SumSin, Placed.SumCos);
+		Added = true;
+	}
+	PlaneFitError = NumCorners > 0 ? (float)sqrt(SquaredDistanceSum / NumCorners) : 0.f;
+	return Added;
+}
+
+void MarkerPlaneEstimator::GetPlacementCorners(const Placement& Placed, cv::Point3f* Corners) const
+{
+	// aruco marker Z points toward the camera and plane Z away from it, so the marker Y axis is Z x X = (sin, -cos) in the plane frame
+	float HalfSize = MarkerSize / 2.f;
+	float Cos = FMath::Cos(Placed.Angle), Sin = FMath::Sin(Placed.Angle);
+	for (int32 c = 0; c < 4; c++) {
+		float OffsetX = CornerOffsets[c][0] * HalfSize;
+		float OffsetY = CornerOffsets[c][1] * HalfSize;
+		Corners[c] = cv::Point3f(Placed.X + Cos * OffsetX + Sin * OffsetY, Placed.Y + Sin * OffsetX - Cos * OffsetY, 0.f);
+	}
+}
+
+void MarkerPlaneEstimator::SolvePose(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams)
+{
+	ObjPoints.clear();
+	ImagePoints.clear();
+	SolvedIds.Reset();
+	for (int32 k = 0; k < SolveIndices.Num(); k++) {
+		const aruco::MarkerRecord& Marker = Markers[SolveIndices[k]];
+		cv::Point3f Corners[4];
+		GetPlacementCorners(Layout[IdToIndex[Marker.id]], Corners);
+		for (int32 c = 0; c < 4; c++) {
+			ObjPoints.push_back(Corners[c]);
+			ImagePoints.push_back(Marker.corner(c));
+		}
+		SolvedIds.Add(Marker.id);
+	}
+	// one problem for all corners, started from the last plane pose
+	ReprojectionError = (float)PlaneTracker.estimate(PlaneTrackerKey, ObjPoints, ImagePoints, CameraParams.CameraMatrix, CameraParams.Distorsion, Rvec, Tvec);
+
+	cv::projectPoints(ObjPoints, Rvec, Tvec, CameraParams.CameraMatrix, CameraParams.Distorsion, Projected);
+	SolvedResiduals.Reset();
+	for (int32 k = 0; k < SolveIndices.Num(); k++) {
+		float SquaredSum = 0.f;
+		for (int32 c = 0; c < 4; c++) {
+			cv::Point2f Difference = Projected[k * 4 + c] - ImagePoints[k * 4 + c];
+			SquaredSum += Difference.dot(Difference);
+		}
+		SolvedResiduals.Add(FMath::Sqrt(SquaredSum / 4.f));
+	}
+}
+
+void MarkerPlaneEstimator::UpdateOutputs()
+{
+	cv::Matx33d PlaneR((const double*)PlaneRotation.data);
+	cv::Vec3d PlaneT = TranslationVector(Tvec);
+	Normal = cv::Point3f(PlaneR(0, 2), PlaneR(1, 2), PlaneR(2, 2));
+	double CenterX = 0.0, CenterY = 0.0;
+	int32 NumPlaced = 0;
+	for (int32 i = 0; i < Layout.Num(); i++) {
+		if (Layout[i].Samples > 0) {
+			CenterX += Layout[i].X;
+			CenterY += Layout[i].Y;
+			NumPlaced++;
+		}
+	}
+	if (NumPlaced > 0) {
+		CenterX /= NumPlaced;
+		CenterY /= NumPlaced;
+	}
+	cv::Vec3d Center = PlaneR * cv::Vec3d(CenterX, CenterY, 0.0) + PlaneT;
+	Midpoint = cv::Point3f(Center[0], Center[1], Center[2]);
+}
@@ -0,0 +1,166 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+#include "aruco/aruco.h"
+
+/**
+ * Estimates the plane, and the pose on it, of a group of coplanar markers with any number of members.
+ * The first time at least three markers of the group are seen, a plane is fitted to their corners (least squares with
+ * iteratively reweighted robust weights) and defines the plane frame.  Every marker is then placed in that frame from its
+ * own pose, averaged over LayoutSamples frames, after which its placement is frozen and no per-marker pose is needed any more.
+ * Each frame the plane pose is solved jointly from the corners of all visible markers in a single warm-started PnP problem,
+ * markers that reproject badly are dropped, and the group markers get their poses from the plane pose and their placement.
+ * All results are in OpenCV camera coordinates and meters.
+ */
+class MarkerPlaneEstimator
+{
+public:
+
+	MarkerPlaneEstimator();
+
+	/* Sets the ids of the group (all of side MarkerSize meters) and forgets the learned layout */
+	void SetMarkerGroup(const TArray<int32>& Ids, float MarkerSize);
+
+	void ResetLayout();
+
+	bool IsInGroup(int32 Id) const { return IdToIndex.Contains(Id); }
+
+	float GetMarkerSize() const { return MarkerSize; }
+
+	/*
+	 True if the marker is part of the group but its placement is still being learned, in which case its own pose has to be
+	 calculated (with the PoseTracker passed to Estimate) before calling Estimate.  The other group markers can skip that.
+	 */
+	bool NeedsMarkerPose(int32 Id) const;
+
+	/*
+	 Solves the plane pose from the visible group markers and sets their rvec/tvec.
+	 Returns true if at least MinMarkers markers with a known placement were used.
+	 */
+	bool Estimate(cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams, const aruco::PoseTracker& MarkerTracker);
+
+	bool IsValid() const { return Valid; }
+
+	/* Pose of the plane frame (Z along the normal, pointing away from the camera) as returned by solvePnP */
+	const cv::Mat& GetRvec() const { return Rvec; }
+	const cv::Mat& GetTvec() const { return Tvec; }
+
+	/* Unit normal of the plane, pointing away from the camera */
+	cv::Point3f GetNormal() const { return Normal; }
+
+	/* Center of the placements of all markers of the group, whether visible or not */
+	cv::Point3f GetMidpoint() const { return Midpoint; }
+
+	/* RMS reprojection error over the corners of the markers used in the last solve, in pixels */
+	float GetReprojectionError() const { return ReprojectionError; }
+
+	/* RMS distance from the plane of the corners of the markers whose placement was refined in the last frame, in meters */
+	float GetPlaneFitError() const { return PlaneFitError; }
+
+	/* Ids of the markers used in the last solve and their RMS reprojection errors in pixels */
+	const TArray<int32>& GetMarkerIds() const { return SolvedIds; }
+	const TArray<float>& GetMarkerResiduals() const { return SolvedResiduals; }
+
+	// minimum number of placed markers for a valid plane
+	int32 MinMarkers;
+
+	// frames over which a marker's placement is averaged before it is frozen
+	int32 LayoutSamples;
+
+	// a marker whose RMS reprojection error is over max(OutlierFactor * median, MinOutlierPixels) is left out of the solve
+	float OutlierFactor;
+	float MinOutlierPixels;
+
+protected:
+
+	struct Placement
+	{
+		int32 Id;
+		int32 Samples;
+		// running sums while learning
+		double SumX, SumY, SumCos, SumSin;
+		// center and in-plane rotation of the marker in the plane frame
+		float X, Y, Angle;
+	};
+
+	/* Defines the plane frame from a robust plane fit to the corners of the visible markers */
+	bool InitializeLayout(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::PoseTracker& MarkerTracker);
+
+	/* Adds the current placement of the visible markers that are still being learned; returns false if none was added */
+	bool RefineLayout(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::PoseTracker& MarkerTracker);
+
+	/* Fits a plane to Points, leaving the normal in PlaneNormal and the weighted centroid in PlaneCentroid */
+	void FitPlane(const cv::vector<cv::Point3d>& Points);
+
+	/* Corners of the marker at Placement in the plane frame, in the order used by aruco::Marker::calculateExtrinsics */
+	void GetPlacementCorners(const Placement& Placed, cv::Point3f* Corners) const;
+
+	/* Gets the object and image points of the markers in SolveIndices, solves the pose and the per-marker residuals */
+	void SolvePose(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams);
+
+	void UpdateOutputs();
+
+	TArray<Placement> Layout;
+
+	TMap<int32, int32> IdToIndex; // marker id -> index in Layout
+
+	float MarkerSize;
+
+	bool HasLayout;
+
+	bool Valid;
+
+	aruco::PoseTracker PlaneTracker;
+
+	cv::Mat Rvec, Tvec;
+
+	cv::Point3f Normal;
+	cv::Point3f Midpoint;
+
+	float ReprojectionError;
+	float PlaneFitError;
+
+	// buffers reused between frames
+	TArray<int32> Visible; // indices into the marker list of the visible group markers
+	TArray<int32> SolveIndices; // subset of Visible that is placed
+	TArray<int32> SolvedIds;
+	TArray<float> SolvedResiduals;
+	TArray<float> SortedResiduals;
+	cv::vector<cv::Point3f> ObjPoints;
+	cv::vector<cv::Point2f> ImagePoints;
+	cv::vector<cv::Point2f> Projected;
+	cv::vector<cv::Point3d> FitPoints;
+	cv::vector<double> FitWeights;
+	cv::vector<double> FitResiduals;
+	cv::vector<double> FitSorted;
+	cv::Point3d PlaneNormal;
+	cv::Point3d PlaneCentroid;
+	cv::Mat MarkerRvec, MarkerTvec, Rotation, PlaneRotation;
+};
@@ -0,0 +1,172 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "MultiBoardDetector.h"
+#include "ParallelFor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMultiBoardDetector, Log, All);
+
+MultiBoardDetector::MultiBoardDetector()
+{
+	ReprojectionThreshold = -1.f;
+	Frame = 0;
+}
+
+MultiBoardDetector::~MultiBoardDetector()
+{
+	ClearBoards();
+}
+
+int32 MultiBoardDetector::AddBoard(const aruco::BoardConfiguration& Config, float MarkerSizeMeters)
+{
+	// aruco::BoardDetector throws on these
+	if (Config.size() == 0 || Config[0].size() < 2) {
+		UE_LOG(LogMultiBoardDetector, Warning, TEXT("Ignoring empty board configuration"));
+		return -1;
+	}
+	int32 Board = Boards.Num();
+	for (size_t i = 0; i < Config.size(); i++) {
+		const BoardMarker* Existing = MarkerBoards.Find(Config[i].id);
+		if (Existing != NULL && Existing->Board != Board) {
+			UE_LOG(LogMultiBoardDetector, Warning, TEXT("Marker %d is on boards %d and %d, ignoring board %d"), Config[i].id, Existing->Board, Board, Board);
+			for (size_t j = 0; j < i; j++) {
+				MarkerBoards.Remove(Config[j].id);
+			}
+			return -1;
+		}
+		BoardMarker Entry;
+		Entry.Board = Board;
+		Entry.Index = (int32)i;
+		MarkerBoards.Add(Config[i].id, Entry);
+	}
+	BoardState* State = new BoardState();
+	State->Config = Config;
+	State->MarkerSize = MarkerSizeMeters;
+	State->Detector.set_repj_err_thres(ReprojectionThreshold);
+	State->Pose.Likelihood = 0.f;
+	State->Pose.ReprojectionError = -1.f;
+	State->DetectedFrame = -1;
+	State->SolvedFrame = Frame;
+	Boards.Add(State);
+	return Board;
+}
+
+void MultiBoardDetector::ClearBoards()
+{
+	for (int32 b = 0; b < Boards.Num(); b++) {
+		delete Boards[b];
+	}
+	Boards.Empty();
+	MarkerBoards.Empty();
+	SeenBoards.Empty();
+}
+
+void MultiBoardDetector::SetReprojectionThreshold(float Pixels)
+{
+	ReprojectionThreshold = Pixels;
+	for (int32 b = 0; b < Boards.Num(); b++) {
+		Boards[b]->Detector.set_repj_err_thres(Pixels);
+	}
+}
+
+bool MultiBoardDetector::FindMarker(int32 MarkerId, int32& OutBoard, int32& OutIndex) const
+{
+	const BoardMarker* Entry = MarkerBoards.Find(MarkerId);
+	if (Entry == NULL) return false;
+	OutBoard = Entry->Board;
+	OutIndex = Entry->Index;
+	return true;
+}
+
+bool MultiBoardDetector::IsBoardDetected(int32 Board) const
+{
+	return Board >= 0 && Board < Boards.Num() && Boards[Board]->DetectedFrame == Frame;
+}
+
+aruco::Board& MultiBoardDetector::GetDetectedBoard(int32 Board)
+{
+	BoardState& State = *Boards[Board];
+	aruco::toMarkers(State.DetectedMarkers, State.Detected);
+	State.Detected.conf = State.Config;
+	return State.Detected;
+}
+
+int32 MultiBoardDetector::Detect(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams)
+{
+	Frame++;
+	// only the buckets filled last frame need emptying
+	for (int32 k = 0; k < SeenBoards.Num(); k++) {
+		Boards[SeenBoards[k]]->Markers.clear();
+		Boards[SeenBoards[k]]->MarkerIndices.clear();
+	}
+	SeenBoards.Reset();
+	for (size_t i = 0; i < Markers.size(); i++) {
+		const BoardMarker* Entry = MarkerBoards.Find(Markers[i].id);
+		if (Entry == NULL) continue;
+		BoardState& State = *Boards[Entry->Board];
+		if (State.Markers.empty()) SeenBoards.Add(Entry->Board);
+		State.Markers.push_back(Markers[i]);
+		State.MarkerIndices.push_back(Entry->Index);
+	}
+
+	// each board has its own detector and buffers, so the solves are independent
+	const int32 NumSeen = SeenBoards.Num();
+	ParallelFor(NumSeen, [this, &CameraParams](int32 k) {
+		SolveBoard(*Boards[SeenBoards[k]], CameraParams);
+	}, NumSeen < 2);
+
+	int32 NumDetected = 0;
+	for (int32 k = 0; k < NumSeen; k++) {
+		if (Boards[SeenBoards[k]]->DetectedFrame == Frame) NumDetected++;
+	}
+	return NumDetected;
+}
+
+void MultiBoardDetector::SolveBoard(BoardState& State, const aruco::CameraParameters& CameraParams)
+{
+	// the detector only counts the frames it is called in: age its pose history over the frames the board was not seen
+	State.Detector.newFrame(Frame - State.SolvedFrame - 1);
+	State.SolvedFrame = Frame;
+	// runs on a task graph worker, which an exception must not reach; a board that fails is just not detected this frame
+	float Likelihood = 0.f;
+	try {
+		Likelihood = State.Detector.detect(State.Markers, State.Config, State.DetectedMarkers, State.Detected.Rvec, State.Detected.Tvec, CameraParams, State.MarkerSize, &State.MarkerIndices);
+	}
+	catch (std::exception& Error) {
+		UE_LOG(LogMultiBoardDetector, Warning, TEXT("Board pose failed: %s"), UTF8_TO_TCHAR(Error.what()));
+		State.DetectedMarkers.clear();
+		return;
+	}
+	if (Likelihood <= 0.f || State.DetectedMarkers.empty() || State.Detected.Rvec.empty()) return;
+	State.Detected.Rvec.copyTo(State.Pose.Rvec);
+	State.Detected.Tvec.copyTo(State.Pose.Tvec);
+	State.Pose.Likelihood = Likelihood;
+	State.Pose.ReprojectionError = (float)State.Detector.getLastReprojectionError();
+	State.DetectedFrame = Frame;
+}
@@ -0,0 +1,119 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "aruco/aruco.h"
+
+/**
+ * Detects any number of boards among the markers found in a frame.
+ * Every marker id of every board goes into one id -> (board, index) table, so the detected markers are sorted into
+ * their boards in a single pass and the cost grows with the markers detected, not with the boards configured.
+ * Only the boards with markers in view have their pose solved, each by its own aruco::BoardDetector (so each keeps its own
+ * pose history), in parallel on the task graph.
+ */
+class MultiBoardDetector
+{
+public:
+
+	/* Pose of a board in the camera, as set by aruco::BoardDetector */
+	struct BoardPose
+	{
+		cv::Mat Rvec;
+		cv::Mat Tvec;
+		float Likelihood; // fraction of the board's markers detected
+		float ReprojectionError; // mean, in pixels
+	};
+
+	MultiBoardDetector();
+	~MultiBoardDetector();
+
+	/*
+	 Adds a board; MarkerSizeMeters is only needed for configurations in pixels.  Returns the index of the board, or -1 if the
+	 configuration is empty or shares a marker id with a board already added.
+	 */
+	int32 AddBoard(const aruco::BoardConfiguration& Config, float MarkerSizeMeters = -1.f);
+
+	void ClearBoards();
+
+	int32 GetNumBoards() const { return Boards.Num(); }
+
+	/* Finds the boards among Markers and solves the pose of each one seen; returns the number of boards detected */
+	int32 Detect(const cv::vector<aruco::MarkerRecord>& Markers, const aruco::CameraParameters& CameraParams);
+
+	/* True if the board was detected in the last call to Detect */
+	bool IsBoardDetected(int32 Board) const;
+
+	/* Pose of the board in the last frame it was detected */
+	const BoardPose& GetPose(int32 Board) const { return Boards[Board]->Pose; }
+
+	/* Markers of the board used for its pose in the last frame it was seen */
+	const cv::vector<aruco::MarkerRecord>& GetDetectedMarkers(int32 Board) const { return Boards[Board]->DetectedMarkers; }
+
+	/* The same as an aruco::Board, with the board's pose and configuration; converted on each call */
+	aruco::Board& GetDetectedBoard(int32 Board);
+
+	/* Looks up the board and the index in its configuration of a marker id; returns false if no board has it */
+	bool FindMarker(int32 MarkerId, int32& OutBoard, int32& OutIndex) const;
+
+	/* Markers reprojecting farther than this (pixels) from a board's pose are rejected as outliers; <= 0 disables the test */
+	void SetReprojectionThreshold(float Pixels);
+
+protected:
+
+	struct BoardMarker
+	{
+		int32 Board;
+		int32 Index;
+	};
+
+	struct BoardState
+	{
+		aruco::BoardConfiguration Config;
+		float MarkerSize;
+		aruco::BoardDetector Detector;
+		cv::vector<aruco::MarkerRecord> Markers; // markers of this board detected in the current frame
+		cv::vector<int> MarkerIndices; // index in Config of each of Markers, from the table
+		cv::vector<aruco::MarkerRecord> DetectedMarkers; // inlier markers of the last solve
+		aruco::Board Detected; // pose set by the detector, markers and configuration only by GetDetectedBoard
+		BoardPose Pose;
+		int32 DetectedFrame;
+		int32 SolvedFrame; // last frame with markers of the board, for aging its pose history over the frames without
+	};
+
+	void SolveBoard(BoardState& State, const aruco::CameraParameters& CameraParams);
+
+	TArray<BoardState*> Boards;
+
+	TMap<int32, BoardMarker> MarkerBoards; // marker id -> board and index in its configuration
+
+	TArray<int32> SeenBoards; // boards with markers in the current frame
+
+	float ReprojectionThreshold;
+
+	int32 Frame;
+};
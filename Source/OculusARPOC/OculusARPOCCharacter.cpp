@@ -2,11 +2,17 @@
 
 #include "OculusARPOC.h"
 #include "OculusARPOCCharacter.h"
+#include "OculusARPOCHUD.h"
 #include "OculusARPOCPlayerController.h"
 #include "OculusARPOCProjectile.h"
 #include "OpenCVVideoSource.h"
 #include "UISurfaceActor.h"
 #include "VideoDisplaySurface.h"
+#include "ARTraceRecorder.h"
+#include "ARDebugDraw.h"
+#include "ARSubsystemInitializer.h"
+#include "LeapHandSampler.h"
+#include "HandTrackingReplay.h"
 #include "Animation/AnimInstance.h"
 #include "Engine.h"
 #include "IHeadMountedDisplay.h"
@@ -83,6 +89,9 @@ AOculusARPOCCharacter::AOculusARPOCCharacter(const FObjectInitializer& ObjectIni
 	LeapEnable = true;
 	LeapDrawSimpleHands = true;
 	RaytraceInputEnable = true;
+	UISurfaceLODEnable = true;
+	MaxUIRedrawsPerFrame = 2;
+	UISurfaceLODActive = false;
 
 	IsInWindowMoveMode = false;
 
@@ -91,14 +100,32 @@ AOculusARPOCCharacter::AOculusARPOCCharacter(const FObjectInitializer& ObjectIni
 
 	SpawnActorAtMarker = true;
 	SpawnedActorFacesCharacter = true;
+	MarkerLostReleaseSeconds = 5.f;
+	UIWindowPoolSize = 2;
+	LastMarkerSeenSeconds = 0.0;
+	ResumeAROnMarker = false;
 	SpawnedActorFollowsMarkerLocation = true;
 	SpawnedActorFollowsMarkerRotation = true; 
+	AdaptiveDetectionQuality = true;
+	DetectionBudgetMs = 4.f;
+	UseKalmanPoseFilter = false;
+	PosePredictionSeconds = 0.03f;
+	UseMarkerMap = false;
+	VideoCaptureResolution = FIntPoint(1280, 720);
+	VideoDisplayResolution = FIntPoint(1280, 720);
+	MarkerDetectionResolution = FIntPoint(1280, 720);
+	UndistortPassthrough = false;
+	SubsystemInitializer = NULL;
+	MarkerDetectorAttached = false;
+	CalibrationErrorsShown = false;
+	VideoSurfaceReady = false;
 
 	ARStarted = false;
 	StartingCharacterLocation = FVector::ZeroVector;
 	StartingMarkerLocation = FVector::ZeroVector;
 
-	PreviousCharacterLocationIndex = -1;
+	LastFilteredDetectionTime = 0.0;
+	MarkerMapAnchored = false;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -110,6 +137,7 @@ void AOculusARPOCCharacter::SetupPlayerInputComponent(class UInputComponent* Inp
 	check(InputComponent);
 
 	InputComponent->BindAction("ResetHMD", IE_Pressed, this, &AOculusARPOCCharacter::ResetHMD);
+	InputComponent->BindAction("TogglePerformanceOverlay", IE_Pressed, this, &AOculusARPOCCharacter::TogglePerformanceOverlay);
 	//InputComponent->BindTouch(EInputEvent::IE_Pressed, this, &AOculusARPOCCharacter::TouchStarted);
 	if (EnableTouchscreenMovement(InputComponent) == false)
 	{
@@ -295,6 +323,25 @@ void AOculusARPOCCharacter::ResetHMD()
 	GEngine->HMDDevice->ResetOrientationAndPosition(0.0);
 }
 
+void AOculusARPOCCharacter::ToggleDebugDrawCategories(int32 CategoryMask)
+{
+#if AR_DEBUG_DRAW_ENABLED
+	ARDebugDraw& DebugDraw = ARDebugDraw::Get();
+	DebugDraw.SetEnabledCategories(DebugDraw.GetEnabledCategories() ^ (uint32)CategoryMask);
+#endif
+}
+
+void AOculusARPOCCharacter::TogglePerformanceOverlay()
+{
+	APlayerController* PlayerController = Cast<APlayerController>(Controller);
+	if (PlayerController) {
+		AOculusARPOCHUD* HUD = Cast<AOculusARPOCHUD>(PlayerController->GetHUD());
+		if (HUD) {
+			HUD->TogglePerformanceOverlay();
+		}
+	}
+}
+
 void AOculusARPOCCharacter::ToggleWindowMoveMode()
 {
 	if (SelectedUISurfaceActor != nullptr) {
@@ -312,13 +359,12 @@ void AOculusARPOCCharacter::ToggleWindowMoveMode()
 void AOculusARPOCCharacter::SpawnUIWindowAtCameraDirectionWithParams(FString URL, float WindowScaleX, float WindowScaleY, float PixelWidth, float DistanceInUnrealUnits) { // NOTE: base size is 1 M square
 	UWorld* const World = GetWorld();
 	if (World){
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.Instigator = this;
 		FVector SpawnLocation = FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * DistanceInUnrealUnits;
 		// NOTE: Camera and ShapePlane mesh have different coordinate systems so can't just add rotators
 		FRotator SpawnRotation = FRotator(0.f - FirstPersonCameraComponent->GetComponentRotation().Roll, 90.f + FirstPersonCameraComponent->GetComponentRotation().Yaw, 90.f + FirstPersonCameraComponent->GetComponentRotation().Pitch);
 
-		AUISurfaceActor* NewUISurface = (AUISurfaceActor*)World->SpawnActor(UISurfaceBlueprintClass, &SpawnLocation, &SpawnRotation, SpawnParams);
+		AUISurfaceActor* NewUISurface = (AUISurfaceActor*)SpawnPool.Acquire(World, UISurfaceBlueprintClass, SpawnLocation, SpawnRotation, this);
+		if (NewUISurface == NULL) return;
 		NewUISurface->SetActorRelativeScale3D(FVector(WindowScaleX, WindowScaleY, 0.f));
 		NewUISurface->CoherentUIViewURL = URL;
 		NewUISurface->CoherentUIViewPixelWidth = PixelWidth;
@@ -327,14 +373,31 @@ void AOculusARPOCCharacter::SpawnUIWindowAtCameraDirectionWithParams(FString URL
 }
 
 AActor* AOculusARPOCCharacter::SpawnActor(UClass* BlueprintClass, FVector Location, FRotator Rotation) { // NOTE: base size is 1 M square
-	UWorld* const World = GetWorld();
-	if (World){
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.Instigator = this;
-		AActor* NewActor = World->SpawnActor(BlueprintClass, &Location, &Rotation, SpawnParams);
-		return NewActor;
-	}
-	return NULL;
+	return SpawnPool.Acquire(GetWorld(), BlueprintClass, Location, Rotation, this);
+}
+
+void AOculusARPOCCharacter::ReleaseActor(AActor* Actor)
+{
+	if (Actor == NULL) return;
+	bool InARScene = ARSceneActors.Contains(Actor);
+	if (ARStarted && (InARScene || Actor == BoardFollowActor)) {
+		// the character moves relative to the AR scene, so it can't go on without part of it: end AR until the marker is seen again
+		StopAR();
+		ResumeAROnMarker = true;
+		if (InARScene) return; // StopAR released it with the rest of the scene
+	}
+	if (Actor == SelectedUISurfaceActor) {
+		SelectedUISurfaceActor = NULL;
+		IsInWindowMoveMode = false;
+	}
+	if (UISurfaceRaytraceHandler != NULL) {
+		UISurfaceRaytraceHandler->ClearSelection(Cast<AUISurfaceActor>(Actor));
+	}
+	ARSceneActors.Remove(Actor);
+	if (Actor == BoardFollowActor) {
+		BoardFollowActor = NULL;
+	}
+	SpawnPool.Release(Actor);
 }
 
 void AOculusARPOCCharacter::HandleZoomInWindow() {
@@ -402,7 +465,8 @@ void AOculusARPOCCharacter::HandleMarkerActor() {
 		}
 		else {
 			if (SpawnActorAtMarker) {
-				GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("About to spawn actor at location: ") + ActorLocation.ToCompactString() + TEXT(", rotation: ") + ActorRotation.ToCompactString());
+				AR_DEBUG_VALUE(MarkerValues, "Spawned actor location", ActorLocation, 5.f);
+				AR_DEBUG_VALUE(MarkerValues, "Spawned actor rotation", ActorRotation, 5.f);
 				//AUISurfaceActor* NewUISurface = (AUISurfaceActor*)this->SpawnActor(UISurfaceBlueprintClass, ActorLocation, ActorRotation);
 				//NewUISurface->SetActorRelativeScale3D(FVector(0.2, 0.2, 0.f));
 				//NewUISurface->CoherentUIViewURL = TEXT("http://www.google.com");
@@ -410,8 +474,10 @@ void AOculusARPOCCharacter::HandleMarkerActor() {
 				//NewUISurface->InitializeView();
 				//BoardFollowActor = NewUISurface;
 				AActor* Prop = this->SpawnActor(PropMeshBlueprintClass, ActorLocation, ActorRotation);
-				Prop->SetActorRelativeScale3D(FVector(0.05, 0.05, 0.05));
-				BoardFollowActor = Prop;
+				if (Prop != NULL) {
+					Prop->SetActorRelativeScale3D(FVector(0.05, 0.05, 0.05));
+					BoardFollowActor = Prop;
+				}
 			}
 		}
 	}
@@ -420,43 +486,126 @@ void AOculusARPOCCharacter::HandleMarkerActor() {
 void AOculusARPOCCharacter::BeginPlay()
 {
 	AVideoDisplaySurface* BackgroundVideoDisplaySurface = (AVideoDisplaySurface*)BackgroundVideoSurface->ChildActor;
-	VideoSource = new OpenCVVideoSource(0, 1280, 720);
+	OpenCVVideoSource* CameraSource = new OpenCVVideoSource(0, VideoDisplayResolution.X, VideoDisplayResolution.Y);
+	CameraSource->SetCaptureResolution(VideoCaptureResolution.X, VideoCaptureResolution.Y);
+	CameraSource->SetDetectionResolution(MarkerDetectionResolution.X, MarkerDetectionResolution.Y);
+	CameraSource->UndistortPassthrough = UndistortPassthrough;
+	VideoSource = CameraSource;
 	VideoSource->SetIsCameraUpsideDown(false);
-	VideoSource->Init();
 	
 	MarkerDetector = new ArucoMarkerDetector();
 	MarkerDetector->DetectMarkers = true;
 	MarkerDetector->DetectSingleMarkerId = -1;
-	// these below are on the board printout
-	//MarkerDetector->PlaneMarker1Id = 985;
-	//MarkerDetector->PlaneMarker2Id = 299;
-	//MarkerDetector->PlaneMarker3Id = 760;
-	//MarkerDetector->PlaneMarker4Id = 977;
-	// these below are the H-U-G-E plane markers
-	MarkerDetector->PlaneMarker1Id = 666;
-	MarkerDetector->PlaneMarker2Id = 683;
-	MarkerDetector->PlaneMarker3Id = 775;
-	MarkerDetector->PlaneMarker4Id = 819;
+	// these are on the board printout: 985, 299, 760, 977 (0.034 m)
+	// these below are the H-U-G-E plane markers; any number of coplanar markers can be added to the group
+	TArray<int32> PlaneMarkerIds;
+	PlaneMarkerIds.Add(666);
+	PlaneMarkerIds.Add(683);
+	PlaneMarkerIds.Add(775);
+	PlaneMarkerIds.Add(819);
+	MarkerDetector->PlaneEstimator.SetMarkerGroup(PlaneMarkerIds, 0.176f);
 	MarkerDetector->DetectBoard = false;
 	MarkerDetector->DetectPlaneMarkers = true;
-	MarkerDetector->Init();
-	VideoSource->SetArucoMarkerDetector(MarkerDetector);
+	MarkerDetector->BuildMarkerMap = UseMarkerMap;
+	MarkerDetector->QualityController.Enabled = AdaptiveDetectionQuality;
+	MarkerDetector->QualityController.BudgetMs = DetectionBudgetMs;
 	
-	BackgroundVideoDisplaySurface->Init(VideoSource);
+	BackgroundVideoDisplaySurface->Init(VideoSource); // shows a placeholder until the camera is ready
 	BackgroundVideoSurface->RelativeLocation = FVector(500.f, -0.f, 0.f);
 	BackgroundVideoSurface->RelativeRotation = FRotator(0.f, 90.f, 90.f);
 	BackgroundVideoSurface->RelativeScale3D = FVector(8.00, 4.50, 1.0); // This is for 1280x720
 	//BackgroundVideoSurface->RelativeScale3D = FVector(7.11, 4.00, 1.0); // This is for 1280x720
 	//BackgroundVideoSurface->RelativeScale3D = FVector(5.33, 3.00, 1.0); // This is for 1280x720
-	LeapController = new Leap::Controller();
-	LeapController->setPolicy(Leap::Controller::POLICY_OPTIMIZE_HMD);
-	LeapInput = new LeapInputReader(LeapController, this);
+	LeapController = NULL;
+	LeapInput = NULL;
+	HandSource = NULL;
+	LiveHandSource = NULL;
+	if (!HandReplayRecording.IsEmpty()) {
+		// replayed hands don't need the device, so they're hooked up straight away
+		HandTrackingReplay* Replay = new HandTrackingReplay();
+		if (Replay->Load(HandTrackingRecorder::GetRecordingPath(HandReplayRecording)) && Replay->Start()) {
+			HandSource = Replay;
+			LeapInput = new LeapInputReader(HandSource, this);
+		}
+		else {
+			delete Replay;
+		}
+	}
 	UISurfaceRaytraceHandler = new UISurfaceRaytraceInputHandler(this, FirstPersonCameraComponent);
+
+	// everything spawned later comes from the pool, so the hitches of spawning (Coherent UI views, meshes) happen here
+	SpawnPool.Prewarm(GetWorld(), UISurfaceBlueprintClass, UIWindowPoolSize, this);
+	SpawnPool.Prewarm(GetWorld(), PropMeshBlueprintClass, 1, this);
+	SpawnPool.Prewarm(GetWorld(), PortalBlueprintClass, 1, this);
+	SpawnPool.Prewarm(GetWorld(), ChairBlueprintClass, 2, this);
+
+	// camera, calibration and Leap come up in the background and are hooked up in UpdateSubsystemInitialization
+	SubsystemInitializer = new ARSubsystemInitializer(VideoSource, MarkerDetector);
+	SubsystemInitializer->Start();
+}
+
+void AOculusARPOCCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (LeapInput != NULL) {
+		delete LeapInput;
+		LeapInput = NULL;
+	}
+	if (HandSource != NULL) {
+		HandSource->Stop(); // stops the Leap polling thread
+		delete HandSource;
+		HandSource = NULL;
+		LiveHandSource = NULL;
+	}
+	if (SubsystemInitializer != NULL) {
+		delete SubsystemInitializer; // waits for subsystems still initializing
+		SubsystemInitializer = NULL;
+		if (!VideoSurfaceReady) {
+			VideoSource->Close(); // the video surface doesn't close a source it never used
+		}
+	}
+	MarkerDetector->WorldMap.StopRefinement();
+	ARSceneActors.Empty();
+	SpawnPool.Empty();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AOculusARPOCCharacter::UpdateSubsystemInitialization()
+{
+	if (SubsystemInitializer == NULL) return;
+	SubsystemInitializer->Update();
+	if (!CalibrationErrorsShown) {
+		ARSubsystemInitializer::State CalibrationState = SubsystemInitializer->GetState(ARSubsystemInitializer::Calibration);
+		if (CalibrationState == ARSubsystemInitializer::Ready || CalibrationState == ARSubsystemInitializer::Failed) {
+			// Init ran on the initializer's thread, where the on-screen messages can't be added
+			const TArray<FString>& Errors = MarkerDetector->GetInitErrors();
+			for (int32 i = 0; i < Errors.Num(); i++) {
+				GEngine->AddOnScreenDebugMessage(-1, 10.0f, FColor::Red, Errors[i]);
+			}
+			CalibrationErrorsShown = true;
+		}
+	}
+	if (!MarkerDetectorAttached && SubsystemInitializer->IsReady(ARSubsystemInitializer::Calibration)) {
+		VideoSource->SetArucoMarkerDetector(MarkerDetector);
+		MarkerDetectorAttached = true;
+	}
+	if (!VideoSurfaceReady && SubsystemInitializer->IsReady(ARSubsystemInitializer::Camera)) {
+		AVideoDisplaySurface* BackgroundVideoDisplaySurface = (AVideoDisplaySurface*)BackgroundVideoSurface->ChildActor;
+		BackgroundVideoDisplaySurface->SetVideoSourceReady(true);
+		VideoSurfaceReady = true;
+	}
+	if (HandSource == NULL && SubsystemInitializer->IsReady(ARSubsystemInitializer::LeapService)) {
+		LeapController = SubsystemInitializer->GetLeapController();
+		LiveHandSource = new LeapHandSampler(LeapController);
+		LiveHandSource->Start();
+		HandSource = LiveHandSource;
+		LeapInput = new LeapInputReader(HandSource, this);
+	}
 }
 
 void AOculusARPOCCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	UpdateSubsystemInitialization();
 	if (IsInWindowMoveMode) {
 		HandleMoveWindow();
 	}
@@ -465,14 +614,16 @@ void AOculusARPOCCharacter::Tick(float DeltaTime)
 		HandleLeap();
 		//HandleMarker();
 	}
+	HandleUISurfaceLOD();
 	//HandleMarkerActor(); 
 	HandleMarkerCharacterMovement();
+	AR_DEBUG_DRAW_FLUSH(GetWorld()); // this frame's commands, and those of actors that ticked after the last flush
 }
 
 void AOculusARPOCCharacter::HandleLeap()
 {
-	if (LeapEnable == true) {
-		LeapInput->UpdateHandLocations();
+	if (LeapEnable == true && LeapInput != NULL) {
+		LeapInput->UpdateHandLocations(FPlatformTime::Seconds() + PosePredictionSeconds); // hands as they will be when the frame is displayed
 		// handle UI input
 		if (LeapInput->IsValidInputLastFrame()) {
 			ActionHandPalmLocation = LeapInput->GetRightPalmLocation_WorldSpace();
@@ -485,6 +636,29 @@ void AOculusARPOCCharacter::HandleLeap()
 	}
 }
 
+void AOculusARPOCCharacter::HandleUISurfaceLOD()
+{
+	if (!UISurfaceLODEnable) {
+		if (UISurfaceLODActive) {
+			UISurfaceLOD.Disable();
+			UISurfaceLODActive = false;
+		}
+		return;
+	}
+	float AspectRatio = 16.f / 9.f;
+	if (GEngine->GameViewport) {
+		FVector2D ViewportSize;
+		GEngine->GameViewport->GetViewportSize(ViewportSize);
+		if (ViewportSize.Y > 0.f) {
+			AspectRatio = ViewportSize.X / ViewportSize.Y;
+		}
+	}
+	UISurfaceLOD.MaxRedrawsPerFrame = MaxUIRedrawsPerFrame;
+	UISurfaceLOD.Update(FirstPersonCameraComponent->GetComponentLocation(), FirstPersonCameraComponent->GetForwardVector(),
+		FirstPersonCameraComponent->FieldOfView, AspectRatio, UISurfaceRaytraceHandler->GetSelectedUISurfaceActor());
+	UISurfaceLODActive = true;
+}
+
 FVector AOculusARPOCCharacter::GetWorldLocationFromMarkerTranslation(FVector MarkerTranslation)
 {
 	FVector WorldLocation = FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * MarkerTranslation.X + FirstPersonCameraComponent->GetRightVector() * MarkerTranslation.Y + FirstPersonCameraComponent->GetUpVector() * MarkerTranslation.Z;
@@ -518,8 +692,11 @@ void AOculusARPOCCharacter::StartAR()
 		StartingMarkerNormalVector = MarkerNormalVector;
 		FVector DetectedWorldNormalVector = GetWorldMarkerNormalVector(MarkerNormalVector);
 		FRotator DetectedNormalWorldRotation = DetectedWorldNormalVector.Rotation();
-		FTransform DetectedMarkerTransform(DetectedNormalWorldRotation, DetectedWorldLocation, *(new FVector(1.f, 1.f, 1.f)));
+		FTransform DetectedMarkerTransform(DetectedNormalWorldRotation, DetectedWorldLocation, FVector(1.f, 1.f, 1.f));
 		StartingMarkerTransform = DetectedMarkerTransform;
+		AdjustedMarkerTranslationFilter.Reset();
+		CharacterLocationFilter.Reset();
+		MarkerMapAnchored = false;
 		//GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("DetectedRotation: ") + DetectedRotation.ToCompactString());
 		FVector ActorLocation = DetectedWorldLocation;
 
@@ -536,7 +713,8 @@ void AOculusARPOCCharacter::StartAR()
 		FRotator AdditionalRotation(0.f, -DetectedNormalWorldRotation.Yaw, -DetectedNormalWorldRotation.Pitch);
 		//FRotator ActorRotation = RotationToFaceCharacter + DetectedRotation;
 		FRotator ActorRotation = RotationToFaceCharacter;
-		GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("About to spawn actor at location: ") + ActorLocation.ToCompactString() + TEXT(", rotation: ") + ActorRotation.ToCompactString());
+		AR_DEBUG_VALUE(MarkerValues, "Spawned actor location", ActorLocation, 5.f);
+		AR_DEBUG_VALUE(MarkerValues, "Spawned actor rotation", ActorRotation, 5.f);
 		//AUISurfaceActor* NewUISurface = (AUISurfaceActor*)this->SpawnActor(UISurfaceBlueprintClass, ActorLocation, ActorRotation);
 		//NewUISurface->SetActorRelativeScale3D(FVector(0.2, 0.2, 0.f));
 		//NewUISurface->CoherentUIViewURL = TEXT("http://www.google.com");
@@ -544,50 +722,165 @@ void AOculusARPOCCharacter::StartAR()
 		//NewUISurface->InitializeView();
 		//BoardFollowActor = NewUISurface;
 		AActor* Prop = this->SpawnActor(PropMeshBlueprintClass, ActorLocation, ActorRotation);
+		if (Prop == NULL) { // the character moves relative to it, AR can't run without it
+			ARStarted = false;
+			return;
+		}
 		Prop->SetActorRelativeScale3D(FVector(0.50, 0.50, 0.50));
 		BoardFollowActor = Prop;
+		ARSceneActors.Add(Prop);
 		AActor* Portal = this->SpawnActor(PortalBlueprintClass, FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * 30.f - FirstPersonCameraComponent->GetUpVector() * 100.f, FRotator::ZeroRotator);
-		Portal->SetActorRelativeScale3D(FVector(0.5, 0.7   , 0.7));
+		if (Portal != NULL) {
+			Portal->SetActorRelativeScale3D(FVector(0.5, 0.7   , 0.7));
+			ARSceneActors.Add(Portal);
+		}
 		AActor* Chair1 = this->SpawnActor(ChairBlueprintClass, FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * 75.f - FirstPersonCameraComponent->GetRightVector() * 75.f - FirstPersonCameraComponent->GetUpVector() * 64.f, FRotator(0.f, 90.f, 0.f));
-		Chair1->SetActorRelativeScale3D(FVector(0.7, 0.7, 0.7));
+		if (Chair1 != NULL) {
+			Chair1->SetActorRelativeScale3D(FVector(0.7, 0.7, 0.7));
+			ARSceneActors.Add(Chair1);
+		}
 		AActor* Chair2 = this->SpawnActor(ChairBlueprintClass, FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * 75.f + FirstPersonCameraComponent->GetRightVector() * 75.f - FirstPersonCameraComponent->GetUpVector() * 64.f, FRotator(0.f, -90.f, 0.f));
-		Chair2->SetActorRelativeScale3D(FVector(0.7, 0.7, 0.7));
+		if (Chair2 != NULL) {
+			Chair2->SetActorRelativeScale3D(FVector(0.7, 0.7, 0.7));
+			ARSceneActors.Add(Chair2);
+		}
+		LastMarkerSeenSeconds = FPlatformTime::Seconds();
+		ResumeAROnMarker = false;
 	}
 }
 
+void AOculusARPOCCharacter::StopAR()
+{
+	ARStarted = false;
+	ResumeAROnMarker = false;
+	while (ARSceneActors.Num() > 0) {
+		ReleaseActor(ARSceneActors.Pop()); // clears BoardFollowActor too
+	}
+}
+
+void AOculusARPOCCharacter::StartPipelineTrace()
+{
+#if AR_TRACE_ENABLED
+	ARTraceRecorder::Get().Start();
+#endif
+}
+
+FString AOculusARPOCCharacter::StopPipelineTrace()
+{
+#if AR_TRACE_ENABLED
+	FString TracePath = FPaths::GameSavedDir() / TEXT("Traces") / (TEXT("ARPipeline-") + FDateTime::Now().ToString() + TEXT(".json"));
+	if (ARTraceRecorder::Get().StopAndExport(TracePath)) {
+		GEngine->AddOnScreenDebugMessage(-1, 5.0f, FColor::Yellow, TEXT("Wrote pipeline trace: ") + TracePath);
+		return TracePath;
+	}
+#endif
+	return FString();
+}
+
+bool AOculusARPOCCharacter::StartHandRecording()
+{
+	if (LiveHandSource == NULL) return false; // no device, or replaying
+	HandRecorder.Start();
+	LiveHandSource->SetRecorder(&HandRecorder);
+	return true;
+}
+
+bool AOculusARPOCCharacter::StopHandRecording(FString RecordingName)
+{
+	if (LiveHandSource != NULL) {
+		LiveHandSource->SetRecorder(NULL);
+	}
+	return HandRecorder.StopAndSave(HandTrackingRecorder::GetRecordingPath(RecordingName));
+}
+
+bool AOculusARPOCCharacter::SaveMarkerMap(FString MapName)
+{
+	return MarkerDetector->WorldMap.Save(MarkerMap::GetMapPath(MapName));
+}
+
+bool AOculusARPOCCharacter::LoadMarkerMap(FString MapName)
+{
+	MarkerMapAnchored = false;
+	return MarkerDetector->WorldMap.Load(MarkerMap::GetMapPath(MapName));
+}
+
+void AOculusARPOCCharacter::ClearMarkerMap()
+{
+	MarkerMapAnchored = false;
+	MarkerDetector->WorldMap.Clear();
+}
+
+void AOculusARPOCCharacter::HandleMarkerMapMovement()
+{
+	CharacterLocationFilter.SetMethod(UseKalmanPoseFilter ? PoseFilter::Kalman : PoseFilter::OneEuro);
+	FTransform CameraInMap = MarkerDetector->WorldMap.GetCameraTransform();
+	if (!MarkerMapAnchored) {
+		// place the map so that it agrees with where the camera is right now
+		MarkerMapToWorld = CameraInMap.Inverse() * FirstPersonCameraComponent->GetComponentTransform();
+		MarkerMapAnchored = true;
+	}
+	double DetectionTime = MarkerDetector->GetDetectionFrameTime();
+	if (DetectionTime != LastFilteredDetectionTime) {
+		FVector CameraLocation = (CameraInMap * MarkerMapToWorld).GetLocation();
+		FVector CameraOffset = FirstPersonCameraComponent->GetComponentLocation() - GetActorLocation();
+		CharacterLocationFilter.UpdateLocation(CameraLocation - CameraOffset, DetectionTime);
+		LastFilteredDetectionTime = DetectionTime;
+	}
+	SetActorLocation(CharacterLocationFilter.PredictLocation(FPlatformTime::Seconds() + PosePredictionSeconds));
+}
+
 void AOculusARPOCCharacter::HandleMarkerCharacterMovement()
 {
-	if (ARStarted && MarkerDetector->IsDetected())
+	// the AR scene is recycled while the marker is lost, and taken back from the pool when it shows up again
+	if (ARStarted) {
+		if (MarkerDetector->IsDetected() || (UseMarkerMap && MarkerDetector->WorldMap.IsLocalized())) {
+			LastMarkerSeenSeconds = FPlatformTime::Seconds();
+		}
+		else if (FPlatformTime::Seconds() - LastMarkerSeenSeconds > MarkerLostReleaseSeconds) {
+			StopAR();
+			ResumeAROnMarker = true;
+			return;
+		}
+	}
+	else if (ResumeAROnMarker) {
+		StartAR(); // only starts once the marker is detected
+	}
+	if (ARStarted && UseMarkerMap && MarkerDetector->WorldMap.IsLocalized()) {
+		HandleMarkerMapMovement();
+		return;
+	}
+	if (ARStarted && MarkerDetector->IsDetected() && BoardFollowActor != NULL)
 	{
-		//GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("PlaneMarker1Translation: ") + MarkerDetector->PlaneMarker1Translation.ToCompactString());
-		FVector PlaneMarker1Location = GetWorldLocationFromMarkerTranslation(MarkerDetector->PlaneMarker1Translation);
-		FVector PlaneMarker2Location = GetWorldLocationFromMarkerTranslation(MarkerDetector->PlaneMarker2Translation);
-		FVector PlaneMarker3Location = GetWorldLocationFromMarkerTranslation(MarkerDetector->PlaneMarker3Translation);
-		FVector PlaneMarker4Location = GetWorldLocationFromMarkerTranslation(MarkerDetector->PlaneMarker4Translation);
-		DrawDebugSphere(GetWorld(), PlaneMarker1Location, 0.5, 12, FColor::Magenta);
-		DrawDebugSphere(GetWorld(), PlaneMarker2Location, 0.5, 12, FColor::Magenta);
-		DrawDebugSphere(GetWorld(), PlaneMarker3Location, 0.5, 12, FColor::Magenta);
-		DrawDebugSphere(GetWorld(), PlaneMarker4Location, 0.5, 12, FColor::Magenta);
+		PoseFilter::Method FilterMethod = UseKalmanPoseFilter ? PoseFilter::Kalman : PoseFilter::OneEuro;
+		AdjustedMarkerTranslationFilter.SetMethod(FilterMethod);
+		CharacterLocationFilter.SetMethod(FilterMethod);
+		// the filters only take a measurement when detection ran on a new frame, in between the pose is extrapolated
+		double DetectionTime = MarkerDetector->GetDetectionFrameTime();
+		bool IsNewDetection = DetectionTime != LastFilteredDetectionTime;
+		double DisplayTime = FPlatformTime::Seconds() + PosePredictionSeconds;
+		const TArray<int32>& PlaneMarkerIds = MarkerDetector->PlaneEstimator.GetMarkerIds();
+		for (int32 i = 0; i < PlaneMarkerIds.Num(); i++) {
+			FVector PlaneMarkerLocation = GetWorldLocationFromMarkerTranslation(MarkerDetector->GetDetectedMarkerTranslation(PlaneMarkerIds[i]));
+			AR_DEBUG_SPHERE(Markers, PlaneMarkerLocation, 0.5, FColor::Magenta);
+		}
 		FVector MarkerTranslation = MarkerDetector->GetPlaneMarkersMidpoint();
 		float MarkerDistance = MarkerTranslation.Size();
-		GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================StartingMarkerTranslation: ") + MarkerTranslation.ToCompactString());
-		GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================MarkerTranslation: ") + MarkerTranslation.ToCompactString());
+		AR_DEBUG_VALUE(MarkerValues, "StartingMarkerTranslation", StartingMarkerTranslation);
+		AR_DEBUG_VALUE(MarkerValues, "MarkerTranslation", MarkerTranslation);
 		FVector MarkerLocation = GetWorldLocationFromMarkerTranslation(MarkerTranslation);
-		DrawDebugSphere(GetWorld(), MarkerLocation, 0.5, 12, FColor::Red);
+		AR_DEBUG_SPHERE(Markers, MarkerLocation, 0.5, FColor::Red);
 		FVector MarkerNormalVector = MarkerDetector->GetPlaneMarkersNormalVector();
 		FVector WorldMarkerNormalVector = GetWorldMarkerNormalVector(MarkerNormalVector);
 		FRotator MarkerRotation = MarkerDetector->GetPlaneMarkersRotation();
 		FRotator WorldMarkerRotation = WorldMarkerNormalVector.Rotation();
-		FTransform WorldMarkerTransform(WorldMarkerRotation, MarkerLocation, *(new FVector(1.f, 1.f, 1.f)));
-		GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================MarkerRotation: ") + MarkerRotation.ToCompactString());
-		FVector CylinderEnd = MarkerLocation + WorldMarkerNormalVector;
-		FVector CylinderEnd2 = MarkerLocation + WorldMarkerNormalVector * 20.f;
-		DrawDebugCylinder(GetWorld(), MarkerLocation, CylinderEnd, 15.f, 12, FColor::Cyan);
-		DrawDebugCylinder(GetWorld(), MarkerLocation, CylinderEnd2, 1.f, 12, FColor::Magenta);
+		FTransform WorldMarkerTransform(WorldMarkerRotation, MarkerLocation, FVector(1.f, 1.f, 1.f));
+		AR_DEBUG_VALUE(MarkerValues, "MarkerRotation", MarkerRotation);
+		AR_DEBUG_CYLINDER(Markers, MarkerLocation, MarkerLocation + WorldMarkerNormalVector, 15.f, FColor::Cyan);
+		AR_DEBUG_CYLINDER(Markers, MarkerLocation, MarkerLocation + WorldMarkerNormalVector * 20.f, 1.f, FColor::Magenta);
 		FVector CameraLocation = FirstPersonCameraComponent->GetComponentLocation();
 		FVector CameraLocationInMarkerSpace = WorldMarkerTransform.InverseTransformPositionNoScale(CameraLocation);
-		GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================CameraLocation: ") + CameraLocation.ToCompactString());
-		GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================CameraLocationInMarkerSpace: ") + CameraLocationInMarkerSpace.ToCompactString());
+		AR_DEBUG_VALUE(MarkerValues, "CameraLocation", CameraLocation);
+		AR_DEBUG_VALUE(MarkerValues, "CameraLocationInMarkerSpace", CameraLocationInMarkerSpace);
 		//DrawDebugLine(GetWorld(), FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * 50 + FirstPersonCameraComponent->GetRightVector() * 50, FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * 100 + FirstPersonCameraComponent->GetRightVector() * 100, FColor::Red);
 		//DrawDebugLine(GetWorld(), FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * 50 - FirstPersonCameraComponent->GetRightVector() * 50, FirstPersonCameraComponent->GetComponentLocation() + FirstPersonCameraComponent->GetForwardVector() * 100 - FirstPersonCameraComponent->GetRightVector() * 100, FColor::Red);
 		//FVector ForwardCylinderEnd = BoardFollowActor->GetActorLocation() + BoardFollowActor->GetActorForwardVector() * 20;
@@ -603,13 +896,16 @@ void AOculusARPOCCharacter::HandleMarkerCharacterMovement()
 			MarkerRotationDelta.Pitch = -MarkerRotationDelta.Pitch;
 			//GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================MarkerRotationDelta: ") + MarkerRotationDelta.ToCompactString());
 			FVector AdjustedMarkerTranslation = MarkerRotationDelta.RotateVector(MarkerTranslation);
-			FVector AdjustedMarkerTranslationMovingAverage = GetAdjustedMarkerTranslationMovingAverage(AdjustedMarkerTranslation);
-			FVector AdjustedCameraPosition = BoardFollowActor->GetActorLocation() + BoardFollowActor->GetActorRightVector() * AdjustedMarkerTranslationMovingAverage.X - BoardFollowActor->GetActorForwardVector() * AdjustedMarkerTranslationMovingAverage.Y - BoardFollowActor->GetActorUpVector() * AdjustedMarkerTranslationMovingAverage.Z;
-			FVector AdjustedCameraTranslation = FVector(AdjustedMarkerTranslationMovingAverage.X, -AdjustedMarkerTranslationMovingAverage.Y, -AdjustedMarkerTranslationMovingAverage.Z);
-			FVector AdjustedCameraLocation = BoardFollowActor->GetActorLocation() + BoardFollowActor->GetActorRightVector() * AdjustedMarkerTranslationMovingAverage.X - BoardFollowActor->GetActorForwardVector() * AdjustedMarkerTranslationMovingAverage.Y - BoardFollowActor->GetActorUpVector() * AdjustedMarkerTranslationMovingAverage.Z;
+			if (IsNewDetection) {
+				AdjustedMarkerTranslationFilter.UpdateLocation(AdjustedMarkerTranslation, DetectionTime);
+			}
+			FVector FilteredAdjustedMarkerTranslation = AdjustedMarkerTranslationFilter.PredictLocation(DisplayTime);
+			FVector AdjustedCameraPosition = BoardFollowActor->GetActorLocation() + BoardFollowActor->GetActorRightVector() * FilteredAdjustedMarkerTranslation.X - BoardFollowActor->GetActorForwardVector() * FilteredAdjustedMarkerTranslation.Y - BoardFollowActor->GetActorUpVector() * FilteredAdjustedMarkerTranslation.Z;
+			FVector AdjustedCameraTranslation = FVector(FilteredAdjustedMarkerTranslation.X, -FilteredAdjustedMarkerTranslation.Y, -FilteredAdjustedMarkerTranslation.Z);
+			FVector AdjustedCameraLocation = BoardFollowActor->GetActorLocation() + BoardFollowActor->GetActorRightVector() * FilteredAdjustedMarkerTranslation.X - BoardFollowActor->GetActorForwardVector() * FilteredAdjustedMarkerTranslation.Y - BoardFollowActor->GetActorUpVector() * FilteredAdjustedMarkerTranslation.Z;
 			//FVector AdjustedCameraLocation = StartingMarkerTransform.TransformPosition(AdjustedCameraTranslation);
-			FVector AdjustedMarkerLocationMovingAverage = GetWorldLocationFromMarkerTranslation(AdjustedMarkerTranslationMovingAverage);
-			//DrawDebugSphere(GetWorld(), AdjustedMarkerLocationMovingAverage, 1.0, 12, FColor::Green);
+			FVector FilteredAdjustedMarkerLocation = GetWorldLocationFromMarkerTranslation(FilteredAdjustedMarkerTranslation);
+			//DrawDebugSphere(GetWorld(), FilteredAdjustedMarkerLocation, 1.0, 12, FColor::Green);
 			//GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================StartingMarkerLocation: ") + StartingMarkerLocation.ToCompactString());
 			//GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================StartingMarkerTranslation: ") + StartingMarkerTranslation.ToCompactString());
 			//GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================AdjustedMarkerTranslation: ") + AdjustedMarkerTranslation.ToCompactString());
@@ -622,9 +918,10 @@ void AOculusARPOCCharacter::HandleMarkerCharacterMovement()
 			//FVector NewCharacterLocation = StartingCharacterLocation + StartingCameraForwardVector * (StartingMarkerDistance - MarkerDistance);
 			FVector NewCharacterLocation = BoardFollowActor->GetActorLocation() + BoardFollowActor->GetActorRightVector() * CameraLocationInMarkerSpace.X - BoardFollowActor->GetActorForwardVector() * CameraLocationInMarkerSpace.Y + BoardFollowActor->GetActorUpVector() * CameraLocationInMarkerSpace.Z;
 			NewCharacterLocation.Z = NewCharacterLocation.Z - 64.f;
-			FVector CharacterLocationMovingAverage = this->GetCharacterLocationMovingAverage(NewCharacterLocation);
-			this->SetActorLocation(CharacterLocationMovingAverage);
-			DrawDebugSphere(GetWorld(), MarkerLocation, 0.5, 12, FColor::Red);
+			if (IsNewDetection) {
+				CharacterLocationFilter.UpdateLocation(NewCharacterLocation, DetectionTime);
+			}
+			this->SetActorLocation(CharacterLocationFilter.PredictLocation(DisplayTime));
 
 			//UNavigationSystem* const NavSys = GetWorld()->GetNavigationSystem();
 			//NavSys->SimpleMoveToLocation(Controller, StartingCharacterLocation + MarkerLocationDelta);
@@ -632,41 +929,10 @@ void AOculusARPOCCharacter::HandleMarkerCharacterMovement()
 			//GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================NewCharacterLocation: ") + NewCharacterLocation.ToCompactString());
 			//GEngine->AddOnScreenDebugMessage(-1, 50.0f, FColor::Yellow, TEXT("===========================================CharacterLocationDelta: ") + CharacterLocationDelta.ToCompactString());
 		}
+		LastFilteredDetectionTime = DetectionTime;
 	}
 }
 
-FVector AOculusARPOCCharacter::GetAdjustedMarkerTranslationMovingAverage(FVector LatestAdjustedMarkerTranslation) {
-	uint8 numItems = 10;
-	if (PreviousAdjustedMarkerTranslations.Num() >= numItems) {
-		PreviousAdjustedMarkerTranslations.RemoveAt(0);
-	}
-	PreviousAdjustedMarkerTranslations.Add(&LatestAdjustedMarkerTranslation);
-	FVector TotalVector = FVector::ZeroVector;
-	for (int32 Index = 0; Index != PreviousAdjustedMarkerTranslations.Num(); ++Index)
-	{
-		TotalVector = TotalVector + *(PreviousAdjustedMarkerTranslations[Index]);
-	}
-	return TotalVector / PreviousAdjustedMarkerTranslations.Num();
-}
-
-FVector AOculusARPOCCharacter::GetCharacterLocationMovingAverage(FVector LatestCharacterLocation) {
-	if (PreviousCharacterLocationIndex == -1)
-	{
-		PreviousCharacterLocations.Init(LatestCharacterLocation, 10);
-		PreviousCharacterLocationIndex = 0;
-	}
-	if (PreviousCharacterLocationIndex == 10) {
-		PreviousCharacterLocationIndex = 0;
-	}
-	PreviousCharacterLocations[PreviousCharacterLocationIndex] = LatestCharacterLocation;
-	FVector TotalVector = FVector::ZeroVector;
-	for (int32 Index = 0; Index != PreviousCharacterLocations.Num(); ++Index)
-	{
-		TotalVector = TotalVector + PreviousCharacterLocations[Index];
-	}
-	PreviousCharacterLocationIndex++;
-	return TotalVector / PreviousCharacterLocations.Num();
-}
 
 
 
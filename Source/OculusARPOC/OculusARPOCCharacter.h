@@ -4,11 +4,16 @@
 #include "ArucoMarkerDetector.h"
 #include "Leap.h"
 #include "LeapInputReader.h"
+#include "HandTrackingRecorder.h"
 #include "UISurfaceRaytraceInputHandler.h"
+#include "UISurfaceLODScheduler.h"
+#include "ActorPool.h"
 #include "VideoDisplaySurface.h"
+#include "PoseFilters.h"
 #include "OculusARPOCCharacter.generated.h"
 
 class UInputComponent;
+class LeapHandSampler;
 
 UCLASS(config=Game)
 class AOculusARPOCCharacter : public ACharacter
@@ -47,10 +52,36 @@ class AOculusARPOCCharacter : public ACharacter
 
 	LeapInputReader* LeapInput;
 
+	IHandTrackingSource* HandSource; // the live Leap sampler or a replay
+
+	LeapHandSampler* LiveHandSource; // same as HandSource when hands come from the device, NULL when replaying
+
+	HandTrackingRecorder HandRecorder;
+
 	UISurfaceRaytraceInputHandler* UISurfaceRaytraceHandler;
 
+	UISurfaceLODScheduler UISurfaceLOD;
+
+	bool UISurfaceLODActive; // the scheduler has throttled views that must be restored when it is disabled
+
 	AActor* BoardFollowActor;
 
+	ActorPool SpawnPool; // props and UI windows are recycled rather than spawned on demand
+
+	double LastMarkerSeenSeconds; // FPlatformTime::Seconds() when HandleMarkerCharacterMovement last saw the marker (or was localized in the map)
+
+	TArray<AActor*> ARSceneActors; // what StartAR took from the pool, handed back together by StopAR
+
+	bool ResumeAROnMarker; // the AR scene was released because the marker was lost: StartAR again once it is seen
+
+	class ARSubsystemInitializer* SubsystemInitializer;
+
+	bool MarkerDetectorAttached;
+
+	bool CalibrationErrorsShown;
+
+	bool VideoSurfaceReady;
+
 
 public:
 	AOculusARPOCCharacter(const FObjectInitializer& ObjectInitializer);
@@ -87,9 +118,29 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Leap)
 		bool LeapDrawSimpleHands;
 
+	/** If set, hands are replayed from the recording Saved/HandRecordings/<HandReplayRecording>.hand instead of coming from the Leap device */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Leap)
+		FString HandReplayRecording;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Leap)
 		FString ImageSource;  // TODO: should be enum
 
+	/** Resolution requested from the passthrough camera */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Video)
+		FIntPoint VideoCaptureResolution;
+
+	/** Resolution of the passthrough texture; the captured frame is resampled if it differs */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Video)
+		FIntPoint VideoDisplayResolution;
+
+	/** Undistort the passthrough image with the camera calibration so virtual objects stay aligned towards the edges */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Video)
+		bool UndistortPassthrough;
+
+	/** Resolution markers are detected at; lower is faster at the cost of range and pose precision */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
+		FIntPoint MarkerDetectionResolution;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Raytrace)
 		bool RaytraceInputEnable;
 
@@ -105,6 +156,14 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Raytrace)
 		float RaytraceDrawFraction;
 
+	// refresh UI surface views at a rate that follows their size on screen (see UISurfaceLODScheduler)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoherentUI)
+		bool UISurfaceLODEnable;
+
+	// how many UI surface views may refresh in one frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoherentUI)
+		int32 MaxUIRedrawsPerFrame;
+
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = CoherentUI)
 	class AUISurfaceActor* SelectedUISurfaceActor;
@@ -145,12 +204,40 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
 		bool SpawnedActorFacesCharacter;
 
+	/** Once the marker (and the marker map) has been lost for this long the AR scene goes back to the pool; it is taken back when the marker is seen again (seconds) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
+		float MarkerLostReleaseSeconds;
+
+	/** UI windows spawned ahead of time at BeginPlay, so opening one doesn't create a Coherent UI view */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoherentUI)
+		int32 UIWindowPoolSize;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
 		bool SpawnedActorFollowsMarkerLocation;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
 		bool SpawnedActorFollowsMarkerRotation;
 
+	/** If true the marker detector trades accuracy for speed whenever detection runs over DetectionBudgetMs */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
+		bool AdaptiveDetectionQuality;
+
+	/** Time budget per frame for marker detection and pose estimation, in milliseconds */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
+		float DetectionBudgetMs;
+
+	/** If true marker driven movement is smoothed with a constant-velocity Kalman filter, otherwise with a One-Euro filter */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
+		bool UseKalmanPoseFilter;
+
+	/** How far ahead of now the filtered marker pose is extrapolated, to make up for the time until the frame is displayed (seconds) */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
+		float PosePredictionSeconds;
+
+	/** If true every marker seen is added to a map of the room, and while the map localizes the camera the character is moved from whichever mapped markers are visible instead of from the plane markers */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Aruco)
+		bool UseMarkerMap;
+
 public:
 
 	virtual FRotator GetViewRotation() const override;
@@ -158,15 +245,27 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Camera)
 		void ResetHMD();
 
+	UFUNCTION(BlueprintCallable, Category = Profiling)
+		void TogglePerformanceOverlay();
+
+	/** Turns the debug draw categories in the mask (see ARDebugCategory) on or off; no effect in shipping builds */
+	UFUNCTION(Exec, BlueprintCallable, Category = Profiling)
+		void ToggleDebugDrawCategories(int32 CategoryMask);
+
 	UFUNCTION(BlueprintCallable, Category = CoherentUI)
 		void ToggleWindowMoveMode();
 
 	UFUNCTION(BlueprintCallable, Category = CoherentUI)
 		void SpawnUIWindowAtCameraDirectionWithParams(FString URL, float WindowScaleX, float WindowScaleY, float PixelWidth, float DistanceInUnrealUnits);
 
+	/** Takes an actor of BlueprintClass from the pool (spawning one only if none is free) */
 	UFUNCTION(BlueprintCallable, Category = Aruco)
 		AActor* SpawnActor(UClass* BlueprintClass, FVector Location, FRotator Rotation);
 
+	/** Hands an actor from SpawnActor (or a UI window) back to the pool instead of destroying it */
+	UFUNCTION(BlueprintCallable, Category = Aruco)
+		void ReleaseActor(AActor* Actor);
+
 	UFUNCTION(BlueprintCallable, Category = CoherentUI)
 		void HandleZoomInWindow();
 
@@ -176,6 +275,37 @@ public:
 	UFUNCTION(BlueprintCallable, Category = Aruco)
 		void StartAR();
 
+	/** Hands the actors StartAR spawned back to the pool; StartAR can then be called again */
+	UFUNCTION(BlueprintCallable, Category = Aruco)
+		void StopAR();
+
+	/** Saves the marker map to Saved/MarkerMaps/<MapName>.bin */
+	UFUNCTION(BlueprintCallable, Category = Aruco)
+		bool SaveMarkerMap(FString MapName);
+
+	/** Loads a marker map saved with SaveMarkerMap, replacing the current one */
+	UFUNCTION(BlueprintCallable, Category = Aruco)
+		bool LoadMarkerMap(FString MapName);
+
+	UFUNCTION(BlueprintCallable, Category = Aruco)
+		void ClearMarkerMap();
+
+	/** Starts recording the frames of the Leap device, for replay with HandReplayRecording */
+	UFUNCTION(BlueprintCallable, Category = Leap)
+		bool StartHandRecording();
+
+	/** Stops recording and saves the recording to Saved/HandRecordings/<RecordingName>.hand */
+	UFUNCTION(BlueprintCallable, Category = Leap)
+		bool StopHandRecording(FString RecordingName);
+
+	/** Starts recording the AR frame pipeline (capture, detection, pose, Leap, raytrace, texture upload) for offline analysis */
+	UFUNCTION(BlueprintCallable, Category = Profiling)
+		void StartPipelineTrace();
+
+	/** Stops the pipeline trace and writes it to Saved/Traces as Chrome trace JSON (open it in Perfetto). Returns the file path. */
+	UFUNCTION(BlueprintCallable, Category = Profiling)
+		FString StopPipelineTrace();
+
 protected:
 	
 	/** Fires a projectile. */
@@ -230,13 +360,24 @@ protected:
 
 	virtual void Tick(float DeltaTime) override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Hooks up the camera, marker detector and Leap as their background initialization completes */
+	void UpdateSubsystemInitialization();
+
 	void HandleLeap();
 
+	/** Decides which UI surface views refresh for this frame's view */
+	void HandleUISurfaceLOD();
+
 	void HandleMoveWindow();
 
 	void HandleMarkerActor();
 
 	void HandleMarkerCharacterMovement();
+
+	/* Moves the character so the camera follows its pose in the marker map */
+	void HandleMarkerMapMovement();
 		
 	FVector LeapPositionToUnrealLocation(Leap::Vector LeapPosition, FVector UnrealOffset);
 
@@ -244,10 +385,6 @@ protected:
 
 	FVector GetWorldMarkerNormalVector(FVector MarkerNormalVector);
 		
-	FVector GetAdjustedMarkerTranslationMovingAverage(FVector LatestAdjustedMarkerTranslation);
-
-	FVector GetCharacterLocationMovingAverage(FVector LatestCharacterLocation);
-
 	bool BoardWindowIsSpawned;
 
 	bool ARStarted;
@@ -262,10 +399,15 @@ protected:
 	FVector StartingMarkerNormalVector;
 	FTransform StartingMarkerTransform;
 
-	TArray<FVector*> PreviousAdjustedMarkerTranslations; // used to calculate running average
+	// smooth the marker driven poses and extrapolate them from the camera frame time to the display time
+	PoseFilter AdjustedMarkerTranslationFilter;
+	PoseFilter CharacterLocationFilter;
+
+	double LastFilteredDetectionTime; // detection frame time of the last measurement fed to the filters
 
-	TArray<FVector> PreviousCharacterLocations; // used to calculate moving average
-	int PreviousCharacterLocationIndex;
+	// places the marker map in the world; anchored the first time the camera is localized after AR starts
+	FTransform MarkerMapToWorld;
+	bool MarkerMapAnchored;
 
 public:
 	/** Returns Mesh1P subobject **/
@@ -6,12 +6,24 @@
 #include "Engine/Canvas.h"
 #include "TextureResource.h"
 #include "CanvasItem.h"
+#include "ARPipelineStats.h"
+#include "DetectionQualityController.h"
 
 AOculusARPOCHUD::AOculusARPOCHUD(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 	// Set the crosshair texture
 	static ConstructorHelpers::FObjectFinder<UTexture2D> CrosshiarTexObj(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair"));
 	CrosshairTex = CrosshiarTexObj.Object;
+
+	ShowPerformanceOverlay = false;
+	PerformanceOverlayRefreshInterval = 0.25f;
+	LastPerformanceOverlayRefresh = 0.0;
+}
+
+void AOculusARPOCHUD::TogglePerformanceOverlay()
+{
+	ShowPerformanceOverlay = !ShowPerformanceOverlay;
+	LastPerformanceOverlayRefresh = 0.0; // refresh immediately when shown
 }
 
 
@@ -55,5 +67,46 @@ void AOculusARPOCHUD::DrawHUD()
 		Canvas->DrawItem(LeftBorder);
 		Canvas->DrawItem(RightBorder);
 	}
+
+	if (ShowPerformanceOverlay) {
+		DrawPerformanceOverlay();
+	}
+}
+
+void AOculusARPOCHUD::DrawPerformanceOverlay()
+{
+	double Now = FPlatformTime::Seconds();
+	if (Now - LastPerformanceOverlayRefresh >= PerformanceOverlayRefreshInterval) {
+		LastPerformanceOverlayRefresh = Now;
+		ARPipelineStatsSnapshot Stats;
+		ARPipelineStats::Get().GetSnapshot(Stats);
+		PerformanceOverlayLines.Reset();
+		PerformanceOverlayLines.Add(FString::Printf(TEXT("Capture: %.1f fps  %.2f ms  convert %.2f ms  dropped %d"), Stats.CaptureFps, Stats.CaptureMs, Stats.ConvertMs, (int32)Stats.DroppedFrames));
+		PerformanceOverlayLines.Add(FString::Printf(TEXT("Detection: %.2f ms total"), Stats.DetectionTotalMs));
+		PerformanceOverlayLines.Add(FString::Printf(TEXT("  quality %d (%s)"), (int32)Stats.DetectionQualityLevel, DetectionQualityController::GetQualityLevelName((int32)Stats.DetectionQualityLevel)));
+		PerformanceOverlayLines.Add(FString::Printf(TEXT("  grey %.2f  thres %.2f  rects %.2f  ident %.2f  refine %.2f  pose %.2f"), Stats.DetectGreyMs, Stats.DetectThresholdMs, Stats.DetectRectanglesMs, Stats.DetectIdentifyMs, Stats.DetectRefinementMs, Stats.PoseMs));
+		PerformanceOverlayLines.Add(FString::Printf(TEXT("Candidates: %d  markers: %d  plane error %.2f px"), (int32)Stats.CandidatesPerFrame, (int32)Stats.MarkersTracked, Stats.PlaneReprojectionError));
+		PerformanceOverlayLines.Add(Stats.PoseAgeSeconds < 0.f ? FString(TEXT("Pose age: none")) : FString::Printf(TEXT("Pose age: %.0f ms"), Stats.PoseAgeSeconds * 1000.f));
+		PerformanceOverlayLines.Add(Stats.LeapFrameAgeSeconds < 0.f ? FString(TEXT("Leap frame age: none")) : FString::Printf(TEXT("Leap frame age: %.0f ms  input to display %.0f ms"), Stats.LeapFrameAgeSeconds * 1000.f, Stats.LeapInputLatencyMs));
+		PerformanceOverlayLines.Add(FString::Printf(TEXT("Texture upload: %.2f ms"), Stats.TextureUploadMs));
+		// how much coalescing saves: events the input handlers queued per event the views received
+		PerformanceOverlayLines.Add(FString::Printf(TEXT("UI input: %d events queued  %d dispatched  (%.1f per dispatch)"), (int32)Stats.UIEventsGenerated, (int32)Stats.UIEventsDispatched,
+			Stats.UIEventsGenerated / FMath::Max(Stats.UIEventsDispatched, 1.f)));
+	}
+
+	// keep the panel near the center so it stays inside the HMD borders drawn above
+	UFont* Font = GEngine->GetSmallFont();
+	const float LineHeight = 14.f;
+	const FVector2D PanelSize(420.f, LineHeight * PerformanceOverlayLines.Num() + 8.f);
+	const FVector2D PanelPosition(Canvas->ClipX * 0.5f - PanelSize.X * 0.5f, Canvas->ClipY * 0.5f + 40.f);
+
+	FCanvasTileItem Background(PanelPosition, PanelSize, FLinearColor(0.f, 0.f, 0.f, 0.6f));
+	Background.BlendMode = SE_BLEND_Translucent;
+	Canvas->DrawItem(Background);
+
+	Canvas->SetDrawColor(FColor::Green);
+	for (int32 i = 0; i < PerformanceOverlayLines.Num(); i++) {
+		Canvas->DrawText(Font, PerformanceOverlayLines[i], PanelPosition.X + 4.f, PanelPosition.Y + 4.f + i * LineHeight);
+	}
 }
 
@@ -14,9 +14,27 @@ public:
 	/** Primary draw call for the HUD */
 	virtual void DrawHUD() override;
 
+	/** Shows/hides the AR pipeline performance panel */
+	UFUNCTION(BlueprintCallable, Category = Profiling)
+	void TogglePerformanceOverlay();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Profiling)
+	bool ShowPerformanceOverlay;
+
+	/** Seconds between refreshes of the panel text, so formatting doesn't happen every frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Profiling)
+	float PerformanceOverlayRefreshInterval;
+
 private:
 	/** Crosshair asset pointer */
 	class UTexture2D* CrosshairTex;
 
+	/** Draws capture/detection/Leap/upload health from the ARPipelineStats snapshot */
+	void DrawPerformanceOverlay();
+
+	TArray<FString> PerformanceOverlayLines;
+
+	double LastPerformanceOverlayRefresh;
+
 };
 
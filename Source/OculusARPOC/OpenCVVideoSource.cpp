@@ -29,6 +29,10 @@
 #include "OculusARPOC.h"
 #include "Engine.h"
 #include "OpenCVVideoSource.h"
+#include "ARTraceRecorder.h"
+#include "ARPipelineStats.h"
+#include "ImageDownscaler.h"
+#include "UndistortionMap.h"
 #include "opencv2/core/core.hpp"
 #include "opencv2/highgui/highgui.hpp"
 
@@ -37,6 +41,13 @@ OpenCVVideoSource::OpenCVVideoSource(uint8 cameraIndex, uint16 videoWidth, uint1
     this->CameraIndex = cameraIndex;
     this->VideoWidth = videoWidth;
     this->VideoHeight = videoHeight;
+    this->CaptureWidth = this->DetectionWidth = videoWidth;
+    this->CaptureHeight = this->DetectionHeight = videoHeight;
+    this->LastFrameSeconds = -1.0;
+    this->AverageFrameInterval = 0.0;
+    this->DroppedFrameCount = 0;
+    this->UndistortPassthrough = false;
+    this->MarkerDetector = NULL;
 }
 
 OpenCVVideoSource::~OpenCVVideoSource()
@@ -81,30 +92,72 @@ void  OpenCVVideoSource::SetIsCameraUpsideDown(bool cameraUpsideDown) {
 	this->CameraUpsideDown = cameraUpsideDown;
 }
 
-void OpenCVVideoSource::Init() {
+void OpenCVVideoSource::SetCaptureResolution(uint16 Width, uint16 Height) {
+    this->CaptureWidth = Width;
+    this->CaptureHeight = Height;
+}
+
+void OpenCVVideoSource::SetDetectionResolution(uint16 Width, uint16 Height) {
+    this->DetectionWidth = Width;
+    this->DetectionHeight = Height;
+}
+
+bool OpenCVVideoSource::Init() {
     cv::VideoCapture VidCap(CameraIndex);
     this->VideoCapture = VidCap;
     if (VideoCapture.isOpened()) {
-        VideoCapture.set(CV_CAP_PROP_FRAME_WIDTH, VideoWidth);
-        VideoCapture.set(CV_CAP_PROP_FRAME_HEIGHT, VideoHeight);
+        VideoCapture.set(CV_CAP_PROP_FRAME_WIDTH, CaptureWidth);
+        VideoCapture.set(CV_CAP_PROP_FRAME_HEIGHT, CaptureHeight);
+        return true;
     }
+    return false;
 }
 
 void OpenCVVideoSource::Close() {
 	VideoCapture.release();
 }
 
-void OpenCVVideoSource::GetFrameImage(uint8* DestinationFrameBuffer) {
-    if (!VideoCapture.isOpened()) return;
+bool OpenCVVideoSource::GetFrameImage(uint8* DestinationFrameBuffer) {
+    AR_TRACE_SCOPE("OpenCVVideoSource::GetFrameImage");
+    if (!VideoCapture.isOpened()) return false;
     cv::Mat Frame;
-    VideoCapture >> Frame; // get a new frame from camera
+    {
+        AR_TRACE_SCOPE("Capture");
+        double CaptureStart = FPlatformTime::Seconds();
+        VideoCapture >> Frame; // get a new frame from camera
+        if (Frame.empty()) return false;
+        UpdateCaptureStats(CaptureStart, FPlatformTime::Seconds());
+    }
 	
-    // start aruco speed test
-    MarkerDetector->ProcessMarkerDetection(Frame);
+    // the camera may not honour the requested size, so compare against what was actually delivered
+    cv::Mat DetectionImage = Frame;
+    if (Frame.cols != DetectionWidth || Frame.rows != DetectionHeight) {
+        ImageDownscaler::Resize(Frame, DetectionFrame, cv::Size(DetectionWidth, DetectionHeight));
+        DetectionImage = DetectionFrame;
+    }
+    if (MarkerDetector != NULL) { // attached once the calibration has loaded
+        MarkerDetector->ProcessMarkerDetection(DetectionImage);
+    }
+
+    // undistortion, resampling, flip and BGRA conversion in one pass over the display image
+    if (UndistortPassthrough && MarkerDetector != NULL && Undistortion.Prepare(MarkerDetector->GetCameraParameters(), Frame, cv::Size(VideoWidth, VideoHeight), CameraUpsideDown)) {
+        MarkerDetector->DrawDetectedMarkers(Frame);
+        double ConvertStart = FPlatformTime::Seconds();
+        Undistortion.Apply(Frame, DestinationFrameBuffer);
+        ARPipelineStats::Get().Set(ARPipelineStats::ConvertMs, (FPlatformTime::Seconds() - ConvertStart) * 1000.0);
+        return true;
+    }
+
+    cv::Mat DisplayImage = Frame;
+    if (Frame.cols != VideoWidth || Frame.rows != VideoHeight) {
+        ImageDownscaler::Resize(Frame, DisplayFrame, cv::Size(VideoWidth, VideoHeight));
+        DisplayImage = DisplayFrame;
+    }
+    if (MarkerDetector != NULL) {
+        MarkerDetector->DrawDetectedMarkers(DisplayImage);
+    }
     
-    uint16 Width = Frame.size().width;
-    uint16 Height = Frame.size().height;
-    uint8* RawFrameBuffer = (uint8*) Frame.data;
+    uint8* RawFrameBuffer = (uint8*) DisplayImage.data;
     uint8* DestinationPointer = NULL;
     uint8* SourcePointer = NULL;
 	
@@ -113,6 +166,8 @@ void OpenCVVideoSource::GetFrameImage(uint8* DestinationFrameBuffer) {
     uint8 BlueChannel;
 
 	if (RawFrameBuffer != NULL) {
+        AR_TRACE_SCOPE("ConvertBGRToBGRA");
+        double ConvertStart = FPlatformTime::Seconds();
         if (CameraUpsideDown) { // draw bottom to top and right to left to flip image
             SourcePointer = RawFrameBuffer;
             for (int32 y = 0; y < VideoHeight; y++)
@@ -143,7 +198,30 @@ void OpenCVVideoSource::GetFrameImage(uint8* DestinationFrameBuffer) {
                 }
             }
         }
+        ARPipelineStats::Get().Set(ARPipelineStats::ConvertMs, (FPlatformTime::Seconds() - ConvertStart) * 1000.0);
     }
-	
+    return RawFrameBuffer != NULL;
 }
 
+
+
+void OpenCVVideoSource::UpdateCaptureStats(double CaptureStart, double CaptureEnd) {
+    ARPipelineStats& Stats = ARPipelineStats::Get();
+    Stats.Set(ARPipelineStats::CaptureMs, (CaptureEnd - CaptureStart) * 1000.0);
+    if (LastFrameSeconds > 0.0) {
+        double Interval = CaptureEnd - LastFrameSeconds;
+        if (AverageFrameInterval <= 0.0) {
+            AverageFrameInterval = Interval;
+        }
+        // a gap of more than 1.5 frame intervals means the camera delivered frames we never read
+        if (Interval > AverageFrameInterval * 1.5) {
+            DroppedFrameCount += FMath::RoundToInt(Interval / AverageFrameInterval) - 1;
+            Stats.Set(ARPipelineStats::DroppedFrames, DroppedFrameCount);
+        }
+        else {
+            AverageFrameInterval = AverageFrameInterval * 0.9 + Interval * 0.1;
+        }
+        Stats.Set(ARPipelineStats::CaptureFps, 1.0 / FMath::Max(Interval, 0.001));
+    }
+    LastFrameSeconds = CaptureEnd;
+}
@@ -28,6 +28,7 @@
 
 #include "IVideoSource.h"
 #include "ArucoMarkerDetector.h"
+#include "UndistortionMap.h"
 #include "opencv2/highgui/highgui.hpp"
 
 #pragma once
@@ -41,7 +42,7 @@ public:
     OpenCVVideoSource(uint8 cameraIndex, uint16 videoWidth, uint16 videoHeight);
     ~OpenCVVideoSource();
     
-    void GetFrameImage(uint8* DestinationImageBuffer) override;
+    bool GetFrameImage(uint8* DestinationImageBuffer) override;
     
     uint16 GetVideoWidth() override;
     
@@ -61,19 +62,52 @@ public:
 
 	void  SetIsCameraUpsideDown(bool CameraUpsideDown) override;
 
-	void Init() override;
+	bool Init() override;
 
 	void Close() override;
 
 	bool CameraUpsideDown;
 
+	/*
+	 Resolution requested from the camera.  Display (GetVideoWidth/GetVideoHeight) and detection resolutions default to
+	 the same size; when they differ the captured frame is resampled for each consumer.
+	 */
+	void SetCaptureResolution(uint16 Width, uint16 Height);
+
+	/*
+	 Resolution of the image handed to the marker detector, e.g. 640x360 to detect on a quarter of a 1280x720 frame.
+	 The camera intrinsics are rescaled to match by ArucoMarkerDetector.
+	 */
+	void SetDetectionResolution(uint16 Width, uint16 Height);
+
+	/*
+	 If true the passthrough image is undistorted with the marker detector's calibration, so virtual objects line up
+	 with the real image towards the edges too.  Detection still runs on the raw frame.
+	 */
+	bool UndistortPassthrough;
+
 protected:
     
     uint8 CameraIndex;
     
-    uint16 VideoWidth;
+    uint16 VideoWidth; // display resolution
     
     uint16 VideoHeight;
+
+    uint16 CaptureWidth;
+
+    uint16 CaptureHeight;
+
+    uint16 DetectionWidth;
+
+    uint16 DetectionHeight;
+
+    // reused between frames so resampling doesn't allocate
+    cv::Mat DetectionFrame;
+
+    cv::Mat DisplayFrame;
+
+    UndistortionMap Undistortion;
     
     float WidthToDistanceRatio;
     
@@ -82,4 +116,15 @@ protected:
     cv::VideoCapture VideoCapture;
 
     ArucoMarkerDetector* MarkerDetector;
+
+    /*
+     Publishes capture time, frame rate and an estimate of frames dropped by the camera to ARPipelineStats
+     */
+    void UpdateCaptureStats(double CaptureStart, double CaptureEnd);
+
+    double LastFrameSeconds;
+
+    double AverageFrameInterval;
+
+    int32 DroppedFrameCount;
 };
@@ -0,0 +1,227 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "PoseFilters.h"
+
+// smoothing factor of an exponential low-pass filter with the given cutoff frequency sampled every DeltaSeconds
+static float LowPassAlpha(float Cutoff, float DeltaSeconds)
+{
+	float Tau = 1.f / (2.f * PI * FMath::Max(Cutoff, KINDA_SMALL_NUMBER));
+	return 1.f / (1.f + Tau / DeltaSeconds);
+}
+
+static float GetLeadSeconds(double Time, double LastTime, float MaxLeadSeconds)
+{
+	return FMath::Clamp((float)(Time - LastTime), 0.f, MaxLeadSeconds);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// OneEuroVectorFilter
+
+OneEuroVectorFilter::OneEuroVectorFilter()
+{
+	MinCutoff = 1.f;
+	Beta = 0.02f;
+	DerivativeCutoff = 1.f;
+	Reset();
+}
+
+void OneEuroVectorFilter::Reset()
+{
+	Initialized = false;
+	Value = FVector::ZeroVector;
+	Velocity = FVector::ZeroVector;
+	LastMeasurement = FVector::ZeroVector;
+	LastTime = 0.0;
+}
+
+FVector OneEuroVectorFilter::Update(const FVector& Measurement, double Time)
+{
+	if (!Initialized) {
+		Initialized = true;
+		Value = Measurement;
+		Velocity = FVector::ZeroVector;
+		LastMeasurement = Measurement;
+		LastTime = Time;
+		return Value;
+	}
+	float DeltaSeconds = (float)(Time - LastTime);
+	if (DeltaSeconds <= 0.f) {
+		return Value; // same frame again
+	}
+	LastTime = Time;
+	FVector RawVelocity = (Measurement - LastMeasurement) / DeltaSeconds;
+	LastMeasurement = Measurement;
+	Velocity += (RawVelocity - Velocity) * LowPassAlpha(DerivativeCutoff, DeltaSeconds);
+	float Cutoff = MinCutoff + Beta * Velocity.Size();
+	Value += (Measurement - Value) * LowPassAlpha(Cutoff, DeltaSeconds);
+	return Value;
+}
+
+FVector OneEuroVectorFilter::Predict(double Time, float MaxLeadSeconds) const
+{
+	return Value + Velocity * GetLeadSeconds(Time, LastTime, MaxLeadSeconds);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// KalmanAxis
+
+void KalmanAxis::Init(float InPosition, float PositionVariance, float VelocityVariance)
+{
+	Position = InPosition;
+	Velocity = 0.f;
+	P00 = PositionVariance;
+	P01 = 0.f;
+	P11 = VelocityVariance;
+}
+
+void KalmanAxis::Predict(float DeltaSeconds, float ProcessNoise)
+{
+	float Dt = DeltaSeconds;
+	Position += Velocity * Dt;
+	// P = F P F' + Q, with F = [1 Dt; 0 1] and Q the integrated white acceleration noise
+	P00 += Dt * (2.f * P01 + Dt * P11) + ProcessNoise * Dt * Dt * Dt / 3.f;
+	P01 += Dt * P11 + ProcessNoise * Dt * Dt / 2.f;
+	P11 += ProcessNoise * Dt;
+}
+
+void KalmanAxis::Correct(float Measurement, float MeasurementNoise)
+{
+	float Innovation = Measurement - Position;
+	float InverseS = 1.f / (P00 + MeasurementNoise);
+	float K0 = P00 * InverseS;
+	float K1 = P01 * InverseS;
+	Position += K0 * Innovation;
+	Velocity += K1 * Innovation;
+	P11 -= K1 * P01;
+	P01 -= K0 * P01;
+	P00 -= K0 * P00;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// KalmanVectorFilter
+
+KalmanVectorFilter::KalmanVectorFilter()
+{
+	ProcessNoise = 5000.f;
+	MeasurementNoise = 0.25f;
+	Reset();
+}
+
+void KalmanVectorFilter::Reset()
+{
+	Initialized = false;
+	for (int32 i = 0; i < 3; i++) {
+		Axes[i].Init(0.f, 0.f, 0.f);
+	}
+	LastTime = 0.0;
+}
+
+FVector KalmanVectorFilter::Update(const FVector& Measurement, double Time)
+{
+	if (!Initialized) {
+		Initialized = true;
+		for (int32 i = 0; i < 3; i++) {
+			// unknown velocity: start with the uncertainty one second of process noise builds up
+			Axes[i].Init(Measurement[i], MeasurementNoise, ProcessNoise);
+		}
+		LastTime = Time;
+		return Measurement;
+	}
+	float DeltaSeconds = (float)(Time - LastTime);
+	if (DeltaSeconds <= 0.f) {
+		return GetValue(); // same frame again: correcting with it twice would overstate its weight
+	}
+	LastTime = Time;
+	for (int32 i = 0; i < 3; i++) {
+		Axes[i].Predict(DeltaSeconds, ProcessNoise);
+	}
+	for (int32 i = 0; i < 3; i++) {
+		Axes[i].Correct(Measurement[i], MeasurementNoise);
+	}
+	return GetValue();
+}
+
+FVector KalmanVectorFilter::Predict(double Time, float MaxLeadSeconds) const
+{
+	return GetValue() + GetVelocity() * GetLeadSeconds(Time, LastTime, MaxLeadSeconds);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// PoseFilter
+
+PoseFilter::PoseFilter()
+{
+	MaxLeadSeconds = 0.1f;
+	ResetAfterSeconds = 0.5f;
+	FilterMethod = OneEuro;
+}
+
+void PoseFilter::SetMethod(Method NewMethod)
+{
+	if (NewMethod != FilterMethod) {
+		FilterMethod = NewMethod;
+		Reset();
+	}
+}
+
+void PoseFilter::Reset()
+{
+	OneEuroLocation.Reset();
+	KalmanLocation.Reset();
+}
+
+void PoseFilter::UpdateLocation(const FVector& Location, double Time)
+{
+	if (FilterMethod == Kalman) {
+		if (KalmanLocation.IsInitialized() && Time - KalmanLocation.GetLastTime() > ResetAfterSeconds) {
+			KalmanLocation.Reset();
+		}
+		KalmanLocation.Update(Location, Time);
+	}
+	else {
+		if (OneEuroLocation.IsInitialized() && Time - OneEuroLocation.GetLastTime() > ResetAfterSeconds) {
+			OneEuroLocation.Reset();
+		}
+		OneEuroLocation.Update(Location, Time);
+	}
+}
+
+FVector PoseFilter::PredictLocation(double Time) const
+{
+	if (FilterMethod == Kalman) {
+		return KalmanLocation.Predict(Time, MaxLeadSeconds);
+	}
+	return OneEuroLocation.Predict(Time, MaxLeadSeconds);
+}
+
+bool PoseFilter::HasLocation() const
+{
+	return FilterMethod == Kalman ? KalmanLocation.IsInitialized() : OneEuroLocation.IsInitialized();
+}
@@ -0,0 +1,182 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+/*
+ Filters for tracked locations that cost O(1) per sample and keep a velocity estimate, so the location can be
+ extrapolated to the time the frame will actually be displayed instead of lagging behind the camera like a moving
+ average does.
+ Times are in seconds (FPlatformTime::Seconds() of the camera frame a measurement came from).
+ */
+
+/*
+ One-Euro filter (Casiez et al.): a low-pass filter whose cutoff frequency rises with the speed of the signal,
+ so it removes jitter when still and has little lag when moving.
+ */
+class OneEuroVectorFilter
+{
+public:
+
+	OneEuroVectorFilter();
+
+	void Reset();
+
+	FVector Update(const FVector& Measurement, double Time);
+
+	/* Filtered value extrapolated with the filtered velocity; MaxLeadSeconds bounds the extrapolation */
+	FVector Predict(double Time, float MaxLeadSeconds) const;
+
+	bool IsInitialized() const { return Initialized; }
+
+	FVector GetValue() const { return Value; }
+
+	FVector GetVelocity() const { return Velocity; }
+
+	double GetLastTime() const { return LastTime; }
+
+	// cutoff frequency in Hz when the signal is still
+	float MinCutoff;
+
+	// how much the cutoff frequency rises per unit/s of speed
+	float Beta;
+
+	// cutoff frequency in Hz used to smooth the velocity
+	float DerivativeCutoff;
+
+protected:
+
+	bool Initialized;
+
+	FVector Value;
+
+	FVector Velocity;
+
+	// the velocity comes from consecutive measurements, as the filtered value lags behind them while moving
+	FVector LastMeasurement;
+
+	double LastTime;
+};
+
+/*
+ State of one axis of a constant-velocity Kalman filter: position, velocity and their 2x2 covariance.
+ The process noise is white acceleration noise, so the filter trusts the velocity model less the longer it runs without a measurement.
+ */
+struct KalmanAxis
+{
+	float Position;
+	float Velocity;
+	float P00, P01, P11;
+
+	void Init(float InPosition, float PositionVariance, float VelocityVariance);
+
+	void Predict(float DeltaSeconds, float ProcessNoise);
+
+	void Correct(float Measurement, float MeasurementNoise);
+};
+
+/*
+ Constant-velocity Kalman filter, one independent axis per component.
+ */
+class KalmanVectorFilter
+{
+public:
+
+	KalmanVectorFilter();
+
+	void Reset();
+
+	/* A measurement no newer than the last one (a repeated frame time) is ignored */
+	FVector Update(const FVector& Measurement, double Time);
+
+	FVector Predict(double Time, float MaxLeadSeconds) const;
+
+	bool IsInitialized() const { return Initialized; }
+
+	FVector GetValue() const { return FVector(Axes[0].Position, Axes[1].Position, Axes[2].Position); }
+
+	FVector GetVelocity() const { return FVector(Axes[0].Velocity, Axes[1].Velocity, Axes[2].Velocity); }
+
+	double GetLastTime() const { return LastTime; }
+
+	// spectral density of the acceleration noise, in units^2/s^3
+	float ProcessNoise;
+
+	// variance of a measurement, in units^2
+	float MeasurementNoise;
+
+protected:
+
+	bool Initialized;
+
+	KalmanAxis Axes[3];
+
+	double LastTime;
+};
+
+/*
+ Location filter with a selectable method.  When no measurement arrives for longer than ResetAfterSeconds the next
+ measurement restarts the filter instead of blending with a stale pose.
+ */
+class PoseFilter
+{
+public:
+
+	enum Method
+	{
+		OneEuro,
+		Kalman
+	};
+
+	PoseFilter();
+
+	void SetMethod(Method NewMethod);
+
+	Method GetMethod() const { return FilterMethod; }
+
+	void Reset();
+
+	void UpdateLocation(const FVector& Location, double Time);
+
+	/* Location extrapolated to Time (e.g. the predicted display time), or the last filtered location if Time is in the past */
+	FVector PredictLocation(double Time) const;
+
+	bool HasLocation() const;
+
+	// upper bound on how far ahead of the last measurement a pose is extrapolated
+	float MaxLeadSeconds;
+
+	float ResetAfterSeconds;
+
+	OneEuroVectorFilter OneEuroLocation;
+	KalmanVectorFilter KalmanLocation;
+
+protected:
+
+	Method FilterMethod;
+};
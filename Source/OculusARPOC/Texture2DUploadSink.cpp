@@ -0,0 +1,73 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "Engine.h"
+#include "Texture2DUploadSink.h"
+#include "TextureUploadPool.h"
+#include "ARTraceRecorder.h"
+#include "ARPipelineStats.h"
+
+Texture2DUploadSink::Texture2DUploadSink()
+	: Texture(NULL), Region(0, 0, 0, 0, 0, 0), SrcPitch(0)
+{
+}
+
+void Texture2DUploadSink::Init(UTexture2D* texture, uint32 Width, uint32 Height)
+{
+	this->Texture = texture;
+	this->Region = FUpdateTextureRegion2D(0, 0, 0, 0, Width, Height);
+	this->SrcPitch = Width * sizeof(FColor);
+}
+
+void Texture2DUploadSink::EnqueueUpload(TextureUploadPool* Pool, int32 BufferIndex)
+{
+	if (Texture == NULL || Texture->Resource == NULL) {
+		Pool->ReleaseBuffer(BufferIndex);
+		return;
+	}
+	// everything is passed by value, so nothing has to be allocated per frame
+	ENQUEUE_UNIQUE_RENDER_COMMAND_FIVEPARAMETER(
+		UploadVideoFrame,
+		FTexture2DResource*, Texture2DResource, (FTexture2DResource*)Texture->Resource,
+		FUpdateTextureRegion2D, Region, Region,
+		uint32, SrcPitch, SrcPitch,
+		TextureUploadPool*, Pool, Pool,
+		int32, BufferIndex, BufferIndex,
+		{
+			AR_TRACE_SCOPE("TextureUpload");
+			double UploadStart = FPlatformTime::Seconds();
+			int32 CurrentFirstMip = Texture2DResource->GetCurrentFirstMip();
+			if (CurrentFirstMip == 0)
+			{
+				RHIUpdateTexture2D(Texture2DResource->GetTexture2DRHI(), 0, Region, SrcPitch, Pool->GetBuffer(BufferIndex));
+			}
+			Pool->ReleaseBuffer(BufferIndex);
+			ARPipelineStats::Get().Set(ARPipelineStats::TextureUploadMs, (FPlatformTime::Seconds() - UploadStart) * 1000.0);
+		});
+}
@@ -0,0 +1,113 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "TextureUploadPool.h"
+
+TextureUploadPool::TextureUploadPool()
+{
+	Memory = NULL;
+	BufferSize = 0;
+	NumBuffers = 0;
+	NextBuffer = 0;
+	StarvedCount = 0;
+	SubmittedCount = 0;
+	for (int32 i = 0; i < MaxBuffers; i++) {
+		States[i] = Free;
+	}
+}
+
+TextureUploadPool::~TextureUploadPool()
+{
+	FreeMemory();
+}
+
+void TextureUploadPool::Init(int32 numBuffers, uint32 bufferSize)
+{
+	check(GetNumInFlight() == 0);
+	FreeMemory();
+	NumBuffers = FMath::Clamp(numBuffers, 1, (int32)MaxBuffers);
+	BufferSize = Align(bufferSize, 16);
+	Memory = (uint8*)FMemory::Malloc(NumBuffers * BufferSize, 16);
+	FMemory::Memzero(Memory, NumBuffers * BufferSize);
+	NextBuffer = 0;
+	for (int32 i = 0; i < MaxBuffers; i++) {
+		States[i] = Free;
+	}
+}
+
+void TextureUploadPool::FreeMemory()
+{
+	if (Memory != NULL) {
+		FMemory::Free(Memory);
+		Memory = NULL;
+	}
+}
+
+int32 TextureUploadPool::AcquireWriteBuffer()
+{
+	for (int32 i = 0; i < NumBuffers; i++) {
+		int32 Index = (NextBuffer + i) % NumBuffers;
+		if (FPlatformAtomics::InterlockedCompareExchange(&States[Index], Writing, Free) == Free) {
+			NextBuffer = (Index + 1) % NumBuffers;
+			return Index;
+		}
+	}
+	StarvedCount++;
+	return INDEX_NONE;
+}
+
+void TextureUploadPool::Submit(int32 BufferIndex, ITextureUploadSink* Sink)
+{
+	check(States[BufferIndex] == Writing);
+	// the interlocked exchange is a full barrier, so the frame contents are visible before the consumer can see the buffer
+	FPlatformAtomics::InterlockedExchange(&States[BufferIndex], InFlight);
+	SubmittedCount++;
+	Sink->EnqueueUpload(this, BufferIndex);
+}
+
+void TextureUploadPool::Cancel(int32 BufferIndex)
+{
+	check(States[BufferIndex] == Writing);
+	FPlatformAtomics::InterlockedExchange(&States[BufferIndex], Free);
+}
+
+void TextureUploadPool::ReleaseBuffer(int32 BufferIndex)
+{
+	check(States[BufferIndex] == InFlight);
+	FPlatformAtomics::InterlockedExchange(&States[BufferIndex], Free);
+}
+
+int32 TextureUploadPool::GetNumInFlight() const
+{
+	int32 Count = 0;
+	for (int32 i = 0; i < NumBuffers; i++) {
+		if (States[i] == InFlight) Count++;
+	}
+	return Count;
+}
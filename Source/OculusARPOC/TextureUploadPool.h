@@ -0,0 +1,131 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+#include "ITextureUploadSink.h"
+
+/**
+ * Small fixed pool of staging buffers used to hand video frames from the game thread to the render thread.
+ * All memory is allocated once in Init.  Each buffer is owned by exactly one side at a time:
+ *   Free -> (AcquireWriteBuffer, game thread) -> Writing -> (Submit) -> InFlight -> (ReleaseBuffer, consumer) -> Free
+ * so the writer can never overwrite a frame that is still being uploaded.  When every buffer is in flight the writer
+ * simply skips the frame instead of blocking.
+ */
+class TextureUploadPool
+{
+public:
+
+	enum BufferState
+	{
+		Free,
+		Writing,
+		InFlight
+	};
+
+	static const int32 MaxBuffers = 4;
+
+	TextureUploadPool();
+	~TextureUploadPool();
+
+	/*
+	 Allocates NumBuffers (clamped to 1..MaxBuffers) zeroed buffers of BufferSize bytes.  Must not be called while buffers are in flight.
+	 */
+	void Init(int32 NumBuffers, uint32 BufferSize);
+
+	/*
+	 Returns the index of a free buffer now owned by the caller, or INDEX_NONE if all buffers are still in flight.
+	 */
+	int32 AcquireWriteBuffer();
+
+	/*
+	 Passes ownership of a written buffer to the sink.
+	 */
+	void Submit(int32 BufferIndex, ITextureUploadSink* Sink);
+
+	/*
+	 Returns an acquired buffer without submitting it (e.g. no new frame was available).
+	 */
+	void Cancel(int32 BufferIndex);
+
+	/*
+	 One frame of the writer: acquires a buffer, has Fill(uint8* Buffer) write the frame into it and submits it to Sink, or
+	 returns the buffer if Fill returns false because there was no new frame.  When the pool is starved Fill isn't called.
+	 Returns true if a frame was submitted.
+	 */
+	template<typename FillType>
+	bool UploadFrame(ITextureUploadSink* Sink, FillType Fill)
+	{
+		int32 BufferIndex = AcquireWriteBuffer();
+		if (BufferIndex == INDEX_NONE) return false;
+		if (!Fill(GetBuffer(BufferIndex))) {
+			Cancel(BufferIndex);
+			return false;
+		}
+		Submit(BufferIndex, Sink);
+		return true;
+	}
+
+	/*
+	 Called by the sink, on whatever thread consumed the buffer, once it has finished reading it.
+	 */
+	void ReleaseBuffer(int32 BufferIndex);
+
+	uint8* GetBuffer(int32 BufferIndex) const { return Memory + BufferIndex * BufferSize; }
+
+	uint32 GetBufferSize() const { return BufferSize; }
+
+	int32 GetNumBuffers() const { return NumBuffers; }
+
+	BufferState GetBufferState(int32 BufferIndex) const { return (BufferState)States[BufferIndex]; }
+
+	int32 GetNumInFlight() const;
+
+	// frames skipped because no buffer was free
+	int32 GetStarvedCount() const { return StarvedCount; }
+
+	int32 GetSubmittedCount() const { return SubmittedCount; }
+
+protected:
+
+	void FreeMemory();
+
+	uint8* Memory;
+
+	uint32 BufferSize;
+
+	int32 NumBuffers;
+
+	int32 NextBuffer; // round robin start, only touched by the writer
+
+	volatile int32 States[MaxBuffers];
+
+	int32 StarvedCount;
+
+	int32 SubmittedCount;
+};
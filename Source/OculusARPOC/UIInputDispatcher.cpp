@@ -0,0 +1,102 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "UIInputDispatcher.h"
+#include <Coherent/UI/View.h>
+#include "ARTraceRecorder.h"
+#include "ARPipelineStats.h"
+
+// totals over every view's dispatcher for ARPipelineStats; dispatchers are only used on the game thread
+static int64 EventsGenerated = 0;
+static int64 EventsDispatched = 0;
+
+Coherent::UI::MouseEventData& UIInputDispatcher::Queue(Coherent::UI::MouseEventData::EventType Type)
+{
+	EventsGenerated++;
+	Coherent::UI::MouseEventData& Event = Pending[Pending.AddDefaulted()];
+	Event.Type = Type;
+	return Event;
+}
+
+void UIInputDispatcher::QueueMouseMove(float X, float Y)
+{
+	if (Pending.Num() > 0 && Pending.Last().Type == Coherent::UI::MouseEventData::EventType::MouseMove) {
+		// only where the pointer ends up matters
+		EventsGenerated++;
+		Pending.Last().X = X;
+		Pending.Last().Y = Y;
+		return;
+	}
+	Coherent::UI::MouseEventData& Event = Queue(Coherent::UI::MouseEventData::EventType::MouseMove);
+	Event.X = X;
+	Event.Y = Y;
+}
+
+void UIInputDispatcher::QueueMouseDown(float X, float Y)
+{
+	Coherent::UI::MouseEventData& Event = Queue(Coherent::UI::MouseEventData::EventType::MouseDown);
+	Event.X = X;
+	Event.Y = Y;
+}
+
+void UIInputDispatcher::QueueMouseUp(float X, float Y)
+{
+	Coherent::UI::MouseEventData& Event = Queue(Coherent::UI::MouseEventData::EventType::MouseUp);
+	Event.X = X;
+	Event.Y = Y;
+}
+
+void UIInputDispatcher::QueueMouseWheel(float WheelX, float WheelY)
+{
+	if (Pending.Num() > 0 && Pending.Last().Type == Coherent::UI::MouseEventData::EventType::MouseWheel) {
+		EventsGenerated++;
+		Pending.Last().WheelX += WheelX;
+		Pending.Last().WheelY += WheelY;
+		return;
+	}
+	Coherent::UI::MouseEventData& Event = Queue(Coherent::UI::MouseEventData::EventType::MouseWheel);
+	Event.WheelX = WheelX;
+	Event.WheelY = WheelY;
+}
+
+void UIInputDispatcher::Flush(Coherent::UI::View* View)
+{
+	if (Pending.Num() == 0) return;
+	if (View) {
+		AR_TRACE_SCOPE("UIInputDispatcher::Flush");
+		for (int32 i = 0; i < Pending.Num(); i++) {
+			View->MouseEvent(Pending[i]);
+		}
+		EventsDispatched += Pending.Num();
+		AR_TRACE_COUNTER("UIEventsDispatched", Pending.Num());
+	}
+	ARPipelineStats& Stats = ARPipelineStats::Get();
+	Stats.Set(ARPipelineStats::UIEventsGenerated, (float)EventsGenerated);
+	Stats.Set(ARPipelineStats::UIEventsDispatched, (float)EventsDispatched);
+	Pending.Reset(); // keeps the memory for the next frame
+}
@@ -0,0 +1,64 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include <Coherent/UI/InputEvents.h>
+
+namespace Coherent { namespace UI { class View; } }
+
+/**
+ * Collects the mouse events generated for a Coherent UI view during a frame and forwards them to the view in one batch.
+ * Consecutive mouse moves are coalesced into the last one and consecutive wheel events into one with the summed deltas,
+ * so the view sees at most one of each between button events.  Events are stored by value in a queue that keeps its
+ * memory between frames, so queuing allocates nothing after the first frames.
+ * The events queued (before coalescing) and dispatched by all dispatchers are counted and published to ARPipelineStats
+ * on each flush, for the performance overlay.
+ */
+class UIInputDispatcher
+{
+public:
+
+	void QueueMouseMove(float X, float Y);
+
+	void QueueMouseDown(float X, float Y);
+
+	void QueueMouseUp(float X, float Y);
+
+	void QueueMouseWheel(float WheelX, float WheelY);
+
+	/* Forwards the queued events to View and empties the queue.  With no view the events are dropped. */
+	void Flush(Coherent::UI::View* View);
+
+	int32 GetNumPending() const { return Pending.Num(); }
+
+private:
+
+	Coherent::UI::MouseEventData& Queue(Coherent::UI::MouseEventData::EventType Type);
+
+	TArray<Coherent::UI::MouseEventData> Pending;
+};
@@ -31,19 +31,20 @@
 #include "CoherentUIComponent.h"
 #include <Coherent/UI/InputEvents.h>
 #include <Coherent/UI/View.h>
-#include "DrawDebugHelpers.h"
 #include "Engine.h"
-#include "Runtime/Core/Public/Misc/DateTime.h"
 #include <string>
 #include "StringConv.h"
 #include "UISurfaceActor.h"
+#include "UIInputDispatcher.h"
+#include "UISurfaceRegistry.h"
+#include "ARDebugDraw.h"
 
 AUISurfaceActor::AUISurfaceActor(const class FPostConstructInitializeProperties& PCIP)
 	: Super(PCIP)
 {
 	UIViewInitialized = false;
 	HoverDistance = 30.0;
-	LastMouseEventPixelCoordinates = *(new FVector());
+	LastMouseEventPixelCoordinates = FVector::ZeroVector;
 
 	UISurfaceMesh = PCIP.CreateDefaultSubobject<UStaticMeshComponent>(this, TEXT("UISurfaceMesh"));
 	RootComponent = UISurfaceMesh;
@@ -56,14 +57,35 @@ AUISurfaceActor::AUISurfaceActor(const class FPostConstructInitializeProperties&
 	PixelToWheelTickScalingFactor = 100.0; // looks like a full wheel tick is approximately 100 pixels (9 or 10 wheel ticks to scroll 1024 pixels)
 	ScrollNumPixelsThreshold = 3.0;
 	SwipeLengthPixelsThreshold = 40.0;
-	SwipeWidthPixelsCutoff = 10.0;
+	SwipeMinPixelsPerSecond = 400.0;
+	FlingMinPixelsPerSecond = 800.0;
+	FlingScrollSeconds = 0.25;
 	MinMillisecondsBetweenSwipes = 500;
 	MaxMillisecondsLinkingSwipes = 1500;
-
-	LastLeftSwipeTime = FDateTime::Now(); // initialize swipe time
-	LastRightSwipeTime = FDateTime::Now(); // initialize swipe time
 }
 
+/* Forwards the input generated by UISurfaceTouchInput to the surface's handlers */
+class UISurfaceActorInputSink : public IUISurfaceInputSink
+{
+public:
+
+	UISurfaceActorInputSink(AUISurfaceActor* InSurface) : Surface(InSurface) {}
+
+	virtual void MouseMove(const FVector2D& Pixels) override { Surface->HandleMouseoverEventPixelCoordinates(FVector(Pixels, 0.f)); }
+
+	virtual void MouseDown(const FVector2D& Pixels) override { Surface->HandleMouseDownEventAtCoordinates(FVector(Pixels, 0.f)); }
+
+	virtual void MouseUp(const FVector2D& Pixels) override { Surface->HandleMouseUpEventAtCoordinates(FVector(Pixels, 0.f)); }
+
+	virtual void MouseWheel(float WheelTicksY) override { Surface->HandleYScrollIncrementEvent(WheelTicksY); }
+
+	virtual void Back() override { Surface->HandleBackEvent(); }
+
+private:
+
+	AUISurfaceActor* Surface;
+};
+
 void AUISurfaceActor::HandleMouseoverEventWorldLocation(FVector EventWorldLocation)
 {
 	if (!PointerFingerIsHovering) { // don't handle raycast mouseover if in hover state
@@ -76,26 +98,25 @@ void AUISurfaceActor::HandleMouseoverEventWorldLocation(FVector EventWorldLocati
 	}
 }
 
-void AUISurfaceActor::HandleMouseoverEventPixelCoordinates(FVector PixelCoordinates)
+void AUISurfaceActor::HandleMouseoverEventActorLocation(FVector EventActorLocation)
 {
-	Coherent::UI::View* UIView = CoherentUIComponent->GetView();
-	if (UIView) {
-		// Generate view mouse events from user input
-		Coherent::UI::MouseEventData* UIMouseEvent = new Coherent::UI::MouseEventData();
-		UIMouseEvent->X = PixelCoordinates.X;
-		UIMouseEvent->Y = PixelCoordinates.Y;
-		UIMouseEvent->Type = Coherent::UI::MouseEventData::EventType::MouseMove;
-		UIView->MouseEvent(*UIMouseEvent);
+	if (!PointerFingerIsHovering) { // don't handle raycast mouseover if in hover state
+		if (CoherentUIComponent->GetView()) {
+			LastMouseEventPixelCoordinates = GetViewPixelCoordinatesFromActorLocation(EventActorLocation);
+			HandleMouseoverEventPixelCoordinates(LastMouseEventPixelCoordinates);
+		}
 	}
 }
 
+void AUISurfaceActor::HandleMouseoverEventPixelCoordinates(FVector PixelCoordinates)
+{
+	// Generate view mouse events from user input
+	InputDispatcher.QueueMouseMove(PixelCoordinates.X, PixelCoordinates.Y);
+}
+
 void AUISurfaceActor::HandleMouseDownEventAtCoordinates(FVector PixelCoordinates)
 {
-	Coherent::UI::MouseEventData* UIMouseEvent = new Coherent::UI::MouseEventData();
-	UIMouseEvent->Type = Coherent::UI::MouseEventData::EventType::MouseDown;
-	UIMouseEvent->X = PixelCoordinates.X;
-	UIMouseEvent->Y = PixelCoordinates.Y;
-	CoherentUIComponent->GetView()->MouseEvent(*UIMouseEvent);
+	InputDispatcher.QueueMouseDown(PixelCoordinates.X, PixelCoordinates.Y);
 }
 
 void AUISurfaceActor::HandleMouseDownEvent()
@@ -105,11 +126,7 @@ void AUISurfaceActor::HandleMouseDownEvent()
 
 void AUISurfaceActor::HandleMouseUpEventAtCoordinates(FVector PixelCoordinates)
 {
-	Coherent::UI::MouseEventData* UIMouseEvent = new Coherent::UI::MouseEventData();
-	UIMouseEvent->Type = Coherent::UI::MouseEventData::EventType::MouseUp;
-	UIMouseEvent->X = PixelCoordinates.X;
-	UIMouseEvent->Y = PixelCoordinates.Y;
-	CoherentUIComponent->GetView()->MouseEvent(*UIMouseEvent);
+	InputDispatcher.QueueMouseUp(PixelCoordinates.X, PixelCoordinates.Y);
 }
 
 void AUISurfaceActor::HandleMouseUpEvent()
@@ -126,10 +143,7 @@ void AUISurfaceActor::HandleMouseClick(FVector ViewPixelCoordinates)
 
 void AUISurfaceActor::HandleYScrollIncrementEvent(float NumYWheelTicksWithSign)
 {
-	Coherent::UI::MouseEventData* UIMouseEvent = new Coherent::UI::MouseEventData();
-	UIMouseEvent->Type = Coherent::UI::MouseEventData::EventType::MouseWheel;
-	UIMouseEvent->WheelY = NumYWheelTicksWithSign;
-	CoherentUIComponent->GetView()->MouseEvent(*UIMouseEvent);
+	InputDispatcher.QueueMouseWheel(0.f, NumYWheelTicksWithSign);
 }
 
 void AUISurfaceActor::HandleScrollDownEvent()
@@ -153,94 +167,67 @@ void AUISurfaceActor::HandleBackEvent()
 void AUISurfaceActor::HandleVirtualTouchInput(FVector ActionHandPalmLocation, FVector ActionHandFingerLocation) {
 	FVector ActorSpaceActionFingerLocation = this->GetTransform().InverseTransformPosition(ActionHandFingerLocation);
 	FVector ActorSpaceActionPalmLocation = this->GetTransform().InverseTransformPosition(ActionHandPalmLocation);
-	FVector ActorSpaceActionFingerPreviousLocation = this->GetTransform().InverseTransformPosition(ActionHandPreviousFingerLocation);
-	FVector ActorSpaceActionPalmPreviousLocation = this->GetTransform().InverseTransformPosition(ActionHandPreviousPalmLocation);
 	FVector ActorSpaceActionFingerLocationXY = ActorSpaceActionFingerLocation;
 	ActorSpaceActionFingerLocationXY.Z = 0.0;
 	FVector ActorSpacePointerFingerLocationXYWorld = this->GetTransform().TransformPosition(ActorSpaceActionFingerLocationXY);
 	FVector PointerFingerPixelCoordinates = GetViewPixelCoordinatesFromActorLocation(ActorSpaceActionFingerLocationXY);
-	if (ActorSpaceActionFingerLocation.Z <= 0) { // finger is across plane
-		if (!PointerFingerAcrossPlane) { // finger was not previously across plane, so handle as mouse click and set across flag to true
-			HandleMouseDownEventAtCoordinates(PointerFingerPixelCoordinates);
-			DrawDebugSphere(GetWorld(), ActorSpacePointerFingerLocationXYWorld, 0.6, 12, FColor::Cyan, true, 0.1);
-			PointerFingerAcrossPlane = true;
-		}
-		else { // was already across plane
-		}
-		// handle scrolling
-		FVector CurrentPalmPixelCoordinates = GetViewPixelCoordinatesFromActorLocation(ActorSpaceActionPalmLocation);
-		FVector PreviousPalmPixelCoordinates = GetViewPixelCoordinatesFromActorLocation(ActorSpaceActionPalmPreviousLocation);
-		float NumPixelsMovedY = CurrentPalmPixelCoordinates.Y - PreviousPalmPixelCoordinates.Y; // if negative means palm is moving up so should scroll down
-		if (abs(NumPixelsMovedY) >= ScrollNumPixelsThreshold) {
-			float WheelTicksY = NumPixelsMovedY / PixelToWheelTickScalingFactor;
-			HandleYScrollIncrementEvent(WheelTicksY);
-		}
-		// Handle left/right swipe
-		// NOTE: was a simple left swipe to go Back before, but since there were too many false positives have more complicated gesture linking left and right swipes to go Back
-		float NumPixelsMovedX = CurrentPalmPixelCoordinates.X - PreviousPalmPixelCoordinates.X; 
-		if (abs(NumPixelsMovedX) >= SwipeLengthPixelsThreshold) { 
-			FDateTime CurrentTime = FDateTime::Now();
-			if (NumPixelsMovedX < 0) { // is left swipe
-				FTimespan TimeBetweenLeftSwipes = CurrentTime - LastLeftSwipeTime;
-				if (TimeBetweenLeftSwipes.GetTotalMilliseconds() >= MinMillisecondsBetweenSwipes) { // check if there has been enough elapsed time since last swipe
-					LastLeftSwipeTime = CurrentTime;
-				}
-			}
-			else { // is right swipe
-				FTimespan TimeBetweenRightSwipes = CurrentTime - LastRightSwipeTime;
-				if (TimeBetweenRightSwipes.GetTotalMilliseconds() >= MinMillisecondsBetweenSwipes) { // check if there has been enough elapsed time since last swipe
-					LastRightSwipeTime = CurrentTime;
-					FTimespan TimeBetweenLeftAndRightSwipes = LastRightSwipeTime - LastLeftSwipeTime;
-					if (TimeBetweenLeftAndRightSwipes.GetTotalMilliseconds() <= MaxMillisecondsLinkingSwipes) { // check right swipe is linked to the previous left swipe
-						HandleBackEvent();
-					}
-				}
-			}
-		}
-		
+	FVector PalmPixelCoordinates = GetViewPixelCoordinatesFromActorLocation(ActorSpaceActionPalmLocation);
+	TouchInput.HoverDistance = HoverDistance;
+	TouchInput.PixelToWheelTickScalingFactor = PixelToWheelTickScalingFactor;
+	TouchInput.FlingScrollSeconds = FlingScrollSeconds;
+	TouchInput.MaxSecondsLinkingSwipes = MaxMillisecondsLinkingSwipes / 1000.0;
+	TouchInput.Gestures.ScrollStepPixels = ScrollNumPixelsThreshold;
+	TouchInput.Gestures.SwipeLengthPixels = SwipeLengthPixelsThreshold;
+	TouchInput.Gestures.SwipeMinVelocity = SwipeMinPixelsPerSecond;
+	TouchInput.Gestures.MinSecondsBetweenSwipes = MinMillisecondsBetweenSwipes / 1000.0;
+	TouchInput.Gestures.FlingMinVelocity = FlingMinPixelsPerSecond;
+	bool WasAcrossPlane = TouchInput.IsAcrossPlane();
+	UISurfaceActorInputSink Sink(this);
+	TouchInput.AddSample(FPlatformTime::Seconds(), FVector2D(PointerFingerPixelCoordinates.X, PointerFingerPixelCoordinates.Y), ActorSpaceActionFingerLocation.Z,
+		FVector2D(PalmPixelCoordinates.X, PalmPixelCoordinates.Y), Sink);
+	PointerFingerAcrossPlane = TouchInput.IsAcrossPlane();
+	PointerFingerIsHovering = TouchInput.IsHovering();
+	if (PointerFingerAcrossPlane && !WasAcrossPlane) {
+		AR_DEBUG_SPHERE(Touch, ActorSpacePointerFingerLocationXYWorld, 0.6, FColor::Cyan, 0.1);
 	}
-	else { // finger is not across plane
-		if (PointerFingerAcrossPlane) { // set across flag to false if it was set to true
-			PointerFingerAcrossPlane = false ;
-			HandleMouseUpEventAtCoordinates(PointerFingerPixelCoordinates);
-		}
-		// check for hover state
-		if (ActorSpaceActionFingerLocation.Z <= this->HoverDistance) { // check for hovering
-			PointerFingerIsHovering = true;
-			DrawDebugSphere(GetWorld(), ActorSpacePointerFingerLocationXYWorld, 0.5, 12, FColor::Magenta);
-			HandleMouseoverEventPixelCoordinates(PointerFingerPixelCoordinates);
-		}
-		else {
-			if (PointerFingerIsHovering) {
-				PointerFingerIsHovering = false;
-			}
-		}
+	else if (!PointerFingerAcrossPlane && PointerFingerIsHovering) {
+		AR_DEBUG_SPHERE(Touch, ActorSpacePointerFingerLocationXYWorld, 0.5, FColor::Magenta);
 	}
-    // Now that we are done with Leap processing let's set the previous hand locations to the current hand locations
-    ActionHandPreviousPalmLocation = ActionHandPalmLocation;
-    ActionHandPreviousFingerLocation = ActionHandFingerLocation;
- 
 }
 
 FVector AUISurfaceActor::GetViewPixelCoordinatesFromWorldLocation(FVector WorldLocation) {
-	FVector* ViewPixelCoordinates = new FVector();
 	FVector ActorLocation = this->GetTransform().InverseTransformPosition(WorldLocation);
 	return GetViewPixelCoordinatesFromActorLocation(ActorLocation);
 }
 
 FVector AUISurfaceActor::GetViewPixelCoordinatesFromActorLocation(FVector ActorLocation) {
-	FVector* ViewPixelCoordinates = new FVector();
-	float NormalizedUIViewX = (ActorLocation.X + 50.0) / 100.0;
-	float NormalizedUIViewY = (ActorLocation.Y + 50.0) / 100.0;
-	ViewPixelCoordinates->X = NormalizedUIViewX * CoherentUIComponent->GetView()->GetWidth();
-	ViewPixelCoordinates->Y = NormalizedUIViewY * CoherentUIComponent->GetView()->GetHeight();
-	ViewPixelCoordinates->Z = 0.0;
-	return *ViewPixelCoordinates;
+	FVector ViewPixelCoordinates(0.f, 0.f, 0.f);
+	Coherent::UI::View* UIView = CoherentUIComponent->GetView();
+	if (UIView) {
+		float NormalizedUIViewX = (ActorLocation.X + 50.0) / 100.0;
+		float NormalizedUIViewY = (ActorLocation.Y + 50.0) / 100.0;
+		ViewPixelCoordinates.X = NormalizedUIViewX * UIView->GetWidth();
+		ViewPixelCoordinates.Y = NormalizedUIViewY * UIView->GetHeight();
+	}
+	return ViewPixelCoordinates;
 }
 
 void AUISurfaceActor::Tick(float DeltaTime)
 {
+	// everything the input handlers generated this frame goes to the view in one batch
+	InputDispatcher.Flush(CoherentUIComponent->GetView());
+}
 
+void AUISurfaceActor::BeginPlay()
+{
+	Super::BeginPlay();
+	UISurfaceRegistry::Get().Register(this);
+}
+
+void AUISurfaceActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UISurfaceRegistry::Get().Unregister(this);
+	Super::EndPlay(EndPlayReason);
 }
 
 void AUISurfaceActor::InitializeView()
@@ -250,12 +237,47 @@ void AUISurfaceActor::InitializeView()
 	CoherentUIComponent.Get()->Width = CoherentUIViewPixelWidth;
 	CoherentUIComponent.Get()->Height = CoherentUIViewPixelWidth / AspectRatio;
 
+	// a surface recycled by the pool already has its view: swap the page and size instead of creating a new one
+	Coherent::UI::View* UIView = CoherentUIComponent->GetView();
+	if (UIView) {
+		UIView->Load(*CoherentUIViewURL);
+		UIView->Resize(CoherentUIComponent.Get()->Width, CoherentUIComponent.Get()->Height);
+	}
+}
+
+void AUISurfaceActor::OnReleasedToPool()
+{
+	UISurfaceRegistry::Get().Unregister(this);
+	DisableInput(UGameplayStatics::GetPlayerController(GetWorld(), 0)); // a selected surface had input enabled by the gaze
+	ResetFlags();
+	TouchInput.Reset();
+	InputDispatcher.Flush(NULL); // drops whatever was queued
+	Coherent::UI::View* UIView = CoherentUIComponent->GetView();
+	if (UIView) {
+		UIView->Load(TEXT("about:blank")); // stop the page (scripts, video) while the surface is hidden
+	}
+	CoherentUIComponent->SetComponentTickEnabled(false);
+}
+
+void AUISurfaceActor::OnAcquiredFromPool()
+{
+	ResetFlags();
+	CoherentUIComponent->SetComponentTickEnabled(true);
+	UISurfaceRegistry::Get().Register(this);
+}
+
+void AUISurfaceActor::SetViewRedraw(bool Redraw)
+{
+	if (CoherentUIComponent->IsComponentTickEnabled() != Redraw) {
+		CoherentUIComponent->SetComponentTickEnabled(Redraw);
+	}
 }
 
 void AUISurfaceActor::ResetFlags()
 {
 	PointerFingerIsHovering = false;
 	PointerFingerAcrossPlane = false;
+	TouchInput.ResetFlags();
 }
 
 
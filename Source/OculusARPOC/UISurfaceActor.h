@@ -31,7 +31,8 @@
 #include "CoherentUIComponent.h"
 #include "Coherent/UI/View.h"
 #include "GameFramework/Actor.h"
-#include "Runtime/Core/Public/Misc/DateTime.h"
+#include "UIInputDispatcher.h"
+#include "UISurfaceTouchInput.h"
 
 #include "UISurfaceActor.generated.h"
 
@@ -59,8 +60,17 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoherentUI)
 	float SwipeLengthPixelsThreshold;
 
+	// horizontal palm speed (pixels per second) needed for a swipe
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoherentUI)
-	float SwipeWidthPixelsCutoff;
+	float SwipeMinPixelsPerSecond;
+
+	// finger speed (pixels per second) at release needed for a fling
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoherentUI)
+	float FlingMinPixelsPerSecond;
+
+	// a vertical fling keeps scrolling as far as its release velocity would carry it in this time
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoherentUI)
+	float FlingScrollSeconds;
 
 	// This property is to prevent multiple swipe events from being recorded from a single swipe action
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = CoherentUI)
@@ -79,12 +89,6 @@ public:
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = CoherentUI)
 	FVector LastMouseEventPixelCoordinates;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = CoherentUI)
-	FDateTime LastLeftSwipeTime;
-
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = CoherentUI)
-	FDateTime LastRightSwipeTime;
-
 	// mesh to use
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category = CoherentUI)
 	TSubobjectPtr<UStaticMeshComponent>  UISurfaceMesh;
@@ -104,6 +108,10 @@ public:
 	UFUNCTION()
 	void HandleMouseoverEventPixelCoordinates(FVector PixelCoordinates);
 
+	// for hits that already have the location in this actor's space (see UISurfaceRegistry)
+	UFUNCTION()
+	void HandleMouseoverEventActorLocation(FVector EventActorLocation);
+
 	UFUNCTION(BlueprintCallable, Category = CoherentUI)
 	void HandleMouseDownEvent();
 
@@ -140,18 +148,33 @@ public:
 	UFUNCTION(BlueprintCallable, Category = CoherentUI)
 	void ResetFlags();
 
+	/*
+	 Level of detail of the view (see UISurfaceLODScheduler): its texture is only updated while Redraw is set.  Input
+	 still reaches a paused view.
+	 */
+	void SetViewRedraw(bool Redraw);
+
+	/* Reset hooks for ActorPool: a released surface drops its page, input and gesture state and leaves the registry; an acquired one rejoins it */
+	void OnReleasedToPool();
+
+	void OnAcquiredFromPool();
+
 	virtual void Tick(float DeltaTime) override;
 
-    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = CoherentUI)
-    FVector ActionHandPreviousPalmLocation;
-    
-    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = CoherentUI)
-    FVector ActionHandPreviousFingerLocation;
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 protected:
 
 	bool UIViewInitialized;
 
+	// touches, hovering and gestures of the action hand, turned into view input (see UISurfaceTouchInput)
+	UISurfaceTouchInput TouchInput;
+
+	// mouse events are queued and forwarded to the view once per Tick
+	UIInputDispatcher InputDispatcher;
+
 	UFUNCTION()
 	FVector GetViewPixelCoordinatesFromWorldLocation(FVector ImpactPointWorldLocation);
 
@@ -0,0 +1,124 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "UISurfaceLODScheduler.h"
+#include "UISurfaceActor.h"
+#include "UISurfaceRegistry.h"
+#include "ARTraceRecorder.h"
+
+static const float SurfaceSize = 100.f; // the UI plane mesh is 100x100 units before scaling
+
+UISurfaceLODScheduler::UISurfaceLODScheduler()
+{
+	FullDetailCoverage = 0.25f;
+	MaxRefreshInterval = 15;
+	MaxRedrawsPerFrame = 2;
+}
+
+float UISurfaceLODScheduler::GetScreenCoverage(const AUISurfaceActor* Surface, const FVector& CameraLocation, const FVector& CameraForward, float TanHalfFov, float AspectRatio)
+{
+	FVector Scale = Surface->GetActorScale();
+	float Width = SurfaceSize * FMath::Abs(Scale.X);
+	float Height = SurfaceSize * FMath::Abs(Scale.Y);
+	float Radius = 0.5f * FMath::Sqrt(Width * Width + Height * Height);
+	FVector ToSurface = Surface->GetActorLocation() - CameraLocation;
+	float Distance = ToSurface.Size();
+	if (Distance <= Radius) return 1.f; // the camera is right at the surface
+	float Along = FVector::DotProduct(ToSurface, CameraForward);
+	if (Along <= -Radius) return 0.f; // behind the user
+	// outside the view cone (through the corners of the screen), allowing for the size of the surface
+	float Lateral = FMath::Sqrt(FMath::Max(0.f, Distance * Distance - Along * Along));
+	float TanHalfDiagonal = TanHalfFov * FMath::Sqrt(1.f + 1.f / (AspectRatio * AspectRatio));
+	if (Lateral - Radius > FMath::Max(Along + Radius, 0.f) * TanHalfDiagonal) return 0.f;
+	// projected area on the plane at unit distance, shrunk by the angle the surface is seen at
+	float Depth = FMath::Max(Along, Radius);
+	float Facing = FMath::Abs(FVector::DotProduct(Surface->GetActorUpVector(), ToSurface / Distance));
+	float ProjectedArea = Width * Height * Facing / (Depth * Depth);
+	float ScreenArea = (2.f * TanHalfFov) * (2.f * TanHalfFov / AspectRatio);
+	return FMath::Min(1.f, ProjectedArea / ScreenArea);
+}
+
+void UISurfaceLODScheduler::Update(const FVector& CameraLocation, const FVector& CameraForward, float FieldOfView, float AspectRatio, AUISurfaceActor* FocusedSurface)
+{
+	AR_TRACE_SCOPE("UISurfaceLODScheduler::Update");
+	UISurfaceRegistry& Registry = UISurfaceRegistry::Get();
+	float TanHalfFov = FMath::Tan(FMath::DegreesToRadians(FieldOfView * 0.5f));
+	AspectRatio = FMath::Max(AspectRatio, 0.1f);
+	uint64 Frame = GFrameCounter;
+	Candidates.Reset();
+	for (int32 i = 0; i < Registry.GetNumSurfaces(); i++) {
+		Candidate& Entry = Candidates[Candidates.AddUninitialized()];
+		Entry.Surface = Registry.GetSurface(i);
+		SurfaceState& State = States.FindOrAdd(Entry.Surface);
+		State.LastSeenFrame = Frame;
+		if (Entry.Surface == FocusedSurface) {
+			Entry.Priority = MAX_FLT;
+			continue;
+		}
+		float Coverage = GetScreenCoverage(Entry.Surface, CameraLocation, CameraForward, TanHalfFov, AspectRatio);
+		if (Coverage <= 0.f) { // paused
+			Entry.Priority = -1.f;
+			continue;
+		}
+		// the refresh rate follows the area on screen
+		int32 RefreshInterval = GetRefreshInterval(Coverage, FullDetailCoverage, MaxRefreshInterval);
+		uint64 FramesSinceRedraw = Frame - State.LastRedrawFrame;
+		Entry.Priority = FramesSinceRedraw >= (uint64)RefreshInterval ? Coverage * FramesSinceRedraw / RefreshInterval : -1.f;
+	}
+
+	// the global budget goes to the views most overdue relative to their size
+	Candidates.Sort();
+	int32 Redraws = 0;
+	for (int32 i = 0; i < Candidates.Num(); i++) {
+		bool Redraw = Candidates[i].Priority >= 0.f && (Redraws < MaxRedrawsPerFrame || Candidates[i].Surface == FocusedSurface);
+		if (Redraw) {
+			Redraws++;
+			States.FindChecked(Candidates[i].Surface).LastRedrawFrame = Frame;
+		}
+		Candidates[i].Surface->SetViewRedraw(Redraw);
+	}
+	AR_TRACE_COUNTER("UIViewRedraws", Redraws);
+
+	// forget surfaces that have been unregistered
+	if (States.Num() > Registry.GetNumSurfaces()) {
+		for (TMap<AUISurfaceActor*, SurfaceState>::TIterator It(States); It; ++It) {
+			if (It.Value().LastSeenFrame != Frame) {
+				It.RemoveCurrent();
+			}
+		}
+	}
+}
+
+void UISurfaceLODScheduler::Disable()
+{
+	UISurfaceRegistry& Registry = UISurfaceRegistry::Get();
+	for (int32 i = 0; i < Registry.GetNumSurfaces(); i++) {
+		Registry.GetSurface(i)->SetViewRedraw(true);
+	}
+	States.Empty();
+}
@@ -0,0 +1,99 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+class AUISurfaceActor;
+
+/**
+ * Level of detail for the Coherent UI views of the registered UI surfaces (see UISurfaceRegistry).
+ * Every frame the screen coverage of each surface is estimated from its size, distance and angle to the camera.  Views
+ * refresh less often the smaller they are, and views that are off screen or behind the user are paused.  At most
+ * MaxRedrawsPerFrame views refresh in a frame, the most overdue and largest first; the focused surface refreshes every
+ * frame regardless.  Views keep their size: resizing a Coherent UI view changes the page layout, not just its resolution.
+ */
+class UISurfaceLODScheduler
+{
+public:
+
+	UISurfaceLODScheduler();
+
+	/*
+	 Decides which views refresh this frame.  FieldOfView is horizontal, in degrees;
+	 AspectRatio is width / height of the viewport.
+	 */
+	void Update(const FVector& CameraLocation, const FVector& CameraForward, float FieldOfView, float AspectRatio, AUISurfaceActor* FocusedSurface);
+
+	/* Lets every surface refresh every frame again */
+	void Disable();
+
+	/*
+	 Frames between refreshes of a visible view covering Coverage of the screen: every frame at FullDetailCoverage and
+	 above, then inversely to the coverage up to MaxRefreshInterval.  The limit is applied while the interval is still a
+	 float, as 1 / Coverage overflows an int32 for views covering next to nothing.
+	 */
+	static int32 GetRefreshInterval(float Coverage, float FullDetailCoverage, int32 MaxRefreshInterval)
+	{
+		float Relative = Coverage / FullDetailCoverage;
+		if (Relative >= 1.f) return 1;
+		return FMath::Max(1, FMath::CeilToInt(FMath::Min(1.f / Relative, (float)MaxRefreshInterval)));
+	}
+
+	// coverage (fraction of the screen) at and above which a view refreshes every frame
+	float FullDetailCoverage;
+
+	// slowest refresh for a visible view, in frames
+	int32 MaxRefreshInterval;
+
+	// how many views may refresh in one frame (the focused one counts, but is never held back)
+	int32 MaxRedrawsPerFrame;
+
+private:
+
+	struct SurfaceState
+	{
+		SurfaceState() : LastRedrawFrame(0), LastSeenFrame(0) {}
+		uint64 LastRedrawFrame;
+		uint64 LastSeenFrame;
+	};
+
+	struct Candidate
+	{
+		AUISurfaceActor* Surface;
+		float Priority; // negative if the view is not due for a refresh this frame
+
+		// highest priority first
+		bool operator<(const Candidate& Other) const { return Priority > Other.Priority; }
+	};
+
+	/* Fraction of the screen covered by Surface, 0 if it is off screen */
+	static float GetScreenCoverage(const AUISurfaceActor* Surface, const FVector& CameraLocation, const FVector& CameraForward, float TanHalfFov, float AspectRatio);
+
+	TMap<AUISurfaceActor*, SurfaceState> States;
+
+	TArray<Candidate> Candidates;
+};
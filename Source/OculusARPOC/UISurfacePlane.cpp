@@ -0,0 +1,59 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "UISurfacePlane.h"
+
+const float UISurfacePlane::HalfExtent = 50.f;
+
+void UISurfacePlane::Set(const FVector& Location, const FVector& InAxisX, const FVector& InAxisY, const FVector& InAxisZ, const FVector& Scale3D)
+{
+	Origin = Location;
+	AxisX = InAxisX;
+	AxisY = InAxisY;
+	Normal = InAxisZ;
+	ScaleX = Scale3D.X;
+	ScaleY = Scale3D.Y;
+}
+
+bool UISurfacePlane::Intersect(const FVector& Start, const FVector& Direction, float MaxDistance, float& OutDistance, FVector& OutLocal) const
+{
+	// intersect with the plane through the origin along the normal, then measure along the (scaled) X and Y axes
+	if (FMath::Abs(ScaleX) < KINDA_SMALL_NUMBER || FMath::Abs(ScaleY) < KINDA_SMALL_NUMBER) return false;
+	float Approach = FVector::DotProduct(Direction, Normal);
+	if (FMath::Abs(Approach) < KINDA_SMALL_NUMBER) return false; // parallel to the surface
+	FVector ToOrigin = Origin - Start;
+	float Distance = FVector::DotProduct(ToOrigin, Normal) / Approach;
+	if (Distance < 0.f || Distance >= MaxDistance) return false;
+	FVector Offset = Direction * Distance - ToOrigin;
+	float LocalX = FVector::DotProduct(Offset, AxisX) / ScaleX;
+	float LocalY = FVector::DotProduct(Offset, AxisY) / ScaleY;
+	if (FMath::Abs(LocalX) > HalfExtent || FMath::Abs(LocalY) > HalfExtent) return false;
+	OutDistance = Distance;
+	OutLocal = FVector(LocalX, LocalY, 0.f);
+	return true;
+}
@@ -0,0 +1,55 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+/*
+ A UI surface as a ray sees it: the 100x100 quad of the surface mesh, placed by the actor's location, unit axes and
+ scale.  Only the X and Y scale matter; the surfaces are spawned with a Z scale of 0, so the actor's transform can't
+ simply be inverted to bring a hit into its space.
+ */
+struct UISurfacePlane
+{
+	FVector Origin;
+	FVector AxisX;
+	FVector AxisY;
+	FVector Normal;
+	float ScaleX;
+	float ScaleY;
+
+	/* The mesh spans -HalfExtent..HalfExtent on X and Y before scaling */
+	static const float HalfExtent;
+
+	void Set(const FVector& Location, const FVector& InAxisX, const FVector& InAxisY, const FVector& InAxisZ, const FVector& Scale3D);
+
+	/*
+	 Intersects the ray from Start along Direction, from either side of the surface.  Returns false if the ray misses
+	 the quad or only reaches it at or beyond MaxDistance (in units of Direction).  OutLocal is in the actor's space,
+	 with Z 0, and OutDistance in units of Direction.
+	 */
+	bool Intersect(const FVector& Start, const FVector& Direction, float MaxDistance, float& OutDistance, FVector& OutLocal) const;
+};
@@ -29,6 +29,9 @@
 #include "OculusARPOC.h"
 #include "Engine.h"
 #include "UISurfaceRaytraceInputHandler.h"
+#include "UISurfaceRegistry.h"
+#include "ARTraceRecorder.h"
+#include "ARDebugDraw.h"
 
 UISurfaceRaytraceInputHandler::UISurfaceRaytraceInputHandler(ACharacter* Character, UCameraComponent* FirstPersonCamera)
 {
@@ -40,6 +43,7 @@ UISurfaceRaytraceInputHandler::UISurfaceRaytraceInputHandler(ACharacter* Charact
     RaytraceForwardOffset = 50.0;
     RaytraceDistance = 4000.0;
     RaytraceDrawFraction = 0.75;
+    OcclusionCheckEnable = true;
 }
 
 UISurfaceRaytraceInputHandler::~UISurfaceRaytraceInputHandler()
@@ -50,22 +54,35 @@ AUISurfaceActor* UISurfaceRaytraceInputHandler::GetSelectedUISurfaceActor() {
     return SelectedUISurfaceActor;
 }
 
+void UISurfaceRaytraceInputHandler::ClearSelection(AUISurfaceActor* Surface) {
+    if (Surface != nullptr && SelectedUISurfaceActor == Surface) {
+        SelectedUISurfaceActor->DisableInput(UGameplayStatics::GetPlayerController(Character->GetWorld(), 0));
+        SelectedUISurfaceActor->ResetFlags();
+        SelectedUISurfaceActor = nullptr;
+    }
+}
+
 void UISurfaceRaytraceInputHandler::HandleRaytrace() {
+    AR_TRACE_SCOPE("UISurfaceRaytraceInputHandler::HandleRaytrace");
     
-    // Perform raytrace to get Hit result
+    // Intersect the gaze with the UI surfaces (flat quads, so no physics needed to find which one is targeted)
     FVector StartTrace = FirstPersonCameraComponent->GetComponentLocation();
     FVector TraceDirection = FirstPersonCameraComponent->GetForwardVector();
     UWorld* World = Character->GetWorld();
-    FVector EndTrace = StartTrace + TraceDirection * RaytraceDistance;
-    
-    FCollisionQueryParams TraceParams(FName(TEXT("LookTrace")), true, Character);
-    TraceParams.bTraceAsyncScene = true;
-    TraceParams.bReturnPhysicalMaterial = true;
-    FHitResult Hit(ForceInit);
-    World->LineTraceSingle(Hit, StartTrace, EndTrace, ECC_Visibility, TraceParams); // simple trace function
+    UISurfaceHit Hit;
+    AUISurfaceActor* UISurfaceActor = nullptr;
+    if (UISurfaceRegistry::Get().Raycast(StartTrace, TraceDirection, RaytraceDistance, Hit)) {
+        UISurfaceActor = Hit.Surface;
+        if (OcclusionCheckEnable) { // physics only to tell whether something is in front of the surface
+            FCollisionQueryParams TraceParams(FName(TEXT("LookTrace")), true, Character);
+            TraceParams.AddIgnoredActor(UISurfaceActor);
+            if (World->LineTraceTest(StartTrace, Hit.WorldLocation, ECC_Visibility, TraceParams)) {
+                UISurfaceActor = nullptr;
+            }
+        }
+    }
     
-    // now check Hit result to see if it has hit a UISurfaceActor object
-    AUISurfaceActor* UISurfaceActor = Cast<AUISurfaceActor>(Hit.GetActor());
+    // now check whether a UISurfaceActor object was hit
     if (UISurfaceActor)
     {
         if (SelectedUISurfaceActor == nullptr) {
@@ -80,21 +97,23 @@ void UISurfaceRaytraceInputHandler::HandleRaytrace() {
             SelectedUISurfaceActor = nullptr;
         }
     }
-    if (SelectedUISurfaceActor) {
+    if (SelectedUISurfaceActor && AR_DEBUG_DRAW_IS_ENABLED(Gaze)) {
         // Draw line and point if targeting a UISurfaceActor
         float ForwardOffset = RaytraceForwardOffset;
         float UpOffset = RaytraceUpOffset;
-        float RaytraceLength = FVector::Dist(StartTrace,Hit.ImpactPoint);
+        float RaytraceLength = FVector::Dist(StartTrace,Hit.WorldLocation);
         if (RaytraceLength < 100.f) {
             ForwardOffset = RaytraceLength * 0.5;
             UpOffset = (0.5 * RaytraceUpOffset) * (1 + RaytraceLength / 100.f);  // starts going from 100% to 50% of up offset
         }
         FVector LineStart = StartTrace + FirstPersonCameraComponent->GetUpVector() * RaytraceUpOffset + FirstPersonCameraComponent->GetForwardVector() * RaytraceForwardOffset;
-        DrawDebugLine(World, LineStart, Hit.ImpactPoint, FColor::Blue.WithAlpha(50)); // NOTE:  DrawDebug methods are ignoring the Alpha
+        AR_DEBUG_LINE(Gaze, LineStart, Hit.WorldLocation, FColor::Blue.WithAlpha(50)); // NOTE:  DrawDebug methods are ignoring the Alpha
         if (!SelectedUISurfaceActor->PointerFingerIsHovering) {
-            DrawDebugSphere(World, Hit.ImpactPoint, 0.5, 12, FColor::Blue.WithAlpha(50));
-            UISurfaceActor->HandleMouseoverEventWorldLocation(Hit.ImpactPoint);
+            AR_DEBUG_SPHERE(Gaze, Hit.WorldLocation, 0.5, FColor::Blue.WithAlpha(50));
         }
     }
+    if (SelectedUISurfaceActor && !SelectedUISurfaceActor->PointerFingerIsHovering) {
+        UISurfaceActor->HandleMouseoverEventActorLocation(Hit.LocalLocation);
+    }
 }
 
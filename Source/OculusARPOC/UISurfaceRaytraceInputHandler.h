@@ -42,6 +42,9 @@ public:
     void HandleRaytrace();
     
     AUISurfaceActor* GetSelectedUISurfaceActor();
+
+    /* Drops the selection if it is Surface (e.g. a surface going back to the pool), so it no longer gets input */
+    void ClearSelection(AUISurfaceActor* Surface);
     
     bool RaytraceInputEnable;
     float RaytraceUpOffset;
@@ -49,6 +52,11 @@ public:
     float RaytraceDistance;
     float RaytraceDrawFraction;
 
+    /*
+     If true a surface hit by the gaze is only selected if nothing else is in front of it (checked with a physics trace up to the hit)
+     */
+    bool OcclusionCheckEnable;
+
 protected:
     ACharacter* Character;
     UCameraComponent* FirstPersonCameraComponent;
@@ -0,0 +1,95 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "UISurfaceRegistry.h"
+#include "UISurfaceActor.h"
+
+UISurfaceRegistry& UISurfaceRegistry::Get()
+{
+	static UISurfaceRegistry Registry;
+	return Registry;
+}
+
+UISurfaceRegistry::UISurfaceRegistry()
+{
+	TransformsFrame = (uint64)-1;
+}
+
+void UISurfaceRegistry::Register(AUISurfaceActor* Surface)
+{
+	if (Surfaces.Contains(Surface)) return;
+	Surfaces.Add(Surface);
+	Planes.AddUninitialized();
+	SetPlane(Planes.Num() - 1);
+}
+
+void UISurfaceRegistry::Unregister(AUISurfaceActor* Surface)
+{
+	int32 Index = Surfaces.Find(Surface);
+	if (Index == INDEX_NONE) return;
+	Surfaces.RemoveAtSwap(Index);
+	Planes.RemoveAtSwap(Index);
+}
+
+void UISurfaceRegistry::SetPlane(int32 Index)
+{
+	const FTransform& Transform = Surfaces[Index]->GetTransform();
+	FQuat Rotation = Transform.GetRotation();
+	Planes[Index].Set(Transform.GetLocation(), Rotation.GetAxisX(), Rotation.GetAxisY(), Rotation.GetAxisZ(), Transform.GetScale3D());
+}
+
+void UISurfaceRegistry::UpdateTransforms()
+{
+	if (TransformsFrame == GFrameCounter) return;
+	TransformsFrame = GFrameCounter;
+	for (int32 i = 0; i < Surfaces.Num(); i++) {
+		SetPlane(i);
+	}
+}
+
+bool UISurfaceRegistry::Raycast(const FVector& Start, const FVector& Direction, float MaxDistance, UISurfaceHit& OutHit)
+{
+	UpdateTransforms();
+	int32 HitIndex = INDEX_NONE;
+	float Nearest = MaxDistance;
+	FVector NearestLocal;
+	for (int32 i = 0; i < Planes.Num(); i++) {
+		float Distance;
+		FVector Local;
+		if (!Planes[i].Intersect(Start, Direction, Nearest, Distance, Local)) continue;
+		HitIndex = i;
+		Nearest = Distance;
+		NearestLocal = Local;
+	}
+	if (HitIndex == INDEX_NONE) return false;
+	OutHit.Surface = Surfaces[HitIndex];
+	OutHit.Distance = Nearest;
+	OutHit.LocalLocation = NearestLocal;
+	OutHit.WorldLocation = Start + Direction * Nearest;
+	return true;
+}
@@ -0,0 +1,84 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "UISurfacePlane.h"
+
+class AUISurfaceActor;
+
+/**
+ * Result of a ray cast against the UI surfaces
+ */
+struct UISurfaceHit
+{
+	AUISurfaceActor* Surface;
+	FVector WorldLocation;
+	FVector LocalLocation; // in the surface actor's space: the quad spans -50..50 on X and Y, Z is 0 on the surface
+	float Distance;        // along the ray, in units of the ray direction
+};
+
+/**
+ * Registry of the UI surfaces in play, so rays (the gaze, a finger) can be resolved against them analytically instead of
+ * with a physics trace.  Every surface is a flat quad, so its location, axes and scale are all a hit test needs: they
+ * are kept in a flat array, refreshed once per frame, and a ray cast is a UISurfacePlane intersection per surface.
+ */
+class UISurfaceRegistry
+{
+public:
+
+	static UISurfaceRegistry& Get();
+
+	void Register(AUISurfaceActor* Surface);
+
+	void Unregister(AUISurfaceActor* Surface);
+
+	/*
+	 Finds the nearest surface hit by the ray from Start along Direction within MaxDistance (in units of Direction).
+	 Surfaces are hit from either side.  Returns false if no surface is hit.
+	 */
+	bool Raycast(const FVector& Start, const FVector& Direction, float MaxDistance, UISurfaceHit& OutHit);
+
+	int32 GetNumSurfaces() const { return Surfaces.Num(); }
+
+	AUISurfaceActor* GetSurface(int32 Index) const { return Surfaces[Index]; }
+
+private:
+
+	UISurfaceRegistry();
+
+	void SetPlane(int32 Index);
+
+	/* Reads the transforms of all surfaces, once per frame */
+	void UpdateTransforms();
+
+	TArray<AUISurfaceActor*> Surfaces;
+
+	TArray<UISurfacePlane> Planes; // parallel to Surfaces
+
+	uint64 TransformsFrame;
+};
@@ -0,0 +1,103 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "OculusARPOC.h"
+#include "UISurfaceTouchInput.h"
+
+UISurfaceTouchInput::UISurfaceTouchInput()
+{
+	HoverDistance = 30.f;
+	PixelToWheelTickScalingFactor = 100.f;
+	FlingScrollSeconds = 0.25f;
+	MaxSecondsLinkingSwipes = 1.5;
+	Reset();
+}
+
+void UISurfaceTouchInput::Reset()
+{
+	ResetFlags();
+	Gestures.Reset();
+	LastLeftSwipeSeconds = -1e9;
+}
+
+void UISurfaceTouchInput::ResetFlags()
+{
+	AcrossPlane = false;
+	Hovering = false;
+}
+
+void UISurfaceTouchInput::AddSample(double Time, const FVector2D& FingerPixels, float FingerHeight, const FVector2D& PalmPixels, IUISurfaceInputSink& Sink)
+{
+	if (FingerHeight <= 0.f) { // finger is across plane
+		if (!AcrossPlane) { // finger was not previously across plane, so handle as mouse click
+			Sink.MouseDown(FingerPixels);
+			AcrossPlane = true;
+		}
+	}
+	else {
+		if (AcrossPlane) {
+			AcrossPlane = false;
+			Sink.MouseUp(FingerPixels);
+		}
+		Hovering = FingerHeight <= HoverDistance;
+		if (Hovering) {
+			Sink.MouseMove(FingerPixels);
+		}
+	}
+	// scrolling, swipes and flings are recognized from the stream of finger and palm positions on the surface
+	Gestures.AddSample(Time, FingerPixels, PalmPixels, AcrossPlane);
+	const TArray<GestureEvent>& Events = Gestures.GetEvents();
+	for (int32 i = 0; i < Events.Num(); i++) {
+		HandleGestureEvent(Events[i], Sink);
+	}
+}
+
+void UISurfaceTouchInput::HandleGestureEvent(const GestureEvent& Event, IUISurfaceInputSink& Sink)
+{
+	switch (Event.Type) {
+	case GestureEvent::Scroll:
+		Sink.MouseWheel(Event.Delta.Y / PixelToWheelTickScalingFactor); // if negative means palm is moving up so should scroll down
+		break;
+	case GestureEvent::Fling:
+		if (FMath::Abs(Event.Velocity.Y) > FMath::Abs(Event.Velocity.X)) {
+			Sink.MouseWheel(Event.Velocity.Y * FlingScrollSeconds / PixelToWheelTickScalingFactor);
+		}
+		break;
+	case GestureEvent::Swipe:
+		// NOTE: was a simple left swipe to go Back before, but since there were too many false positives have more complicated gesture linking left and right swipes to go Back
+		if (Event.Velocity.X < 0.f) {
+			LastLeftSwipeSeconds = Event.Time;
+		}
+		else if (Event.Time - LastLeftSwipeSeconds <= MaxSecondsLinkingSwipes) { // check right swipe is linked to the previous left swipe
+			LastLeftSwipeSeconds = -1e9;
+			Sink.Back();
+		}
+		break;
+	default: // taps are already clicks (mouse down and up as the finger crosses the surface), drags need no handling yet
+		break;
+	}
+}
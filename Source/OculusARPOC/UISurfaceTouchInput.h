@@ -0,0 +1,106 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "GestureRecognizer.h"
+
+/*
+ Receives the view input that UISurfaceTouchInput generates.  Positions are view pixels.
+ */
+class IUISurfaceInputSink
+{
+public:
+
+	virtual ~IUISurfaceInputSink() {}
+
+	virtual void MouseMove(const FVector2D& Pixels) = 0;
+
+	virtual void MouseDown(const FVector2D& Pixels) = 0;
+
+	virtual void MouseUp(const FVector2D& Pixels) = 0;
+
+	/* Vertical wheel ticks; negative scrolls down */
+	virtual void MouseWheel(float WheelTicksY) = 0;
+
+	/* Navigates the view back in its history */
+	virtual void Back() = 0;
+};
+
+/*
+ Turns the action hand over a UI surface into input for its view.  The fingertip crossing the surface plane is a mouse
+ down and leaving it a mouse up, and a fingertip hovering in front of the plane moves the mouse.  The gestures that
+ GestureRecognizer finds are mapped as well: palm scrolls and vertical flings become wheel ticks, and a left swipe
+ followed closely by a right swipe goes Back.
+ Samples come in view pixels, with the fingertip's height above the plane in actor units (actor Z), so nothing here
+ needs the engine: AUISurfaceActor and the offline tests run the same code.
+ */
+class UISurfaceTouchInput
+{
+public:
+
+	UISurfaceTouchInput();
+
+	/* Forgets the touch, the gestures in progress and any pending left swipe */
+	void Reset();
+
+	/* Clears the across plane and hovering states only, as AUISurfaceActor::ResetFlags does */
+	void ResetFlags();
+
+	/* Adds a sample at Time (seconds) and sends the input it generates to Sink */
+	void AddSample(double Time, const FVector2D& FingerPixels, float FingerHeight, const FVector2D& PalmPixels, IUISurfaceInputSink& Sink);
+
+	/* Sends the input for a recognized gesture to Sink.  AddSample calls this for each gesture it finds. */
+	void HandleGestureEvent(const GestureEvent& Event, IUISurfaceInputSink& Sink);
+
+	bool IsAcrossPlane() const { return AcrossPlane; }
+
+	bool IsHovering() const { return Hovering; }
+
+	// the finger moves the mouse while at most this far in front of the plane
+	float HoverDistance;
+
+	// pixels of scrolling per wheel tick
+	float PixelToWheelTickScalingFactor;
+
+	// a vertical fling keeps scrolling as far as its release velocity would carry it in this time
+	float FlingScrollSeconds;
+
+	// a right swipe goes Back if it comes at most this long after a left swipe
+	double MaxSecondsLinkingSwipes;
+
+	GestureRecognizer Gestures;
+
+private:
+
+	bool AcrossPlane;
+
+	bool Hovering;
+
+	// time of the last left swipe, to link it with the right swipe that follows
+	double LastLeftSwipeSeconds;
+};
@@ -0,0 +1,225 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "UndistortionMap.h"
+#include "ARTraceRecorder.h"
+#include "MappedFile.h"
+#include "opencv2/imgproc/imgproc.hpp"
+
+DEFINE_LOG_CATEGORY_STATIC(LogUndistortion, Log, All);
+
+static const uint32 UndistortionCacheMagic = 0x4D444E55; // "UNDM"
+static const uint32 UndistortionCacheVersion = 1;
+
+struct UndistortionCacheHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 Key;
+	int32 Width;
+	int32 Height;
+	int32 SourceWidth;
+	int32 SourceHeight;
+	int32 SourceStep;
+	int32 Flipped;
+};
+
+/**
+ * Applies the table to a band of output rows; run through cv::parallel_for_.
+ */
+class UndistortRowsBody : public cv::ParallelLoopBody
+{
+public:
+	UndistortRowsBody(const uint8* source, int32 sourceStep, const UndistortionMap::Entry* table, uint8* destination, int32 width)
+		: Source(source), SourceStep(sourceStep), Table(table), Destination(destination), Width(width)
+	{
+	}
+
+	void operator()(const cv::Range& Rows) const override
+	{
+		const int32 One = cv::INTER_TAB_SIZE;
+		const int32 Shift = 2 * cv::INTER_BITS;
+		const int32 Round = 1 << (Shift - 1);
+		for (int32 y = Rows.start; y < Rows.end; y++)
+		{
+			const UndistortionMap::Entry* E = Table + y * Width;
+			uint8* DestinationPointer = Destination + y * Width * 4;
+			for (int32 x = 0; x < Width; x++, E++, DestinationPointer += 4)
+			{
+				if (E->SourceOffset < 0) {
+					*(uint32*)DestinationPointer = 0xFF000000; // opaque black
+					continue;
+				}
+				const uint8* Top = Source + E->SourceOffset;
+				const uint8* Bottom = Top + SourceStep;
+				const int32 FX = E->FractionX;
+				const int32 FY = E->FractionY;
+				const int32 W00 = (One - FX) * (One - FY);
+				const int32 W01 = FX * (One - FY);
+				const int32 W10 = (One - FX) * FY;
+				const int32 W11 = FX * FY;
+				DestinationPointer[0] = (uint8)((Top[0] * W00 + Top[3] * W01 + Bottom[0] * W10 + Bottom[3] * W11 + Round) >> Shift);
+				DestinationPointer[1] = (uint8)((Top[1] * W00 + Top[4] * W01 + Bottom[1] * W10 + Bottom[4] * W11 + Round) >> Shift);
+				DestinationPointer[2] = (uint8)((Top[2] * W00 + Top[5] * W01 + Bottom[2] * W10 + Bottom[5] * W11 + Round) >> Shift);
+				DestinationPointer[3] = 0xFF;
+			}
+		}
+	}
+
+private:
+	const uint8* Source;
+	int32 SourceStep;
+	const UndistortionMap::Entry* Table;
+	uint8* Destination;
+	int32 Width;
+};
+
+UndistortionMap::UndistortionMap()
+{
+	Key = 0;
+	Width = Height = 0;
+	SourceWidth = SourceHeight = SourceStep = 0;
+	Flipped = false;
+}
+
+/* Returns a float copy of CameraMatrix with focal lengths and principal point scaled to Size */
+static cv::Mat ScaleCameraMatrix(const aruco::CameraParameters& CameraParams, cv::Size Size)
+{
+	cv::Mat Scaled;
+	CameraParams.CameraMatrix.convertTo(Scaled, CV_32F);
+	float ScaleX = float(Size.width) / float(CameraParams.CamSize.width);
+	float ScaleY = float(Size.height) / float(CameraParams.CamSize.height);
+	Scaled.at<float>(0, 0) *= ScaleX;
+	Scaled.at<float>(0, 2) *= ScaleX;
+	Scaled.at<float>(1, 1) *= ScaleY;
+	Scaled.at<float>(1, 2) *= ScaleY;
+	return Scaled;
+}
+
+bool UndistortionMap::Prepare(const aruco::CameraParameters& CameraParams, const cv::Mat& SourceFrame, cv::Size DestinationSize, bool Flip)
+{
+	if (!CameraParams.isValid() || SourceFrame.type() != CV_8UC3) return false;
+	// cheap check first: same layout as last frame, calibration unchanged
+	cv::Mat SourceCameraMatrix = ScaleCameraMatrix(CameraParams, SourceFrame.size());
+	cv::Mat Distortion;
+	CameraParams.Distorsion.convertTo(Distortion, CV_32F);
+	uint32 NewKey = FCrc::MemCrc32(SourceCameraMatrix.ptr<float>(), 9 * sizeof(float));
+	NewKey = FCrc::MemCrc32(Distortion.ptr<float>(), Distortion.total() * sizeof(float), NewKey);
+	int32 Layout[6] = { SourceFrame.cols, SourceFrame.rows, (int32)SourceFrame.step, DestinationSize.width, DestinationSize.height, Flip ? 1 : 0 };
+	NewKey = FCrc::MemCrc32(Layout, sizeof(Layout), NewKey);
+	if (IsValid() && NewKey == Key) return true;
+
+	Key = NewKey;
+	Width = DestinationSize.width;
+	Height = DestinationSize.height;
+	SourceWidth = SourceFrame.cols;
+	SourceHeight = SourceFrame.rows;
+	SourceStep = (int32)SourceFrame.step;
+	Flipped = Flip;
+
+	FString CachePath = FPaths::GameSavedDir() / TEXT("Calibration") / FString::Printf(TEXT("Undistort-%08X.bin"), Key);
+	if (LoadFromCache(CachePath)) {
+		UE_LOG(LogUndistortion, Log, TEXT("Loaded undistortion map from %s"), *CachePath);
+		return true;
+	}
+	double BuildStart = FPlatformTime::Seconds();
+	Build(SourceCameraMatrix, Distortion, ScaleCameraMatrix(CameraParams, DestinationSize));
+	UE_LOG(LogUndistortion, Log, TEXT("Built %dx%d undistortion map in %.1f ms"), Width, Height, (FPlatformTime::Seconds() - BuildStart) * 1000.0);
+	SaveToCache(CachePath);
+	return true;
+}
+
+void UndistortionMap::Build(const cv::Mat& SourceCameraMatrix, const cv::Mat& Distortion, const cv::Mat& DestinationCameraMatrix)
+{
+	AR_TRACE_SCOPE("UndistortionMap::Build");
+	// the destination camera keeps the same field of view, so resampling to the display size comes for free
+	cv::Mat Map1, Map2;
+	cv::initUndistortRectifyMap(SourceCameraMatrix, Distortion, cv::Mat(), DestinationCameraMatrix, cv::Size(Width, Height), CV_16SC2, Map1, Map2);
+	Table.SetNumUninitialized(Width * Height);
+	for (int32 y = 0; y < Height; y++)
+	{
+		const cv::Vec2s* Positions = Map1.ptr<cv::Vec2s>(y);
+		const uint16* Fractions = Map2.ptr<uint16>(y);
+		// the 180 degree rotation for an upside down camera is baked into the table
+		int32 OutputY = Flipped ? Height - 1 - y : y;
+		for (int32 x = 0; x < Width; x++)
+		{
+			int32 OutputX = Flipped ? Width - 1 - x : x;
+			Entry& E = Table[OutputY * Width + OutputX];
+			int32 SourceX = Positions[x][0];
+			int32 SourceY = Positions[x][1];
+			E.Padding = 0;
+			if (SourceX >= 0 && SourceY >= 0 && SourceX < SourceWidth - 1 && SourceY < SourceHeight - 1) {
+				E.SourceOffset = SourceY * SourceStep + SourceX * 3;
+				E.FractionX = Fractions[x] & (cv::INTER_TAB_SIZE - 1);
+				E.FractionY = Fractions[x] >> cv::INTER_BITS;
+			}
+			else {
+				E.SourceOffset = -1;
+				E.FractionX = E.FractionY = 0;
+			}
+		}
+	}
+}
+
+void UndistortionMap::Apply(const cv::Mat& SourceFrame, uint8* Destination) const
+{
+	AR_TRACE_SCOPE("UndistortionMap::Apply");
+	check(SourceFrame.cols == SourceWidth && SourceFrame.rows == SourceHeight && (int32)SourceFrame.step == SourceStep);
+	UndistortRowsBody Body(SourceFrame.data, SourceStep, Table.GetData(), Destination, Width);
+	cv::parallel_for_(cv::Range(0, Height), Body);
+}
+
+bool UndistortionMap::LoadFromCache(const FString& FilePath)
+{
+	MappedFile File;
+	if (!File.Open(FilePath)) return false;
+	const int32 TableBytes = Width * Height * sizeof(Entry);
+	if (File.GetSize() != sizeof(UndistortionCacheHeader) + TableBytes) return false;
+	const UndistortionCacheHeader* Header = (const UndistortionCacheHeader*)File.GetData();
+	if (Header->Magic != UndistortionCacheMagic || Header->Version != UndistortionCacheVersion || Header->Key != Key
+		|| Header->Width != Width || Header->Height != Height || Header->SourceWidth != SourceWidth
+		|| Header->SourceHeight != SourceHeight || Header->SourceStep != SourceStep || Header->Flipped != (Flipped ? 1 : 0)) {
+		return false;
+	}
+	Table.SetNumUninitialized(Width * Height);
+	FMemory::Memcpy(Table.GetData(), File.GetData() + sizeof(UndistortionCacheHeader), TableBytes);
+	return true;
+}
+
+void UndistortionMap::SaveToCache(const FString& FilePath) const
+{
+	UndistortionCacheHeader Header = { UndistortionCacheMagic, UndistortionCacheVersion, Key, Width, Height, SourceWidth, SourceHeight, SourceStep, Flipped ? 1 : 0 };
+	TArray<uint8> Data;
+	Data.Append((const uint8*)&Header, sizeof(Header));
+	Data.Append((const uint8*)Table.GetData(), Table.Num() * sizeof(Entry));
+	if (!FFileHelper::SaveArrayToFile(Data, *FilePath)) {
+		UE_LOG(LogUndistortion, Warning, TEXT("Could not write undistortion map cache %s"), *FilePath);
+	}
+}
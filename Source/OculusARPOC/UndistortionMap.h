@@ -0,0 +1,90 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#pragma once
+
+#include "aruco/cameraparameters.h"
+
+/**
+ * Precomputed lookup table that undistorts a camera frame with its calibration, resamples it to the display resolution,
+ * optionally rotates it by 180 degrees and converts BGR to BGRA, all in a single pass over the output.
+ * Every output pixel stores the byte offset of its top-left source sample and a 5 bit fixed point fraction per axis
+ * (the INTER_BITS precision of OpenCV's CV_16SC2 maps), so applying the table is integer math only.
+ * Tables are expensive to build, so they're cached in Saved/Calibration keyed on the calibration and sizes.
+ */
+class UndistortionMap
+{
+public:
+
+	UndistortionMap();
+
+	/*
+	 Makes sure the table matches the calibration, the source frame layout, the output size and orientation,
+	 loading it from the disk cache or building (and caching) it if it doesn't.  Returns false if the calibration is invalid.
+	 */
+	bool Prepare(const aruco::CameraParameters& CameraParams, const cv::Mat& SourceFrame, cv::Size DestinationSize, bool Flip);
+
+	/*
+	 Writes the undistorted BGRA image to Destination (DestinationSize.width * 4 bytes per row).  Rows are split across worker threads.
+	 */
+	void Apply(const cv::Mat& SourceFrame, uint8* Destination) const;
+
+	bool IsValid() const { return Table.Num() > 0; }
+
+	struct Entry
+	{
+		int32 SourceOffset; // -1 if the sample falls outside the source frame
+		uint8 FractionX;
+		uint8 FractionY;
+		uint16 Padding;
+	};
+
+protected:
+
+	void Build(const cv::Mat& SourceCameraMatrix, const cv::Mat& Distortion, const cv::Mat& DestinationCameraMatrix);
+
+	bool LoadFromCache(const FString& FilePath);
+
+	void SaveToCache(const FString& FilePath) const;
+
+	TArray<Entry> Table;
+
+	uint32 Key;
+
+	int32 Width;
+
+	int32 Height;
+
+	int32 SourceWidth;
+
+	int32 SourceHeight;
+
+	int32 SourceStep;
+
+	bool Flipped;
+};
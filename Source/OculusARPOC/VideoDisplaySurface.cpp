@@ -29,6 +29,8 @@
 #include "OculusARPOC.h"
 #include "Engine.h"
 #include "VideoDisplaySurface.h"
+#include "ARTraceRecorder.h"
+#include "ARPipelineStats.h"
 
 
 AVideoDisplaySurface::AVideoDisplaySurface(const class FPostConstructInitializeProperties& PCIP)
@@ -44,77 +46,21 @@ AVideoDisplaySurface::AVideoDisplaySurface(const class FPostConstructInitializeP
 	PrimaryActorTick.bCanEverTick = true;
 
 	PreferredDistanceInMeters = 10.0;
+	NumUploadBuffers = 3;
+	VideoSourceReady = false;
+	VideoSource = NULL;
 }
 
 //////////////////////////////////////////////////////////////////////////
 // Texture
 
-void AVideoDisplaySurface::UpdateTextureRegions(UTexture2D* Texture, int32 MipIndex, uint32 NumRegions, FUpdateTextureRegion2D* Regions, uint32 SrcPitch, uint32 SrcBpp, uint8* SrcData, bool bFreeData)
-{
-	if (Texture && Texture->Resource)
-	{
-
-		struct FUpdateTextureRegionsData
-		{
-			FTexture2DResource* Texture2DResource;
-			int32 MipIndex;
-			uint32 NumRegions;
-			FUpdateTextureRegion2D* Regions;
-			uint32 SrcPitch;
-			uint32 SrcBpp;
-			uint8* SrcData;
-		};
-
-		FUpdateTextureRegionsData* RegionData = new FUpdateTextureRegionsData;
-
-		RegionData->Texture2DResource = (FTexture2DResource*)Texture->Resource;
-		RegionData->MipIndex = MipIndex;
-		RegionData->NumRegions = NumRegions;
-		RegionData->Regions = Regions;
-		RegionData->SrcPitch = SrcPitch;
-		RegionData->SrcBpp = SrcBpp;
-		RegionData->SrcData = SrcData;
-
-		ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
-			UpdateTextureRegionsData,
-			FUpdateTextureRegionsData*, RegionData, RegionData,
-			bool, bFreeData, bFreeData,
-			{
-				for (uint32 RegionIndex = 0; RegionIndex < RegionData->NumRegions; ++RegionIndex)
-				{
-					int32 CurrentFirstMip = RegionData->Texture2DResource->GetCurrentFirstMip();
-					if (RegionData->MipIndex >= CurrentFirstMip)
-					{
-						RHIUpdateTexture2D(
-							RegionData->Texture2DResource->GetTexture2DRHI(),
-							RegionData->MipIndex - CurrentFirstMip,
-							RegionData->Regions[RegionIndex],
-							RegionData->SrcPitch,
-							RegionData->SrcData
-							+ RegionData->Regions[RegionIndex].SrcY * RegionData->SrcPitch
-							+ RegionData->Regions[RegionIndex].SrcX * RegionData->SrcBpp
-							);
-					}
-				}
-				if (bFreeData)
-				{
-					FMemory::Free(RegionData->Regions);
-					FMemory::Free(RegionData->SrcData);
-				}
-				delete RegionData;
-
-			});
-
-	}
-
-}
-
 void AVideoDisplaySurface::UpdateVideoFrame()
 {
-	uint8* DestinationImageBuffer = (uint8*)VideoFrameData.GetData();
-	VideoSource->GetFrameImage(DestinationImageBuffer);
-	UpdateTextureRegions(VideoTexture, (int32)0, (uint32)1, VideoTextureRegion, (uint32)(4 * VideoSource->GetVideoWidth()), (uint32)4, DestinationImageBuffer, false);
-
+	AR_TRACE_SCOPE("AVideoDisplaySurface::UpdateVideoFrame");
+	// if the render thread hasn't consumed the previous frames yet, the camera frame is picked up next tick
+	IVideoSource* Source = VideoSource;
+	UploadPool.UploadFrame(&UploadSink, [Source](uint8* Buffer) { return Source->GetFrameImage(Buffer); });
+	AR_TRACE_COUNTER("UploadBuffersInFlight", UploadPool.GetNumInFlight());
 }
 
 FVector AVideoDisplaySurface::GetWorldLocationFromPixelCoordinates(FVector2D PixelCoordinates) {
@@ -129,18 +75,45 @@ void AVideoDisplaySurface::BeginPlay()
 void AVideoDisplaySurface::Init(IVideoSource* videoSource)
 {
     this->VideoSource = videoSource;
-	VideoFrameData.Init(FColor::MakeRandomColor(), VideoSource->GetVideoWidth() * VideoSource->GetVideoHeight()); // TODO: avoid hardcoding of image height/width
+	UploadPool.Init(NumUploadBuffers, VideoSource->GetVideoWidth() * VideoSource->GetVideoHeight() * sizeof(FColor));
 	InitVideoMaterialTexture();
+	ShowPlaceholder();
+}
+
+void AVideoDisplaySurface::SetVideoSourceReady(bool Ready)
+{
+	VideoSourceReady = Ready;
+}
+
+void AVideoDisplaySurface::ShowPlaceholder()
+{
+	int32 BufferIndex = UploadPool.AcquireWriteBuffer();
+	if (BufferIndex == INDEX_NONE) return;
+	uint16 Width = VideoSource->GetVideoWidth();
+	uint16 Height = VideoSource->GetVideoHeight();
+	FColor* Pixels = (FColor*)UploadPool.GetBuffer(BufferIndex);
+	for (int32 y = 0; y < Height; y++) {
+		for (int32 x = 0; x < Width; x++) {
+			uint8 Grey = ((x / 64 + y / 64) & 1) ? 0x30 : 0x20;
+			*Pixels++ = FColor(Grey, Grey, Grey, 0xFF);
+		}
+	}
+	UploadPool.Submit(BufferIndex, &UploadSink);
 }
 
 void AVideoDisplaySurface::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	VideoSource->Close();
+	FlushRenderingCommands(); // no upload may still reference the pool once the actor goes away
+	if (VideoSourceReady) { // otherwise the source still belongs to the initialization thread
+		VideoSource->Close();
+	}
 }
 
 void AVideoDisplaySurface::Tick(float DeltaTime)
 {
-	UpdateVideoFrame();
+	if (VideoSourceReady) {
+		UpdateVideoFrame();
+	}
 }
 
 void AVideoDisplaySurface::InitVideoMaterialTexture()
@@ -175,7 +148,7 @@ void AVideoDisplaySurface::InitVideoMaterialTexture()
                 VideoTexture = UTexture2D::CreateTransient(VideoSource->GetVideoWidth(), VideoSource->GetVideoHeight());
                 VideoTexture->UpdateResource();
                 VideoMaterial->SetTextureParameterValue(FName("VideoTexture"), VideoTexture);
-                VideoTextureRegion = new FUpdateTextureRegion2D(0, 0, 0, 0, VideoSource->GetVideoWidth(), VideoSource->GetVideoHeight());  // Note: This never gets freed
+                UploadSink.Init(VideoTexture, VideoSource->GetVideoWidth(), VideoSource->GetVideoHeight());
                 break;
 			}
 		}
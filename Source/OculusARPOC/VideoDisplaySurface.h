@@ -31,6 +31,8 @@
 
 #include "GameFramework/Actor.h"
 #include "IVideoSource.h"
+#include "TextureUploadPool.h"
+#include "Texture2DUploadSink.h"
 #include "VideoDisplaySurface.generated.h"
 
 /**
@@ -61,14 +63,14 @@ public:
 
     void Init(IVideoSource* VideoSource);
 
+    /** Until the source is ready (it is opened asynchronously) the surface shows a placeholder and doesn't pull frames */
+    void SetVideoSourceReady(bool Ready);
+
 protected:
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AugmentedReality)
     UTexture2D* VideoTexture;
 
-	/** Update texture region from https://wiki.unrealengine.com/Dynamic_Textures */
-	void UpdateTextureRegions(UTexture2D* Texture, int32 MipIndex, uint32 NumRegions, FUpdateTextureRegion2D* Regions, uint32 SrcPitch, uint32 SrcBpp, uint8* SrcData, bool bFreeData);
-
 	//UFUNCTION(BlueprintCallable, Category = AugmentedReality)
     //void CreateVideoTexture();
 
@@ -83,12 +85,19 @@ protected:
 
 	void InitVideoMaterialTexture();
 
+	/** Uploads a neutral checkerboard so the surface isn't black or garbage while the camera comes up */
+	void ShowPlaceholder();
+
+	bool VideoSourceReady;
+
 	FVector GetWorldLocationFromPixelCoordinates(FVector2D PixelCoordinates);
 		
-	UPROPERTY()
-	TArray<FColor> VideoFrameData;
+	/** Number of staging buffers shared with the render thread; with 3 the game thread keeps writing while the render thread is up to two frames behind */
+	int32 NumUploadBuffers;
+
+	TextureUploadPool UploadPool;
 
-	FUpdateTextureRegion2D *VideoTextureRegion;
+	Texture2DUploadSink UploadSink;
 
 	UMaterialInstanceDynamic *VideoMaterial;
 
@@ -39,6 +39,7 @@ namespace aruco {
     */
     BoardConfiguration::BoardConfiguration() {
         mInfoType=NONE;
+        _indexedSize=0;
     }
     /**
     *
@@ -46,6 +47,7 @@ namespace aruco {
     */
     BoardConfiguration::BoardConfiguration ( string filePath )  {
         mInfoType=NONE;
+        _indexedSize=0;
         readFromFile ( filePath );
     }
     /**
@@ -55,6 +57,8 @@ namespace aruco {
     BoardConfiguration::BoardConfiguration ( const BoardConfiguration  &T ) : vector<MarkerInfo> ( T ) {
 //     MarkersInfo=T.MarkersInfo;
         mInfoType=T.mInfoType;
+        _idIndex=T._idIndex;
+        _indexedSize=T._indexedSize;
     }
 
     /**
@@ -65,6 +69,8 @@ namespace aruco {
 //     MarkersInfo=T.MarkersInfo;
         vector<MarkerInfo>::operator= ( T );
         mInfoType=T.mInfoType;
+        _idIndex=T._idIndex;
+        _indexedSize=T._indexedSize;
         return *this;
     }
     /**
@@ -134,14 +140,30 @@ namespace aruco {
                 at ( i ).push_back ( point );
             }
         }
+        updateIdIndex();
 		
     }
 
     /**
      */
-    int BoardConfiguration::getIndexOfMarkerId ( int id ) const
+    void BoardConfiguration::updateIdIndex()
     {
+        _idIndex.assign ( MAX_INDEXED_ID,-1 );
+        _indexedSize=size();
+        for ( size_t i=0; i<size(); i++ )
+            if ( at ( i ).id>=0 && at ( i ).id<MAX_INDEXED_ID && _idIndex[at ( i ).id]==-1 ) _idIndex[at ( i ).id]=i;
+    }
 
+    /**
+     */
+    int BoardConfiguration::getIndexOfMarkerId ( int id ) const
+    {
+        //the index is only trusted while the list keeps the size it was built for and the hit checks out
+        if ( id>=0 && id<MAX_INDEXED_ID && _indexedSize==size() && !_idIndex.empty() ) {
+            int idx=_idIndex[id];
+            if ( idx==-1 ) return -1;
+            if ( at ( idx ).id==id ) return idx;
+        }
         for ( size_t i=0; i<size(); i++ )
             if ( at ( i ).id==id ) return i;
         return -1;
@@ -150,8 +172,8 @@ namespace aruco {
     /**
      */
     const MarkerInfo& BoardConfiguration::getMarkerInfo ( int id ) const  {
-        for ( size_t i=0; i<size(); i++ )
-            if ( at ( i ).id ==id ) return at ( i );
+        int idx=getIndexOfMarkerId ( id );
+        if ( idx!=-1 ) return at ( idx );
         throw cv::Exception ( 111,"BoardConfiguration::getMarkerInfo","Marker with the id given is not found",__FILE__,__LINE__ );
 
     }
@@ -107,6 +107,12 @@ public:
     /**Returns the index of the marker with id indicated, if is in the list
      */
     int getIndexOfMarkerId(int id)const;
+    /**Rebuilds the id->index table that makes getIndexOfMarkerId and getMarkerInfo O(1).
+     * Called by readFromFile; call it again after adding or removing markers directly
+     */
+    void updateIdIndex();
+    //ids below this value are looked up in the dense index, others with a linear search
+    static const int MAX_INDEXED_ID=1024;
     /**Returns the Info of the marker with id specified. If not in the set, throws exception
      */
     const MarkerInfo& getMarkerInfo(int id)const;
@@ -120,6 +126,9 @@ private:
     /**Reads board info from a file
     */
     void readFromFile(cv::FileStorage &fs);
+    //_idIndex[id] is the index of the marker with that id, or -1
+    vector<int> _idIndex;
+    size_t _indexedSize;
 };
 
 /**
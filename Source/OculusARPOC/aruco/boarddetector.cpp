@@ -33,6 +33,7 @@ or implied, of Rafael Muñoz Salinas.
 #include <ctime>
 #include <cassert>
 #include <fstream>
+#include <limits>
 #include <opencv2/calib3d/calib3d.hpp>
 using namespace std;
 using namespace cv;
@@ -43,6 +44,7 @@ namespace aruco {
         _setYPerpendicular=setYPerpendicular;
         _areParamsSet=false;
         repj_err_thres=-1;
+        _lastReprjErr=-1;
     }
     /**
        * Use if you plan to let this class to perform marker detection too
@@ -88,121 +90,196 @@ namespace aruco {
     *
     */
     float BoardDetector::detect ( const vector<Marker> &detectedMarkers,const  BoardConfiguration &BConf, Board &Bdetected, Mat camMatrix,Mat distCoeff,float markerSizeMeters )  {
+        //the Marker api: the markers are converted, the board detected on records and its markers converted back
+        _recordsIn.resize ( detectedMarkers.size() );
+        for ( size_t i=0; i<detectedMarkers.size(); i++ ) fromMarker ( detectedMarkers[i],_recordsIn[i] );
+        float prob=detect ( _recordsIn,BConf,_recordsOut,Bdetected.Rvec,Bdetected.Tvec,camMatrix,distCoeff,markerSizeMeters );
+        toMarkers ( _recordsOut,Bdetected );
+        //copy configuration, unless the board already holds it (the copy allocates every marker)
+        if ( !isSameConfiguration ( Bdetected.conf,BConf ) ) Bdetected.conf=BConf;
+        return prob;
+    }
+    /**
+    *
+    *
+    */
+    float BoardDetector::detect ( const vector<MarkerRecord> &detectedMarkers,const  BoardConfiguration &BConf, vector<MarkerRecord> &boardMarkers,cv::Mat &Rvec,cv::Mat &Tvec,const CameraParameters &cp, float markerSizeMeters,const vector<int> *confIndices )  {
+        return detect ( detectedMarkers, BConf,boardMarkers,Rvec,Tvec,cp.CameraMatrix,cp.Distorsion,markerSizeMeters,confIndices );
+    }
+    /**
+    *
+    *
+    */
+    float BoardDetector::detect ( const vector<MarkerRecord> &detectedMarkers,const  BoardConfiguration &BConf, vector<MarkerRecord> &boardMarkers,cv::Mat &Rvec,cv::Mat &Tvec, Mat camMatrix,Mat distCoeff,float markerSizeMeters,const vector<int> *confIndices )  {
         if ( BConf.size() ==0 ) throw cv::Exception ( 8881,"BoardDetector::detect","Invalid BoardConfig that is empty",__FILE__,__LINE__ );
         if ( BConf[0].size() <2 ) throw cv::Exception ( 8881,"BoardDetector::detect","Invalid BoardConfig that is empty 2",__FILE__,__LINE__ );
+        int trackKey=BConf[0].id;//identifies the board in the pose tracker
+        _tracker.newFrame();//boards not seen for a while are dropped from the tracker
         //compute the size of the markers in meters, which is used for some routines(mostly drawing)
-        float ssize;
+        float ssize=-1;
         if ( BConf.mInfoType==BoardConfiguration::PIX && markerSizeMeters>0 ) ssize=markerSizeMeters;
         else if ( BConf.mInfoType==BoardConfiguration::METERS ) {
             ssize=cv::norm ( BConf[0][0]-BConf[0][1] );
         }
-		
-        // cout<<"markerSizeMeters="<<markerSizeMeters<<endl;
-        Bdetected.clear();
-        ///find among detected markers these that belong to the board configuration
+        _lastReprjErr=-1;
+
+        ///find among detected markers these that belong to the board configuration (O(1) per marker through the id index),
+        ///unless the caller already did
+        boardMarkers.clear();
+        _confIndices.clear();
         for ( unsigned int i=0; i<detectedMarkers.size(); i++ ) {
-            int idx=BConf.getIndexOfMarkerId ( detectedMarkers[i].id );
+            int idx=confIndices!=NULL? ( *confIndices ) [i]:BConf.getIndexOfMarkerId ( detectedMarkers[i].id );
             if ( idx!=-1 ) {
-                Bdetected.push_back ( detectedMarkers[i] );
-                Bdetected.back().ssize=ssize;
+                boardMarkers.push_back ( detectedMarkers[i] );
+                boardMarkers.back().ssize=ssize;
+                _confIndices.push_back ( idx );
             }
         }
-        //copy configuration
-        Bdetected.conf=BConf;
-//
-		
         bool hasEnoughInfoForRTvecCalculation=false;
-        if ( Bdetected.size() >=1 ) {
+        if ( boardMarkers.size() >=1 ) {
             if ( camMatrix.rows!=0 ) {
                 if ( markerSizeMeters>0 && BConf.mInfoType==BoardConfiguration::PIX ) hasEnoughInfoForRTvecCalculation=true;
                 else if ( BConf.mInfoType==BoardConfiguration::METERS ) hasEnoughInfoForRTvecCalculation=true;
             }
         }
-		
+
 //calculate extrinsic if there is information for that
         if ( hasEnoughInfoForRTvecCalculation ) {
-			
+
             //calculate the size of the markers in meters if expressed in pixels
             double marker_meter_per_pix=0;
             if ( BConf.mInfoType==BoardConfiguration::PIX ) marker_meter_per_pix=markerSizeMeters /  cv::norm ( BConf[0][0]-BConf[0][1] );
             else marker_meter_per_pix=1;//to avoind interferring the process below
 
-            // now, create the matrices for finding the extrinsics
-			vector<cv::Point3f>* objPoints = new vector<cv::Point3f>();
-			vector<cv::Point2f>* imagePoints = new vector<cv::Point2f>();
-            for ( size_t i=0; i<Bdetected.size(); i++ ) {
-                int idx=Bdetected.conf.getIndexOfMarkerId ( Bdetected[i].id );
-                assert ( idx!=-1 );
+            // now, fill the (reused) correspondence buffers, 4 consecutive points per marker
+            _objPoints.clear();
+            _imagePoints.clear();
+            for ( size_t i=0; i<boardMarkers.size(); i++ ) {
+                const aruco::MarkerInfo &Minfo=BConf[_confIndices[i]];
                 for ( int p=0; p<4; p++ ) {
-                    (*imagePoints).push_back ( Bdetected[i][p] );
-                    const aruco::MarkerInfo &Minfo=Bdetected.conf.getMarkerInfo ( Bdetected[i].id );
-                    (*objPoints).push_back ( Minfo[p]*marker_meter_per_pix );
-//  		cout<<objPoints.back()<<endl;
+                    _imagePoints.push_back ( boardMarkers[i].corner ( p ) );
+                    _objPoints.push_back ( Minfo[p]*marker_meter_per_pix );
                 }
             }
-			
+
             if ( distCoeff.total() ==0 ) distCoeff=cv::Mat::zeros ( 1,4,CV_32FC1 );
 
-// 	    for(size_t i=0;i< imagePoints.size();i++){
-// 		cout<<objPoints[i]<<" "<<imagePoints[i]<<endl;
-// 	    }
-// 	    cout<<"cam="<<camMatrix<<" "<<distCoeff<<endl;
-            cv::Mat rvec,tvec;
-            cv::solvePnP ( *objPoints,*imagePoints,camMatrix,distCoeff,rvec,tvec );
-            rvec.convertTo ( Bdetected.Rvec,CV_32FC1 );
-            tvec.convertTo ( Bdetected.Tvec,CV_32FC1 );
-//             cout<<rvec<< " "<<tvec<<" _setYPerpendicular="<<_setYPerpendicular<<endl;
-			
-            {
-				vector<cv::Point2f>* reprojected = new vector<cv::Point2f>();
-                cv::projectPoints ( *objPoints,rvec,tvec,camMatrix,distCoeff,*reprojected );
-                double errSum=0;
-                //check now the reprojection error and
-                for ( size_t i=0; i<(*reprojected).size(); i++ ) {
-                    errSum+=cv::norm ( (*reprojected)[i]-(*imagePoints)[i] );
+            if ( repj_err_thres>0 && boardMarkers.size() >=2 ) {
+                //robust estimation: a pose hypothesis from each single marker, keep the one most markers agree with,
+                //then refine on the inlier markers only
+                //the previous frame's pose is tried first: if every marker agrees with it, no hypotheses are needed
+                int bestInliers=0;
+                double bestErr=std::numeric_limits<double>::max();
+                if ( _tracker.getPose ( trackKey,_rvec,_tvec ) ) {
+                    bestInliers=classifyMarkers ( camMatrix,distCoeff,_rvec,_tvec,_markerIsInlier,bestErr );
+                    if ( bestInliers<int ( boardMarkers.size() ) ) {
+                        bestInliers=0;
+                        bestErr=std::numeric_limits<double>::max();
+                    }
                 }
-//                  cout<<"AAA RE="<<errSum/double ( reprojected.size() ) <<endl;
-
-            }
-			
-            //now, do a refinement and remove points whose reprojection error is above a threshold, then repeat calculation with the rest
-            if ( repj_err_thres>0 ) {
-				vector<cv::Point2f>* reprojected = new vector<cv::Point2f>();
-                cv::projectPoints ( *objPoints,rvec,tvec,camMatrix,distCoeff,*reprojected );
-
-                vector<int> pointsThatPassTest;//indices
-                //check now the reprojection error and
-                for ( size_t i=0; i<(*reprojected).size(); i++ ) {
-                    float err=cv::norm ( (*reprojected)[i]-(*imagePoints)[i] );
-                    if ( err<repj_err_thres ) pointsThatPassTest.push_back ( i );
+                for ( size_t h=0; h<boardMarkers.size() && bestInliers<int ( boardMarkers.size() ); h++ ) {
+                    _objSample.assign ( _objPoints.begin() +4*h,_objPoints.begin() +4*h+4 );
+                    _imageSample.assign ( _imagePoints.begin() +4*h,_imagePoints.begin() +4*h+4 );
+                    if ( !cv::solvePnP ( _objSample,_imageSample,camMatrix,distCoeff,_rvecHyp,_tvecHyp,false,CV_P3P ) ) continue;
+                    double err;
+                    int nInliers=classifyMarkers ( camMatrix,distCoeff,_rvecHyp,_tvecHyp,_markerIsInlierHyp,err );
+                    if ( nInliers>bestInliers || ( nInliers==bestInliers && err<bestErr ) ) {
+                        bestInliers=nInliers;
+                        bestErr=err;
+                        _rvecHyp.copyTo ( _rvec );
+                        _tvecHyp.copyTo ( _tvec );
+                        _markerIsInlier.swap ( _markerIsInlierHyp );
+                    }
                 }
-                //cout<<"Number of points after reprjection test "<<pointsThatPassTest.size() <<"/"<<objPoints.size() <<endl;
-                //copy these data to another vectors and repeat
-				vector<cv::Point3f>* objPoints_filtered = new vector<cv::Point3f>();
-				vector<cv::Point2f>* imagePoints_filtered = new vector<cv::Point2f>();
-                for ( size_t i=0; i<pointsThatPassTest.size(); i++ ) {
-                    (*objPoints_filtered).push_back ( (*objPoints)[pointsThatPassTest[i] ] );
-                    (*imagePoints_filtered).push_back ( (*imagePoints)[pointsThatPassTest[i] ] );
+                if ( bestInliers==0 ) {
+                    boardMarkers.clear();
+                    return 0;
                 }
-
-                cv::solvePnP ( *objPoints,*imagePoints,camMatrix,distCoeff,rvec,tvec );
-                rvec.convertTo ( Bdetected.Rvec,CV_32FC1 );
-                tvec.convertTo ( Bdetected.Tvec,CV_32FC1 );
+                //refine with the inliers, starting from the best hypothesis; a second pass picks up markers the refined pose explains
+                for ( int pass=0; pass<2; pass++ ) {
+                    gatherInliers();
+                    if ( _objSample.size() <4 ) {//the refined pose explains no marker: nothing left to solve with
+                        boardMarkers.clear();
+                        return 0;
+                    }
+                    cv::solvePnP ( _objSample,_imageSample,camMatrix,distCoeff,_rvec,_tvec,true,CV_ITERATIVE );
+                    _markerIsInlierHyp=_markerIsInlier;
+                    classifyMarkers ( camMatrix,distCoeff,_rvec,_tvec,_markerIsInlier,_lastReprjErr );
+                    if ( _markerIsInlier==_markerIsInlierHyp ) break;
+                }
+                //outlier markers are not part of the detected board
+                size_t n=0;
+                for ( size_t i=0; i<boardMarkers.size(); i++ )
+                    if ( _markerIsInlier[i] ) {
+                        if ( n!=i ) boardMarkers[n]=boardMarkers[i];
+                        n++;
+                    }
+                boardMarkers.resize ( n );
+                if ( n==0 ) return 0;
+                _tracker.setPose ( trackKey,_rvec,_tvec );
+            } else {
+                _tracker.estimate ( trackKey,_objPoints,_imagePoints,camMatrix,distCoeff,_rvec,_tvec );
+                classifyMarkers ( camMatrix,distCoeff,_rvec,_tvec,_markerIsInlier,_lastReprjErr );
             }
+            _rvec.convertTo ( Rvec,CV_32FC1 );
+            _tvec.convertTo ( Tvec,CV_32FC1 );
 
-			
             //now, rotate 90 deg in X so that Y axis points up
             if ( _setYPerpendicular )
-                rotateXAxis ( Bdetected.Rvec );
-//         cout<<Bdetected.Rvec.at<float>(0,0)<<" "<<Bdetected.Rvec.at<float>(1,0)<<" "<<Bdetected.Rvec.at<float>(2,0)<<endl;
-//         cout<<Bdetected.Tvec.at<float>(0,0)<<" "<<Bdetected.Tvec.at<float>(1,0)<<" "<<Bdetected.Tvec.at<float>(2,0)<<endl;
-		
-		}
-		
-        float prob=float ( Bdetected.size() ) /double ( Bdetected.conf.size() );
+                rotateXAxis ( Rvec );
+        }
+
+        float prob=float ( boardMarkers.size() ) /double ( BConf.size() );
         return prob;
-		
-		//return 0.f;
+    }
+
+    /**Projects all the board points with the pose given and marks as inliers the markers whose mean corner error is
+     * below repj_err_thres (all markers if there is no threshold). Returns the number of inliers and, in meanErr,
+     * their mean reprojection error in pixels
+     */
+    int BoardDetector::classifyMarkers ( const cv::Mat &camMatrix,const cv::Mat &distCoeff,const cv::Mat &rvec,const cv::Mat &tvec,vector<char> &isInlier,double &meanErr ) {
+        cv::projectPoints ( _objPoints,rvec,tvec,camMatrix,distCoeff,_reprojected );
+        size_t nMarkers=_imagePoints.size() /4;
+        isInlier.resize ( nMarkers );
+        int nInliers=0;
+        double errSum=0;
+        for ( size_t m=0; m<nMarkers; m++ ) {
+            double err=0;
+            for ( int p=0; p<4; p++ ) err+=cv::norm ( _reprojected[4*m+p]-_imagePoints[4*m+p] );
+            err/=4;
+            isInlier[m]= ( repj_err_thres<=0 || err<repj_err_thres );
+            if ( isInlier[m] ) {
+                nInliers++;
+                errSum+=err;
+            }
+        }
+        meanErr=nInliers>0?errSum/nInliers:std::numeric_limits<double>::max();
+        return nInliers;
+    }
+
+    /**Copies the correspondences of the inlier markers into the sample buffers
+     */
+    void BoardDetector::gatherInliers() {
+        _objSample.clear();
+        _imageSample.clear();
+        for ( size_t m=0; m<_markerIsInlier.size(); m++ ) {
+            if ( !_markerIsInlier[m] ) continue;
+            _objSample.insert ( _objSample.end(),_objPoints.begin() +4*m,_objPoints.begin() +4*m+4 );
+            _imageSample.insert ( _imageSample.end(),_imagePoints.begin() +4*m,_imagePoints.begin() +4*m+4 );
+        }
+    }
+
+    /**Indicates whether the two configurations hold the same markers, so the copy can be skipped
+     */
+    bool BoardDetector::isSameConfiguration ( const BoardConfiguration &a,const BoardConfiguration &b ) {
+        if ( &a==&b ) return true;
+        if ( a.size() !=b.size() || a.mInfoType!=b.mInfoType ) return false;
+        for ( size_t i=0; i<a.size(); i++ ) {
+            if ( a[i].id!=b[i].id || a[i].size() !=b[i].size() ) return false;
+            for ( size_t p=0; p<a[i].size(); p++ )
+                if ( a[i][p]!=b[i][p] ) return false;
+        }
+        return true;
     }
 
     void BoardDetector::rotateXAxis ( Mat &rotation ) {
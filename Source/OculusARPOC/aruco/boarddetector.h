@@ -32,6 +32,7 @@ or implied, of Rafael Muñoz Salinas.
 #include "board.h"
 #include "cameraparameters.h"
 #include "markerdetector.h"
+#include "posetracker.h"
 using namespace std;
 
 namespace aruco
@@ -107,6 +108,20 @@ public:
     */
     float detect(const vector<Marker> &detectedMarkers,const  BoardConfiguration &BConf, Board &Bdetected, cv::Mat camMatrix=cv::Mat(),cv::Mat distCoeff=cv::Mat(), float markerSizeMeters=-1 );
     float detect(const vector<Marker> &detectedMarkers,const  BoardConfiguration &BConf, Board &Bdetected,const CameraParameters &cp, float markerSizeMeters=-1 );
+    /** Same as above on MarkerRecords, which is what the versions taking Markers convert to. Once the buffers of this object
+    * and the output vector have grown, it does no allocation of its own (solvePnP still does).
+    * @param boardMarkers output markers of the board (outliers removed), with ssize set
+    * @param Rvec,Tvec output pose of the board (3x1 CV_32F), left untouched if there is no pose
+    * @param confIndices if given, the index in BConf of each of detectedMarkers, which must then all be on the board
+    * (for callers that already looked the markers up); otherwise they are looked up here
+    */
+    float detect(const vector<MarkerRecord> &detectedMarkers,const  BoardConfiguration &BConf, vector<MarkerRecord> &boardMarkers,cv::Mat &Rvec,cv::Mat &Tvec,const CameraParameters &cp, float markerSizeMeters=-1,const vector<int> *confIndices=NULL );
+    float detect(const vector<MarkerRecord> &detectedMarkers,const  BoardConfiguration &BConf, vector<MarkerRecord> &boardMarkers,cv::Mat &Rvec,cv::Mat &Tvec,cv::Mat camMatrix=cv::Mat(),cv::Mat distCoeff=cv::Mat(), float markerSizeMeters=-1,const vector<int> *confIndices=NULL );
+    /**Every call to detect counts as a frame for the pose history, which is dropped after a few frames without the board.
+     * Callers that don't call detect when none of the board's markers are seen tell here how many frames went by,
+     * so a board seen again later is not warm-started from a stale pose
+     */
+    void newFrame(int frames=1){_tracker.newFrame(frames);}
 
      /**Static version (all in one). Detects the board indicated
     * @param Image input image
@@ -126,16 +141,24 @@ public:
     void setYPerperdicular(bool enable){ setYPerpendicular(enable); } // TODO mark as deprecated
     bool isYPerpendicular(){ return _setYPerpendicular; }
     
-    /**Sets the threshold for reprjection test. Pixels that after  estimating the camera location
-     * projects 'repj_err_thres' pixels farther from its original location are discarded as outliers.
+    /**Sets the threshold for reprjection test. Markers whose corners, after estimating the camera location,
+     * project on average 'repj_err_thres' pixels farther from their detected location are discarded as outliers.
+     * When set, the pose is estimated robustly: every detected board marker yields a pose hypothesis, the one
+     * most markers agree with is kept and the pose is refined with its inliers only.
      * By default it is set to -1, meaning that not reprojection test is performed
      */
     void set_repj_err_thres(float Repj_err_thres){repj_err_thres=Repj_err_thres;}
     float get_repj_err_thres  ( )const {return repj_err_thres;}
+    /**Mean reprojection error in pixels of the markers used for the last pose, -1 if no pose was computed
+     */
+    double getLastReprojectionError()const {return _lastReprjErr;}
     
     
 private:
     void rotateXAxis(cv::Mat &rotation);
+    int classifyMarkers(const cv::Mat &camMatrix,const cv::Mat &distCoeff,const cv::Mat &rvec,const cv::Mat &tvec,vector<char> &isInlier,double &meanErr);
+    void gatherInliers();
+    static bool isSameConfiguration(const BoardConfiguration &a,const BoardConfiguration &b);
     bool _setYPerpendicular;
     
     //-- Functionality to detect markers inside
@@ -146,6 +169,16 @@ private:
     CameraParameters _camParams;
     MarkerDetector _mdetector;//internal markerdetector
     vector<Marker> _vmarkers;//markers detected in the call to : float  detect(const cv::Mat &im);
+    vector<MarkerRecord> _recordsIn,_recordsOut;//conversion of the Marker versions of detect
+
+    //-- buffers reused between calls so the pose estimation doesn't allocate once warmed up
+    vector<int> _confIndices;//index in the configuration of each marker of the detected board
+    vector<cv::Point3f> _objPoints,_objSample;
+    vector<cv::Point2f> _imagePoints,_imageSample,_reprojected;
+    vector<char> _markerIsInlier,_markerIsInlierHyp;
+    cv::Mat _rvec,_tvec,_rvecHyp,_tvecHyp;
+    double _lastReprjErr;
+    PoseTracker _tracker;//pose of each board in the previous frames, used as starting point
     
 };
 
@@ -296,10 +296,41 @@ void Marker::calculateExtrinsics(float markerSizeMeters,cv::Mat  camMatrix,cv::M
     //rotate the X axis so that Y is perpendicular to the marker plane
    if (setYPerpendicular) rotateXAxis(Rvec);
     ssize=markerSizeMeters; 
-    cout<<(*this)<<endl;
-    
 }
 
+/**
+ */
+void Marker::calculateExtrinsics(float markerSizeMeters,const CameraParameters &CP,PoseTracker &tracker,bool setYPerpendicular)
+{
+    if (!isValid()) throw cv::Exception(9004,"!isValid(): invalid marker. It is not possible to calculate extrinsics","calculateExtrinsics",__FILE__,__LINE__);
+    if (markerSizeMeters<=0)throw cv::Exception(9004,"markerSize<=0: invalid markerSize","calculateExtrinsics",__FILE__,__LINE__);
+    if (!CP.isValid()) throw cv::Exception(9004,"!CP.isValid(): invalid camera parameters. It is not possible to calculate extrinsics","calculateExtrinsics",__FILE__,__LINE__);
+
+    //same corner order as the untracked version
+    float halfSize=markerSizeMeters/2.f;
+    vector<cv::Point3f> objPoints(4);
+    objPoints[0]=cv::Point3f(-halfSize,-halfSize,0);
+    objPoints[1]=cv::Point3f(-halfSize,halfSize,0);
+    objPoints[2]=cv::Point3f(halfSize,halfSize,0);
+    objPoints[3]=cv::Point3f(halfSize,-halfSize,0);
+
+    cv::Mat raux,taux;
+    tracker.estimate(id,objPoints,*this,CP.CameraMatrix,CP.Distorsion,raux,taux);
+    raux.convertTo(Rvec,CV_32F);
+    taux.convertTo(Tvec,CV_32F);
+    if (setYPerpendicular) rotateXAxis(Rvec);
+    ssize=markerSizeMeters;
+}
+
+/**
+ */
+void Marker::setExtrinsics(const cv::Mat &rvec,const cv::Mat &tvec,float markerSizeMeters,bool setYPerpendicular)
+{
+    rvec.convertTo(Rvec,CV_32F);
+    tvec.convertTo(Tvec,CV_32F);
+    if (setYPerpendicular) rotateXAxis(Rvec);
+    ssize=markerSizeMeters;
+}
 
 /**
 */
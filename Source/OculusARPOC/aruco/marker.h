@@ -32,6 +32,7 @@ or implied, of Rafael Muñoz Salinas.
 #include <opencv2/core/core.hpp>
 #include "exports.h"
 #include "cameraparameters.h"
+#include "posetracker.h"
 using namespace std;
 namespace aruco {
 /**\brief This class represents a marker. It is a vector of the fours corners ot the marker
@@ -74,6 +75,14 @@ public:
      * @param setYPerpendicular If set the Y axis will be perpendicular to the surface. Otherwise, it will be the Z axis
      */
     void calculateExtrinsics(float markerSize,const CameraParameters &CP,bool setYPerpendicular=true);
+    /**Calculates the extrinsics starting from the pose the tracker has for this marker id in the previous frames
+     * (see PoseTracker), which is faster and temporally stable
+     * @param markerSize size of the marker side expressed in meters
+     * @param CP parmeters of the camera
+     * @param tracker keeps the poses between frames
+     * @param setYPerpendicular If set the Y axis will be perpendicular to the surface. Otherwise, it will be the Z axis
+     */
+    void calculateExtrinsics(float markerSize,const CameraParameters &CP,PoseTracker &tracker,bool setYPerpendicular=true);
     /**Calculates the extrinsics (Rvec and Tvec) of the marker with respect to the camera
      * @param markerSize size of the marker side expressed in meters
      * @param CameraMatrix matrix with camera parameters (fx,fy,cx,cy)
@@ -81,6 +90,12 @@ public:
      * @param setYPerpendicular If set the Y axis will be perpendicular to the surface. Otherwise, it will be the Z axis
      */
     void calculateExtrinsics(float markerSize,cv::Mat  CameraMatrix,cv::Mat Distorsion=cv::Mat(),bool setYPerpendicular=true);
+    /**Sets the extrinsics from a pose computed elsewhere (e.g. from the pose of a group of markers)
+     * @param rvec,tvec pose of the marker as returned by solvePnP for the corners used by calculateExtrinsics
+     * @param markerSize size of the marker side expressed in meters
+     * @param setYPerpendicular If set the Y axis will be perpendicular to the surface. Otherwise, it will be the Z axis
+     */
+    void setExtrinsics(const cv::Mat &rvec,const cv::Mat &tvec,float markerSize,bool setYPerpendicular=true);
     
     /**Given the extrinsic camera parameters returns the GL_MODELVIEW matrix for opengl.
      * Setting this matrix, the reference coordinate system will be set in this marker
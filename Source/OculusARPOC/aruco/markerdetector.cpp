@@ -37,6 +37,7 @@ or implied, of Rafael Muñoz Salinas.
 #include "arucofidmarkers.h"
 #include <valarray>
 #include "ar_omp.h"
+#include "ARTraceRecorder.h"
 using namespace std;
 using namespace cv;
   
@@ -58,6 +59,7 @@ MarkerDetector::MarkerDetector()
     _speed=0;
     markerIdDetector_ptrfunc=aruco::FiducidalMarkers::detect;
     pyrdown_level=0; // no image reduction
+    _candidatesValid=false;
     _minSize=0.04;
     _maxSize=0.5;
 
@@ -116,25 +118,63 @@ void MarkerDetector::detect ( const  cv::Mat &input,std::vector<Marker> &detecte
 }
 
 
+//returns the milliseconds elapsed since tick, and restarts it
+static double lapMs ( int64 &tick )
+{
+    int64 now=cv::getTickCount();
+    double ms=double ( now-tick ) *1000./cv::getTickFrequency();
+    tick=now;
+    return ms;
+}
+
 /************************************
  *
- * Main detection function. Performs all steps
- *
+ * Main detection function with the legacy Marker type. The detection itself is done on MarkerRecord,
+ * the markers are only converted at the end
  *
  ************************************/
 void MarkerDetector::detect ( const  cv::Mat &input,vector<Marker> &detectedMarkers,Mat camMatrix ,Mat distCoeff ,float markerSizeMeters ,bool setYPerpendicular) 
 {
+    detect ( input,_records,camMatrix,distCoeff );
+    toMarkers ( _records,detectedMarkers );
+    ///detect the position of detected markers if desired
+    if ( camMatrix.rows!=0  && markerSizeMeters>0 )
+    {
+        for ( unsigned int i=0;i<detectedMarkers.size();i++ )
+            detectedMarkers[i].calculateExtrinsics ( markerSizeMeters,camMatrix,distCoeff,setYPerpendicular );
+    }
+}
+
+static bool recordIdLess ( const MarkerRecord &a,const MarkerRecord &b )
+{
+    return a.id<b.id;
+}
 
+/************************************
+ *
+ * Main detection function. Performs all steps
+ *
+ *
+ ************************************/
+void MarkerDetector::detect ( const  cv::Mat &input,vector<MarkerRecord> &detectedMarkers,const Mat &camMatrix ,const Mat &distCoeff ) 
+{
+    AR_TRACE_SCOPE("MarkerDetector::detect");
+    int64 tick=cv::getTickCount();
 	
     //it must be a 3 channel image
-    if ( input.type() ==CV_8UC3 )   cv::cvtColor ( input,grey,CV_BGR2GRAY );
-    else     grey=input;
+    {
+        AR_TRACE_SCOPE("Grey");
+        if ( input.type() ==CV_8UC3 )   cv::cvtColor ( input,grey,CV_BGR2GRAY );
+        else     grey=input;
+    }
+    _times.grey=lapMs ( tick );
 
 
 //     cv::cvtColor(grey,_ssImC ,CV_GRAY2BGR); //DELETE
 
     //clear input data
     detectedMarkers.clear();
+    _candidatesValid=false;
 
 	
     cv::Mat imgToBeThresHolded=grey;
@@ -151,129 +191,177 @@ void MarkerDetector::detect ( const  cv::Mat &input,vector<Marker> &detectedMark
         }
         int red_den=pow ( 2.0f,pyrdown_level );
         imgToBeThresHolded=reduced;
-        ThresParam1/=float ( red_den );
-        ThresParam2/=float ( red_den );
+        //the adaptive block size shrinks with the image, a fixed grey level does not
+        if ( _thresMethod!=FIXED_THRES ) {
+            ThresParam1/=float ( red_den );
+            ThresParam2/=float ( red_den );
+        }
     }
 	
     ///Do threshold the image and detect contours
-    thresHold ( _thresMethod,imgToBeThresHolded,thres,ThresParam1,ThresParam2 );
-    //an erosion might be required to detect chessboard like boards
-    if ( _doErosion )
     {
-        erode ( thres,thres2,cv::Mat() );
-        thres2.copyTo(thres); //vs thres=thres2;
+        AR_TRACE_SCOPE("Threshold");
+        thresHold ( _thresMethod,imgToBeThresHolded,thres,ThresParam1,ThresParam2 );
+        //an erosion might be required to detect chessboard like boards
+        if ( _doErosion )
+        {
+            erode ( thres,thres2,cv::Mat() );
+            thres2.copyTo(thres); //vs thres=thres2;
+        }
     }
+    _times.threshold=lapMs ( tick );
 	
     //find all rectangles in the thresholdes image
-    vector<MarkerCandidate > MarkerCanditates; // TODO:  use "new" so can be garbage collected? 
-    detectRectangles ( thres,MarkerCanditates );
+    {
+        AR_TRACE_SCOPE("DetectRectangles");
+        detectRectangles ( thres,_markerCandidates );
+    }
+    AR_TRACE_COUNTER("MarkerCandidates", _markerCandidates.size());
+    _times.nCandidates=_markerCandidates.size();
     //if the image has been downsampled, then calcualte the location of the corners in the original image
     if ( pyrdown_level!=0 )
     {
         float red_den=pow ( 2.0f,pyrdown_level );
         float offInc= ( ( pyrdown_level/2. )-0.5 );
-        for ( unsigned int i=0;i<MarkerCanditates.size();i++ ) {
+        for ( unsigned int i=0;i<_markerCandidates.size();i++ ) {
             for ( int c=0;c<4;c++ )
             {
-                MarkerCanditates[i][c].x=MarkerCanditates[i][c].x*red_den+offInc;
-                MarkerCanditates[i][c].y=MarkerCanditates[i][c].y*red_den+offInc;
+                _markerCandidates[i].corners[c][0]=_markerCandidates[i].corners[c][0]*red_den+offInc;
+                _markerCandidates[i].corners[c][1]=_markerCandidates[i].corners[c][1]*red_den+offInc;
             }
             //do the same with the the contour points
-            for ( int c=0;c<MarkerCanditates[i].contour.size();c++ )
+            vector<cv::Point> &contour=_contours[_markerCandidates[i].contourIdx];
+            for ( size_t c=0;c<contour.size();c++ )
             {
-                MarkerCanditates[i].contour[c].x=MarkerCanditates[i].contour[c].x*red_den+offInc;
-                MarkerCanditates[i].contour[c].y=MarkerCanditates[i].contour[c].y*red_den+offInc;
+                contour[c].x=contour[c].x*red_den+offInc;
+                contour[c].y=contour[c].y*red_den+offInc;
             }
         }
     }
 	
     
+    _times.rectangles=lapMs ( tick );
     ///identify the markers
-    vector<vector<Marker> >markers_omp(omp_get_max_threads());
-    vector<vector < std::vector<cv::Point2f> > >candidates_omp(omp_get_max_threads());
+    prepareThreadBuffers();
+    for ( size_t t=0;t<_threadBuffers.size();t++ ) {
+        _threadBuffers[t].markers.clear();
+        _threadBuffers[t].rejected.clear();
+    }
+    {
+    AR_TRACE_SCOPE("Identify");
+    const int nCandidates=int ( _markerCandidates.size() );
     #pragma omp parallel for
-    for ( unsigned int i=0;i<MarkerCanditates.size();i++ )
+    for ( int i=0;i<nCandidates;i++ )
     {
+        ThreadBuffers &buffers=_threadBuffers[omp_get_thread_num()];
         //Find proyective homography
-        Mat canonicalMarker;
-        bool resW=false;
-     	resW=warp ( grey,canonicalMarker,Size ( _markerWarpSize,_markerWarpSize ),MarkerCanditates[i] );
-        if (resW) {
-             int nRotations;
-            int id= ( *markerIdDetector_ptrfunc ) ( canonicalMarker,nRotations );
+        if ( warp ( grey,buffers.canonical,Size ( _markerWarpSize,_markerWarpSize ),_markerCandidates[i] ) ) {
+            int nRotations;
+            int id= ( *markerIdDetector_ptrfunc ) ( buffers.canonical,nRotations );
             if ( id!=-1 )
             {
- 		if(_cornerMethod==LINES) // make LINES refinement before lose contour points
-		  refineCandidateLines( MarkerCanditates[i], camMatrix, distCoeff ); 
-                markers_omp[omp_get_thread_num()].push_back ( MarkerCanditates[i] );
-                markers_omp[omp_get_thread_num()].back().id=id;
+                if(_cornerMethod==LINES) // make LINES refinement before lose contour points
+                    refineCandidateLines( _markerCandidates[i], _contours[_markerCandidates[i].contourIdx], camMatrix, distCoeff ); 
+                buffers.markers.push_back ( _markerCandidates[i] );
+                buffers.markers.back().id=id;
                 //sort the points so that they are always in the same order no matter the camera orientation
-                std::rotate ( markers_omp[omp_get_thread_num()].back().begin(),markers_omp[omp_get_thread_num()].back().begin() +4-nRotations,markers_omp[omp_get_thread_num()].back().end() );
+                buffers.markers.back().rotateCorners ( 4-nRotations );
             }
-            else candidates_omp[omp_get_thread_num()].push_back ( MarkerCanditates[i] );
+            else buffers.rejected.push_back ( i );
         }
        
+    }
     }
     //unify parallel data 
-	joinVectors(markers_omp,detectedMarkers,true);
-	joinVectors(candidates_omp,_candidates,true);
+    _rejected.clear();
+    for ( size_t t=0;t<_threadBuffers.size();t++ ) {
+        const ThreadBuffers &buffers=_threadBuffers[t];
+        detectedMarkers.insert ( detectedMarkers.end(),buffers.markers.begin(),buffers.markers.end() );
+        for ( size_t i=0;i<buffers.rejected.size();i++ ) _rejected.push_back ( _markerCandidates[buffers.rejected[i]] );
+    }
+    _times.identify=lapMs ( tick );
 
 	
 
     ///refine the corner location if desired
     if ( detectedMarkers.size() >0 && _cornerMethod!=NONE && _cornerMethod!=LINES )
     {
-        vector<Point2f> Corners;
+        AR_TRACE_SCOPE("CornerRefinement");
+        _cornerBuffer.resize ( detectedMarkers.size() *4 );
         for ( unsigned int i=0;i<detectedMarkers.size();i++ )
             for ( int c=0;c<4;c++ )
-                Corners.push_back ( detectedMarkers[i][c] );
+                _cornerBuffer[i*4+c]=detectedMarkers[i].corner ( c );
 
         if ( _cornerMethod==HARRIS )
-            findBestCornerInRegion_harris ( grey, Corners,7 );
+            findBestCornerInRegion_harris ( grey, _cornerBuffer,7 );
         else if ( _cornerMethod==SUBPIX )
-            cornerSubPix ( grey, Corners,cvSize ( 5,5 ), cvSize ( -1,-1 )   ,cvTermCriteria ( CV_TERMCRIT_ITER|CV_TERMCRIT_EPS,3,0.05 ) );
+            cornerSubPix ( grey, _cornerBuffer,cvSize ( 5,5 ), cvSize ( -1,-1 )   ,cvTermCriteria ( CV_TERMCRIT_ITER|CV_TERMCRIT_EPS,3,0.05 ) );
 
         //copy back
         for ( unsigned int i=0;i<detectedMarkers.size();i++ )
-            for ( int c=0;c<4;c++ )     detectedMarkers[i][c]=Corners[i*4+c];
+            for ( int c=0;c<4;c++ )     detectedMarkers[i].setCorner ( c,_cornerBuffer[i*4+c] );
     }
+    _times.refinement=lapMs ( tick );
 	
     //sort by id
-    std::sort ( detectedMarkers.begin(),detectedMarkers.end() );
+    std::sort ( detectedMarkers.begin(),detectedMarkers.end(),recordIdLess );
     //there might be still the case that a marker is detected twice because of the double border indicated earlier,
     //detect and remove these cases
     int borderDistThresX=_borderDistThres*float(input.cols);
     int borderDistThresY=_borderDistThres*float(input.rows);
-    vector<bool> toRemove ( detectedMarkers.size(),false );
+    _toRemove.assign ( detectedMarkers.size(),0 );
     for ( int i=0;i<int ( detectedMarkers.size() )-1;i++ )
     {
-        if ( detectedMarkers[i].id==detectedMarkers[i+1].id && !toRemove[i+1] )
+        if ( detectedMarkers[i].id==detectedMarkers[i+1].id && !_toRemove[i+1] )
         {
             //deletes the one with smaller perimeter
-            if ( perimeter ( detectedMarkers[i] ) >perimeter ( detectedMarkers[i+1] ) ) toRemove[i+1]=true;
-            else toRemove[i]=true;
+            if ( perimeter ( detectedMarkers[i] ) >perimeter ( detectedMarkers[i+1] ) ) _toRemove[i+1]=1;
+            else _toRemove[i]=1;
         }
         //delete if any of the corners is too near image border
-        for(size_t c=0;c<detectedMarkers[i].size();c++){
-			if ( detectedMarkers[i][c].x<borderDistThresX ||
-			  detectedMarkers[i][c].y<borderDistThresY || 
-			  detectedMarkers[i][c].x>input.cols-borderDistThresX ||
-			  detectedMarkers[i][c].y>input.rows-borderDistThresY ) toRemove[i]=true;
+        for(int c=0;c<4;c++){
+			if ( detectedMarkers[i].corners[c][0]<borderDistThresX ||
+			  detectedMarkers[i].corners[c][1]<borderDistThresY || 
+			  detectedMarkers[i].corners[c][0]>input.cols-borderDistThresX ||
+			  detectedMarkers[i].corners[c][1]>input.rows-borderDistThresY ) _toRemove[i]=1;
 
 		}
  
         
     }
     //remove the markers marker
-    removeElements ( detectedMarkers, toRemove );
-	
-    ///detect the position of detected markers if desired
-    if ( camMatrix.rows!=0  && markerSizeMeters>0 )
-    {
-        for ( unsigned int i=0;i<detectedMarkers.size();i++ )
-            detectedMarkers[i].calculateExtrinsics ( markerSizeMeters,camMatrix,distCoeff,setYPerpendicular );
+    removeElements ( detectedMarkers, _toRemove );
+    for ( size_t i=0;i<detectedMarkers.size();i++ ) detectedMarkers[i].updateMetrics();
+}
+
+/************************************
+ *
+ *
+ *
+ *
+ ************************************/
+void MarkerDetector::prepareThreadBuffers()
+{
+    if ( int ( _threadBuffers.size() ) <omp_get_max_threads() ) _threadBuffers.resize ( omp_get_max_threads() );
+}
+
+/************************************
+ *
+ *
+ *
+ *
+ ************************************/
+const vector<std::vector<cv::Point2f> > &MarkerDetector::getCandidates()
+{
+    if ( !_candidatesValid ) {
+        _candidates.resize ( _rejected.size() );
+        for ( size_t i=0;i<_rejected.size();i++ ) {
+            _candidates[i].resize ( 4 );
+            for ( int c=0;c<4;c++ ) _candidates[i][c]=_rejected[i].corner ( c );
+        }
+        _candidatesValid=true;
     }
-	
+    return _candidates;
 }
 
 
@@ -285,72 +373,65 @@ void MarkerDetector::detect ( const  cv::Mat &input,vector<Marker> &detectedMark
  ************************************/
 void  MarkerDetector::detectRectangles ( const cv::Mat &thres,vector<std::vector<cv::Point2f> > &MarkerCanditates )
 {
-    vector<MarkerCandidate>  candidates;
+    vector<MarkerRecord>  candidates;
     detectRectangles(thres,candidates);
     //create the output
     MarkerCanditates.resize(candidates.size());
-    for (size_t i=0;i<MarkerCanditates.size();i++)
-        MarkerCanditates[i]=candidates[i];
+    for (size_t i=0;i<MarkerCanditates.size();i++) {
+        MarkerCanditates[i].resize(4);
+        for (int c=0;c<4;c++) MarkerCanditates[i][c]=candidates[i].corner(c);
+    }
 }
 
-void MarkerDetector::detectRectangles(const cv::Mat &thresImg,vector<MarkerCandidate> & OutMarkerCanditates)
+void MarkerDetector::detectRectangles(const cv::Mat &thresImg,vector<MarkerRecord> & OutMarkerCanditates)
 {
-    vector<MarkerCandidate>  MarkerCanditates;
+    OutMarkerCanditates.clear();
+    _rectangles.clear();
     //calcualte the min_max contour sizes
     int minSize=_minSize*std::max(thresImg.cols,thresImg.rows)*4;
     int maxSize=_maxSize*std::max(thresImg.cols,thresImg.rows)*4;
-    std::vector<std::vector<cv::Point> >* contours2 = new std::vector<std::vector<cv::Point>>();
-    std::vector<cv::Vec4i>* hierarchy2 = new std::vector<cv::Vec4i>();
 	
     thresImg.copyTo ( thres2 );
-    cv::findContours ( thres2 , *contours2, *hierarchy2,CV_RETR_LIST, CV_CHAIN_APPROX_NONE );
-    vector<Point>*  approxCurve = new vector<Point>();
+    cv::findContours ( thres2 , _contours, _hierarchy,CV_RETR_LIST, CV_CHAIN_APPROX_NONE );
     ///for each contour, analyze if it is a paralelepiped likely to be the marker
 	
-    for ( unsigned int i=0;i<(*contours2).size();i++ )
+    for ( unsigned int i=0;i<_contours.size();i++ )
     {
 		
 
         //check it is a possible element by first checking is has enough points
-        if ( minSize< (*contours2)[i].size() && (*contours2)[i].size()<maxSize  )
+        if ( minSize< int ( _contours[i].size() ) && int ( _contours[i].size() ) <maxSize  )
         {
 			
             //approximate to a poligon
-			std::vector<cv::Point> inputCurve = (*contours2)[i];
-			double epsilon = inputCurve.size() * 0.05;
-			cv::approxPolyDP(inputCurve, *approxCurve, epsilon, true);
+			double epsilon = _contours[i].size() * 0.05;
+			cv::approxPolyDP(_contours[i], _approxCurve, epsilon, true);
             // 				drawApproxCurve(copy,approxCurve,Scalar(0,0,255));
             //check that the poligon has 4 points
-            if ( (*approxCurve).size() ==4 )
+            if ( _approxCurve.size() ==4 )
             {
 
-//  	   drawContour(input,contours2[i],Scalar(255,0,225));
-//  		  namedWindow("input");
-//  		imshow("input",input);
-//  	 	waitKey(0);
                 //and is convex
-                if ( isContourConvex ( Mat ( *approxCurve ) ) )
+                if ( isContourConvex ( Mat ( _approxCurve ) ) )
                 {
-// 					      drawApproxCurve(input,approxCurve,Scalar(255,0,255));
 // 						//ensure that the   distace between consecutive points is large enough
                     float minDist=1e10;
                     for ( int j=0;j<4;j++ )
                     {
-                        float d= std::sqrt ( ( float ) ( (*approxCurve)[j].x-(*approxCurve)[ ( j+1 ) %4].x ) * ( (*approxCurve)[j].x-(*approxCurve)[ ( j+1 ) %4].x ) +
-                                             ( (*approxCurve)[j].y-(*approxCurve)[ ( j+1 ) %4].y ) * ( (*approxCurve)[j].y-(*approxCurve)[ ( j+1 ) %4].y ) );
-                        // 		norm(Mat(approxCurve[i]),Mat(approxCurve[(i+1)%4]));
+                        float d= std::sqrt ( ( float ) ( _approxCurve[j].x-_approxCurve[ ( j+1 ) %4].x ) * ( _approxCurve[j].x-_approxCurve[ ( j+1 ) %4].x ) +
+                                             ( _approxCurve[j].y-_approxCurve[ ( j+1 ) %4].y ) * ( _approxCurve[j].y-_approxCurve[ ( j+1 ) %4].y ) );
                         if ( d<minDist ) minDist=d;
                     }
                     //check that distance is not very small
                     if ( minDist>10 )
                     {
                         //add the points
-                        // 	      cout<<"ADDED"<<endl;
-                        MarkerCanditates.push_back ( MarkerCandidate() );
-                        MarkerCanditates.back().idx=i;
+                        _rectangles.push_back ( MarkerRecord() );
+                        _rectangles.back().clear();
+                        _rectangles.back().contourIdx=i;
                         for ( int j=0;j<4;j++ )
                         {
-                            MarkerCanditates.back().push_back ( Point2f ( (*approxCurve)[j].x,(*approxCurve)[j].y ) );
+                            _rectangles.back().setCorner ( j,Point2f ( _approxCurve[j].x,_approxCurve[j].y ) );
                         }
                     }
                 } 
@@ -358,77 +439,73 @@ void MarkerDetector::detectRectangles(const cv::Mat &thresImg,vector<MarkerCandi
         } 
     }
 	
-// 		 		  namedWindow("input");
-//  		imshow("input",input);
-//  						waitKey(0);
     ///sort the points in anti-clockwise order
-    valarray<bool> swapped(false,MarkerCanditates.size());//used later
-    for ( unsigned int i=0;i<MarkerCanditates.size();i++ )
+    _swapped.assign ( _rectangles.size(),0 );//used later
+    for ( unsigned int i=0;i<_rectangles.size();i++ )
     {
 
         //trace a line between the first and second point.
         //if the thrid point is at the right side, then the points are anti-clockwise
-        double dx1 = MarkerCanditates[i][1].x - MarkerCanditates[i][0].x;
-        double dy1 =  MarkerCanditates[i][1].y - MarkerCanditates[i][0].y;
-        double dx2 = MarkerCanditates[i][2].x - MarkerCanditates[i][0].x;
-        double dy2 = MarkerCanditates[i][2].y - MarkerCanditates[i][0].y;
+        const float (&c)[4][2]=_rectangles[i].corners;
+        double dx1 = c[1][0] - c[0][0];
+        double dy1 = c[1][1] - c[0][1];
+        double dx2 = c[2][0] - c[0][0];
+        double dy2 = c[2][1] - c[0][1];
         double o = ( dx1*dy2 )- ( dy1*dx2 );
 
         if ( o  < 0.0 )		 //if the third point is in the left side, then sort in anti-clockwise order
         {
-            swap ( MarkerCanditates[i][1],MarkerCanditates[i][3] );
-            swapped[i]=true;
-            //sort the contour points
-//  	    reverse(MarkerCanditates[i].contour.begin(),MarkerCanditates[i].contour.end());//????
-
+            cv::Point2f aux=_rectangles[i].corner ( 1 );
+            _rectangles[i].setCorner ( 1,_rectangles[i].corner ( 3 ) );
+            _rectangles[i].setCorner ( 3,aux );
+            _swapped[i]=1;
         }
     }
 	
     /// remove these elements which corners are too close to each other
     //first detect candidates to be removed
- 
-    vector< vector<pair<int,int>  > > TooNearCandidates_omp(omp_get_max_threads());
+    prepareThreadBuffers();
+    for ( size_t t=0;t<_threadBuffers.size();t++ ) _threadBuffers[t].tooNear.clear();
+    const int nRectangles=int ( _rectangles.size() );
     #pragma omp parallel for
-    for ( unsigned int i=0;i<MarkerCanditates.size();i++ )
+    for ( int i=0;i<nRectangles;i++ )
     {
-        // 	cout<<"Marker i="<<i<<MarkerCanditates[i]<<endl;
         //calculate the average distance of each corner to the nearest corner of the other marker candidate
-        for ( unsigned int j=i+1;j<MarkerCanditates.size();j++ )
+        for ( int j=i+1;j<nRectangles;j++ )
         {
             float dist=0;
-            for ( int c=0;c<4;c++ )
-                dist+= sqrt ( ( MarkerCanditates[i][c].x-MarkerCanditates[j][c].x ) * ( MarkerCanditates[i][c].x-MarkerCanditates[j][c].x ) + ( MarkerCanditates[i][c].y-MarkerCanditates[j][c].y ) * ( MarkerCanditates[i][c].y-MarkerCanditates[j][c].y ) );
+            for ( int c=0;c<4;c++ ) {
+                float dx=_rectangles[i].corners[c][0]-_rectangles[j].corners[c][0];
+                float dy=_rectangles[i].corners[c][1]-_rectangles[j].corners[c][1];
+                dist+= sqrt ( dx*dx+dy*dy );
+            }
             dist/=4;
             //if distance is too small
             if ( dist< 10 )
             {
-                TooNearCandidates_omp[omp_get_thread_num()].push_back ( pair<int,int> ( i,j ) );
+                _threadBuffers[omp_get_thread_num()].tooNear.push_back ( pair<int,int> ( i,j ) );
             }
         }
     }
 	
-    //join
-     vector<pair<int,int>  > TooNearCandidates;
-     joinVectors(  TooNearCandidates_omp,TooNearCandidates);
     //mark for removal the element of  the pair with smaller perimeter
-    valarray<bool> toRemove ( false,MarkerCanditates.size() );
-    for ( unsigned int i=0;i<TooNearCandidates.size();i++ )
-    {
-        if ( perimeter ( MarkerCanditates[TooNearCandidates[i].first ] ) >perimeter ( MarkerCanditates[ TooNearCandidates[i].second] ) )
-            toRemove[TooNearCandidates[i].second]=true;
-        else toRemove[TooNearCandidates[i].first]=true;
+    _rectToRemove.assign ( _rectangles.size(),0 );
+    for ( size_t t=0;t<_threadBuffers.size();t++ ) {
+        const vector<pair<int,int> > &tooNear=_threadBuffers[t].tooNear;
+        for ( unsigned int i=0;i<tooNear.size();i++ )
+        {
+            if ( perimeter ( _rectangles[tooNear[i].first ] ) >perimeter ( _rectangles[ tooNear[i].second] ) )
+                _rectToRemove[tooNear[i].second]=1;
+            else _rectToRemove[tooNear[i].first]=1;
+        }
     }
 	
-    //remove the invalid ones
-//     removeElements ( MarkerCanditates,toRemove );
-    //finally, assign to the remaining candidates the contour
-    OutMarkerCanditates.reserve(MarkerCanditates.size());
-    for (size_t i=0;i<MarkerCanditates.size();i++) {
-        if (!toRemove[i]) {
-            OutMarkerCanditates.push_back(MarkerCanditates[i]);
-            OutMarkerCanditates.back().contour=(*contours2)[ MarkerCanditates[i].idx];
-            if (swapped[i] )//if the corners where swapped, it is required to reverse here the points so that they are in the same order
-                reverse(OutMarkerCanditates.back().contour.begin(),OutMarkerCanditates.back().contour.end());//????
+    //finally, keep the remaining candidates, with their contour in the same order as the corners
+    for (size_t i=0;i<_rectangles.size();i++) {
+        if (!_rectToRemove[i]) {
+            OutMarkerCanditates.push_back(_rectangles[i]);
+            if (_swapped[i] )//if the corners where swapped, it is required to reverse here the points so that they are in the same order
+                reverse(_contours[_rectangles[i].contourIdx].begin(),_contours[_rectangles[i].contourIdx].end());
         }
     }
 	
@@ -497,6 +574,41 @@ bool MarkerDetector::warp ( Mat &in,Mat &out,Size size, vector<Point2f> points )
     return true;
 }
 
+bool MarkerDetector::warp ( const Mat &in,Mat &out,Size size,const MarkerRecord &candidate ) 
+{
+    Point2f  pointsRes[4],pointsIn[4];
+    for ( int i=0;i<4;i++ ) pointsIn[i]=candidate.corner ( i );
+    pointsRes[0]= ( Point2f ( 0,0 ) );
+    pointsRes[1]= Point2f ( size.width-1,0 );
+    pointsRes[2]= Point2f ( size.width-1,size.height-1 );
+    pointsRes[3]= Point2f ( 0,size.height-1 );
+    cv::Matx33d M;
+    perspectiveTransform ( pointsIn,pointsRes,M );
+    cv::warpPerspective ( in, out,  cv::Mat ( M,false ), size,cv::INTER_NEAREST );
+    return true;
+}
+
+/**Same as cv::getPerspectiveTransform, but the result goes into a Matx instead of a newly allocated Mat
+ */
+void MarkerDetector::perspectiveTransform ( const Point2f src[4],const Point2f dst[4],cv::Matx33d &M )
+{
+    cv::Matx<double,8,8> A=cv::Matx<double,8,8>::zeros();
+    cv::Matx<double,8,1> b;
+    for ( int i=0;i<4;i++ ) {
+        A ( i,0 ) =A ( i+4,3 ) =src[i].x;
+        A ( i,1 ) =A ( i+4,4 ) =src[i].y;
+        A ( i,2 ) =A ( i+4,5 ) =1;
+        A ( i,6 ) =-src[i].x*dst[i].x;
+        A ( i,7 ) =-src[i].y*dst[i].x;
+        A ( i+4,6 ) =-src[i].x*dst[i].y;
+        A ( i+4,7 ) =-src[i].y*dst[i].y;
+        b ( i ) =dst[i].x;
+        b ( i+4 ) =dst[i].y;
+    }
+    cv::Matx<double,8,1> h=A.solve ( b,cv::DECOMP_LU );
+    M=cv::Matx33d ( h ( 0 ),h ( 1 ),h ( 2 ),h ( 3 ),h ( 4 ),h ( 5 ),h ( 6 ),h ( 7 ),1 );
+}
+
 void findCornerPointsInContour(const vector<cv::Point2f>& points,const vector<cv::Point> &contour,vector<int> &idxs)
 {
     assert(points.size()==4);
@@ -585,50 +697,50 @@ void setPointIntoImage(cv::Point  &p,cv::Size s) {
  *
  *
  ************************************/
-bool MarkerDetector::warp_cylinder ( Mat &in,Mat &out,Size size, MarkerCandidate& mcand ) 
+bool MarkerDetector::warp_cylinder ( Mat &in,Mat &out,Size size, MarkerRecord& mcand, const vector<cv::Point> &contour ) 
 {
 
-    if ( mcand.size() !=4 )    throw cv::Exception ( 9001,"point.size()!=4","MarkerDetector::warp",__FILE__,__LINE__ );
+    vector<cv::Point2f> corners(4);
+    for ( int i=0;i<4;i++ ) corners[i]=mcand.corner ( i );
 
     //check first the real need for cylinder warping
-//     cout<<"im="<<mcand.contour.size()<<endl;
+//     cout<<"im="<<contour.size()<<endl;
 
-//     for (size_t i=0;i<mcand.contour.size();i++) {
-//         cv::rectangle(_ssImC ,mcand.contour[i],mcand.contour[i],cv::Scalar(111,111,111),-1 );
+//     for (size_t i=0;i<contour.size();i++) {
+//         cv::rectangle(_ssImC ,contour[i],contour[i],cv::Scalar(111,111,111),-1 );
 //     }
-//     mcand.draw(imC,cv::Scalar(0,255,0));
+//     corners.draw(imC,cv::Scalar(0,255,0));
     //find the 4 different segments of the contour
     vector<int> idxSegments;
-    findCornerPointsInContour(mcand,mcand.contour,idxSegments);
+    findCornerPointsInContour(corners,contour,idxSegments);
     //let us rearrange the points so that the first corner is the one whith smaller idx
     int minIdx=0;
     for (int i=1;i<4;i++)
         if (idxSegments[i] <idxSegments[minIdx]) minIdx=i;
     //now, rotate the points to be in this order
     std::rotate(idxSegments.begin(),idxSegments.begin()+minIdx,idxSegments.end());
-    std::rotate(mcand.begin(),mcand.begin()+minIdx,mcand.end());
+    std::rotate(corners.begin(),corners.begin()+minIdx,corners.end());
 
 //     cout<<"idxSegments="<<idxSegments[0]<< " "<<idxSegments[1]<< " "<<idxSegments[2]<<" "<<idxSegments[3]<<endl;
     //now, determine the sides that are deformated by cylinder perspective
-    int defrmdSide=findDeformedSidesIdx(mcand.contour,idxSegments);
+    int defrmdSide=findDeformedSidesIdx(contour,idxSegments);
 //     cout<<"Def="<<defrmdSide<<endl;
 
     //instead of removing perspective distortion  of the rectangular region
     //given by the rectangle, we enlarge it a bit to include the deformed parts
-    cv::Point2f center=mcand.getCenter();
     Point2f enlargedRegion[4];
-    for (int i=0;i<4;i++) enlargedRegion[i]=mcand[i];
+    for (int i=0;i<4;i++) enlargedRegion[i]=corners[i];
     if (defrmdSide==0) {
-        enlargedRegion[0]=mcand[0]+(mcand[3]-mcand[0])*1.2;
-        enlargedRegion[1]=mcand[1]+(mcand[2]-mcand[1])*1.2;
-        enlargedRegion[2]=mcand[2]+(mcand[1]-mcand[2])*1.2;
-        enlargedRegion[3]=mcand[3]+(mcand[0]-mcand[3])*1.2;
+        enlargedRegion[0]=corners[0]+(corners[3]-corners[0])*1.2;
+        enlargedRegion[1]=corners[1]+(corners[2]-corners[1])*1.2;
+        enlargedRegion[2]=corners[2]+(corners[1]-corners[2])*1.2;
+        enlargedRegion[3]=corners[3]+(corners[0]-corners[3])*1.2;
     }
     else {
-        enlargedRegion[0]=mcand[0]+(mcand[1]-mcand[0])*1.2;
-        enlargedRegion[1]=mcand[1]+(mcand[0]-mcand[1])*1.2;
-        enlargedRegion[2]=mcand[2]+(mcand[3]-mcand[2])*1.2;
-        enlargedRegion[3]=mcand[3]+(mcand[2]-mcand[3])*1.2;
+        enlargedRegion[0]=corners[0]+(corners[1]-corners[0])*1.2;
+        enlargedRegion[1]=corners[1]+(corners[0]-corners[1])*1.2;
+        enlargedRegion[2]=corners[2]+(corners[3]-corners[2])*1.2;
+        enlargedRegion[3]=corners[3]+(corners[2]-corners[3])*1.2;
     }
     for (size_t i=0;i<4;i++)
         setPointIntoImage(enlargedRegion[i],in.size());
@@ -636,7 +748,7 @@ bool MarkerDetector::warp_cylinder ( Mat &in,Mat &out,Size size, MarkerCandidate
     /*
         cv::Scalar colors[4]={cv::Scalar(0,0,255),cv::Scalar(255,0,0),cv::Scalar(0,255,0),cv::Scalar(111,111,0)};
         for (int i=0;i<4;i++) {
-            cv::rectangle(_ssImC,mcand.contour[idxSegments[i]]-cv::Point(2,2),mcand.contour[idxSegments[i]]+cv::Point(2,2),colors[i],-1 );
+            cv::rectangle(_ssImC,contour[idxSegments[i]]-cv::Point(2,2),contour[idxSegments[i]]+cv::Point(2,2),colors[i],-1 );
             cv::rectangle(_ssImC,enlargedRegion[i]-cv::Point2f(2,2),enlargedRegion[i]+cv::Point2f(2,2),colors[i],-1 );
 
         }*/
@@ -649,7 +761,7 @@ bool MarkerDetector::warp_cylinder ( Mat &in,Mat &out,Size size, MarkerCandidate
     //check that the region is into image limits
     //obtain the perspective transform
     Point2f  pointsRes[4],pointsIn[4];
-    for ( int i=0;i<4;i++ ) pointsIn[i]=mcand[i];
+    for ( int i=0;i<4;i++ ) pointsIn[i]=corners[i];
 
     cv::Size enlargedSize=size;
     enlargedSize.width+=2*enlargedSize.width*0.2;
@@ -664,7 +776,7 @@ bool MarkerDetector::warp_cylinder ( Mat &in,Mat &out,Size size, MarkerCandidate
     cv::warpPerspective ( in, imAux,  M, enlargedSize,cv::INTER_NEAREST);
 
     //now, transform all points to the new image
-    vector<cv::Point> pointsCO(mcand.contour.size());
+    vector<cv::Point> pointsCO(contour.size());
     assert(M.type()==CV_64F);
     assert(M.cols==3 && M.rows==3);
 //     cout<<M<<endl;
@@ -672,9 +784,9 @@ bool MarkerDetector::warp_cylinder ( Mat &in,Mat &out,Size size, MarkerCandidate
     imAux2.setTo(cv::Scalar::all(0));
 
 
-    for (size_t i=0;i<mcand.contour.size();i++) {
-        float inX=mcand.contour[i].x;
-        float inY=mcand.contour[i].y;
+    for (size_t i=0;i<contour.size();i++) {
+        float inX=contour[i].x;
+        float inY=contour[i].y;
         float w= inX * mptr[6]+inY * mptr[7]+mptr[8];
         cv::Point2f pres;
         pointsCO[i].x=( (inX * mptr[0]+inY* mptr[1]+mptr[2])/w)+0.5;
@@ -711,15 +823,16 @@ bool MarkerDetector::warp_cylinder ( Mat &in,Mat &out,Size size, MarkerCandidate
     }
 
 
-//     cout<<"SS="<<mcand.contour.size()<<" "<<pointsCO.size()<<endl;
+//     cout<<"SS="<<contour.size()<<" "<<pointsCO.size()<<endl;
     //get the central region with the size specified
     cv::Mat centerReg=outIm(cv::Range::all(),cv::Range(0,size.width));
     out=centerReg.clone();
-//     cv::perspectiveTransform(mcand.contour,pointsCO,M);
+//     cv::perspectiveTransform(contour,pointsCO,M);
     //draw them
 //     cv::imshow("out2",out);
 //     cv::imshow("imm",imAux2);
 //     cv::waitKey(0);
+    for ( int i=0;i<4;i++ ) mcand.setCorner ( i,corners[i] );
 return true;
 }
 /************************************
@@ -752,6 +865,19 @@ int MarkerDetector:: perimeter ( vector<Point2f> &a )
     return sum;
 }
 
+int MarkerDetector:: perimeter ( const MarkerRecord &a )
+{
+    int sum=0;
+    for ( int i=0;i<4;i++ )
+    {
+        int i2= ( i+1 ) %4;
+        float dx=a.corners[i][0]-a.corners[i2][0];
+        float dy=a.corners[i][1]-a.corners[i2][1];
+        sum+= sqrt ( dx*dx+dy*dy ) ;
+    }
+    return sum;
+}
+
 
 /**
  *
@@ -769,14 +895,15 @@ void MarkerDetector::findBestCornerInRegion_harris ( const cv::Mat  & grey,vecto
  *
  *
  */
-void MarkerDetector::refineCandidateLines(MarkerDetector::MarkerCandidate& candidate, const cv::Mat &camMatrix, const cv::Mat &distCoeff)
+void MarkerDetector::refineCandidateLines(MarkerRecord& candidate, const vector<cv::Point> &contour, const cv::Mat &camMatrix, const cv::Mat &distCoeff)
 {
+      if (_threadBuffers.empty()) prepareThreadBuffers();//called outside of detect
+      ThreadBuffers &buffers=_threadBuffers[omp_get_thread_num()];
       // search corners on the contour vector
-      vector<unsigned int> cornerIndex;
-      cornerIndex.resize(4);
-      for(unsigned int j=0; j<candidate.contour.size(); j++) {
+      unsigned int cornerIndex[4]={0,0,0,0};
+      for(unsigned int j=0; j<contour.size(); j++) {
 	for(unsigned int k=0; k<4; k++) {
-	  if(candidate.contour[j].x==candidate[k].x && candidate.contour[j].y==candidate[k].y) {
+	  if(contour[j].x==candidate.corners[k][0] && contour[j].y==candidate.corners[k][1]) {
 	    cornerIndex[k] = j;
 	  }   
 	}
@@ -796,19 +923,20 @@ void MarkerDetector::refineCandidateLines(MarkerDetector::MarkerCandidate& candi
       if(inverse) inc = -1;
       
       // undistort contour
-      vector<Point2f> contour2f;
-      for(unsigned int i=0; i<candidate.contour.size(); i++) 
-	contour2f.push_back( cv::Point2f(candidate.contour[i].x, candidate.contour[i].y) );      
+      vector<Point2f> &contour2f=buffers.contour2f;
+      contour2f.resize(contour.size());
+      for(unsigned int i=0; i<contour.size(); i++) 
+	contour2f[i]=cv::Point2f(contour[i].x, contour[i].y);
       if(!camMatrix.empty() && !distCoeff.empty())
 	cv::undistortPoints(contour2f, contour2f, camMatrix, distCoeff, cv::Mat(), camMatrix); 
 
 
-      vector<std::vector<cv::Point2f> > contourLines;
-      contourLines.resize(4);
+      vector<cv::Point2f> *contourLines=buffers.contourLines;
       for(unsigned int l=0; l<4; l++) {
+	contourLines[l].clear();
 	for(int j=(int)cornerIndex[l]; j!=(int)cornerIndex[(l+1)%4]; j+=inc) {
-	  if(j==(int)candidate.contour.size() && !inverse) j=0;
-	  else if(j==0 && inverse) j=candidate.contour.size()-1;
+	  if(j==(int)contour.size() && !inverse) j=0;
+	  else if(j==0 && inverse) j=contour.size()-1;
 	  contourLines[l].push_back(contour2f[j]);
 	  if(j==(int)cornerIndex[(l+1)%4]) break; // this has to be added because of the previous ifs
 	}
@@ -816,27 +944,28 @@ void MarkerDetector::refineCandidateLines(MarkerDetector::MarkerCandidate& candi
       }
 
       // interpolate marker lines
-      vector<Point3f> lines;
-      lines.resize(4);
-      for(unsigned int j=0; j<lines.size(); j++) interpolate2Dline(contourLines[j], lines[j]);    
+      Point3f lines[4];
+      for(unsigned int j=0; j<4; j++) interpolate2Dline(contourLines[j], lines[j]);    
       
       // get cross points of lines
-      vector<Point2f> crossPoints;
-      crossPoints.resize(4);
+      Point2f crossPoints[4];
       for(unsigned int i=0; i<4; i++)
-	crossPoints[i] = getCrossPoint( lines[(i-1)%4], lines[i] );
+	crossPoints[i] = getCrossPoint( lines[(i+3)%4], lines[i] );
       
       // distort corners again if undistortion was performed
-      if(!camMatrix.empty() && !distCoeff.empty())
-	  distortPoints(crossPoints, crossPoints, camMatrix, distCoeff);
+      if(!camMatrix.empty() && !distCoeff.empty()) {
+	  vector<Point2f> distorted(crossPoints,crossPoints+4);
+	  distortPoints(distorted, distorted, camMatrix, distCoeff);
+	  for(unsigned int j=0; j<4; j++) crossPoints[j]=distorted[j];
+      }
       
       // reassing points
       for(unsigned int j=0; j<4; j++)
-	candidate[j] = crossPoints[j];  
+	candidate.setCorner(j,crossPoints[j]);  
 }
 
 
-/**
+/**Least squares line through the points, solved with the 2x2 normal equations (no allocation)
  */
 void MarkerDetector::interpolate2Dline( const std::vector< Point2f >& inPoints, Point3f& outLine)
 {
@@ -851,68 +980,30 @@ void MarkerDetector::interpolate2Dline( const std::vector< Point2f >& inPoints,
     if(inPoints[i].y > maxY) maxY = inPoints[i].y;
   }
 
-    // create matrices of equation system
-    Mat A(inPoints.size(),2,CV_32FC1, Scalar(0));
-    Mat B(inPoints.size(),1,CV_32FC1, Scalar(0));
-    Mat X;
-
-    
-    
-    if( maxX-minX > maxY-minY ) {
-      // Ax + C = y
-      for (int i=0; i<inPoints.size(); i++) {
-
-	  A.at<float>(i, 0) = inPoints[i].x;
-	  A.at<float>(i, 1) = 1.;
-	  B.at<float>(i, 0) = inPoints[i].y;
-
-      }
-
-      // solve system
-      solve(A,B,X, DECOMP_SVD);
-      // return Ax + By + C
-      outLine = Point3f(X.at<float>(0,0), -1., X.at<float>(1,0));  
+    //fit v=a*u+c, with u the coordinate along which the points spread most
+    bool alongX = maxX-minX > maxY-minY;
+    double su=0, sv=0, suu=0, suv=0, n=inPoints.size();
+    for (size_t i=0; i<inPoints.size(); i++) {
+      double u = alongX ? inPoints[i].x : inPoints[i].y;
+      double v = alongX ? inPoints[i].y : inPoints[i].x;
+      su+=u; sv+=v; suu+=u*u; suv+=u*v;
     }
-    else {
-      // By + C = x
-      for (int i=0; i<inPoints.size(); i++) {
-
-	  A.at<float>(i, 0) = inPoints[i].y;
-	  A.at<float>(i, 1) = 1.;
-	  B.at<float>(i, 0) = inPoints[i].x;
-
-      }
-
-      // solve system
-      solve(A,B,X, DECOMP_SVD);
-      // return Ax + By + C
-      outLine = Point3f(-1., X.at<float>(0,0), X.at<float>(1,0));        
-    }
-  
+    double den = n*suu-su*su;
+    double a = fabs(den)>1e-12 ? (n*suv-su*sv)/den : 0;
+    double c = (sv-a*su)/n;
+    // return Ax + By + C
+    if (alongX) outLine = Point3f(a, -1., c);  // Ax + C = y
+    else outLine = Point3f(-1., a, c);         // By + C = x
 }
 
 /**
  */
 Point2f MarkerDetector::getCrossPoint(const cv::Point3f& line1, const cv::Point3f& line2)
 {
-  
-    // create matrices of equation system
-    Mat A(2,2,CV_32FC1, Scalar(0));
-    Mat B(2,1,CV_32FC1, Scalar(0));
-    Mat X;
-
-    A.at<float>(0, 0) = line1.x;
-    A.at<float>(0, 1) = line1.y;
-    B.at<float>(0, 0) = -line1.z;    
-
-    A.at<float>(1, 0) = line2.x;
-    A.at<float>(1, 1) = line2.y;
-    B.at<float>(1, 0) = -line2.z; 	
-	
-    // solve system
-    solve(A,B,X, DECOMP_SVD);
-    return Point2f(X.at<float>(0,0), X.at<float>(1,0));   
-  
+    //solve line1.x*x+line1.y*y=-line1.z, line2.x*x+line2.y*y=-line2.z by Cramer's rule
+    double det = line1.x*line2.y-line1.y*line2.x;
+    if (fabs(det)<1e-12) return Point2f(0,0);
+    return Point2f((-line1.z*line2.y+line1.y*line2.z)/det, (-line1.x*line2.z+line1.z*line2.x)/det);
 }
 
 
@@ -33,6 +33,7 @@ or implied, of Rafael Muñoz Salinas.
 #include "cameraparameters.h"
 #include "exports.h"
 #include "marker.h"
+#include "markerrecord.h"
 using namespace std;
 
 namespace aruco
@@ -43,25 +44,6 @@ namespace aruco
  */
 class ARUCO_EXPORTS  MarkerDetector
 {
-  //Represent a candidate to be a maker
-  class MarkerCandidate : public Marker{
-  public:
-    MarkerCandidate(){}
-    MarkerCandidate(const Marker &M): Marker(M){} 
-    MarkerCandidate(const  MarkerCandidate &M): Marker(M){
-      contour=M.contour;
-      idx=M.idx;
-    }
-    MarkerCandidate & operator=(const  MarkerCandidate &M){
-      (*(Marker*)this)=(*(Marker*)&M);
-      contour=M.contour;
-      idx=M.idx;
-      return *this;
-    }
-    
-    vector<cv::Point> contour;//all the points of its contour
-    int idx;//index position in the global contour list
-  };
 public:
 
     /**
@@ -96,6 +78,16 @@ public:
      * @param setYPerperdicular If set the Y axis will be perpendicular to the surface. Otherwise, it will be the Z axis
      */
     void detect(const cv::Mat &input,std::vector<Marker> &detectedMarkers, CameraParameters camParams,float markerSizeMeters=-1,bool setYPerperdicular=false);
+    /**Detects the markers in the image passed, without calculating their extrinsics.
+     *
+     * This is the version used internally: candidates and markers are handled as MarkerRecord, and every buffer is kept
+     * between calls, so once they have grown to the number of candidates seen the detector does no allocation of its own.
+     *
+     * @param input input color image
+     * @param detectedMarkers output vector with the markers detected, sorted by id
+     * @param camMatrix,distCoeff camera parameters, only used to undistort the contours in the LINES corner refinement
+     */
+    void detect(const cv::Mat &input,std::vector<MarkerRecord> &detectedMarkers,const cv::Mat &camMatrix=cv::Mat(),const cv::Mat &distCoeff=cv::Mat());
 
     /**This set the type of thresholding methods available
      */
@@ -136,6 +128,19 @@ public:
     }
 
 
+    /**Time spent (in milliseconds) in each stage of the last call to detect, and the number of candidates analyzed
+     */
+    struct DetectionTimes {
+        DetectionTimes():grey(0),threshold(0),rectangles(0),identify(0),refinement(0),nCandidates(0){}
+        double grey,threshold,rectangles,identify,refinement;
+        int nCandidates;
+    };
+    /**Returns the stage times of the last call to detect
+     */
+    const DetectionTimes & getLastDetectionTimes()const {
+        return _times;
+    }
+
     /**Returns a reference to the internal image thresholded. It is for visualization purposes and to adjust manually
      * the parameters
      */
@@ -242,11 +247,9 @@ public:
     */
     void detectRectangles(const cv::Mat &thresImg,vector<std::vector<cv::Point2f> > & candidates);
 
-    /**Returns a list candidates to be markers (rectangles), for which no valid id was found after calling detectRectangles
+    /**Returns a list candidates to be markers (rectangles), for which no valid id was found after calling detect
      */
-    const vector<std::vector<cv::Point2f> > &getCandidates() {
-        return _candidates;
-    }
+    const vector<std::vector<cv::Point2f> > &getCandidates();
 
     /**Given the iput image with markers, creates an output image with it in the canonical position
      * @param in input image
@@ -259,10 +262,11 @@ public:
     
     
     
-    /** Refine MarkerCandidate Corner using LINES method
+    /** Refine the corners of a candidate using LINES method
      * @param candidate candidate to refine corners
+     * @param contour contour the candidate was found in
      */
-    void refineCandidateLines(MarkerCandidate &candidate, const cv::Mat &camMatrix, const cv::Mat &distCoeff);    
+    void refineCandidateLines(MarkerRecord &candidate, const vector<cv::Point> &contour, const cv::Mat &camMatrix, const cv::Mat &distCoeff);    
     
     
     /**DEPRECATED!!! Use the member function in CameraParameters
@@ -282,12 +286,15 @@ public:
 
 private:
 
-     bool warp_cylinder ( cv::Mat &in,cv::Mat &out,cv::Size size, MarkerCandidate& mc ) ;
+     bool warp_cylinder ( cv::Mat &in,cv::Mat &out,cv::Size size, MarkerRecord& mc, const vector<cv::Point> &contour ) ;
+    /**Warps the region of a candidate; unlike the public version it does not allocate
+     */
+    bool warp ( const cv::Mat &in,cv::Mat &out,cv::Size size,const MarkerRecord &candidate );
     /**
     * Detection of candidates to be markers, i.e., rectangles.
-    * This function returns in candidates all the rectangles found in a thresolded image
+    * This function returns in candidates all the rectangles found in a thresolded image; their contours are in _contours
     */
-    void detectRectangles(const cv::Mat &thresImg,vector<MarkerCandidate> & candidates);
+    void detectRectangles(const cv::Mat &thresImg,vector<MarkerRecord> & candidates);
     //Current threshold method
     ThresholdMethods _thresMethod;
     //Threshold parameters
@@ -301,12 +308,35 @@ private:
     int _markerWarpSize;
     bool _doErosion;
     float _borderDistThres;//border around image limits in which corners are not allowed to be detected.
-    //vectr of candidates to be markers. This is a vector with a set of rectangles that have no valid id
+    //vectr of candidates to be markers. This is a vector with a set of rectangles that have no valid id (built on demand from _rejected)
     vector<std::vector<cv::Point2f> > _candidates;
+    vector<MarkerRecord> _rejected;
+    bool _candidatesValid;
+
+    //buffers kept between calls to detect
+    struct ThreadBuffers
+    {
+        cv::Mat canonical;//canonical image of the candidate being identified
+        vector<MarkerRecord> markers;//markers identified by the thread
+        vector<int> rejected;//candidates with no valid id
+        vector<pair<int,int> > tooNear;//pairs of candidates too close to each other
+        vector<cv::Point2f> contour2f;//LINES refinement
+        vector<cv::Point2f> contourLines[4];
+    };
+    vector<ThreadBuffers> _threadBuffers;//one per omp thread
+    vector<std::vector<cv::Point> > _contours;
+    vector<cv::Vec4i> _hierarchy;
+    vector<cv::Point> _approxCurve;
+    vector<MarkerRecord> _rectangles,_markerCandidates,_records;
+    vector<char> _swapped,_rectToRemove,_toRemove;
+    vector<cv::Point2f> _cornerBuffer;
+    void prepareThreadBuffers();
     //level of image reduction
     int pyrdown_level;
     //Images
     cv::Mat grey,thres,thres2,reduced;
+    //stage times of the last detection
+    DetectionTimes _times;
     //pointer to the function that analizes a rectangular region so as to detect its internal marker
     int (* markerIdDetector_ptrfunc)(const cv::Mat &in,int &nRotations);
 
@@ -316,6 +346,7 @@ private:
     /**
      */
     int perimeter(std::vector<cv::Point2f> &a);
+    static int perimeter(const MarkerRecord &a);
 
     
 //     //GL routines
@@ -329,6 +360,7 @@ private:
 
     //detection of the
     void findBestCornerInRegion_harris(const cv::Mat  & grey,vector<cv::Point2f> &  Corners,int blockSize);
+    static void perspectiveTransform(const cv::Point2f src[4],const cv::Point2f dst[4],cv::Matx33d &M);
    
     
     // auxiliar functions to perform LINES refinement
@@ -343,7 +375,7 @@ private:
      * @param toRemove
      */
     template<typename T>
-    void removeElements(vector<T> & vinout,const vector<bool> &toRemove)
+    void removeElements(vector<T> & vinout,const vector<char> &toRemove)
     {
        //remove the invalid ones by setting the valid in the positions left by the invalids
       size_t indexValid=0;
@@ -0,0 +1,166 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#include "OculusARPOC.h"
+#include "markerrecord.h"
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <opencv2/calib3d/calib3d.hpp>
+namespace aruco {
+/**Rotates the X axis of the pose so that Y is perpendicular to the marker, as Marker::rotateXAxis, without allocating
+ */
+static void rotateXAxis(float rotation[3])
+{
+    cv::Matx33f R;
+    cv::Mat rvec(3,1,CV_32F,rotation),RM(3,3,CV_32F,R.val);
+    cv::Rodrigues(rvec,RM);
+    float angleRad=M_PI/2;
+    cv::Matx33f RX(1,0,0,
+                   0,cos(angleRad),-sin(angleRad),
+                   0,sin(angleRad),cos(angleRad));
+    R=R*RX;
+    cv::Rodrigues(RM,rvec);
+}
+/**Copies a 3 element vector of any float depth
+ */
+static void copyVector3(const cv::Mat &in,float out[3])
+{
+    if (in.total()!=3) throw cv::Exception(9004,"pose vectors must have 3 elements","MarkerRecord::setExtrinsics",__FILE__,__LINE__);
+    for (int i=0;i<3;i++) {
+        int row=in.rows==1?0:i,col=in.rows==1?i:0;
+        out[i]=in.depth()==CV_64F?float(in.at<double>(row,col)):in.at<float>(row,col);
+    }
+}
+/**
+ */
+void MarkerRecord::clear()
+{
+    for (int i=0;i<4;i++) corners[i][0]=corners[i][1]=0;
+    id=-1;
+    for (int i=0;i<3;i++) rvec[i]=tvec[i]=-999999;
+    ssize=-1;
+    perimeter=area=0;
+    contourIdx=-1;
+}
+/**
+ */
+void MarkerRecord::rotateCorners(int n)
+{
+    n=((n%4)+4)%4;
+    if (n==0) return;
+    float aux[4][2];
+    for (int i=0;i<4;i++) {
+        aux[i][0]=corners[(i+n)%4][0];
+        aux[i][1]=corners[(i+n)%4][1];
+    }
+    for (int i=0;i<4;i++) {
+        corners[i][0]=aux[i][0];
+        corners[i][1]=aux[i][1];
+    }
+}
+/**
+ */
+void MarkerRecord::updateMetrics()
+{
+    perimeter=0;
+    float twiceArea=0;
+    for (int i=0;i<4;i++) {
+        int i2=(i+1)%4;
+        float dx=corners[i2][0]-corners[i][0];
+        float dy=corners[i2][1]-corners[i][1];
+        perimeter+=sqrt(dx*dx+dy*dy);
+        twiceArea+=corners[i][0]*corners[i2][1]-corners[i2][0]*corners[i][1];
+    }
+    area=fabs(twiceArea)/2.f;
+}
+/**
+ */
+void MarkerRecord::calculateExtrinsics(float markerSize,const CameraParameters &CP,PoseTracker &tracker,bool setYPerpendicular)
+{
+    if (id==-1) throw cv::Exception(9004,"id==-1: invalid marker. It is not possible to calculate extrinsics","calculateExtrinsics",__FILE__,__LINE__);
+    if (markerSize<=0)throw cv::Exception(9004,"markerSize<=0: invalid markerSize","calculateExtrinsics",__FILE__,__LINE__);
+    if (!CP.isValid()) throw cv::Exception(9004,"!CP.isValid(): invalid camera parameters. It is not possible to calculate extrinsics","calculateExtrinsics",__FILE__,__LINE__);
+    //the tracker writes into these through copyTo, so the pose lands on the stack
+    double raux[3],taux[3];
+    cv::Mat rmat(3,1,CV_64F,raux),tmat(3,1,CV_64F,taux);
+    tracker.estimate(id,markerSize,corners,CP.CameraMatrix,CP.Distorsion,rmat,tmat);
+    copyVector3(rmat,rvec);
+    copyVector3(tmat,tvec);
+    if (setYPerpendicular) rotateXAxis(rvec);
+    ssize=markerSize;
+}
+/**
+ */
+void MarkerRecord::setExtrinsics(const cv::Mat &r,const cv::Mat &t,float markerSize,bool setYPerpendicular)
+{
+    copyVector3(r,rvec);
+    copyVector3(t,tvec);
+    if (setYPerpendicular) rotateXAxis(rvec);
+    ssize=markerSize;
+}
+/**
+ */
+void toMarker(const MarkerRecord &r,Marker &m)
+{
+    m.resize(4);
+    for (int i=0;i<4;i++) m[i]=r.corner(i);
+    m.id=r.id;
+    m.ssize=r.ssize;
+    m.Rvec.create(3,1,CV_32FC1);
+    m.Tvec.create(3,1,CV_32FC1);
+    for (int i=0;i<3;i++) {
+        m.Rvec.at<float>(i,0)=r.rvec[i];
+        m.Tvec.at<float>(i,0)=r.tvec[i];
+    }
+}
+/**
+ */
+void fromMarker(const Marker &m,MarkerRecord &r)
+{
+    r.clear();
+    for (int i=0;i<4 && i<int(m.size());i++) r.setCorner(i,m[i]);
+    r.id=m.id;
+    if (m.ssize>0 && m.Rvec.total()==3 && m.Tvec.total()==3) {
+        cv::Mat rvec,tvec;
+        m.Rvec.convertTo(rvec,CV_32F);
+        m.Tvec.convertTo(tvec,CV_32F);
+        for (int i=0;i<3;i++) {
+            r.rvec[i]=rvec.ptr<float>(0)[i];
+            r.tvec[i]=tvec.ptr<float>(0)[i];
+        }
+        r.ssize=m.ssize;
+    }
+    r.updateMetrics();
+}
+/**
+ */
+void toMarkers(const vector<MarkerRecord> &records,vector<Marker> &markers)
+{
+    markers.resize(records.size());
+    for (size_t i=0;i<records.size();i++) toMarker(records[i],markers[i]);
+}
+}
@@ -0,0 +1,89 @@
+/*****************************
+Copyright 2011 Rafael Muñoz Salinas. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are
+permitted provided that the following conditions are met:
+
+   1. Redistributions of source code must retain the above copyright notice, this list of
+      conditions and the following disclaimer.
+
+   2. Redistributions in binary form must reproduce the above copyright notice, this list
+      of conditions and the following disclaimer in the documentation and/or other materials
+      provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY Rafael Muñoz Salinas ''AS IS'' AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those of the
+authors and should not be interpreted as representing official policies, either expressed
+or implied, of Rafael Muñoz Salinas.
+********************************/
+#ifndef _Aruco_MarkerRecord_H
+#define _Aruco_MarkerRecord_H
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include "exports.h"
+#include "marker.h"
+using namespace std;
+namespace aruco {
+/**\brief Fixed size version of Marker used inside the detection pipeline
+ *
+ * Marker is a vector of corners with two cv::Mat for the pose, so every marker allocates and copies are deep.
+ * A MarkerRecord owns no memory and is trivially copyable: a vector of them that is reused between frames stops
+ * allocating once it has grown to the number of markers seen. The pose estimators (marker, plane, map and boards) work on
+ * records; convert with toMarker/fromMarker only where the Marker api is needed.
+ */
+struct ARUCO_EXPORTS MarkerRecord
+{
+    float corners[4][2];//x,y of the four corners, in the same order as in Marker
+    int id;//-1 for a candidate that has not been identified
+    float rvec[3],tvec[3];//pose with respect to the camera, as in Marker (valid if ssize>0)
+    float ssize;//size of the marker sides in meters, -1 if there is no pose
+    float perimeter;//in pixels
+    float area;//in pixels
+    int contourIdx;//index of the contour it was found in (internal to MarkerDetector)
+
+    /**Sets an unidentified marker without pose
+     */
+    void clear();
+    cv::Point2f corner(int i)const{return cv::Point2f(corners[i][0],corners[i][1]);}
+    void setCorner(int i,const cv::Point2f &p){corners[i][0]=p.x;corners[i][1]=p.y;}
+    bool hasPose()const{return ssize>0;}
+    /**Rotates the corners so that corner n becomes the first one
+     */
+    void rotateCorners(int n);
+    /**Updates perimeter and area from the corners
+     */
+    void updateMetrics();
+    /**Calculates the pose as Marker::calculateExtrinsics with a tracker: starting from the pose the tracker has for this id
+     * @param markerSize size of the marker side expressed in meters
+     * @param CP parmeters of the camera
+     * @param tracker keeps the poses between frames
+     * @param setYPerpendicular If set the Y axis will be perpendicular to the surface. Otherwise, it will be the Z axis
+     */
+    void calculateExtrinsics(float markerSize,const CameraParameters &CP,PoseTracker &tracker,bool setYPerpendicular=true);
+    /**Sets the pose from one computed elsewhere, as Marker::setExtrinsics
+     * @param rvec,tvec 3 element CV_32F or CV_64F pose of the marker as returned by solvePnP for the corners used by calculateExtrinsics
+     */
+    void setExtrinsics(const cv::Mat &rvec,const cv::Mat &tvec,float markerSize,bool setYPerpendicular=true);
+};
+
+/**Copies r into m, reusing the memory m already has
+ */
+void ARUCO_EXPORTS toMarker(const MarkerRecord &r,Marker &m);
+/**Copies m into r; the pose is copied only if m has one
+ */
+void ARUCO_EXPORTS fromMarker(const Marker &m,MarkerRecord &r);
+/**Converts a list of records, reusing the markers already in the output list
+ */
+void ARUCO_EXPORTS toMarkers(const vector<MarkerRecord> &records,vector<Marker> &markers);
+
+}
+#endif
@@ -0,0 +1,167 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+
+#include "OculusARPOC.h"
+#include "posetracker.h"
+#include <opencv2/calib3d/calib3d.hpp>
+#include <cmath>
+using namespace std;
+using namespace cv;
+namespace aruco {
+    /**
+    */
+    PoseTracker::PoseTracker() {
+        _frame=0;
+        _iterations=5;
+        _maxAge=5;
+        _maxReprjErr=3;
+        _warmSolves=_coldSolves=0;
+    }
+
+    /**
+    */
+    bool PoseTracker::getPose ( int key,cv::Mat &rvec,cv::Mat &tvec ) const {
+        map<int,Track>::const_iterator it=_tracks.find ( key );
+        if ( it==_tracks.end() || _frame-it->second.frame>_maxAge ) return false;
+        it->second.rvec.copyTo ( rvec );
+        it->second.tvec.copyTo ( tvec );
+        return true;
+    }
+
+    /**
+    */
+    void PoseTracker::setPose ( int key,const cv::Mat &rvec,const cv::Mat &tvec ) {
+        Track &t=_tracks[key];
+        rvec.convertTo ( t.rvec,CV_64F );
+        tvec.convertTo ( t.tvec,CV_64F );
+        t.frame=_frame;
+    }
+
+    /**
+    */
+    double PoseTracker::estimate ( int key,const vector<cv::Point3f> &objPoints,const vector<cv::Point2f> &imagePoints,const cv::Mat &camMatrix,const cv::Mat &distCoeff,cv::Mat &rvec,cv::Mat &tvec ) {
+        double err=-1;
+        if ( getPose ( key,rvec,tvec ) ) {
+            err=refine ( objPoints,imagePoints,camMatrix,distCoeff,rvec,tvec );
+            if ( err<=_maxReprjErr ) {
+                _warmSolves++;
+                setPose ( key,rvec,tvec );
+                return err;
+            }
+        }
+        //no usable previous pose: solve from scratch, and keep the warm result if it was still the better one
+        cv::solvePnP ( objPoints,imagePoints,camMatrix,distCoeff,_rvecCold,_tvecCold );
+        _rvecCold.convertTo ( _rvecCold,CV_64F );
+        _tvecCold.convertTo ( _tvecCold,CV_64F );
+        double coldErr=sqrt ( residuals ( objPoints,imagePoints,camMatrix,distCoeff,_rvecCold,_tvecCold,0 ) /double ( objPoints.size() ) );
+        _coldSolves++;
+        if ( err<0 || coldErr<err ) {
+            _rvecCold.copyTo ( rvec );
+            _tvecCold.copyTo ( tvec );
+            err=coldErr;
+        }
+        setPose ( key,rvec,tvec );
+        return err;
+    }
+
+    /**
+    */
+    double PoseTracker::estimate ( int key,float markerSize,const float corners[4][2],const cv::Mat &camMatrix,const cv::Mat &distCoeff,cv::Mat &rvec,cv::Mat &tvec ) {
+        float halfSize=markerSize/2.f;
+        _markerObj.resize ( 4 );
+        _markerObj[0]=cv::Point3f ( -halfSize,-halfSize,0 );
+        _markerObj[1]=cv::Point3f ( -halfSize,halfSize,0 );
+        _markerObj[2]=cv::Point3f ( halfSize,halfSize,0 );
+        _markerObj[3]=cv::Point3f ( halfSize,-halfSize,0 );
+        _markerImage.resize ( 4 );
+        for ( int c=0; c<4; c++ ) _markerImage[c]=cv::Point2f ( corners[c][0],corners[c][1] );
+        return estimate ( key,_markerObj,_markerImage,camMatrix,distCoeff,rvec,tvec );
+    }
+
+    /**
+    */
+    double PoseTracker::residuals ( const vector<cv::Point3f> &objPoints,const vector<cv::Point2f> &imagePoints,const cv::Mat &camMatrix,const cv::Mat &distCoeff,const cv::Mat &rvec,const cv::Mat &tvec,cv::Mat *jacobian ) {
+        if ( jacobian ) cv::projectPoints ( objPoints,rvec,tvec,camMatrix,distCoeff,_projected,*jacobian );
+        else cv::projectPoints ( objPoints,rvec,tvec,camMatrix,distCoeff,_projected );
+        _residuals.create ( 2*int ( objPoints.size() ),1,CV_64F );
+        double *r=_residuals.ptr<double> ( 0 );
+        double sum=0;
+        for ( size_t i=0; i<_projected.size(); i++ ) {
+            r[2*i]=imagePoints[i].x-_projected[i].x;
+            r[2*i+1]=imagePoints[i].y-_projected[i].y;
+            sum+=r[2*i]*r[2*i]+r[2*i+1]*r[2*i+1];
+        }
+        return sum;
+    }
+
+    /**Levenberg-Marquardt on the 6 pose parameters, using the jacobian given by projectPoints
+     */
+    double PoseTracker::refine ( const vector<cv::Point3f> &objPoints,const vector<cv::Point2f> &imagePoints,const cv::Mat &camMatrix,const cv::Mat &distCoeff,cv::Mat &rvec,cv::Mat &tvec ) {
+        double lambda=1e-3;
+        double err=residuals ( objPoints,imagePoints,camMatrix,distCoeff,rvec,tvec,&_jacobian );
+        double A[36],g[6];
+        for ( int it=0; it<_iterations; it++ ) {
+            //normal equations J^t J d = J^t r, only the rvec and tvec columns of the jacobian are needed
+            const double *r=_residuals.ptr<double> ( 0 );
+            for ( int a=0; a<6; a++ ) {
+                g[a]=0;
+                for ( int b=0; b<6; b++ ) A[a*6+b]=0;
+            }
+            for ( int row=0; row<_jacobian.rows; row++ ) {
+                const double *J=_jacobian.ptr<double> ( row );
+                for ( int a=0; a<6; a++ ) {
+                    g[a]+=J[a]*r[row];
+                    for ( int b=a; b<6; b++ ) A[a*6+b]+=J[a]*J[b];
+                }
+            }
+            for ( int a=0; a<6; a++ ) {
+                for ( int b=0; b<a; b++ ) A[a*6+b]=A[b*6+a];
+                A[a*6+a]*= ( 1+lambda );
+            }
+            cv::Mat AM ( 6,6,CV_64F,A ),gM ( 6,1,CV_64F,g ),delta;
+            if ( !cv::solve ( AM,gM,delta,cv::DECOMP_CHOLESKY ) ) break;
+            _rvecTry=rvec+delta.rowRange ( 0,3 );
+            _tvecTry=tvec+delta.rowRange ( 3,6 );
+            double newErr=residuals ( objPoints,imagePoints,camMatrix,distCoeff,_rvecTry,_tvecTry,&_jacobianTry );
+            if ( newErr<err ) {
+                bool converged= ( err-newErr ) < 1e-6*err;
+                _rvecTry.copyTo ( rvec );
+                _tvecTry.copyTo ( tvec );
+                cv::swap ( _jacobian,_jacobianTry );
+                err=newErr;
+                lambda*=0.1;
+                if ( converged ) break;
+            } else {
+                //rejected step: the residuals must match the current pose again
+                residuals ( objPoints,imagePoints,camMatrix,distCoeff,rvec,tvec,0 );
+                lambda*=10;
+            }
+        }
+        return sqrt ( err/double ( objPoints.size() ) );
+    }
+};
@@ -0,0 +1,116 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#ifndef _Aruco_PoseTracker_H
+#define _Aruco_PoseTracker_H
+#include <opencv2/core/core.hpp>
+#include <map>
+#include <vector>
+#include "exports.h"
+using namespace std;
+
+namespace aruco
+{
+
+/**\brief Frame to frame pose estimation for markers and boards
+ *
+ * Instead of solving every pose from scratch, the previous solution of the same marker (or board), identified by a key,
+ * is used as the starting point of a few Levenberg-Marquardt iterations on the reprojection error.
+ * Starting from the previous pose keeps the solver in the same basin, so planar targets no longer flip between their
+ * two ambiguous solutions from one frame to the next, and converging from a good guess needs far fewer iterations.
+ * When there is no recent pose, or the refined pose reprojects worse than the threshold, a cold solvePnP is done.
+ * Poses are expressed as returned by solvePnP (no Y perpendicular rotation).
+ */
+class ARUCO_EXPORTS  PoseTracker
+{
+public:
+    PoseTracker();
+
+    /**Estimates the pose of the given correspondences, warm-starting from the last pose stored for key.
+     * The result is stored for the next frame.
+     * @param rvec,tvec output pose (3x1 CV_64F)
+     * @return root mean square reprojection error in pixels
+     */
+    double estimate(int key,const vector<cv::Point3f> &objPoints,const vector<cv::Point2f> &imagePoints,const cv::Mat &camMatrix,const cv::Mat &distCoeff,cv::Mat &rvec,cv::Mat &tvec);
+    /**Same for a single square marker of side markerSize, corners in the order used by Marker::calculateExtrinsics.
+     * The correspondences go in buffers of the tracker, so nothing is allocated once they exist
+     */
+    double estimate(int key,float markerSize,const float corners[4][2],const cv::Mat &camMatrix,const cv::Mat &distCoeff,cv::Mat &rvec,cv::Mat &tvec);
+
+    /**Returns in rvec,tvec the last pose stored for key, if it is recent enough
+     */
+    bool getPose(int key,cv::Mat &rvec,cv::Mat &tvec)const;
+    /**Stores a pose computed elsewhere (e.g. a robust board estimation) as the starting point for the next frame
+     */
+    void setPose(int key,const cv::Mat &rvec,const cv::Mat &tvec);
+
+    /**Call once per frame; poses not updated for more than getMaxAge() frames are no longer used
+     * @param frames number of frames that went by, for callers that skip frames in which there is nothing to track
+     */
+    void newFrame(int frames=1){_frame+=frames;}
+    void reset(){_tracks.clear();}
+
+    /**Reprojection error (pixels, RMS) above which a warm-started solution is discarded and solved cold
+     */
+    void setMaxReprjErr(double err){_maxReprjErr=err;}
+    double getMaxReprjErr()const{return _maxReprjErr;}
+    /**Maximum number of Levenberg-Marquardt iterations from the previous pose
+     */
+    void setIterations(int n){_iterations=n;}
+    int getIterations()const{return _iterations;}
+    void setMaxAge(int frames){_maxAge=frames;}
+    int getMaxAge()const{return _maxAge;}
+
+    /**Number of poses solved from the previous pose and from scratch since construction
+     */
+    int getWarmSolves()const{return _warmSolves;}
+    int getColdSolves()const{return _coldSolves;}
+
+private:
+    struct Track {
+        cv::Mat rvec,tvec;
+        int frame;
+    };
+    /**Refines rvec,tvec in place, returns the rms reprojection error
+     */
+    double refine(const vector<cv::Point3f> &objPoints,const vector<cv::Point2f> &imagePoints,const cv::Mat &camMatrix,const cv::Mat &distCoeff,cv::Mat &rvec,cv::Mat &tvec);
+    /**Fills _residuals (and the jacobian if given) and returns the sum of squared residuals
+     */
+    double residuals(const vector<cv::Point3f> &objPoints,const vector<cv::Point2f> &imagePoints,const cv::Mat &camMatrix,const cv::Mat &distCoeff,const cv::Mat &rvec,const cv::Mat &tvec,cv::Mat *jacobian);
+
+    std::map<int,Track> _tracks;
+    int _frame,_iterations,_maxAge;
+    double _maxReprjErr;
+    int _warmSolves,_coldSolves;
+    //buffers reused between calls
+    vector<cv::Point2f> _projected,_markerImage;
+    vector<cv::Point3f> _markerObj;
+    cv::Mat _residuals,_jacobian,_jacobianTry,_rvecTry,_tvecTry,_rvecCold,_tvecCold;
+};
+
+};
+#endif
@@ -0,0 +1,195 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "OculusARPOC.h"
+#include "ARDebugDraw.h"
+#include "AllocationCounter.h"
+
+/*
+ The debug draw channel, built as in development builds (UE_BUILD_SHIPPING 0): what is recorded for which categories,
+ that a disabled category costs no argument evaluation, and that a frame's commands reach the output once and then
+ leave the channel without it allocating again.  ARDebugDraw::Draw is stood in for here instead of ARDebugDrawOutput.cpp:
+ it copies the commands it is given.
+ */
+
+struct DrawnCommand
+{
+	int32 Type;
+	FColor Color;
+	float Radius;
+	float Seconds;
+	FVector A;
+	FVector B;
+	const TCHAR* Label;
+};
+
+static DrawnCommand Drawn[64];
+static int32 NumDrawn = 0;
+static int32 NumDraws = 0;
+
+void ARDebugDraw::Draw(UWorld* /*World*/) const
+{
+	NumDraws++;
+	NumDrawn = 0;
+	for (int32 i = 0; i < Commands.Num() && i < 64; i++) {
+		const Command& Current = Commands[i];
+		DrawnCommand& Out = Drawn[NumDrawn++];
+		Out.Type = Current.Type;
+		Out.Color = Current.Color;
+		Out.Radius = Current.Radius;
+		Out.Seconds = Current.Seconds;
+		Out.A = Current.A;
+		Out.B = Current.B;
+		Out.Label = Current.Label;
+	}
+}
+
+static UWorld World;
+
+/* Empties the channel and enables every category */
+static void ResetChannel()
+{
+	ARDebugDraw::Get().SetEnabledCategories(ARDebugCategory::All);
+	AR_DEBUG_DRAW_FLUSH(&World);
+	NumDraws = 0;
+	NumDrawn = 0;
+}
+
+static int32 Evaluations = 0;
+
+static FVector Evaluated(const FVector& Value)
+{
+	Evaluations++;
+	return Value;
+}
+
+AR_TEST(CommandsReachTheOutputInOrder)
+{
+	ResetChannel();
+	AR_DEBUG_SPHERE(Hands, FVector(1.f, 2.f, 3.f), 4.f, FColor::Red);
+	AR_DEBUG_LINE(Gaze, FVector(0.f, 0.f, 0.f), FVector(10.f, 0.f, 0.f), FColor::Red);
+	AR_DEBUG_CYLINDER(Markers, FVector(0.f, 0.f, 0.f), FVector(0.f, 0.f, 5.f), 2.f, FColor::Red);
+	AR_DEBUG_VALUE(MarkerValues, "Camera", FVector(7.f, 8.f, 9.f));
+	AR_DEBUG_VALUE(MarkerValues, "Spawn rotation", FRotator(10.f, 20.f, 30.f), 5.f);
+	AR_DEBUG_SPHERE(Touch, FVector(0.f, 0.f, 0.f), 1.f, FColor::Red, 2.f);
+	AR_DEBUG_DRAW_FLUSH(&World);
+	AR_CHECK(NumDraws == 1);
+	AR_CHECK(NumDrawn == 6);
+	AR_CHECK(Drawn[0].A == FVector(1.f, 2.f, 3.f) && Drawn[0].Radius == 4.f && Drawn[0].Seconds == 0.f && Drawn[0].Color == FColor::Red);
+	AR_CHECK(Drawn[1].B == FVector(10.f, 0.f, 0.f));
+	AR_CHECK(Drawn[2].B == FVector(0.f, 0.f, 5.f) && Drawn[2].Radius == 2.f);
+	AR_CHECK(strcmp(Drawn[3].Label, "Camera") == 0 && Drawn[3].A == FVector(7.f, 8.f, 9.f) && Drawn[3].Color == FColor::Yellow);
+	AR_CHECK(strcmp(Drawn[4].Label, "Spawn rotation") == 0 && Drawn[4].A == FVector(10.f, 20.f, 30.f) && Drawn[4].Seconds == 5.f);
+	AR_CHECK(Drawn[4].Type != Drawn[3].Type);
+	AR_CHECK(Drawn[5].Seconds == 2.f);
+}
+
+AR_TEST(FlushEmptiesTheChannel)
+{
+	ResetChannel();
+	AR_DEBUG_SPHERE(Hands, FVector(0.f, 0.f, 0.f), 1.f, FColor::Red);
+	AR_DEBUG_DRAW_FLUSH(&World);
+	AR_DEBUG_DRAW_FLUSH(&World);
+	AR_CHECK(NumDraws == 1); // nothing recorded, nothing drawn
+	AR_DEBUG_LINE(Gaze, FVector(0.f, 0.f, 0.f), FVector(1.f, 0.f, 0.f), FColor::Red);
+	AR_DEBUG_DRAW_FLUSH(&World);
+	AR_CHECK(NumDraws == 2);
+	AR_CHECK(NumDrawn == 1);
+}
+
+AR_TEST(DisabledCategoriesRecordNothing)
+{
+	ResetChannel();
+	ARDebugDraw::Get().SetEnabledCategories(ARDebugCategory::Hands | ARDebugCategory::Gaze);
+	AR_CHECK(AR_DEBUG_DRAW_IS_ENABLED(Hands));
+	AR_CHECK(!AR_DEBUG_DRAW_IS_ENABLED(Touch));
+	AR_DEBUG_SPHERE(Touch, FVector(0.f, 0.f, 0.f), 1.f, FColor::Red);
+	AR_DEBUG_VALUE(MarkerValues, "Camera", FVector(0.f, 0.f, 0.f));
+	AR_DEBUG_LINE(Gaze, FVector(0.f, 0.f, 0.f), FVector(1.f, 0.f, 0.f), FColor::Red);
+	// the functions check too, for callers that don't go through the macros
+	ARDebugDraw::Get().Cylinder(ARDebugCategory::Markers, FVector(0.f, 0.f, 0.f), FVector(0.f, 0.f, 1.f), 1.f, FColor::Red);
+	AR_DEBUG_DRAW_FLUSH(&World);
+	AR_CHECK(NumDrawn == 1);
+	ARDebugDraw::Get().SetEnabledCategories(0);
+	AR_DEBUG_SPHERE(Hands, FVector(0.f, 0.f, 0.f), 1.f, FColor::Red);
+	AR_DEBUG_DRAW_FLUSH(&World);
+	AR_CHECK(NumDraws == 1);
+}
+
+AR_TEST(DisabledCategoriesDontEvaluateArguments)
+{
+	ResetChannel();
+	ARDebugDraw::Get().SetEnabledCategories(ARDebugCategory::Hands);
+	Evaluations = 0;
+	AR_DEBUG_SPHERE(Touch, Evaluated(FVector(0.f, 0.f, 0.f)), 1.f, FColor::Red);
+	AR_DEBUG_VALUE(MarkerValues, "Camera", Evaluated(FVector(0.f, 0.f, 0.f)));
+	AR_CHECK(Evaluations == 0);
+	AR_DEBUG_SPHERE(Hands, Evaluated(FVector(0.f, 0.f, 0.f)), 1.f, FColor::Red);
+	AR_CHECK(Evaluations == 1);
+}
+
+AR_TEST(MacrosAreStatements)
+{
+	ResetChannel();
+	bool Near = false;
+	if (Near)
+		AR_DEBUG_SPHERE(Hands, FVector(0.f, 0.f, 0.f), 1.f, FColor::Red);
+	else
+		AR_DEBUG_LINE(Hands, FVector(0.f, 0.f, 0.f), FVector(1.f, 0.f, 0.f), FColor::Red);
+	AR_DEBUG_DRAW_FLUSH(&World);
+	AR_CHECK(NumDrawn == 1);
+	AR_CHECK(Drawn[0].B == FVector(1.f, 0.f, 0.f));
+}
+
+AR_TEST(SteadyFramesDontAllocate)
+{
+	ResetChannel();
+	for (int32 Frame = 0; Frame < 2; Frame++) { // the first frame grows the command array
+		for (int32 i = 0; i < 40; i++) {
+			AR_DEBUG_SPHERE(Hands, FVector((float)i, 0.f, 0.f), 1.f, FColor::Red);
+		}
+		AR_DEBUG_VALUE(MarkerValues, "Camera", FVector(0.f, 0.f, 0.f));
+		AR_DEBUG_DRAW_FLUSH(&World);
+	}
+	AllocationCounter::StartCounting();
+	for (int32 Frame = 0; Frame < 100; Frame++) {
+		for (int32 i = 0; i < 40; i++) {
+			AR_DEBUG_SPHERE(Hands, FVector((float)i, 0.f, 0.f), 1.f, FColor::Red);
+		}
+		AR_DEBUG_VALUE(MarkerValues, "Camera", FVector(0.f, 0.f, 0.f));
+		AR_DEBUG_DRAW_FLUSH(&World);
+	}
+	int64 Allocations = AllocationCounter::StopCounting();
+	AR_CHECK(Allocations == 0);
+	AR_CHECK(NumDrawn == 41);
+}
+
+int main()
+{
+	return RunTests();
+}
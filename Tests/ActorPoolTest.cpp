@@ -0,0 +1,256 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "OculusARPOC.h"
+#include "ActorPool.h"
+
+/*
+ ActorPool's bookkeeping.  Spawn, Activate and Deactivate are stood in for here instead of ActorPoolActors.cpp: they
+ create plain AActors, record where and whether each actor is active, and can be made to fail.  Deleting an actor
+ stands in for the world destroying it behind the pool's back.
+ */
+
+struct ActorState
+{
+	bool Active;
+	FVector Location;
+};
+
+static std::map<AActor*, ActorState> States;
+static int32 NumSpawned = 0;
+static bool FailSpawns = false;
+
+AActor* ActorPool::Spawn(UWorld* /*World*/, UClass* Class, const FVector& Location, const FRotator& /*Rotation*/, APawn* /*Instigator*/)
+{
+	if (FailSpawns) return NULL;
+	AActor* Actor = new AActor(Class);
+	ActorState& State = States[Actor];
+	State.Active = true;
+	State.Location = Location;
+	NumSpawned++;
+	return Actor;
+}
+
+void ActorPool::Activate(AActor* Actor, const FVector& Location, const FRotator& /*Rotation*/)
+{
+	AR_CHECK(!States[Actor].Active);
+	States[Actor].Active = true;
+	States[Actor].Location = Location;
+}
+
+void ActorPool::Deactivate(AActor* Actor)
+{
+	AR_CHECK(States[Actor].Active);
+	States[Actor].Active = false;
+}
+
+static void Destroy(AActor* Actor)
+{
+	States.erase(Actor);
+	delete Actor;
+}
+
+static void ResetWorld()
+{
+	for (std::map<AActor*, ActorState>::iterator It = States.begin(); It != States.end(); ++It) {
+		delete It->first;
+	}
+	States.clear();
+	NumSpawned = 0;
+	FailSpawns = false;
+}
+
+static UWorld World;
+static UClass PropClass;
+static UClass WindowClass;
+
+AR_TEST(PrewarmSpawnsFreeActorsUpToCount)
+{
+	ResetWorld();
+	ActorPool Pool;
+	Pool.Prewarm(&World, &PropClass, 3, NULL);
+	AR_CHECK(NumSpawned == 3);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 3);
+	for (std::map<AActor*, ActorState>::iterator It = States.begin(); It != States.end(); ++It) {
+		AR_CHECK(!It->second.Active);
+	}
+	Pool.Prewarm(&World, &PropClass, 2, NULL);
+	Pool.Prewarm(&World, &PropClass, 3, NULL);
+	AR_CHECK(NumSpawned == 3);
+	Pool.Prewarm(&World, &PropClass, 4, NULL);
+	AR_CHECK(NumSpawned == 4);
+	AR_CHECK(Pool.GetNumSpawnMisses() == 0);
+}
+
+AR_TEST(AcquireReusesAFreeActor)
+{
+	ResetWorld();
+	ActorPool Pool;
+	Pool.Prewarm(&World, &PropClass, 1, NULL);
+	AActor* Actor = Pool.Acquire(&World, &PropClass, FVector(1.f, 2.f, 3.f), FRotator::ZeroRotator, NULL);
+	AR_CHECK(Actor != NULL);
+	AR_CHECK(NumSpawned == 1);
+	AR_CHECK(Pool.GetNumSpawnMisses() == 0);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 0);
+	AR_CHECK(States[Actor].Active);
+	AR_CHECK(States[Actor].Location == FVector(1.f, 2.f, 3.f));
+}
+
+AR_TEST(AcquireSpawnsWhenNoneIsFree)
+{
+	ResetWorld();
+	ActorPool Pool;
+	AActor* First = Pool.Acquire(&World, &PropClass, FVector(5.f, 0.f, 0.f), FRotator::ZeroRotator, NULL);
+	AActor* Second = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	AR_CHECK(First != NULL && Second != NULL && First != Second);
+	AR_CHECK(NumSpawned == 2);
+	AR_CHECK(Pool.GetNumSpawnMisses() == 2);
+	AR_CHECK(States[First].Location == FVector(5.f, 0.f, 0.f));
+}
+
+AR_TEST(ReleaseHandsTheActorBackForTheNextAcquire)
+{
+	ResetWorld();
+	ActorPool Pool;
+	AActor* Actor = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	Pool.Release(Actor);
+	AR_CHECK(!States[Actor].Active);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 1);
+	AR_CHECK(Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL) == Actor);
+	AR_CHECK(NumSpawned == 1);
+	AR_CHECK(Pool.GetNumSpawnMisses() == 1);
+}
+
+AR_TEST(ReleaseIgnoresActorsThePoolDidNotHandOut)
+{
+	ResetWorld();
+	ActorPool Pool;
+	AActor* Stranger = new AActor(&PropClass);
+	States[Stranger].Active = true;
+	Pool.Release(Stranger);
+	Pool.Release(NULL);
+	AR_CHECK(States[Stranger].Active);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 0);
+
+	// nor twice: the second release must not deactivate it again or free it twice
+	AActor* Actor = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	Pool.Release(Actor);
+	Pool.Release(Actor);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 1);
+}
+
+AR_TEST(ClassesAreKeptApart)
+{
+	ResetWorld();
+	ActorPool Pool;
+	Pool.Prewarm(&World, &WindowClass, 1, NULL);
+	AActor* Prop = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	AR_CHECK(Prop->GetClass() == &PropClass);
+	AR_CHECK(Pool.GetNumSpawnMisses() == 1);
+	AR_CHECK(Pool.GetNumFree(&WindowClass) == 1);
+	Pool.Release(Prop);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 1);
+	AR_CHECK(Pool.GetNumFree(&WindowClass) == 1);
+}
+
+AR_TEST(DestroyedFreeActorsAreNeverHandedOut)
+{
+	ResetWorld();
+	ActorPool Pool;
+	Pool.Prewarm(&World, &PropClass, 2, NULL);
+	AActor* Survivor = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	Pool.Release(Survivor);
+	AActor* Doomed = NULL;
+	for (std::map<AActor*, ActorState>::iterator It = States.begin(); It != States.end(); ++It) {
+		if (It->first != Survivor) Doomed = It->first;
+	}
+	Destroy(Doomed);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 1);
+	AR_CHECK(Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL) == Survivor);
+	AActor* Spawned = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	AR_CHECK(Spawned != NULL && Spawned != Survivor);
+	AR_CHECK(Pool.GetNumSpawnMisses() == 1);
+}
+
+AR_TEST(PrewarmReplacesDestroyedFreeActors)
+{
+	ResetWorld();
+	ActorPool Pool;
+	Pool.Prewarm(&World, &PropClass, 2, NULL);
+	Destroy(States.begin()->first);
+	Pool.Prewarm(&World, &PropClass, 2, NULL);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 2);
+	AR_CHECK(NumSpawned == 3);
+}
+
+AR_TEST(ActorsDestroyedInUseAreForgotten)
+{
+	ResetWorld();
+	ActorPool Pool;
+	AActor* Doomed = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	AActor* Other = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	Destroy(Doomed);
+	Pool.Release(Other);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 1);
+	AR_CHECK(Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL) == Other);
+}
+
+AR_TEST(FailedSpawnsReturnNull)
+{
+	ResetWorld();
+	ActorPool Pool;
+	FailSpawns = true;
+	Pool.Prewarm(&World, &PropClass, 2, NULL);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 0);
+	AR_CHECK(Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL) == NULL);
+	AR_CHECK(Pool.GetNumSpawnMisses() == 0);
+	AR_CHECK(Pool.Acquire(NULL, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL) == NULL);
+	FailSpawns = false;
+	AR_CHECK(Pool.Acquire(&World, NULL, FVector::ZeroVector, FRotator::ZeroRotator, NULL) == NULL);
+	AR_CHECK(NumSpawned == 0);
+}
+
+AR_TEST(EmptyForgetsEverything)
+{
+	ResetWorld();
+	ActorPool Pool;
+	Pool.Prewarm(&World, &PropClass, 2, NULL);
+	AActor* Actor = Pool.Acquire(&World, &PropClass, FVector::ZeroVector, FRotator::ZeroRotator, NULL);
+	Pool.Empty();
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 0);
+	Pool.Release(Actor);
+	AR_CHECK(Pool.GetNumFree(&PropClass) == 0);
+	AR_CHECK(States[Actor].Active);
+}
+
+int main()
+{
+	int Result = RunTests();
+	ResetWorld();
+	return Result;
+}
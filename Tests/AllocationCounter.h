@@ -0,0 +1,68 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "OculusARPOC.h"
+
+/*
+ Counts heap allocations by replacing glibc's malloc, calloc and realloc (so it works on Linux only), for tests and
+ benchmarks that check a path doesn't allocate.  It defines those functions, so include it in one source file of an
+ executable only.  Allocations are counted between StartCounting and StopCounting, on every thread.
+ */
+extern "C" void* __libc_malloc(size_t Size);
+extern "C" void* __libc_calloc(size_t Count, size_t Size);
+extern "C" void* __libc_realloc(void* Pointer, size_t Size);
+
+namespace AllocationCounter
+{
+	static volatile bool Counting = false;
+	static int64 Allocations = 0;
+
+	inline void StartCounting() { Allocations = 0; Counting = true; }
+
+	/* Returns the allocations since StartCounting */
+	inline int64 StopCounting() { Counting = false; return Allocations; }
+}
+
+extern "C" void* malloc(size_t Size)
+{
+	if (AllocationCounter::Counting) AllocationCounter::Allocations++;
+	return __libc_malloc(Size);
+}
+
+extern "C" void* calloc(size_t Count, size_t Size)
+{
+	if (AllocationCounter::Counting) AllocationCounter::Allocations++;
+	return __libc_calloc(Count, Size);
+}
+
+extern "C" void* realloc(void* Pointer, size_t Size)
+{
+	if (AllocationCounter::Counting) AllocationCounter::Allocations++;
+	return __libc_realloc(Pointer, Size);
+}
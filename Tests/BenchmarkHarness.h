@@ -0,0 +1,64 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "OculusARPOC.h"
+
+/*
+ Benchmark support: Benchmark::Run times a function over a number of iterations (after a warm-up run) and prints the
+ time per iteration.  Benchmarks are also run by ctest with a short iteration count, so they keep building and working.
+ */
+namespace Benchmark
+{
+	/* Iteration count from the first command line argument, or Default */
+	inline int32 GetIterations(int argc, char** argv, int32 Default)
+	{
+		return argc > 1 ? FMath::Max(1, atoi(argv[1])) : Default;
+	}
+
+	/* Runs Function Iterations times and returns the seconds per iteration; Units is what one iteration processes, for the report */
+	template<typename FunctionType>
+	double Run(const char* Name, int32 Iterations, double Units, const char* UnitName, FunctionType Function)
+	{
+		Function(); // warm-up: caches, lazily grown buffers
+		double Start = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Iterations; i++) {
+			Function();
+		}
+		double Seconds = (FPlatformTime::Seconds() - Start) / Iterations;
+		printf("%-48s %10.1f ns/iteration %10.2f ns/%s\n", Name, Seconds * 1e9, Seconds * 1e9 / Units, UnitName);
+		return Seconds;
+	}
+
+	/* Keeps the optimizer from dropping a computation whose result is otherwise unused */
+	template<typename T>
+	inline void DoNotOptimize(const T& Value)
+	{
+		asm volatile("" : : "g"(&Value) : "memory");
+	}
+}
@@ -0,0 +1,179 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "BenchmarkHarness.h"
+#include "MarkerFixtures.h"
+
+/*
+ Board pose estimation over a synthetic camera trajectory (see MarkerFixtures): the BoardDetector::detect aruco shipped
+ with (copied below as LegacyBoardDetect) against the current one, for speed and pose error.  Both detectors use the 4 px
+ reprojection threshold ArucoMarkerDetector sets.
+ Usage: BoardDetectorBenchmark [iterations]
+ */
+
+using namespace MarkerFixtures;
+
+static const float ReprojectionThreshold = 4.f;
+static const int32 NumFrames = 600;
+
+/* BoardDetector::detect as shipped with aruco, without the Y perpendicular rotation neither benchmark uses */
+static float LegacyBoardDetect(const std::vector<aruco::Marker>& detectedMarkers, const aruco::BoardConfiguration& BConf, aruco::Board& Bdetected, cv::Mat camMatrix, cv::Mat distCoeff, float repj_err_thres)
+{
+	float ssize = cv::norm(BConf[0][0] - BConf[0][1]);
+	Bdetected.clear();
+	for (unsigned int i = 0; i < detectedMarkers.size(); i++) {
+		int idx = BConf.getIndexOfMarkerId(detectedMarkers[i].id);
+		if (idx != -1) {
+			Bdetected.push_back(detectedMarkers[i]);
+			Bdetected.back().ssize = ssize;
+		}
+	}
+	Bdetected.conf = BConf;
+	if (Bdetected.size() >= 1) {
+		// the shipped version never deleted these five vectors; they are freed here so the benchmark doesn't grow
+		std::vector<cv::Point3f>* objPoints = new std::vector<cv::Point3f>();
+		std::vector<cv::Point2f>* imagePoints = new std::vector<cv::Point2f>();
+		for (size_t i = 0; i < Bdetected.size(); i++) {
+			int idx = Bdetected.conf.getIndexOfMarkerId(Bdetected[i].id);
+			check(idx != -1);
+			for (int p = 0; p < 4; p++) {
+				(*imagePoints).push_back(Bdetected[i][p]);
+				const aruco::MarkerInfo& Minfo = Bdetected.conf.getMarkerInfo(Bdetected[i].id);
+				(*objPoints).push_back(Minfo[p]);
+			}
+		}
+		if (distCoeff.total() == 0) distCoeff = cv::Mat::zeros(1, 4, CV_32FC1);
+		cv::Mat rvec, tvec;
+		cv::solvePnP(*objPoints, *imagePoints, camMatrix, distCoeff, rvec, tvec);
+		rvec.convertTo(Bdetected.Rvec, CV_32FC1);
+		tvec.convertTo(Bdetected.Tvec, CV_32FC1);
+		std::vector<cv::Point2f>* reprojected = new std::vector<cv::Point2f>();
+		cv::projectPoints(*objPoints, rvec, tvec, camMatrix, distCoeff, *reprojected);
+		double errSum = 0;
+		for (size_t i = 0; i < (*reprojected).size(); i++) {
+			errSum += cv::norm((*reprojected)[i] - (*imagePoints)[i]);
+		}
+		Benchmark::DoNotOptimize(errSum);
+		std::vector<cv::Point3f>* objPoints_filtered = new std::vector<cv::Point3f>();
+		std::vector<cv::Point2f>* imagePoints_filtered = new std::vector<cv::Point2f>();
+		if (repj_err_thres > 0) {
+			cv::projectPoints(*objPoints, rvec, tvec, camMatrix, distCoeff, *reprojected);
+			std::vector<int> pointsThatPassTest;
+			for (size_t i = 0; i < (*reprojected).size(); i++) {
+				float err = cv::norm((*reprojected)[i] - (*imagePoints)[i]);
+				if (err < repj_err_thres) pointsThatPassTest.push_back(i);
+			}
+			for (size_t i = 0; i < pointsThatPassTest.size(); i++) {
+				(*objPoints_filtered).push_back((*objPoints)[pointsThatPassTest[i]]);
+				(*imagePoints_filtered).push_back((*imagePoints)[pointsThatPassTest[i]]);
+			}
+			// as shipped: solved again with the unfiltered points
+			cv::solvePnP(*objPoints, *imagePoints, camMatrix, distCoeff, rvec, tvec);
+			rvec.convertTo(Bdetected.Rvec, CV_32FC1);
+			tvec.convertTo(Bdetected.Tvec, CV_32FC1);
+		}
+		delete objPoints;
+		delete imagePoints;
+		delete reprojected;
+		delete objPoints_filtered;
+		delete imagePoints_filtered;
+	}
+	return float(Bdetected.size()) / double(Bdetected.conf.size());
+}
+
+struct PoseError
+{
+	PoseError() : RotationSum(0.0), RotationMax(0.0), TranslationSum(0.0), TranslationMax(0.0), NumPoses(0) {}
+
+	void Add(const aruco::Board& Detected, const Frame& Truth)
+	{
+		cv::Mat Rvec, Tvec, Estimated, Actual;
+		Detected.Rvec.convertTo(Rvec, CV_64F);
+		Detected.Tvec.convertTo(Tvec, CV_64F);
+		cv::Rodrigues(Rvec, Estimated);
+		cv::Rodrigues(Truth.Rvec, Actual);
+		cv::Mat Difference = Estimated.t() * Actual;
+		double Angle = acos(FMath::Clamp((cv::trace(Difference)[0] - 1.0) / 2.0, -1.0, 1.0)) * 180.0 / PI;
+		double Distance = cv::norm(Tvec - Truth.Tvec) * 1000.0;
+		RotationSum += Angle;
+		RotationMax = FMath::Max(RotationMax, Angle);
+		TranslationSum += Distance;
+		TranslationMax = FMath::Max(TranslationMax, Distance);
+		NumPoses++;
+	}
+
+	void Print(const char* Name) const
+	{
+		printf("%-12s rotation error mean %.3f max %.3f deg, translation error mean %.2f max %.2f mm (%d poses)\n", Name,
+			RotationSum / FMath::Max(1, NumPoses), RotationMax, TranslationSum / FMath::Max(1, NumPoses), TranslationMax, NumPoses);
+	}
+
+	double RotationSum, RotationMax, TranslationSum, TranslationMax;
+	int32 NumPoses;
+};
+
+int main(int argc, char** argv)
+{
+	int32 Iterations = Benchmark::GetIterations(argc, argv, 10);
+
+	aruco::CameraParameters CameraParams = MakeCameraParameters();
+	aruco::BoardConfiguration Config = MakeBoard();
+	std::vector<Frame> Frames;
+	MakeFrames(Config, CameraParams, NumFrames, Frames);
+
+	PoseError LegacyError, CurrentError;
+	aruco::Board Detected;
+	aruco::BoardDetector Detector;
+	Detector.set_repj_err_thres(ReprojectionThreshold);
+	for (int32 f = 0; f < NumFrames; f++) {
+		if (LegacyBoardDetect(Frames[f].Markers, Config, Detected, CameraParams.CameraMatrix, CameraParams.Distorsion, ReprojectionThreshold) > 0.f) {
+			LegacyError.Add(Detected, Frames[f]);
+		}
+		if (Detector.detect(Frames[f].Markers, Config, Detected, CameraParams) > 0.f) {
+			CurrentError.Add(Detected, Frames[f]);
+		}
+	}
+	LegacyError.Print("Legacy");
+	CurrentError.Print("Current");
+
+	Benchmark::Run("Legacy BoardDetector::detect", Iterations, NumFrames, "frame", [&]() {
+		for (int32 f = 0; f < NumFrames; f++) {
+			LegacyBoardDetect(Frames[f].Markers, Config, Detected, CameraParams.CameraMatrix, CameraParams.Distorsion, ReprojectionThreshold);
+		}
+		Benchmark::DoNotOptimize(Detected);
+	});
+	Benchmark::Run("Current BoardDetector::detect", Iterations, NumFrames, "frame", [&]() {
+		for (int32 f = 0; f < NumFrames; f++) {
+			Detector.detect(Frames[f].Markers, Config, Detected, CameraParams);
+		}
+		Benchmark::DoNotOptimize(Detected);
+	});
+
+	// the robust estimation must keep the pose on the board despite the outliers
+	bool Accurate = CurrentError.NumPoses >= NumFrames * 99 / 100 && CurrentError.RotationSum / NumFrames < 1.0 && CurrentError.TranslationSum / NumFrames < 10.0;
+	return Accurate ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "BenchmarkHarness.h"
+#include "HandStreamFixtures.h"
+#include "TouchReplayHarness.h"
+
+/*
+ Cost of the touch gesture path per game frame: a hand recording replayed through TouchReplayHarness (sampling, mapping
+ to the surface and GestureRecognizer::AddSample), and AddSample alone.  Usage: GestureRecognizerBenchmark [iterations]
+ [recording.hand]; without a recording a 60 second synthetic session of taps, scrolls and swipes is used.
+ */
+int main(int argc, char** argv)
+{
+	int32 Iterations = Benchmark::GetIterations(argc, argv, 20);
+	const float Seconds = 60.f;
+	FString RecordingPath = argc > 2 ? FString(argv[2]) : FString(TEXT("GestureRecognizerBenchmark.hand"));
+	if (argc <= 2) {
+		// a 2 second cycle: tap, scroll, swipe right, swipe left
+		TArray<LeapHandSample> Session;
+		HandStreamFixtures::MakeTouchSession(0.0, Seconds, 110.f, [](double T, FVector2D& Finger, FVector2D& Palm, float& Depth) {
+			float Phase = (float)FMath::Fmod((float)T, 2.f);
+			Palm = FVector2D(500.f, 600.f);
+			if (Phase < 0.3f) { // tap
+				Depth = Phase > 0.1f && Phase < 0.2f ? -5.f : 20.f;
+			}
+			else if (Phase < 1.f) { // scroll down 80 pixels
+				Palm.Y += (Phase - 0.3f) * 115.f;
+				Depth = Phase < 0.95f ? -5.f : 20.f;
+			}
+			else { // swipe right then left
+				float Swipe = Phase < 1.5f ? (Phase - 1.f) : (2.f - Phase);
+				Palm.X += Swipe * 800.f;
+				Depth = Phase < 1.95f ? -5.f : 20.f;
+			}
+			Finger = Palm - FVector2D(0.f, 100.f);
+			return true;
+		}, Session);
+		if (!HandStreamFixtures::SaveSession(Session, RecordingPath)) return 1;
+	}
+
+	HandTrackingReplay Replay;
+	if (!Replay.Load(RecordingPath)) return 1;
+	Replay.Looping = false;
+	Replay.StartAt(0.0);
+	TouchReplayHarness Harness;
+	Harness.Run(Replay, 0.0, Seconds, 90.f);
+	printf("%d frames: %d taps, %d drags, %d scrolls, %d flings, %d swipes\n", Harness.NumFrames,
+		Harness.CountEvents(GestureEvent::Tap), Harness.CountEvents(GestureEvent::Drag), Harness.CountEvents(GestureEvent::Scroll),
+		Harness.CountEvents(GestureEvent::Fling), Harness.CountEvents(GestureEvent::Swipe));
+	int32 Frames = FMath::Max(1, Harness.NumFrames);
+
+	Benchmark::Run("Replay + TouchReplayHarness::Step (90 Hz)", Iterations, Frames, "frame", [&]() {
+		Harness.Reset();
+		Harness.Run(Replay, 0.0, Seconds, 90.f);
+		Benchmark::DoNotOptimize(Harness.Events.Num());
+	});
+
+	// the same frames straight into the recognizer, without replay and mapping
+	TArray<FVector2D> Fingers, Palms;
+	TArray<uint8> Touching;
+	for (int32 Frame = 0; Frame < Frames; Frame++) {
+		LeapHandSample Sample;
+		if (!Replay.GetSampleAt(Frame / 90.0, Sample) || !Sample.HasHand(LeapHandSample::Right)) continue;
+		bool IsTouching = false;
+		Fingers.Add(Harness.GetPixelCoordinates(Sample.Hands[LeapHandSample::Right].Joints[2][LeapHandSample::TipJoint], &IsTouching));
+		Palms.Add(Harness.GetPixelCoordinates(Sample.Hands[LeapHandSample::Right].PalmPosition, NULL));
+		Touching.Add(IsTouching ? 1 : 0);
+	}
+	GestureRecognizer Gestures;
+	Benchmark::Run("GestureRecognizer::AddSample", Iterations, FMath::Max(1, Fingers.Num()), "sample", [&]() {
+		Gestures.Reset();
+		int32 Events = 0;
+		for (int32 i = 0; i < Fingers.Num(); i++) {
+			Gestures.AddSample(i / 90.0, Fingers[i], Palms[i], Touching[i] != 0);
+			Events += Gestures.GetEvents().Num();
+		}
+		Benchmark::DoNotOptimize(Events);
+	});
+	return 0;
+}
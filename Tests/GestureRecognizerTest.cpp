@@ -0,0 +1,267 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "HandStreamFixtures.h"
+#include "TouchReplayHarness.h"
+
+/*
+ Gesture recognition from recorded hand streams: each test scripts a right hand in surface pixels, records it at the
+ Leap's 110 frames per second, replays the recording and feeds it through TouchReplayHarness at 90 frames per second,
+ as the game does.  Times are checked to within a frame or two of when the gesture is complete.
+ */
+
+static const float RecordRate = 110.f;
+static const float FrameRate = 90.f;
+static const double Frame = 1.0 / 90.0;
+static const TCHAR* RecordingFile = TEXT("GestureRecognizerTest.hand");
+
+template<typename ScriptType>
+static void RunScript(ScriptType Script, float Seconds, TouchReplayHarness& Harness)
+{
+	TArray<LeapHandSample> Samples;
+	HandStreamFixtures::MakeTouchSession(0.0, Seconds, RecordRate, Script, Samples);
+	AR_CHECK(HandStreamFixtures::SaveSession(Samples, RecordingFile));
+	HandTrackingReplay Replay;
+	AR_CHECK(Replay.Load(RecordingFile));
+	Replay.Looping = false;
+	AR_CHECK(Replay.StartAt(0.0));
+	Harness.Reset();
+	Harness.Run(Replay, 0.0, Seconds, FrameRate);
+}
+
+static float Depth(double T, double TouchStart, double TouchEnd)
+{
+	return T >= TouchStart && T < TouchEnd ? -5.f : 20.f;
+}
+
+AR_TEST(HarnessMapsLikeTheSurface)
+{
+	TouchReplayHarness Harness;
+	float Leap[3];
+	TouchReplayHarness::LeapFromPixels(FVector2D(120.f, 860.f), -1.f, Leap);
+	bool Touching = false;
+	FVector2D Pixels = Harness.GetPixelCoordinates(Leap, &Touching);
+	AR_CHECK_NEAR(Pixels.X, 120.f, 1e-3);
+	AR_CHECK_NEAR(Pixels.Y, 860.f, 1e-3);
+	AR_CHECK(Touching);
+	TouchReplayHarness::LeapFromPixels(FVector2D(120.f, 860.f), 1.f, Leap);
+	Harness.GetPixelCoordinates(Leap, &Touching);
+	AR_CHECK(!Touching);
+}
+
+AR_TEST(ShortStillTouchIsATap)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& /*Palm*/, float& D) {
+		Finger = FVector2D(300.f, 400.f);
+		D = Depth(T, 0.2, 0.35);
+		return true;
+	}, 0.6f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Tap) == 1);
+	AR_CHECK(Harness.Events.Num() == 1); // nothing else: no drag, scroll, swipe or fling
+	int32 Tap = Harness.FindEvent(GestureEvent::Tap);
+	if (Tap != INDEX_NONE) {
+		AR_CHECK_NEAR(Harness.Events[Tap].Time, 0.35, Frame * 1.5); // on release
+		AR_CHECK_NEAR(Harness.Events[Tap].Position.X, 300.f, 0.5);
+		AR_CHECK_NEAR(Harness.Events[Tap].Position.Y, 400.f, 0.5);
+	}
+}
+
+AR_TEST(LongTouchIsNotATap)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& /*Finger*/, FVector2D& /*Palm*/, float& D) {
+		D = Depth(T, 0.2, 0.6);
+		return true;
+	}, 0.8f, Harness);
+	AR_CHECK(Harness.Events.Num() == 0);
+}
+
+AR_TEST(SlowMovingTouchDrags)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& /*Palm*/, float& D) {
+		float Moved = (float)FMath::Clamp(T - 0.3, 0.0, 1.0) * 200.f; // 200 pixels per second from 0.3 to 1.3 s
+		Finger = FVector2D(300.f + Moved, 400.f);
+		D = Depth(T, 0.2, 1.4);
+		return true;
+	}, 1.6f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Tap) == 0);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Fling) == 0); // released after stopping
+	AR_CHECK(Harness.CountEvents(GestureEvent::Swipe) == 0);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Drag) > 50);
+	int32 First = Harness.FindEvent(GestureEvent::Drag);
+	if (First != INDEX_NONE) {
+		AR_CHECK_NEAR(Harness.Events[First].Time, 0.3 + Harness.Touch.Gestures.TapSlopPixels / 200.f, Frame * 1.5); // once past the tap slop
+	}
+	FVector2D Dragged(0.f, 0.f);
+	for (int32 i = 0; i < Harness.Events.Num(); i++) {
+		if (Harness.Events[i].Type == GestureEvent::Drag) Dragged += Harness.Events[i].Delta;
+	}
+	// the deltas add up to the movement since the touch, less what happened within the slop before dragging began
+	AR_CHECK(Dragged.X > 200.f - Harness.Touch.Gestures.TapSlopPixels - 3.f && Dragged.X <= 200.f + 0.5f);
+	AR_CHECK_NEAR(Dragged.Y, 0.f, 0.5);
+}
+
+AR_TEST(FastReleaseFlings)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& /*Palm*/, float& D) {
+		float Moved = (float)FMath::Max(T - 0.3, 0.0) * 1500.f; // keeps moving as it lifts off at 0.5 s
+		Finger = FVector2D(100.f + Moved, 400.f);
+		D = Depth(T, 0.2, 0.5);
+		return true;
+	}, 0.7f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Fling) == 1);
+	int32 Fling = Harness.FindEvent(GestureEvent::Fling);
+	if (Fling != INDEX_NONE) {
+		const GestureEvent& Event = Harness.Events[Fling];
+		AR_CHECK_NEAR(Event.Time, 0.5, Frame * 1.5);
+		AR_CHECK_NEAR(Event.Velocity.X, 1500.f, 1500.f * 0.05f);
+		AR_CHECK_NEAR(Event.Velocity.Y, 0.f, 10.f);
+	}
+}
+
+AR_TEST(PalmMovingVerticallyScrolls)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& /*Finger*/, FVector2D& Palm, float& D) {
+		Palm = FVector2D(500.f, 600.f + (float)FMath::Clamp(T - 0.3, 0.0, 0.6) * 100.f); // 60 pixels down at 100 per second
+		D = Depth(T, 0.2, 1.2);
+		return true;
+	}, 1.4f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Scroll) >= 15);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Scroll) == Harness.Events.Num());
+	float Scrolled = 0.f;
+	for (int32 i = 0; i < Harness.Events.Num(); i++) {
+		AR_CHECK(Harness.Events[i].Delta.Y >= Harness.Touch.Gestures.ScrollStepPixels);
+		Scrolled += Harness.Events[i].Delta.Y;
+	}
+	// everything is scrolled but the remainder below one step
+	AR_CHECK(Scrolled > 60.f - Harness.Touch.Gestures.ScrollStepPixels && Scrolled <= 60.f + 0.5f);
+	int32 First = Harness.FindEvent(GestureEvent::Scroll);
+	if (First != INDEX_NONE) {
+		AR_CHECK_NEAR(Harness.Events[First].Time, 0.3 + Harness.Touch.Gestures.ScrollStepPixels / 100.f, Frame * 1.5);
+	}
+}
+
+AR_TEST(SwipesAreReportedOncePerInterval)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& Palm, float& D) {
+		Palm = FVector2D(-200.f + (float)FMath::Clamp(T - 0.3, 0.0, 1.2) * 1000.f, 600.f); // right at 1000 pixels per second
+		Finger = Palm - FVector2D(0.f, 100.f);
+		D = Depth(T, 0.2, 1.6);
+		return true;
+	}, 1.8f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Swipe) == 3);
+	int32 First = Harness.FindEvent(GestureEvent::Swipe);
+	if (First == INDEX_NONE) return;
+	// soon after the palm has covered SwipeLengthPixels: the fit over the window has to catch up with the sudden start
+	double Covered = 0.3 + Harness.Touch.Gestures.SwipeLengthPixels / 1000.f;
+	AR_CHECK(Harness.Events[First].Time >= Covered - Frame * 0.5);
+	AR_CHECK(Harness.Events[First].Time <= Covered + Frame * 2.5);
+	AR_CHECK(Harness.Events[First].Velocity.X > Harness.Touch.Gestures.SwipeMinVelocity);
+	AR_CHECK(Harness.Events[First].Delta.X >= Harness.Touch.Gestures.SwipeLengthPixels);
+	int32 Second = Harness.FindEvent(GestureEvent::Swipe, First + 1);
+	if (Second == INDEX_NONE) return;
+	// the movement goes on, so the next one comes as soon as MinSecondsBetweenSwipes allows
+	double Interval = Harness.Events[Second].Time - Harness.Events[First].Time;
+	AR_CHECK(Interval >= Harness.Touch.Gestures.MinSecondsBetweenSwipes - 1e-6);
+	AR_CHECK(Interval <= Harness.Touch.Gestures.MinSecondsBetweenSwipes + Frame * 1.01);
+}
+
+AR_TEST(OppositeSwipesAreIndependent)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& Palm, float& D) {
+		// left at 1000 pixels per second for 0.2 s, then straight back
+		float Offset = T < 0.3 ? 0.f : (T < 0.5 ? -(float)(T - 0.3) * 1000.f : -200.f + (float)FMath::Min(T - 0.5, 0.2) * 1000.f);
+		Palm = FVector2D(600.f + Offset, 600.f);
+		Finger = Palm - FVector2D(0.f, 100.f);
+		D = Depth(T, 0.2, 0.9);
+		return true;
+	}, 1.f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Swipe) == 2);
+	int32 Left = Harness.FindEvent(GestureEvent::Swipe);
+	int32 Right = Left == INDEX_NONE ? INDEX_NONE : Harness.FindEvent(GestureEvent::Swipe, Left + 1);
+	if (Right == INDEX_NONE) return;
+	AR_CHECK(Harness.Events[Left].Velocity.X < 0.f);
+	AR_CHECK(Harness.Events[Right].Velocity.X > 0.f);
+	AR_CHECK(Harness.Events[Right].Time < 0.7); // well within MinSecondsBetweenSwipes of the left one
+}
+
+AR_TEST(FramesWithoutTheHandAreSkipped)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& /*Finger*/, FVector2D& /*Palm*/, float& D) {
+		D = Depth(T, 0.2, 0.35);
+		return T < 0.5; // the hand leaves
+	}, 1.f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Tap) == 1);
+	AR_CHECK(Harness.NumFrames < 55); // the replay holds the last frame only briefly, then reports no hand
+}
+
+AR_TEST(VelocityStaysAccurateThroughLongTouches)
+{
+	// an hour of holding still at 90 Hz, at a clock an uptime away from 0, then a steady movement
+	SlidingMotionWindow Window;
+	const double Start = 250000.0;
+	int32 Samples = 3600 * 90;
+	for (int32 i = 0; i < Samples; i++) {
+		Window.Add(Start + i / 90.0, FVector2D(400.f, 300.f));
+	}
+	double MoveStart = Start + Samples / 90.0;
+	for (int32 i = 0; i < 18; i++) {
+		Window.Add(MoveStart + i / 90.0, FVector2D(400.f + i * (123.f / 90.f), 300.f - i * (45.f / 90.f)));
+	}
+	AR_CHECK_NEAR(Window.GetVelocity().X, 123.f, 0.01);
+	AR_CHECK_NEAR(Window.GetVelocity().Y, -45.f, 0.01);
+}
+
+AR_TEST(WindowFitsTheRecentSamplesOnly)
+{
+	SlidingMotionWindow Window;
+	Window.WindowSeconds = 0.1f;
+	AR_CHECK(Window.GetVelocity() == FVector2D::ZeroVector);
+	Window.Add(0.0, FVector2D(0.f, 0.f));
+	AR_CHECK(Window.GetVelocity() == FVector2D::ZeroVector); // needs two samples
+	for (int32 i = 1; i <= 20; i++) { // 100 per second, then 300 per second from 0.1 s
+		double T = i * 0.01;
+		float X = T <= 0.1 ? (float)T * 100.f : 10.f + (float)(T - 0.1) * 300.f;
+		Window.Add(T, FVector2D(X, 0.f));
+	}
+	AR_CHECK(Window.Num() == 11); // 0.1 s to 0.2 s
+	AR_CHECK_NEAR(Window.GetVelocity().X, 300.f, 1e-2);
+	AR_CHECK_NEAR(Window.GetDisplacement().X, 30.f, 1e-3);
+}
+
+int main()
+{
+	return RunTests();
+}
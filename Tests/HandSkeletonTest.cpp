@@ -0,0 +1,166 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "OculusARPOC.h"
+#include "HandSkeleton.h"
+
+/*
+ HandSkeleton's flat layout: the index helpers against each other and against the points SetFromSample copies from a
+ LeapHandSample, a hand dropping out of a frame, and the batch transforms.
+ */
+
+/* A distinct Leap position for every point, so a point landing at the wrong index shows */
+static FVector MakeJoint(int32 Side, int32 Finger, int32 Joint)
+{
+	return FVector(Side * 1000.f + Finger * 100.f + Joint * 10.f, -(Side * 1000.f + Finger * 100.f + Joint * 10.f), 1.f + Joint);
+}
+
+static LeapHandSample MakeSample(uint8 HandsPresent, float Offset)
+{
+	LeapHandSample Sample;
+	FMemory::Memzero(&Sample, sizeof(Sample));
+	Sample.HandsPresent = HandsPresent;
+	for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+		LeapHandSample::Hand& Hand = Sample.Hands[Side];
+		for (int32 Axis = 0; Axis < 3; Axis++) {
+			Hand.PalmPosition[Axis] = Side * 1000.f + 5.f * Axis + Offset;
+			Hand.PalmVelocity[Axis] = Side * 100.f + Axis + Offset;
+		}
+		for (int32 Finger = 0; Finger < LeapHandSample::NumFingers; Finger++) {
+			for (int32 Joint = 0; Joint < LeapHandSample::NumJoints; Joint++) {
+				FVector Position = MakeJoint(Side, Finger, Joint);
+				Hand.Joints[Finger][Joint][0] = Position.X + Offset;
+				Hand.Joints[Finger][Joint][1] = Position.Y + Offset;
+				Hand.Joints[Finger][Joint][2] = Position.Z + Offset;
+			}
+			for (int32 Axis = 0; Axis < 3; Axis++) {
+				Hand.TipVelocity[Finger][Axis] = Side * 100.f + Finger * 10.f + Axis + 0.5f + Offset;
+			}
+		}
+		Hand.Confidence = 0.25f + Side * 0.5f;
+		Hand.PinchStrength = 0.1f + Side * 0.2f;
+		Hand.GrabStrength = 0.3f + Side * 0.4f;
+	}
+	return Sample;
+}
+
+static bool SameVector(const FVector& A, const FVector& B)
+{
+	return FVector::Dist(A, B) <= 1e-3f * FMath::Max(1.f, A.Size());
+}
+
+AR_TEST(IndicesCoverEveryPointOnce)
+{
+	int32 Points[HandSkeleton::NumPoints] = { 0 };
+	int32 Velocities[HandSkeleton::NumVelocities] = { 0 };
+	for (int32 Side = 0; Side < HandSkeleton::NumSides; Side++) {
+		Points[HandSkeleton::PalmIndex(Side)]++;
+		Velocities[HandSkeleton::PalmVelocityIndex(Side)]++;
+		for (int32 Finger = 0; Finger < HandSkeleton::NumFingers; Finger++) {
+			for (int32 Joint = 0; Joint < HandSkeleton::NumJoints; Joint++) {
+				int32 Index = HandSkeleton::JointIndex(Side, Finger, Joint);
+				AR_CHECK(Index >= 0 && Index < HandSkeleton::NumPoints);
+				if (Index >= 0 && Index < HandSkeleton::NumPoints) Points[Index]++;
+			}
+			AR_CHECK(HandSkeleton::TipIndex(Side, Finger) == HandSkeleton::JointIndex(Side, Finger, LeapHandSample::TipJoint));
+			int32 Velocity = HandSkeleton::TipVelocityIndex(Side, Finger);
+			AR_CHECK(Velocity >= 0 && Velocity < HandSkeleton::NumVelocities);
+			if (Velocity >= 0 && Velocity < HandSkeleton::NumVelocities) Velocities[Velocity]++;
+		}
+	}
+	for (int32 i = 0; i < HandSkeleton::NumPoints; i++) {
+		AR_CHECK(Points[i] == 1);
+	}
+	for (int32 i = 0; i < HandSkeleton::NumVelocities; i++) {
+		AR_CHECK(Velocities[i] == 1);
+	}
+	AR_CHECK(HandSkeleton::NumPoints == 2 * (1 + 5 * 5));
+	AR_CHECK(HandSkeleton::NumVelocities == 2 * (1 + 5));
+}
+
+AR_TEST(SetFromSampleFollowsTheIndices)
+{
+	HandSkeleton Skeleton;
+	LeapHandSample Sample = MakeSample((1 << LeapHandSample::Left) | (1 << LeapHandSample::Right), 0.f);
+	Skeleton.SetFromSample(Sample);
+	for (int32 Side = 0; Side < HandSkeleton::NumSides; Side++) {
+		const LeapHandSample::Hand& Hand = Sample.Hands[Side];
+		AR_CHECK(Skeleton.HasHand(Side));
+		AR_CHECK(Skeleton.LeapPositions.Get(HandSkeleton::PalmIndex(Side)) == FVector(Hand.PalmPosition[0], Hand.PalmPosition[1], Hand.PalmPosition[2]));
+		AR_CHECK(Skeleton.LeapVelocities.Get(HandSkeleton::PalmVelocityIndex(Side)) == FVector(Hand.PalmVelocity[0], Hand.PalmVelocity[1], Hand.PalmVelocity[2]));
+		for (int32 Finger = 0; Finger < HandSkeleton::NumFingers; Finger++) {
+			for (int32 Joint = 0; Joint < HandSkeleton::NumJoints; Joint++) {
+				AR_CHECK(Skeleton.LeapPositions.Get(HandSkeleton::JointIndex(Side, Finger, Joint)) == MakeJoint(Side, Finger, Joint));
+			}
+			const float* TipVelocity = Hand.TipVelocity[Finger];
+			AR_CHECK(Skeleton.LeapVelocities.Get(HandSkeleton::TipVelocityIndex(Side, Finger)) == FVector(TipVelocity[0], TipVelocity[1], TipVelocity[2]));
+		}
+		AR_CHECK(Skeleton.Confidence[Side] == Hand.Confidence);
+		AR_CHECK(Skeleton.PinchStrength[Side] == Hand.PinchStrength);
+		AR_CHECK(Skeleton.GrabStrength[Side] == Hand.GrabStrength);
+	}
+}
+
+AR_TEST(MissingHandKeepsItsLastPoints)
+{
+	HandSkeleton Skeleton;
+	Skeleton.SetFromSample(MakeSample((1 << LeapHandSample::Left) | (1 << LeapHandSample::Right), 0.f));
+	Skeleton.SetFromSample(MakeSample(1 << LeapHandSample::Left, 7.f)); // the right hand is gone, the left one moved
+	AR_CHECK(Skeleton.HasHand(LeapHandSample::Left));
+	AR_CHECK(!Skeleton.HasHand(LeapHandSample::Right));
+	FVector LeftTip = MakeJoint(LeapHandSample::Left, 1, LeapHandSample::TipJoint) + FVector(7.f, 7.f, 7.f);
+	AR_CHECK(Skeleton.LeapPositions.Get(HandSkeleton::TipIndex(LeapHandSample::Left, 1)) == LeftTip);
+	AR_CHECK(Skeleton.LeapPositions.Get(HandSkeleton::TipIndex(LeapHandSample::Right, 1)) == MakeJoint(LeapHandSample::Right, 1, LeapHandSample::TipJoint));
+	AR_CHECK(Skeleton.Confidence[LeapHandSample::Right] == 0.75f);
+}
+
+AR_TEST(BatchTransformsMatchPointByPoint)
+{
+	HandSkeleton Skeleton;
+	Skeleton.SetFromSample(MakeSample((1 << LeapHandSample::Left) | (1 << LeapHandSample::Right), 0.f));
+	// Leap millimeters to world: a rotation about Z, scaled to centimeters and moved
+	FMatrix LeapToWorld(FVector(0.f, 0.1f, 0.f), FVector(-0.1f, 0.f, 0.f), FVector(0.f, 0.f, 0.1f), FVector(100.f, 200.f, 300.f));
+	FMatrix WorldToCharacter(FVector(1.f, 0.f, 0.f), FVector(0.f, 0.f, 1.f), FVector(0.f, -1.f, 0.f), FVector(-100.f, 0.f, 50.f));
+	Skeleton.UpdateTransforms(LeapToWorld, WorldToCharacter);
+	for (int32 i = 0; i < HandSkeleton::NumPoints; i++) {
+		FVector World = LeapToWorld.TransformPosition(Skeleton.LeapPositions.Get(i));
+		AR_CHECK(SameVector(Skeleton.WorldPositions.Get(i), World));
+		AR_CHECK(SameVector(Skeleton.CharacterPositions.Get(i), WorldToCharacter.TransformPosition(World)));
+	}
+	// velocities are directions: rotated and scaled, not moved
+	for (int32 i = 0; i < HandSkeleton::NumVelocities; i++) {
+		FVector World = LeapToWorld.TransformVector(Skeleton.LeapVelocities.Get(i));
+		AR_CHECK(SameVector(Skeleton.WorldVelocities.Get(i), World));
+		AR_CHECK(SameVector(Skeleton.CharacterVelocities.Get(i), WorldToCharacter.TransformVector(World)));
+	}
+}
+
+int main()
+{
+	return RunTests();
+}
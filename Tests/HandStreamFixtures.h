@@ -0,0 +1,122 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "OculusARPOC.h"
+#include "IHandTrackingSource.h"
+#include "HandTrackingRecorder.h"
+#include "TouchReplayHarness.h"
+
+/*
+ Synthetic hand tracking sessions, for tests and benchmarks that have no recording from a real Leap device.
+ A recording from a device can be used instead wherever a benchmark takes a file name.
+ */
+namespace HandStreamFixtures
+{
+	/*
+	 Seconds of both hands at Rate frames per second starting at StartTime: palms circling in front of the device
+	 (Leap coordinates, millimeters) with every joint of every finger offset from the palm, and plausible velocities.
+	 */
+	inline void MakeSession(double StartTime, float Seconds, float Rate, TArray<LeapHandSample>& OutSamples)
+	{
+		int32 Count = FMath::Max(1, (int32)(Seconds * Rate));
+		OutSamples.Reset();
+		OutSamples.Reserve(Count);
+		for (int32 i = 0; i < Count; i++) {
+			LeapHandSample& Sample = OutSamples[OutSamples.AddZeroed()];
+			double T = i / (double)Rate;
+			Sample.Time = StartTime + T;
+			Sample.FrameId = 1000 + i;
+			Sample.HandsPresent = (1 << LeapHandSample::Left) | (1 << LeapHandSample::Right);
+			for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+				LeapHandSample::Hand& Hand = Sample.Hands[Side];
+				float Phase = (float)T * 2.f + Side * PI;
+				float Center[3] = { (Side == LeapHandSample::Left ? -80.f : 80.f) + 40.f * FMath::Cos(Phase), 200.f + 30.f * FMath::Sin(Phase), -20.f };
+				for (int32 Axis = 0; Axis < 3; Axis++) {
+					Hand.PalmPosition[Axis] = Center[Axis];
+				}
+				Hand.PalmVelocity[0] = -80.f * FMath::Sin(Phase);
+				Hand.PalmVelocity[1] = 60.f * FMath::Cos(Phase);
+				for (int32 Finger = 0; Finger < LeapHandSample::NumFingers; Finger++) {
+					for (int32 Joint = 0; Joint < LeapHandSample::NumJoints; Joint++) {
+						Hand.Joints[Finger][Joint][0] = Center[0] + (Finger - 2) * 18.f;
+						Hand.Joints[Finger][Joint][1] = Center[1] + Joint * 4.f;
+						Hand.Joints[Finger][Joint][2] = Center[2] - 10.f - Joint * 20.f;
+					}
+					Hand.TipVelocity[Finger][0] = Hand.PalmVelocity[0];
+					Hand.TipVelocity[Finger][1] = Hand.PalmVelocity[1];
+				}
+				Hand.Confidence = 0.9f;
+				Hand.PinchStrength = 0.5f + 0.5f * FMath::Sin(Phase);
+			}
+		}
+	}
+
+	/*
+	 A right hand scripted in surface pixels (see TouchReplayHarness::LeapFromPixels), at Rate frames per second for
+	 Seconds.  Script(T, Finger, Palm, Depth) sets the middle fingertip and palm pixels and the fingertip depth in front
+	 of the surface (<= 0 touches) at T seconds into the session; it returns false for frames without the hand.
+	 */
+	template<typename ScriptType>
+	void MakeTouchSession(double StartTime, float Seconds, float Rate, ScriptType Script, TArray<LeapHandSample>& OutSamples)
+	{
+		int32 Count = (int32)(Seconds * Rate + 0.5f) + 1;
+		OutSamples.Reset();
+		for (int32 i = 0; i < Count; i++) {
+			double T = i / (double)Rate;
+			FVector2D Finger(500.f, 500.f);
+			FVector2D Palm(500.f, 600.f);
+			float Depth = 20.f;
+			LeapHandSample& Sample = OutSamples[OutSamples.AddZeroed()];
+			Sample.Time = StartTime + T;
+			Sample.FrameId = i;
+			if (!Script(T, Finger, Palm, Depth)) continue;
+			Sample.HandsPresent = 1 << LeapHandSample::Right;
+			LeapHandSample::Hand& Hand = Sample.Hands[LeapHandSample::Right];
+			TouchReplayHarness::LeapFromPixels(Palm, Depth + 30.f, Hand.PalmPosition);
+			for (int32 FingerType = 0; FingerType < LeapHandSample::NumFingers; FingerType++) {
+				for (int32 Joint = 0; Joint < LeapHandSample::NumJoints; Joint++) {
+					// the middle finger points at Finger, the others curl back toward the palm
+					TouchReplayHarness::LeapFromPixels(FingerType == 2 ? Finger : Palm, Depth + (LeapHandSample::TipJoint - Joint) * 8.f, Hand.Joints[FingerType][Joint]);
+				}
+			}
+			Hand.Confidence = 1.f;
+		}
+	}
+
+	/* Writes Samples as HandTrackingRecorder does */
+	inline bool SaveSession(const TArray<LeapHandSample>& Samples, const FString& FilePath)
+	{
+		HandTrackingRecorder Recorder;
+		Recorder.Start();
+		for (int32 i = 0; i < Samples.Num(); i++) {
+			Recorder.Record(Samples[i]);
+		}
+		return Recorder.StopAndSave(FilePath);
+	}
+}
@@ -0,0 +1,75 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "BenchmarkHarness.h"
+#include "HandStreamFixtures.h"
+#include "HandTrackingReplay.h"
+
+/*
+ Cost of loading a hand recording and of sampling it once per rendered frame, as LeapInputReader does with a
+ HandTrackingReplay.  Usage: HandTrackingReplayBenchmark [iterations] [recording.hand]; without a recording a
+ 60 second synthetic session at the Leap's 110 frames per second is used.
+ */
+int main(int argc, char** argv)
+{
+	int32 Iterations = Benchmark::GetIterations(argc, argv, 50);
+	FString RecordingPath = argc > 2 ? FString(argv[2]) : FString(TEXT("HandTrackingReplayBenchmark.hand"));
+	if (argc <= 2) {
+		TArray<LeapHandSample> Session;
+		HandStreamFixtures::MakeSession(0.0, 60.f, 110.f, Session);
+		if (!HandStreamFixtures::SaveSession(Session, RecordingPath)) return 1;
+	}
+
+	HandTrackingReplay Replay;
+	if (!Replay.Load(RecordingPath)) return 1;
+	TArray<LeapHandSample> Loaded;
+	HandTrackingRecorder::Load(RecordingPath, Loaded);
+	printf("%d frames, %.1f seconds\n", Loaded.Num(), Loaded.Last().Time);
+
+	Benchmark::Run("HandTrackingRecorder::Load", Iterations, Loaded.Num(), "frame", [&]() {
+		TArray<LeapHandSample> Samples;
+		HandTrackingRecorder::Load(RecordingPath, Samples);
+		Benchmark::DoNotOptimize(Samples.Num());
+	});
+
+	// one render frame at 90 Hz per sample, over the whole recording
+	const double FrameSeconds = 1.0 / 90.0;
+	int32 Frames = FMath::Max(1, (int32)(Loaded.Last().Time / FrameSeconds));
+	Replay.Looping = true;
+	Replay.StartAt(0.0);
+	Benchmark::Run("HandTrackingReplay::GetSampleAt (90 Hz frames)", Iterations, Frames, "frame", [&]() {
+		LeapHandSample Sample;
+		float Sum = 0.f;
+		for (int32 Frame = 0; Frame < Frames; Frame++) {
+			if (Replay.GetSampleAt(Frame * FrameSeconds, Sample)) {
+				Sum += Sample.Hands[LeapHandSample::Right].PalmPosition[0];
+			}
+		}
+		Benchmark::DoNotOptimize(Sum);
+	});
+	return 0;
+}
@@ -0,0 +1,224 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "HandTrackingRecorder.h"
+#include "HandTrackingReplay.h"
+
+/*
+ Recording round trip and replay of HandTrackingRecorder / HandTrackingReplay, without a Leap device.
+ */
+
+static const TCHAR* RecordingFile = TEXT("HandTrackingReplayTest.hand");
+
+/* A sample whose hand floats all derive from Value (the right palm X is Value), so blends can be checked on any of them */
+static LeapHandSample MakeSample(double Time, int64 FrameId, uint8 HandsPresent, float Value)
+{
+	LeapHandSample Sample;
+	FMemory::Memzero(&Sample, sizeof(Sample));
+	Sample.Time = Time;
+	Sample.FrameId = FrameId;
+	Sample.HandsPresent = HandsPresent;
+	for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+		if (!Sample.HasHand((LeapHandSample::Side)Side)) continue;
+		float* Floats = (float*)&Sample.Hands[Side];
+		for (int32 k = 0; k < LeapHandSample::FloatsPerHand; k++) {
+			Floats[k] = Value + (Side == LeapHandSample::Left ? 1000.f : 0.f) + k * 0.5f;
+		}
+	}
+	return Sample;
+}
+
+static bool SaveRecording(const TArray<LeapHandSample>& Samples)
+{
+	HandTrackingRecorder Recorder;
+	Recorder.Start();
+	for (int32 i = 0; i < Samples.Num(); i++) {
+		Recorder.Record(Samples[i]);
+	}
+	return Recorder.StopAndSave(RecordingFile);
+}
+
+/* Palm X of the right hand at 0, 0.1 and 0.2 s is 0, 10 and 30 */
+static bool LoadRampReplay(HandTrackingReplay& Replay)
+{
+	TArray<LeapHandSample> Samples;
+	Samples.Add(MakeSample(500.0, 1, 2, 0.f));
+	Samples.Add(MakeSample(500.1, 2, 2, 10.f));
+	Samples.Add(MakeSample(500.2, 3, 2, 30.f));
+	return SaveRecording(Samples) && Replay.Load(RecordingFile);
+}
+
+static float RightPalmX(const LeapHandSample& Sample)
+{
+	return Sample.Hands[LeapHandSample::Right].PalmPosition[0];
+}
+
+AR_TEST(RoundTripKeepsFramesAndHands)
+{
+	TArray<LeapHandSample> Samples;
+	const uint8 HandsPresent[] = { 0, 1, 2, 3, 1 };
+	for (int32 i = 0; i < 5; i++) {
+		Samples.Add(MakeSample(1000.0 + i / 90.0, 7000 + i, HandsPresent[i], i * 10.f));
+	}
+	AR_CHECK(SaveRecording(Samples));
+	TArray<LeapHandSample> Loaded;
+	AR_CHECK(HandTrackingRecorder::Load(RecordingFile, Loaded));
+	AR_CHECK(Loaded.Num() == Samples.Num());
+	for (int32 i = 0; i < Loaded.Num() && i < Samples.Num(); i++) {
+		AR_CHECK_NEAR(Loaded[i].Time, Samples[i].Time - Samples[0].Time, 1e-5); // times are relative to the first frame
+		AR_CHECK(Loaded[i].FrameId == Samples[i].FrameId);
+		AR_CHECK(Loaded[i].HandsPresent == Samples[i].HandsPresent);
+		for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+			// hands present are stored bit for bit, missing ones aren't stored at all and come back zeroed
+			AR_CHECK(FMemory::Memcmp(&Loaded[i].Hands[Side], &Samples[i].Hands[Side], sizeof(LeapHandSample::Hand)) == 0);
+		}
+	}
+}
+
+AR_TEST(NothingRecordedIsNotSaved)
+{
+	HandTrackingRecorder Recorder;
+	Recorder.Record(MakeSample(1.0, 1, 1, 0.f)); // not recording yet
+	AR_CHECK(!Recorder.IsRecording());
+	Recorder.Start();
+	AR_CHECK(Recorder.IsRecording());
+	AR_CHECK(!Recorder.StopAndSave(TEXT("HandTrackingReplayTest_Empty.hand")));
+	AR_CHECK(!Recorder.IsRecording());
+}
+
+AR_TEST(InvalidRecordingsAreRejected)
+{
+	TArray<LeapHandSample> Loaded;
+	AR_CHECK(!HandTrackingRecorder::Load(TEXT("HandTrackingReplayTest_Missing.hand"), Loaded));
+
+	TArray<LeapHandSample> Samples;
+	Samples.Add(MakeSample(0.0, 1, 3, 1.f));
+	Samples.Add(MakeSample(0.1, 2, 3, 2.f));
+	AR_CHECK(SaveRecording(Samples));
+	TArray<uint8> Data;
+	AR_CHECK(FFileHelper::LoadFileToArray(Data, RecordingFile));
+
+	TArray<uint8> Truncated;
+	Truncated.Append(Data.GetData(), Data.Num() - 4);
+	AR_CHECK(FFileHelper::SaveArrayToFile(Truncated, TEXT("HandTrackingReplayTest_Truncated.hand")));
+	AR_CHECK(!HandTrackingRecorder::Load(TEXT("HandTrackingReplayTest_Truncated.hand"), Loaded));
+
+	TArray<uint8> BadMagic = Data;
+	BadMagic[0] ^= 0xff;
+	AR_CHECK(FFileHelper::SaveArrayToFile(BadMagic, TEXT("HandTrackingReplayTest_BadMagic.hand")));
+	AR_CHECK(!HandTrackingRecorder::Load(TEXT("HandTrackingReplayTest_BadMagic.hand"), Loaded));
+}
+
+AR_TEST(ReplayNeedsStart)
+{
+	HandTrackingReplay Replay;
+	LeapHandSample Sample;
+	AR_CHECK(!Replay.Start()); // nothing loaded
+	AR_CHECK(LoadRampReplay(Replay));
+	AR_CHECK(!Replay.GetSampleAt(10.0, Sample));
+	AR_CHECK(Replay.GetLatencySeconds(10.0) == -1.f);
+	AR_CHECK(Replay.StartAt(10.0));
+	AR_CHECK(Replay.GetSampleAt(10.0, Sample));
+	Replay.Stop();
+	AR_CHECK(!Replay.GetSampleAt(10.0, Sample));
+}
+
+AR_TEST(GetSampleAtInterpolatesBetweenFrames)
+{
+	HandTrackingReplay Replay;
+	AR_CHECK(LoadRampReplay(Replay));
+	Replay.Looping = false;
+	const double Start = 100.0;
+	AR_CHECK(Replay.StartAt(Start));
+	LeapHandSample Sample;
+	AR_CHECK(Replay.GetSampleAt(Start, Sample));
+	AR_CHECK_NEAR(RightPalmX(Sample), 0.f, 1e-4);
+	AR_CHECK(Replay.GetSampleAt(Start + 0.05, Sample));
+	AR_CHECK_NEAR(RightPalmX(Sample), 5.f, 1e-3);
+	AR_CHECK_NEAR(Sample.Time, Start + 0.05, 1e-9); // reported at the requested time
+	AR_CHECK(Sample.HasHand(LeapHandSample::Right) && !Sample.HasHand(LeapHandSample::Left));
+	AR_CHECK(Replay.GetSampleAt(Start + 0.15, Sample));
+	AR_CHECK_NEAR(RightPalmX(Sample), 20.f, 1e-3);
+	AR_CHECK_NEAR(Replay.GetLatencySeconds(Start + 0.15), 0.05, 1e-5);
+}
+
+AR_TEST(GetSampleAtExtrapolatesOnlySoFar)
+{
+	HandTrackingReplay Replay;
+	AR_CHECK(LoadRampReplay(Replay));
+	Replay.Looping = false;
+	Replay.MaxExtrapolationSeconds = 0.05f;
+	const double Start = 100.0;
+	AR_CHECK(Replay.StartAt(Start));
+	LeapHandSample Sample;
+	// along the last two frames (200 per second), for at most MaxExtrapolationSeconds past the last one
+	AR_CHECK(Replay.GetSampleAt(Start + 0.23, Sample));
+	AR_CHECK_NEAR(RightPalmX(Sample), 36.f, 1e-2);
+	AR_CHECK(Replay.GetSampleAt(Start + 5.0, Sample));
+	AR_CHECK_NEAR(RightPalmX(Sample), 40.f, 1e-2);
+	AR_CHECK_NEAR(Replay.GetLatencySeconds(Start + 5.0), 4.8, 1e-4);
+}
+
+AR_TEST(LoopingStartsOver)
+{
+	HandTrackingReplay Replay;
+	AR_CHECK(LoadRampReplay(Replay));
+	Replay.Looping = true;
+	const double Start = 100.0;
+	AR_CHECK(Replay.StartAt(Start));
+	LeapHandSample Sample;
+	AR_CHECK(Replay.GetSampleAt(Start + 0.25, Sample)); // 0.05 into the second pass
+	AR_CHECK_NEAR(RightPalmX(Sample), 5.f, 1e-2);
+	AR_CHECK(Replay.GetSampleAt(Start + 10 * 0.2 + 0.15, Sample)); // 0.15 into the eleventh
+	AR_CHECK_NEAR(RightPalmX(Sample), 20.f, 1e-2);
+}
+
+AR_TEST(HandsAppearingAreNotBlended)
+{
+	TArray<LeapHandSample> Samples;
+	Samples.Add(MakeSample(0.0, 1, 2, 0.f));  // right hand only
+	Samples.Add(MakeSample(0.1, 2, 3, 10.f)); // both
+	AR_CHECK(SaveRecording(Samples));
+	HandTrackingReplay Replay;
+	AR_CHECK(Replay.Load(RecordingFile));
+	Replay.Looping = false;
+	AR_CHECK(Replay.StartAt(0.0));
+	LeapHandSample Sample;
+	AR_CHECK(Replay.GetSampleAt(0.03, Sample)); // nearer the first frame: no left hand yet
+	AR_CHECK(Sample.HandsPresent == 2);
+	AR_CHECK_NEAR(RightPalmX(Sample), 3.f, 1e-3);
+	AR_CHECK(Replay.GetSampleAt(0.07, Sample)); // nearer the second: the left hand as recorded, the right one blended
+	AR_CHECK(Sample.HandsPresent == 3);
+	AR_CHECK_NEAR(Sample.Hands[LeapHandSample::Left].PalmPosition[0], 1010.f, 1e-4);
+	AR_CHECK_NEAR(RightPalmX(Sample), 7.f, 1e-3);
+}
+
+int main()
+{
+	return RunTests();
+}
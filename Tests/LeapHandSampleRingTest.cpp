@@ -0,0 +1,155 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "OculusARPOC.h"
+#include "LeapHandSampleRing.h"
+#include <thread>
+
+/*
+ The ring LeapHandSampler keeps its Leap frames in: order, wrap around, the Capacity - 1 limit, and a producer thread
+ pushing flat out while the consumer copies, checking that no copied sample is torn or out of order.
+ */
+
+static void MakeSample(int32 Index, LeapHandSample& OutSample)
+{
+	FMemory::Memzero(&OutSample, sizeof(OutSample));
+	OutSample.Time = Index;
+	OutSample.FrameId = Index;
+	OutSample.HandsPresent = 1 << LeapHandSample::Left;
+	float* Floats = (float*)&OutSample.Hands[0];
+	for (int32 i = 0; i < LeapHandSample::FloatsPerHand * LeapHandSample::NumSides; i++) {
+		Floats[i] = (float)Index;
+	}
+}
+
+/* A sample made by MakeSample, whole */
+static bool IsConsistent(const LeapHandSample& Sample)
+{
+	if (Sample.Time != (double)Sample.FrameId) return false;
+	const float* Floats = (const float*)&Sample.Hands[0];
+	for (int32 i = 0; i < LeapHandSample::FloatsPerHand * LeapHandSample::NumSides; i++) {
+		if (Floats[i] != (float)Sample.FrameId) return false;
+	}
+	return true;
+}
+
+static LeapHandSample Copied[LeapHandSampleRing::Capacity];
+
+AR_TEST(EmptyRingCopiesNothing)
+{
+	LeapHandSampleRing Ring;
+	AR_CHECK(Ring.CopyNewest(Copied, 16) == 0);
+}
+
+AR_TEST(CopiesTheNewestOldestFirst)
+{
+	LeapHandSampleRing Ring;
+	LeapHandSample Sample;
+	for (int32 i = 0; i < 5; i++) {
+		MakeSample(i, Sample);
+		Ring.Push(Sample);
+	}
+	AR_CHECK(Ring.CopyNewest(Copied, 16) == 5);
+	for (int32 i = 0; i < 5; i++) {
+		AR_CHECK(Copied[i].FrameId == i);
+		AR_CHECK(IsConsistent(Copied[i]));
+	}
+	AR_CHECK(Ring.CopyNewest(Copied, 2) == 2);
+	AR_CHECK(Copied[0].FrameId == 3 && Copied[1].FrameId == 4);
+}
+
+AR_TEST(OverwritesTheOldestWhenFull)
+{
+	LeapHandSampleRing Ring;
+	LeapHandSample Sample;
+	const int32 Pushed = LeapHandSampleRing::Capacity * 3 + 7;
+	for (int32 i = 0; i < Pushed; i++) {
+		MakeSample(i, Sample);
+		Ring.Push(Sample);
+	}
+	AR_CHECK(Ring.CopyNewest(Copied, 16) == 16);
+	for (int32 i = 0; i < 16; i++) {
+		AR_CHECK(Copied[i].FrameId == Pushed - 16 + i);
+	}
+}
+
+AR_TEST(CopiesAtMostCapacityLessOne)
+{
+	LeapHandSampleRing Ring;
+	LeapHandSample Sample;
+	for (int32 i = 0; i < LeapHandSampleRing::Capacity * 2; i++) {
+		MakeSample(i, Sample);
+		Ring.Push(Sample);
+	}
+	LeapHandSample* Many = new LeapHandSample[LeapHandSampleRing::Capacity * 2];
+	int32 Count = Ring.CopyNewest(Many, LeapHandSampleRing::Capacity * 2);
+	AR_CHECK(Count == LeapHandSampleRing::Capacity - 1);
+	AR_CHECK(Many[Count - 1].FrameId == LeapHandSampleRing::Capacity * 2 - 1);
+	AR_CHECK(Many[0].FrameId == LeapHandSampleRing::Capacity + 1);
+	delete[] Many;
+}
+
+AR_TEST(ConcurrentCopiesAreWholeAndInOrder)
+{
+	static LeapHandSampleRing Ring;
+	const int32 Pushed = 200000;
+	volatile int32 Done = 0;
+	std::thread Producer([&]() {
+		LeapHandSample Sample;
+		for (int32 i = 0; i < Pushed; i++) {
+			MakeSample(i, Sample);
+			Ring.Push(Sample);
+		}
+		FPlatformAtomics::InterlockedExchange(&Done, 1);
+	});
+	int64 Newest = -1;
+	int32 Copies = 0;
+	int32 Failures = 0;
+	while (!Done || Copies == 0) {
+		// alternate the game thread's window with the largest copy, which the producer laps most often
+		int32 Count = Ring.CopyNewest(Copied, (Copies & 1) ? 16 : LeapHandSampleRing::Capacity);
+		for (int32 i = 0; i < Count; i++) {
+			if (!IsConsistent(Copied[i])) Failures++;
+			if (i > 0 && Copied[i].FrameId != Copied[i - 1].FrameId + 1) Failures++;
+		}
+		if (Count > 0) {
+			if (Copied[Count - 1].FrameId < Newest) Failures++;
+			Newest = Copied[Count - 1].FrameId;
+		}
+		Copies++;
+	}
+	Producer.join();
+	AR_CHECK(Failures == 0);
+	AR_CHECK(Ring.CopyNewest(Copied, 1) == 1);
+	AR_CHECK(Copied[0].FrameId == Pushed - 1);
+}
+
+int main()
+{
+	return RunTests();
+}
@@ -0,0 +1,188 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "BenchmarkHarness.h"
+#include "HandStreamFixtures.h"
+#include "HandTrackingReplay.h"
+#include "HandSkeleton.h"
+
+/*
+ Leap to world conversion of the hands per frame, over a recorded hand stream: the per-point conversion
+ LeapInputReader used before (the HMD orientation queried and the rotation rebuilt for every palm and fingertip) against
+ the batch transform (one Leap to world matrix per frame, applied to the whole skeleton by HandSkeleton::UpdateTransforms).
+ The HMD and the character are stand-ins behind virtual calls, as in the engine; the real HMD query also takes a lock,
+ so the per-point figures are a lower bound.  Both conversions are checked to agree on the palms and fingertips.
+ Usage: LeapTransformBenchmark [iterations] [recording.hand]; without a recording a 60 second synthetic session is used.
+ */
+
+class HeadMountedDisplayStandIn
+{
+public:
+	HeadMountedDisplayStandIn(const FRotator& InOrientation) : Orientation(InOrientation) {}
+	virtual ~HeadMountedDisplayStandIn() {}
+	virtual bool IsHeadTrackingAllowed() const { return true; }
+	virtual void GetCurrentOrientationAndPosition(FRotator& OutOrientation, FVector& OutPosition) const { OutOrientation = Orientation; OutPosition = FVector::ZeroVector; }
+private:
+	FRotator Orientation;
+};
+
+class CharacterStandIn
+{
+public:
+	CharacterStandIn(const FVector& InLocation, const FRotator& InRotation)
+		: Location(InLocation), Rotation(InRotation.ToMatrix())
+	{
+		FMatrix Transposed;
+		for (int32 Row = 0; Row < 4; Row++) {
+			for (int32 Column = 0; Column < 4; Column++) {
+				Transposed.M[Row][Column] = Row < 3 && Column < 3 ? Rotation.M[Column][Row] : (Row == Column ? 1.f : 0.f);
+			}
+		}
+		FVector InverseOrigin = Transposed.TransformVector(-Location);
+		WorldToCharacter = Transposed;
+		WorldToCharacter.M[3][0] = InverseOrigin.X;
+		WorldToCharacter.M[3][1] = InverseOrigin.Y;
+		WorldToCharacter.M[3][2] = InverseOrigin.Z;
+	}
+	virtual ~CharacterStandIn() {}
+	virtual FVector GetActorLocation() const { return Location; }
+	virtual FVector GetActorForwardVector() const { return FVector(Rotation.M[0][0], Rotation.M[0][1], Rotation.M[0][2]); }
+	virtual FVector GetActorRightVector() const { return FVector(Rotation.M[1][0], Rotation.M[1][1], Rotation.M[1][2]); }
+	virtual FVector GetActorUpVector() const { return FVector(Rotation.M[2][0], Rotation.M[2][1], Rotation.M[2][2]); }
+	virtual FVector InverseTransformPosition(const FVector& V) const { return WorldToCharacter.TransformPosition(V); }
+	FMatrix WorldToCharacter;
+private:
+	FVector Location;
+	FMatrix Rotation;
+};
+
+static const FVector LeapMountOffset(150.f, 0.f, -20.f);
+static const FVector LeapHandOffset(10.f, 0.f, 45.f);
+static const float LeapToUnrealScalingFactor = 0.1f;
+
+/* LeapInputReader::LeapPositionToUnrealLocation before the batch transform, once per palm and fingertip */
+static FVector LeapPositionToUnrealLocation(const HeadMountedDisplayStandIn* HMD, const CharacterStandIn* Character, const float LeapVector[3], const FVector& UnrealOffset)
+{
+	FVector LeapVectorCorrected = FVector(LeapVector[1], LeapVector[0], LeapVector[2]) + LeapMountOffset;
+	if (HMD != NULL && HMD->IsHeadTrackingAllowed())
+	{
+		FRotator HMDRotator;
+		FVector HMDPosition;
+		HMD->GetCurrentOrientationAndPosition(HMDRotator, HMDPosition);
+		LeapVectorCorrected = HMDRotator.UnrotateVector(LeapVectorCorrected);
+	}
+	FVector ScaledLeapVector = LeapVectorCorrected * LeapToUnrealScalingFactor;
+	return Character->GetActorLocation() - (Character->GetActorRightVector() * ScaledLeapVector.Y) + (Character->GetActorForwardVector() * (ScaledLeapVector.X + UnrealOffset.X)) - (Character->GetActorUpVector() * (ScaledLeapVector.Z - UnrealOffset.Z));
+}
+
+struct PerPointResult
+{
+	FVector Palm[LeapHandSample::NumSides];
+	FVector Tips[LeapHandSample::NumSides][LeapHandSample::NumFingers];
+	FVector MiddleTipInCharacter[LeapHandSample::NumSides];
+};
+
+static void ConvertPerPoint(const HeadMountedDisplayStandIn* HMD, const CharacterStandIn* Character, const LeapHandSample& Sample, PerPointResult& Out)
+{
+	for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+		if (!Sample.HasHand((LeapHandSample::Side)Side)) continue;
+		const LeapHandSample::Hand& Hand = Sample.Hands[Side];
+		Out.Palm[Side] = LeapPositionToUnrealLocation(HMD, Character, Hand.PalmPosition, LeapHandOffset);
+		for (int32 Finger = 0; Finger < LeapHandSample::NumFingers; Finger++) {
+			Out.Tips[Side][Finger] = LeapPositionToUnrealLocation(HMD, Character, Hand.Joints[Finger][LeapHandSample::TipJoint], LeapHandOffset);
+		}
+		Out.MiddleTipInCharacter[Side] = Character->InverseTransformPosition(Out.Tips[Side][2]);
+	}
+}
+
+static void ConvertBatch(const HeadMountedDisplayStandIn* HMD, const CharacterStandIn* Character, const LeapHandSample& Sample, HandSkeleton& Skeleton)
+{
+	FRotator HMDRotator = FRotator::ZeroRotator;
+	if (HMD != NULL && HMD->IsHeadTrackingAllowed()) {
+		FVector HMDPosition;
+		HMD->GetCurrentOrientationAndPosition(HMDRotator, HMDPosition);
+	}
+	Skeleton.SetFromSample(Sample);
+	Skeleton.UpdateTransforms(HandSkeleton::MakeLeapToWorldTransform(HMDRotator, Character->GetActorLocation(), Character->GetActorForwardVector(),
+		Character->GetActorRightVector(), Character->GetActorUpVector(), LeapMountOffset, LeapHandOffset, LeapToUnrealScalingFactor), Character->WorldToCharacter);
+}
+
+int main(int argc, char** argv)
+{
+	int32 Iterations = Benchmark::GetIterations(argc, argv, 20);
+	TArray<LeapHandSample> Samples;
+	if (argc > 2) {
+		if (!HandTrackingRecorder::Load(FString(argv[2]), Samples)) return 1;
+	}
+	else {
+		HandStreamFixtures::MakeSession(0.0, 60.f, 110.f, Samples); // only the samples are used, so it needn't go through a file
+	}
+
+	HeadMountedDisplayStandIn* HMD = new HeadMountedDisplayStandIn(FRotator(-12.f, 35.f, 4.f));
+	CharacterStandIn* Character = new CharacterStandIn(FVector(120.f, -340.f, 90.f), FRotator(0.f, 70.f, 0.f));
+
+	// both conversions must put the palms and fingertips at the same place
+	float MaxError = 0.f;
+	for (int32 i = 0; i < Samples.Num(); i++) {
+		PerPointResult PerPoint;
+		HandSkeleton Skeleton;
+		ConvertPerPoint(HMD, Character, Samples[i], PerPoint);
+		ConvertBatch(HMD, Character, Samples[i], Skeleton);
+		for (int32 Side = 0; Side < LeapHandSample::NumSides; Side++) {
+			if (!Samples[i].HasHand((LeapHandSample::Side)Side)) continue;
+			MaxError = FMath::Max(MaxError, FVector::Dist(PerPoint.Palm[Side], Skeleton.WorldPositions.Get(HandSkeleton::PalmIndex(Side))));
+			for (int32 Finger = 0; Finger < LeapHandSample::NumFingers; Finger++) {
+				MaxError = FMath::Max(MaxError, FVector::Dist(PerPoint.Tips[Side][Finger], Skeleton.WorldPositions.Get(HandSkeleton::TipIndex(Side, Finger))));
+			}
+			MaxError = FMath::Max(MaxError, FVector::Dist(PerPoint.MiddleTipInCharacter[Side], Skeleton.CharacterPositions.Get(HandSkeleton::TipIndex(Side, 2))));
+		}
+	}
+	printf("%d frames, largest difference between the conversions %g units\n", Samples.Num(), MaxError);
+	if (MaxError > 1e-3f) return 1;
+
+	Benchmark::Run("Per point: 2 palms + 10 tips, HMD per point", Iterations, Samples.Num(), "frame", [&]() {
+		PerPointResult Result;
+		float Sum = 0.f;
+		for (int32 i = 0; i < Samples.Num(); i++) {
+			ConvertPerPoint(HMD, Character, Samples[i], Result);
+			Sum += Result.Tips[LeapHandSample::Right][2].X;
+		}
+		Benchmark::DoNotOptimize(Sum);
+	});
+	HandSkeleton Skeleton;
+	Benchmark::Run("Batch: whole skeleton, world and character", Iterations, Samples.Num(), "frame", [&]() {
+		float Sum = 0.f;
+		for (int32 i = 0; i < Samples.Num(); i++) {
+			ConvertBatch(HMD, Character, Samples[i], Skeleton);
+			Sum += Skeleton.WorldPositions.X[HandSkeleton::TipIndex(LeapHandSample::Right, 2)];
+		}
+		Benchmark::DoNotOptimize(Sum);
+	});
+	delete HMD;
+	delete Character;
+	return 0;
+}
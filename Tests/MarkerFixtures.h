@@ -0,0 +1,166 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "OculusARPOC.h"
+#include "aruco/aruco.h"
+#include "aruco/arucofidmarkers.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <algorithm>
+
+/*
+ A synthetic marker board seen by a moving camera, for the marker and board benchmarks: what the marker detector would
+ report frame by frame, with a little corner noise, missed markers, a marker that is not on the board, and now and then
+ a misplaced or wrongly oriented marker; or the camera images themselves, for running the marker detector.
+ */
+namespace MarkerFixtures
+{
+	static const int32 BoardColumns = 5;
+	static const int32 BoardRows = 4;
+	static const int32 FirstBoardId = 100;
+	static const float MarkerSize = 0.04f;
+	static const float MarkerSpacing = 0.05f;
+
+	struct Frame
+	{
+		std::vector<aruco::Marker> Markers;
+		std::vector<aruco::MarkerRecord> Records; // the same markers
+		cv::Mat Rvec; // true pose of the board
+		cv::Mat Tvec;
+	};
+
+	/* 1280x720 camera without distortion */
+	inline aruco::CameraParameters MakeCameraParameters()
+	{
+		cv::Mat CameraMatrix = (cv::Mat_<float>(3, 3) << 800.f, 0.f, 640.f, 0.f, 800.f, 360.f, 0.f, 0.f, 1.f);
+		return aruco::CameraParameters(CameraMatrix, cv::Mat::zeros(1, 4, CV_32FC1), cv::Size(1280, 720));
+	}
+
+	/* BoardColumns x BoardRows markers, in meters, ids from FirstBoardId */
+	inline aruco::BoardConfiguration MakeBoard()
+	{
+		aruco::BoardConfiguration Config;
+		Config.mInfoType = aruco::BoardConfiguration::METERS;
+		float HalfSize = MarkerSize / 2.f;
+		for (int32 Row = 0; Row < BoardRows; Row++) {
+			for (int32 Column = 0; Column < BoardColumns; Column++) {
+				aruco::MarkerInfo Info(FirstBoardId + Row * BoardColumns + Column);
+				float X = (Column - (BoardColumns - 1) / 2.f) * MarkerSpacing;
+				float Y = (Row - (BoardRows - 1) / 2.f) * MarkerSpacing;
+				Info.push_back(cv::Point3f(X - HalfSize, Y - HalfSize, 0.f));
+				Info.push_back(cv::Point3f(X + HalfSize, Y - HalfSize, 0.f));
+				Info.push_back(cv::Point3f(X + HalfSize, Y + HalfSize, 0.f));
+				Info.push_back(cv::Point3f(X - HalfSize, Y + HalfSize, 0.f));
+				Config.push_back(Info);
+			}
+		}
+		Config.updateIdIndex();
+		return Config;
+	}
+
+	/* Pose of the board in frame f, moving in front of the camera at 60 Hz */
+	inline void GetBoardPose(int32 f, cv::Mat& OutRvec, cv::Mat& OutTvec)
+	{
+		double T = f / 60.0;
+		OutRvec = (cv::Mat_<double>(3, 1) << 0.4 * sin(0.7 * T), 0.4 * sin(0.5 * T + 1.0), 0.2 * sin(0.3 * T));
+		OutTvec = (cv::Mat_<double>(3, 1) << 0.05 * sin(0.4 * T), 0.03 * sin(0.6 * T), 0.6 + 0.15 * sin(0.2 * T));
+	}
+
+	/* What the marker detector reports in NumFrames of the board moving in front of the camera */
+	inline void MakeFrames(const aruco::BoardConfiguration& Config, const aruco::CameraParameters& CameraParams, int32 NumFrames, std::vector<Frame>& OutFrames)
+	{
+		cv::RNG Random(1234);
+		std::vector<cv::Point2f> Projected;
+		OutFrames.resize(NumFrames);
+		for (int32 f = 0; f < NumFrames; f++) {
+			Frame& Out = OutFrames[f];
+			GetBoardPose(f, Out.Rvec, Out.Tvec);
+			for (size_t m = 0; m < Config.size(); m++) {
+				if (Random.uniform(0.f, 1.f) < 0.1f) continue; // missed by the marker detector
+				cv::projectPoints(Config[m], Out.Rvec, Out.Tvec, CameraParams.CameraMatrix, CameraParams.Distorsion, Projected);
+				aruco::Marker Marker;
+				Marker.id = Config[m].id;
+				for (int32 c = 0; c < 4; c++) {
+					Marker.push_back(Projected[c] + cv::Point2f((float)Random.gaussian(0.3), (float)Random.gaussian(0.3)));
+				}
+				Out.Markers.push_back(Marker);
+			}
+			// a marker that is not on the board
+			aruco::Marker Stray(Out.Markers[0], 7);
+			for (int32 c = 0; c < 4; c++) Stray[c] += cv::Point2f(-200.f, 150.f);
+			Out.Markers.push_back(Stray);
+			// outliers: a marker found in the wrong place, or with its corners in the wrong order
+			if (Random.uniform(0.f, 1.f) < 0.5f) {
+				aruco::Marker& Misplaced = Out.Markers[Random.uniform(0, (int)Out.Markers.size())];
+				cv::Point2f Shift(Random.uniform(15.f, 40.f), Random.uniform(-40.f, 40.f));
+				for (int32 c = 0; c < 4; c++) Misplaced[c] += Shift;
+			}
+			if (Random.uniform(0.f, 1.f) < 0.3f) {
+				aruco::Marker& Rotated = Out.Markers[Random.uniform(0, (int)Out.Markers.size())];
+				std::rotate(Rotated.begin(), Rotated.begin() + 1, Rotated.end());
+			}
+			Out.Records.resize(Out.Markers.size());
+			for (size_t m = 0; m < Out.Markers.size(); m++) {
+				aruco::fromMarker(Out.Markers[m], Out.Records[m]);
+			}
+		}
+	}
+
+	/*
+	 Grey camera images of NumFrames along the same path as MakeFrames: every marker of the board drawn (in perspective,
+	 with FiducidalMarkers::createMarkerImage) on a white background, with a little noise.
+	 */
+	inline void MakeImages(const aruco::BoardConfiguration& Config, const aruco::CameraParameters& CameraParams, int32 NumFrames, std::vector<cv::Mat>& OutImages)
+	{
+		const int32 MarkerPixels = 7 * 20; // createMarkerImage draws 7x7 cells
+		std::vector<cv::Mat> MarkerImages(Config.size());
+		for (size_t m = 0; m < Config.size(); m++) {
+			MarkerImages[m] = aruco::FiducidalMarkers::createMarkerImage(Config[m].id, MarkerPixels, false);
+		}
+		const cv::Point2f MarkerCorners[4] = { cv::Point2f(0.f, 0.f), cv::Point2f((float)MarkerPixels, 0.f), cv::Point2f((float)MarkerPixels, (float)MarkerPixels), cv::Point2f(0.f, (float)MarkerPixels) };
+		cv::RNG Random(4321);
+		cv::Mat Rvec, Tvec, Noise;
+		std::vector<cv::Point2f> Projected;
+		OutImages.resize(NumFrames);
+		for (int32 f = 0; f < NumFrames; f++) {
+			GetBoardPose(f, Rvec, Tvec);
+			cv::Mat& Image = OutImages[f];
+			Image.create(CameraParams.CamSize, CV_8UC1);
+			Image.setTo(cv::Scalar(235));
+			for (size_t m = 0; m < Config.size(); m++) {
+				cv::projectPoints(Config[m], Rvec, Tvec, CameraParams.CameraMatrix, CameraParams.Distorsion, Projected);
+				cv::Mat Homography = cv::getPerspectiveTransform(MarkerCorners, &Projected[0]);
+				cv::warpPerspective(MarkerImages[m], Image, Homography, Image.size(), cv::INTER_LINEAR, cv::BORDER_TRANSPARENT);
+			}
+			Noise.create(Image.size(), CV_8SC1);
+			Random.fill(Noise, cv::RNG::NORMAL, 0, 4);
+			cv::add(Image, Noise, Image, cv::noArray(), CV_8UC1);
+		}
+	}
+}
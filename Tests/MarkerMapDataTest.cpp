@@ -0,0 +1,190 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "MarkerMapData.h"
+
+/*
+ Save/Load round trip of the marker map file (MarkerMapData), and rejection of truncated and corrupt files.
+ */
+
+static const TCHAR* MapFile = TEXT("MarkerMapDataTest.bin");
+
+/* Three markers seen in two keyframes */
+static MarkerMapData MakeMap()
+{
+	MarkerMapData Map;
+	for (int32 m = 0; m < 3; m++) {
+		MarkerMapData::Marker& Marker = Map.Markers[Map.Markers.AddZeroed()];
+		Marker.Id = 40 + m;
+		Marker.Size = 0.05f;
+		for (int32 Axis = 0; Axis < 3; Axis++) {
+			Marker.Rvec[Axis] = 0.1 * m + Axis;
+			Marker.Tvec[Axis] = 0.5 * m - Axis;
+		}
+	}
+	for (int32 k = 0; k < 2; k++) {
+		MarkerMapData::Keyframe& Frame = Map.Keyframes[Map.Keyframes.AddZeroed()];
+		Frame.Rvec[0] = 0.2 * k;
+		Frame.Tvec[2] = 1.0 + k;
+		Frame.FirstObservation = Map.Observations.Num();
+		Frame.NumObservations = 2;
+		for (int32 o = 0; o < 2; o++) {
+			MarkerMapData::Observation& Observed = Map.Observations[Map.Observations.AddZeroed()];
+			Observed.MarkerIndex = k + o;
+			Observed.KeyframeIndex = k;
+			for (int32 c = 0; c < 4; c++) {
+				Observed.Corners[c][0] = 0.01f * (c + o);
+				Observed.Corners[c][1] = -0.02f * (c + k);
+			}
+		}
+	}
+	return Map;
+}
+
+template<typename T>
+static bool SameRecords(const TArray<T>& A, const TArray<T>& B)
+{
+	return A.Num() == B.Num() && (A.Num() == 0 || FMemory::Memcmp(A.GetData(), B.GetData(), A.Num() * sizeof(T)) == 0);
+}
+
+static bool SameMap(const MarkerMapData& A, const MarkerMapData& B)
+{
+	return SameRecords(A.Markers, B.Markers) && SameRecords(A.Keyframes, B.Keyframes) && SameRecords(A.Observations, B.Observations);
+}
+
+/* Writes Data to a file of its own and checks that loading it fails and leaves the map alone */
+static void CheckRejected(const TArray<uint8>& Data, const TCHAR* Name)
+{
+	FString Path = FString(TEXT("MarkerMapDataTest_")) + Name + TEXT(".bin");
+	AR_CHECK(FFileHelper::SaveArrayToFile(Data, *Path));
+	MarkerMapData Loaded = MakeMap();
+	Loaded.Markers[0].Id = 7;
+	MarkerMapData Before = Loaded;
+	AR_CHECK(!Loaded.Load(Path));
+	AR_CHECK(SameMap(Loaded, Before));
+}
+
+/* Offsets in the file image, which has a 20 byte header */
+static const int32 HeaderSize = 5 * sizeof(int32);
+
+static int32& IntAt(TArray<uint8>& Data, int32 Offset)
+{
+	return *(int32*)(Data.GetData() + Offset);
+}
+
+AR_TEST(RoundTripKeepsEveryRecord)
+{
+	MarkerMapData Map = MakeMap();
+	AR_CHECK(Map.Save(MapFile));
+	MarkerMapData Loaded;
+	AR_CHECK(Loaded.Load(MapFile));
+	AR_CHECK(SameMap(Loaded, Map));
+	AR_CHECK(Loaded.Markers.Num() == 3 && Loaded.Keyframes.Num() == 2 && Loaded.Observations.Num() == 4);
+}
+
+AR_TEST(EmptyMapRoundTrips)
+{
+	MarkerMapData Map;
+	AR_CHECK(Map.Save(MapFile));
+	MarkerMapData Loaded = MakeMap();
+	AR_CHECK(Loaded.Load(MapFile));
+	AR_CHECK(Loaded.Markers.Num() == 0 && Loaded.Keyframes.Num() == 0 && Loaded.Observations.Num() == 0);
+}
+
+AR_TEST(MissingFileIsRejected)
+{
+	MarkerMapData Loaded = MakeMap();
+	AR_CHECK(!Loaded.Load(TEXT("MarkerMapDataTest_Missing.bin")));
+	AR_CHECK(SameMap(Loaded, MakeMap()));
+}
+
+AR_TEST(TruncatedFilesAreRejected)
+{
+	TArray<uint8> Data;
+	MakeMap().Write(Data);
+	const int32 Lengths[] = { 0, 3, HeaderSize - 1, HeaderSize, HeaderSize + 10, Data.Num() - 1 };
+	for (int32 i = 0; i < (int32)(sizeof(Lengths) / sizeof(Lengths[0])); i++) {
+		TArray<uint8> Truncated;
+		Truncated.Append(Data.GetData(), Lengths[i]);
+		CheckRejected(Truncated, TEXT("Truncated"));
+	}
+	TArray<uint8> Longer = Data;
+	Longer.Add(0);
+	CheckRejected(Longer, TEXT("Longer"));
+}
+
+AR_TEST(CorruptHeadersAreRejected)
+{
+	TArray<uint8> Data;
+	MakeMap().Write(Data);
+	TArray<uint8> BadMagic = Data;
+	BadMagic[0] ^= 0xff;
+	CheckRejected(BadMagic, TEXT("BadMagic"));
+	TArray<uint8> BadVersion = Data;
+	IntAt(BadVersion, 4) = 2;
+	CheckRejected(BadVersion, TEXT("BadVersion"));
+	TArray<uint8> NegativeCount = Data;
+	IntAt(NegativeCount, 8) = -1;
+	CheckRejected(NegativeCount, TEXT("NegativeCount"));
+	TArray<uint8> HugeCount = Data;
+	IntAt(HugeCount, 16) = 0x7fffffff; // observations
+	CheckRejected(HugeCount, TEXT("HugeCount"));
+}
+
+AR_TEST(RecordsReferringOutsideTheMapAreRejected)
+{
+	MarkerMapData Map = MakeMap();
+	TArray<uint8> Data;
+
+	MarkerMapData BadMarker = Map;
+	BadMarker.Observations[3].MarkerIndex = 3;
+	BadMarker.Write(Data);
+	CheckRejected(Data, TEXT("BadMarkerIndex"));
+
+	MarkerMapData BadKeyframe = Map;
+	BadKeyframe.Observations[0].KeyframeIndex = -1;
+	BadKeyframe.Write(Data);
+	CheckRejected(Data, TEXT("BadKeyframeIndex"));
+
+	MarkerMapData BadRange = Map;
+	BadRange.Keyframes[1].NumObservations = 3;
+	BadRange.Write(Data);
+	CheckRejected(Data, TEXT("BadRange"));
+
+	// FirstObservation + NumObservations overflows an int32
+	MarkerMapData Overflow = Map;
+	Overflow.Keyframes[1].FirstObservation = 0x7fffffff;
+	Overflow.Keyframes[1].NumObservations = 0x7fffffff;
+	Overflow.Write(Data);
+	CheckRejected(Data, TEXT("Overflow"));
+}
+
+int main()
+{
+	return RunTests();
+}
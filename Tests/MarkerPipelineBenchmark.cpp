@@ -0,0 +1,171 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "BenchmarkHarness.h"
+#include "MarkerFixtures.h"
+#include "AllocationCounter.h"
+
+/*
+ Heap allocations and time per frame of the whole marker path on rendered camera images (see MarkerFixtures::MakeImages):
+ the marker detector, the pose of every marker and the board's pose, with the markers held as aruco::Marker, as
+ ArucoMarkerDetector used to (MarkerDetector's Marker interface, markers copied into the board's bucket), and as
+ aruco::MarkerRecord, as now (the record interface, poses from the pose tracker).
+ Allocations are counted at malloc (AllocationCounter, so this runs on Linux only), so OpenCV's own (thresholding,
+ contours, the solvers' work buffers) are included; the record path is also counted stage by stage.  It fails if the
+ detector misses most of the board, since the counts would then measure little, or if the record path allocates no less
+ than the Marker path.
+ Usage: MarkerPipelineBenchmark [iterations]
+ */
+
+using namespace MarkerFixtures;
+
+static const int32 NumImages = 60;
+static const float ReprojectionThreshold = 4.f;
+
+/* The path on aruco::Marker: detected markers converted and their poses solved by MarkerDetector, then copied into the board's bucket */
+struct MarkerPipeline
+{
+	MarkerPipeline() { Detector.set_repj_err_thres(ReprojectionThreshold); }
+
+	void Run(const cv::Mat& Image, const aruco::BoardConfiguration& Config, const aruco::CameraParameters& CameraParams)
+	{
+		MarkerFinder.detect(Image, Markers, CameraParams, MarkerSize);
+		Bucket.clear();
+		for (size_t i = 0; i < Markers.size(); i++) {
+			if (Config.getIndexOfMarkerId(Markers[i].id) != -1) Bucket.push_back(Markers[i]);
+		}
+		Detector.detect(Bucket, Config, Detected, CameraParams, MarkerSize);
+	}
+
+	aruco::MarkerDetector MarkerFinder;
+	std::vector<aruco::Marker> Markers;
+	std::vector<aruco::Marker> Bucket;
+	aruco::Board Detected;
+	aruco::BoardDetector Detector;
+};
+
+/* The same on aruco::MarkerRecord, as ArucoMarkerDetector::DetectMarkers runs it; allocations are added up per stage while counting */
+struct RecordPipeline
+{
+	enum Stage { Detection, MarkerPoses, BoardPose, NumStages };
+
+	RecordPipeline() { Detector.set_repj_err_thres(ReprojectionThreshold); ResetStages(); }
+
+	void ResetStages()
+	{
+		for (int32 i = 0; i < NumStages; i++) StageAllocations[i] = 0;
+	}
+
+	void Run(const cv::Mat& Image, const aruco::BoardConfiguration& Config, const aruco::CameraParameters& CameraParams)
+	{
+		int64 Start = AllocationCounter::Allocations;
+		MarkerFinder.detect(Image, Records);
+		int64 Detected = AllocationCounter::Allocations;
+		Tracker.newFrame();
+		for (size_t i = 0; i < Records.size(); i++) {
+			Records[i].calculateExtrinsics(MarkerSize, CameraParams, Tracker);
+		}
+		int64 Posed = AllocationCounter::Allocations;
+		Bucket.clear();
+		for (size_t i = 0; i < Records.size(); i++) {
+			if (Config.getIndexOfMarkerId(Records[i].id) != -1) Bucket.push_back(Records[i]);
+		}
+		Detector.detect(Bucket, Config, BoardMarkers, Rvec, Tvec, CameraParams, MarkerSize);
+		StageAllocations[Detection] += Detected - Start;
+		StageAllocations[MarkerPoses] += Posed - Detected;
+		StageAllocations[BoardPose] += AllocationCounter::Allocations - Posed;
+	}
+
+	aruco::MarkerDetector MarkerFinder;
+	std::vector<aruco::MarkerRecord> Records;
+	std::vector<aruco::MarkerRecord> Bucket;
+	std::vector<aruco::MarkerRecord> BoardMarkers;
+	cv::Mat Rvec;
+	cv::Mat Tvec;
+	aruco::BoardDetector Detector;
+	aruco::PoseTracker Tracker;
+	int64 StageAllocations[NumStages];
+};
+
+/* Allocations per frame over all images, after a first pass has grown the buffers */
+template<typename PipelineType>
+static double CountPerFrame(PipelineType& Pipeline, const std::vector<cv::Mat>& Images, const aruco::BoardConfiguration& Config, const aruco::CameraParameters& CameraParams)
+{
+	for (size_t f = 0; f < Images.size(); f++) {
+		Pipeline.Run(Images[f], Config, CameraParams);
+	}
+	AllocationCounter::StartCounting();
+	for (size_t f = 0; f < Images.size(); f++) {
+		Pipeline.Run(Images[f], Config, CameraParams);
+	}
+	return AllocationCounter::StopCounting() / (double)Images.size();
+}
+
+int main(int argc, char** argv)
+{
+	int32 Iterations = Benchmark::GetIterations(argc, argv, 5);
+	aruco::CameraParameters CameraParams = MakeCameraParameters();
+	aruco::BoardConfiguration Config = MakeBoard();
+	std::vector<cv::Mat> Images;
+	MakeImages(Config, CameraParams, NumImages, Images);
+
+	MarkerPipeline Markers;
+	RecordPipeline Records;
+	double MarkerTotal = CountPerFrame(Markers, Images, Config, CameraParams);
+	Records.ResetStages();
+	double RecordTotal = CountPerFrame(Records, Images, Config, CameraParams);
+	int64 BoardMarkersFound = 0;
+	for (size_t f = 0; f < Images.size(); f++) {
+		Records.Run(Images[f], Config, CameraParams);
+		BoardMarkersFound += Records.BoardMarkers.size();
+	}
+	double FoundPerFrame = BoardMarkersFound / (double)Images.size();
+	printf("Board markers found per frame: %.1f of %d\n", FoundPerFrame, (int)Config.size());
+	printf("Allocations per frame, detection, marker poses and board pose: aruco::Marker %.1f, aruco::MarkerRecord %.1f\n", MarkerTotal, RecordTotal);
+	printf("aruco::MarkerRecord by stage: detection %.1f, marker poses %.1f, board pose %.1f\n",
+		Records.StageAllocations[RecordPipeline::Detection] / (double)Images.size(),
+		Records.StageAllocations[RecordPipeline::MarkerPoses] / (double)Images.size(),
+		Records.StageAllocations[RecordPipeline::BoardPose] / (double)Images.size());
+
+	Benchmark::Run("Detection, marker poses and board, aruco::Marker", Iterations, NumImages, "frame", [&]() {
+		for (int32 f = 0; f < NumImages; f++) {
+			Markers.Run(Images[f], Config, CameraParams);
+		}
+		Benchmark::DoNotOptimize(Markers.Detected);
+	});
+	Benchmark::Run("Detection, marker poses and board, aruco::MarkerRecord", Iterations, NumImages, "frame", [&]() {
+		for (int32 f = 0; f < NumImages; f++) {
+			Records.Run(Images[f], Config, CameraParams);
+		}
+		Benchmark::DoNotOptimize(Records.BoardMarkers);
+	});
+
+	bool DetectsBoard = FoundPerFrame >= 0.8 * Config.size();
+	if (!DetectsBoard) fprintf(stderr, "The detector found too few markers in the rendered images\n");
+	if (RecordTotal >= MarkerTotal) fprintf(stderr, "The record path allocates no less than the Marker path\n");
+	return DetectsBoard && RecordTotal < MarkerTotal ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "AllocationCounter.h"
+#include "OculusARPOC.h"
+#include "PoseFilters.h"
+
+/*
+ Location filters (see PoseFilters.h), through PoseFilter as the character uses them: measurements at camera frame
+ times, locations predicted ahead to display time.  Most tests run with both methods.
+ */
+
+static const double FrameSeconds = 1.0 / 60.0;
+static const PoseFilter::Method Methods[] = { PoseFilter::OneEuro, PoseFilter::Kalman };
+
+/* Feeds Seconds of a location moving at Velocity from Start, one measurement per frame from StartTime; returns the time of the last one */
+static double FeedSteadyMotion(PoseFilter& Filter, const FVector& Start, const FVector& Velocity, double StartTime, float Seconds)
+{
+	int32 Frames = (int32)(Seconds / FrameSeconds + 0.5);
+	double Time = StartTime;
+	for (int32 i = 0; i <= Frames; i++) {
+		Time = StartTime + i * FrameSeconds;
+		Filter.UpdateLocation(Start + Velocity * (float)(i * FrameSeconds), Time);
+	}
+	return Time;
+}
+
+AR_TEST(PredictionLeadsByTheVelocityUpToMaxLeadSeconds)
+{
+	for (int32 m = 0; m < 2; m++) {
+		PoseFilter Filter;
+		Filter.SetMethod(Methods[m]);
+		const FVector Velocity(100.f, -50.f, 20.f);
+		double Last = FeedSteadyMotion(Filter, FVector(10.f, 20.f, 30.f), Velocity, 1000.0, 2.f);
+		FVector Now = Filter.PredictLocation(Last);
+		// within the cap the prediction moves on with the velocity
+		FVector Lead = Filter.PredictLocation(Last + Filter.MaxLeadSeconds * 0.5f) - Now;
+		AR_CHECK_NEAR(Lead.X, Velocity.X * Filter.MaxLeadSeconds * 0.5f, 0.2);
+		AR_CHECK_NEAR(Lead.Y, Velocity.Y * Filter.MaxLeadSeconds * 0.5f, 0.2);
+		AR_CHECK_NEAR(Lead.Z, Velocity.Z * Filter.MaxLeadSeconds * 0.5f, 0.2);
+		// beyond it the prediction stops at MaxLeadSeconds
+		FVector Capped = Filter.PredictLocation(Last + 1.0) - Now;
+		AR_CHECK_NEAR(Capped.X, Velocity.X * Filter.MaxLeadSeconds, 0.4);
+		AR_CHECK_NEAR(Capped.Y, Velocity.Y * Filter.MaxLeadSeconds, 0.4);
+		AR_CHECK(Filter.PredictLocation(Last + 5.0) == Filter.PredictLocation(Last + Filter.MaxLeadSeconds));
+		// and times before the last measurement give the filtered location
+		AR_CHECK(Filter.PredictLocation(Last - 0.5) == Now);
+		Filter.MaxLeadSeconds = 0.f;
+		AR_CHECK(Filter.PredictLocation(Last + 0.05) == Now);
+	}
+}
+
+AR_TEST(StillLocationConverges)
+{
+	for (int32 m = 0; m < 2; m++) {
+		PoseFilter Filter;
+		Filter.SetMethod(Methods[m]);
+		AR_CHECK(!Filter.HasLocation());
+		double Last = FeedSteadyMotion(Filter, FVector(5.f, 6.f, 7.f), FVector::ZeroVector, 0.0, 1.f);
+		AR_CHECK(Filter.HasLocation());
+		FVector Location = Filter.PredictLocation(Last + 0.05);
+		AR_CHECK_NEAR(Location.X, 5.f, 1e-3);
+		AR_CHECK_NEAR(Location.Y, 6.f, 1e-3);
+		AR_CHECK_NEAR(Location.Z, 7.f, 1e-3);
+	}
+}
+
+AR_TEST(RestartsAfterResetAfterSeconds)
+{
+	for (int32 m = 0; m < 2; m++) {
+		PoseFilter Filter;
+		Filter.SetMethod(Methods[m]);
+		double Last = FeedSteadyMotion(Filter, FVector::ZeroVector, FVector(100.f, 0.f, 0.f), 0.0, 1.f);
+		// a measurement after a gap longer than ResetAfterSeconds is taken as is, with no velocity
+		double After = Last + Filter.ResetAfterSeconds + 0.01;
+		Filter.UpdateLocation(FVector(500.f, 500.f, 500.f), After);
+		AR_CHECK(Filter.PredictLocation(After) == FVector(500.f, 500.f, 500.f));
+		AR_CHECK(Filter.PredictLocation(After + 0.05) == FVector(500.f, 500.f, 500.f));
+		// one within ResetAfterSeconds is blended with the filtered location
+		Filter.UpdateLocation(FVector(600.f, 500.f, 500.f), After + Filter.ResetAfterSeconds - 0.01);
+		FVector Blended = Filter.PredictLocation(After + Filter.ResetAfterSeconds - 0.01);
+		AR_CHECK(Blended.X > 500.f && Blended.X < 600.f);
+	}
+}
+
+AR_TEST(SwitchingMethodsRestarts)
+{
+	PoseFilter Filter;
+	FeedSteadyMotion(Filter, FVector::ZeroVector, FVector(100.f, 0.f, 0.f), 0.0, 1.f);
+	Filter.SetMethod(PoseFilter::Kalman);
+	AR_CHECK(!Filter.HasLocation());
+	AR_CHECK(!Filter.OneEuroLocation.IsInitialized());
+}
+
+AR_TEST(RepeatedFrameTimeIsIgnored)
+{
+	for (int32 m = 0; m < 2; m++) {
+		PoseFilter Filter;
+		Filter.SetMethod(Methods[m]);
+		double Last = FeedSteadyMotion(Filter, FVector::ZeroVector, FVector(100.f, 0.f, 0.f), 0.0, 1.f);
+		FVector Before = Filter.PredictLocation(Last);
+		FVector LeadBefore = Filter.PredictLocation(Last + 0.05);
+		// the same camera frame again (dt == 0), and an older one (dt < 0), with different measurements
+		Filter.UpdateLocation(FVector(300.f, 0.f, 0.f), Last);
+		Filter.UpdateLocation(FVector(-300.f, 0.f, 0.f), Last - FrameSeconds);
+		AR_CHECK(Filter.PredictLocation(Last) == Before);
+		AR_CHECK(Filter.PredictLocation(Last + 0.05) == LeadBefore); // the velocity is untouched as well
+	}
+	KalmanVectorFilter Kalman;
+	Kalman.Update(FVector(1.f, 2.f, 3.f), 1.0);
+	Kalman.Update(FVector(2.f, 2.f, 3.f), 1.1);
+	FVector Value = Kalman.GetValue();
+	FVector Velocity = Kalman.GetVelocity();
+	AR_CHECK(Kalman.Update(FVector(50.f, 50.f, 50.f), 1.1) == Value);
+	AR_CHECK(Kalman.GetVelocity() == Velocity);
+	AR_CHECK(Kalman.GetLastTime() == 1.1);
+}
+
+AR_TEST(UpdatesCostTheSameThroughLongRuns)
+{
+	// O(1) per sample: no history is kept, so an hour of updates allocates nothing and the state stays the same size
+	for (int32 m = 0; m < 2; m++) {
+		PoseFilter Filter;
+		Filter.SetMethod(Methods[m]);
+		Filter.UpdateLocation(FVector::ZeroVector, 0.0);
+		// circling at 50 units/s, which the filters follow with a constant lag
+		int32 Frames = 3600 * 60;
+		float ErrorAfterAMinute = 0.f;
+		float Error = 0.f;
+		AllocationCounter::StartCounting();
+		for (int32 i = 1; i <= Frames; i++) {
+			double Time = i * FrameSeconds;
+			FVector Measurement(FMath::Sin((float)Time) * 50.f, FMath::Cos((float)Time) * 50.f, 0.f);
+			Filter.UpdateLocation(Measurement, Time);
+			Error = (Filter.PredictLocation(Time) - Measurement).Size();
+			if (i == 60 * 60) ErrorAfterAMinute = Error;
+		}
+		AR_CHECK(AllocationCounter::StopCounting() == 0);
+		// and the hour makes no difference to how well they follow
+		AR_CHECK(ErrorAfterAMinute < 5.f);
+		AR_CHECK_NEAR(Error, ErrorAfterAMinute, 0.05);
+	}
+}
+
+int main()
+{
+	return RunTests();
+}
@@ -0,0 +1,97 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "EngineMinimal.h"
+#include <stdarg.h>
+
+const FVector FVector::ZeroVector(0.f, 0.f, 0.f);
+const FVector2D FVector2D::ZeroVector(0.f, 0.f);
+const FMatrix FMatrix::Identity(FVector(1.f, 0.f, 0.f), FVector(0.f, 1.f, 0.f), FVector(0.f, 0.f, 1.f), FVector(0.f, 0.f, 0.f));
+const FRotator FRotator::ZeroRotator(0.f, 0.f, 0.f);
+const FColor FColor::Red(255, 0, 0);
+const FColor FColor::Yellow(255, 255, 0);
+
+static std::map<const UObject*, uint64>& GetLiveObjects()
+{
+	static std::map<const UObject*, uint64> LiveObjects;
+	return LiveObjects;
+}
+
+UObject::UObject()
+{
+	static uint64 NextSerialNumber = 1;
+	GetLiveObjects()[this] = NextSerialNumber++;
+}
+
+UObject::~UObject()
+{
+	GetLiveObjects().erase(this);
+}
+
+uint64 UObject::GetSerialNumber(const UObject* Object)
+{
+	std::map<const UObject*, uint64>::const_iterator It = GetLiveObjects().find(Object);
+	return It == GetLiveObjects().end() ? 0 : It->second;
+}
+
+FString FString::Printf(const TCHAR* Format, ...)
+{
+	char Buffer[1024];
+	va_list Args;
+	va_start(Args, Format);
+	vsnprintf(Buffer, sizeof(Buffer), Format, Args);
+	va_end(Args);
+	return FString(Buffer);
+}
+
+FString FPaths::GameSavedDir()
+{
+	return FString(TEXT("Saved/"));
+}
+
+bool FFileHelper::SaveArrayToFile(const TArray<uint8>& Array, const TCHAR* Filename)
+{
+	FILE* File = fopen(Filename, "wb");
+	if (File == NULL) return false;
+	size_t Written = Array.Num() > 0 ? fwrite(Array.GetData(), 1, Array.Num(), File) : 0;
+	bool Closed = fclose(File) == 0;
+	return Closed && Written == (size_t)Array.Num();
+}
+
+bool FFileHelper::LoadFileToArray(TArray<uint8>& Result, const TCHAR* Filename, uint32 /*Flags*/)
+{
+	FILE* File = fopen(Filename, "rb");
+	if (File == NULL) return false;
+	fseek(File, 0, SEEK_END);
+	long Size = ftell(File);
+	fseek(File, 0, SEEK_SET);
+	Result.Reset();
+	Result.AddUninitialized((int32)Size);
+	size_t Read = Size > 0 ? fread(Result.GetData(), 1, Size, File) : 0;
+	fclose(File);
+	return Read == (size_t)Size;
+}
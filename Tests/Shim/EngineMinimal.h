@@ -0,0 +1,436 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+/*
+ Stand-in for the engine headers, for building the engine independent parts of the game module (hand tracking
+ recording and replay, gesture recognition, hand skeleton) offline, without Unreal, Leap or OpenCV.
+ It provides only the subset of Core those sources use, with the same names and semantics; TCHAR is char.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+#define PLATFORM_WINDOWS 0
+#define PLATFORM_MAC 0
+#define PLATFORM_LINUX 1
+#ifndef UE_BUILD_SHIPPING
+#define UE_BUILD_SHIPPING 1 // trace recording and debug drawing compile out
+#endif
+
+typedef int8_t int8;
+typedef uint8_t uint8;
+typedef int16_t int16;
+typedef uint16_t uint16;
+typedef int32_t int32;
+typedef uint32_t uint32;
+typedef int64_t int64;
+typedef uint64_t uint64;
+typedef char TCHAR;
+typedef char ANSICHAR;
+
+#define TEXT(x) x
+#define TCHAR_TO_UTF8(x) (x)
+#define FORCEINLINE inline
+#define INDEX_NONE (-1)
+#define MAX_FLT 3.402823466e+38F
+#define KINDA_SMALL_NUMBER (1.e-4f)
+#define PI 3.1415926535897932f
+#define check(expr) do { if (!(expr)) { fprintf(stderr, "check failed: %s (%s:%d)\n", #expr, __FILE__, __LINE__); abort(); } } while (0)
+#define checkSlow(expr) check(expr)
+#define PREPROCESSOR_JOIN_INNER(x, y) x##y
+#define PREPROCESSOR_JOIN(x, y) PREPROCESSOR_JOIN_INNER(x, y)
+
+// logging goes to stderr for warnings and errors only, so test output stays readable
+enum ELogVerbosityShim { Fatal, Error, Warning, Display, Log, Verbose, VeryVerbose, All };
+#define DEFINE_LOG_CATEGORY_STATIC(Name, Default, Compile) static const char* Name = #Name
+#define UE_LOG(Category, Verbosity, Format, ...) do { if (Verbosity <= Warning) { fprintf(stderr, "%s: ", Category); fprintf(stderr, Format, ##__VA_ARGS__); fprintf(stderr, "\n"); } } while (0)
+
+struct FMath
+{
+	template<class T> static T Min(const T A, const T B) { return A < B ? A : B; }
+	template<class T> static T Max(const T A, const T B) { return A > B ? A : B; }
+	template<class T> static T Clamp(const T X, const T Low, const T High) { return X < Low ? Low : (X < High ? X : High); }
+	template<class T> static T Abs(const T A) { return A < (T)0 ? -A : A; }
+	template<class T> static T Square(const T A) { return A * A; }
+	template<class T, class U> static T Lerp(const T& A, const T& B, const U& Alpha) { return (T)(A + Alpha * (B - A)); }
+	static float Sqrt(float Value) { return sqrtf(Value); }
+	static float Sin(float Value) { return sinf(Value); }
+	static float Cos(float Value) { return cosf(Value); }
+	static float Fmod(float X, float Y) { return fmodf(X, Y); }
+	static int32 RoundToInt(float F) { return (int32)floorf(F + 0.5f); }
+	static int32 CeilToInt(float F) { return (int32)ceilf(F); }
+	static float CeilToFloat(float F) { return ceilf(F); }
+	static bool IsNearlyEqual(float A, float B, float Tolerance = 1e-8f) { return Abs(A - B) <= Tolerance; }
+	static float DegreesToRadians(float Degrees) { return Degrees * (PI / 180.f); }
+};
+
+struct FMemory
+{
+	static void* Memcpy(void* Dest, const void* Src, size_t Count) { return memcpy(Dest, Src, Count); }
+	static void* Memzero(void* Dest, size_t Count) { return memset(Dest, 0, Count); }
+	static void* Memset(void* Dest, uint8 Char, size_t Count) { return memset(Dest, Char, Count); }
+	static int32 Memcmp(const void* A, const void* B, size_t Count) { return memcmp(A, B, Count); }
+	static void* Malloc(size_t Count, uint32 Alignment = 16) { void* Result = NULL; return posix_memalign(&Result, FMath::Max<size_t>(Alignment, sizeof(void*)), Count) == 0 ? Result : NULL; }
+	static void Free(void* Original) { free(Original); }
+};
+
+template<typename T>
+inline T Align(const T Value, int32 Alignment)
+{
+	return (T)(((uint64)Value + Alignment - 1) & ~((uint64)Alignment - 1));
+}
+
+struct FPlatformMisc
+{
+	static void MemoryBarrier() { __sync_synchronize(); }
+};
+
+struct FPlatformAtomics
+{
+	/* Both return the previous value and are full barriers, as on the engine's platforms */
+	static int32 InterlockedExchange(volatile int32* Value, int32 Exchange) { return __atomic_exchange_n(Value, Exchange, __ATOMIC_SEQ_CST); }
+	static int32 InterlockedCompareExchange(volatile int32* Dest, int32 Exchange, int32 Comparand) { return __sync_val_compare_and_swap(Dest, Comparand, Exchange); }
+};
+
+struct FVector
+{
+	float X, Y, Z;
+
+	FVector() {}
+	explicit FVector(float InF) : X(InF), Y(InF), Z(InF) {}
+	FVector(float InX, float InY, float InZ) : X(InX), Y(InY), Z(InZ) {}
+
+	FVector operator+(const FVector& V) const { return FVector(X + V.X, Y + V.Y, Z + V.Z); }
+	FVector operator-(const FVector& V) const { return FVector(X - V.X, Y - V.Y, Z - V.Z); }
+	FVector operator-() const { return FVector(-X, -Y, -Z); }
+	FVector operator*(float Scale) const { return FVector(X * Scale, Y * Scale, Z * Scale); }
+	FVector operator/(float Scale) const { return FVector(X / Scale, Y / Scale, Z / Scale); }
+	FVector& operator+=(const FVector& V) { X += V.X; Y += V.Y; Z += V.Z; return *this; }
+	float operator[](int32 Index) const { return (&X)[Index]; }
+	bool operator==(const FVector& V) const { return X == V.X && Y == V.Y && Z == V.Z; }
+	bool operator!=(const FVector& V) const { return !(*this == V); }
+	float operator|(const FVector& V) const { return X * V.X + Y * V.Y + Z * V.Z; }
+	FVector operator^(const FVector& V) const { return FVector(Y * V.Z - Z * V.Y, Z * V.X - X * V.Z, X * V.Y - Y * V.X); }
+	float Size() const { return sqrtf(X * X + Y * Y + Z * Z); }
+	bool IsZero() const { return X == 0.f && Y == 0.f && Z == 0.f; }
+
+	static float Dist(const FVector& A, const FVector& B) { return (A - B).Size(); }
+	static float DotProduct(const FVector& A, const FVector& B) { return A | B; }
+
+	static const FVector ZeroVector;
+};
+
+inline FVector operator*(float Scale, const FVector& V) { return V * Scale; }
+
+struct FVector2D
+{
+	float X, Y;
+
+	FVector2D() {}
+	FVector2D(float InX, float InY) : X(InX), Y(InY) {}
+
+	FVector2D operator+(const FVector2D& V) const { return FVector2D(X + V.X, Y + V.Y); }
+	FVector2D operator-(const FVector2D& V) const { return FVector2D(X - V.X, Y - V.Y); }
+	FVector2D operator*(float Scale) const { return FVector2D(X * Scale, Y * Scale); }
+	FVector2D& operator+=(const FVector2D& V) { X += V.X; Y += V.Y; return *this; }
+	bool operator==(const FVector2D& V) const { return X == V.X && Y == V.Y; }
+	bool operator!=(const FVector2D& V) const { return !(*this == V); }
+	float Size() const { return sqrtf(X * X + Y * Y); }
+
+	static float Distance(const FVector2D& A, const FVector2D& B) { return (A - B).Size(); }
+
+	static const FVector2D ZeroVector;
+};
+
+struct FColor
+{
+	uint8 B, G, R, A; // in Unreal's order
+
+	FColor() {}
+	FColor(uint8 InR, uint8 InG, uint8 InB, uint8 InA = 255) : B(InB), G(InG), R(InR), A(InA) {}
+
+	bool operator==(const FColor& C) const { return R == C.R && G == C.G && B == C.B && A == C.A; }
+
+	static const FColor Red;
+	static const FColor Yellow;
+};
+
+/* Row vectors, V * M, as in Unreal */
+struct FMatrix
+{
+	float M[4][4];
+
+	FMatrix() {}
+	FMatrix(const FVector& InX, const FVector& InY, const FVector& InZ, const FVector& InW)
+	{
+		M[0][0] = InX.X; M[0][1] = InX.Y; M[0][2] = InX.Z; M[0][3] = 0.f;
+		M[1][0] = InY.X; M[1][1] = InY.Y; M[1][2] = InY.Z; M[1][3] = 0.f;
+		M[2][0] = InZ.X; M[2][1] = InZ.Y; M[2][2] = InZ.Z; M[2][3] = 0.f;
+		M[3][0] = InW.X; M[3][1] = InW.Y; M[3][2] = InW.Z; M[3][3] = 1.f;
+	}
+
+	FMatrix operator*(const FMatrix& Other) const
+	{
+		FMatrix Result;
+		for (int32 Row = 0; Row < 4; Row++) {
+			for (int32 Column = 0; Column < 4; Column++) {
+				Result.M[Row][Column] = M[Row][0] * Other.M[0][Column] + M[Row][1] * Other.M[1][Column] + M[Row][2] * Other.M[2][Column] + M[Row][3] * Other.M[3][Column];
+			}
+		}
+		return Result;
+	}
+
+	FVector TransformPosition(const FVector& V) const
+	{
+		return FVector(V.X * M[0][0] + V.Y * M[1][0] + V.Z * M[2][0] + M[3][0],
+			V.X * M[0][1] + V.Y * M[1][1] + V.Z * M[2][1] + M[3][1],
+			V.X * M[0][2] + V.Y * M[1][2] + V.Z * M[2][2] + M[3][2]);
+	}
+
+	FVector TransformVector(const FVector& V) const
+	{
+		return FVector(V.X * M[0][0] + V.Y * M[1][0] + V.Z * M[2][0],
+			V.X * M[0][1] + V.Y * M[1][1] + V.Z * M[2][1],
+			V.X * M[0][2] + V.Y * M[1][2] + V.Z * M[2][2]);
+	}
+
+	static const FMatrix Identity;
+};
+
+/* Degrees; RotateVector and UnrotateVector use the same rotation matrix as Unreal's FRotationMatrix */
+struct FRotator
+{
+	float Pitch, Yaw, Roll;
+
+	FRotator() {}
+	FRotator(float InPitch, float InYaw, float InRoll) : Pitch(InPitch), Yaw(InYaw), Roll(InRoll) {}
+
+	FMatrix ToMatrix() const
+	{
+		float SP = sinf(FMath::DegreesToRadians(Pitch)), CP = cosf(FMath::DegreesToRadians(Pitch));
+		float SY = sinf(FMath::DegreesToRadians(Yaw)), CY = cosf(FMath::DegreesToRadians(Yaw));
+		float SR = sinf(FMath::DegreesToRadians(Roll)), CR = cosf(FMath::DegreesToRadians(Roll));
+		return FMatrix(FVector(CP * CY, CP * SY, SP),
+			FVector(SR * SP * CY - CR * SY, SR * SP * SY + CR * CY, -SR * CP),
+			FVector(-(CR * SP * CY + SR * SY), CY * SR - CR * SP * SY, CR * CP),
+			FVector(0.f, 0.f, 0.f));
+	}
+
+	FVector RotateVector(const FVector& V) const { return ToMatrix().TransformVector(V); }
+
+	FVector UnrotateVector(const FVector& V) const
+	{
+		FMatrix R = ToMatrix();
+		return FVector(V.X * R.M[0][0] + V.Y * R.M[0][1] + V.Z * R.M[0][2],
+			V.X * R.M[1][0] + V.Y * R.M[1][1] + V.Z * R.M[1][2],
+			V.X * R.M[2][0] + V.Y * R.M[2][1] + V.Z * R.M[2][2]);
+	}
+
+	static const FRotator ZeroRotator;
+};
+
+template<typename T>
+class TArray
+{
+public:
+
+	typedef T ElementType;
+
+	int32 Num() const { return (int32)Items.size(); }
+	bool IsValidIndex(int32 Index) const { return Index >= 0 && Index < Num(); }
+	T* GetData() { return Items.empty() ? NULL : &Items[0]; }
+	const T* GetData() const { return Items.empty() ? NULL : &Items[0]; }
+	T& operator[](int32 Index) { check(IsValidIndex(Index)); return Items[Index]; }
+	const T& operator[](int32 Index) const { check(IsValidIndex(Index)); return Items[Index]; }
+	T& Last() { return Items.back(); }
+	const T& Last() const { return Items.back(); }
+
+	int32 Add(const T& Item) { Items.push_back(Item); return Num() - 1; }
+	int32 AddZeroed(int32 Count = 1) { int32 Index = Num(); Items.resize(Items.size() + Count); FMemory::Memzero(&Items[Index], Count * sizeof(T)); return Index; }
+	int32 AddUninitialized(int32 Count = 1) { int32 Index = Num(); Items.resize(Items.size() + Count); return Index; }
+	void Append(const T* Ptr, int32 Count) { Items.insert(Items.end(), Ptr, Ptr + Count); }
+	void Init(const T& Element, int32 Number) { Items.assign(Number, Element); }
+	void SetNum(int32 NewNum) { Items.resize(NewNum); }
+	void Reserve(int32 Number) { Items.reserve(Number); }
+	void Reset() { Items.clear(); }
+	void Empty() { std::vector<T>().swap(Items); }
+	T Pop() { T Item = Items.back(); Items.pop_back(); return Item; }
+	void RemoveAt(int32 Index) { Items.erase(Items.begin() + Index); }
+	void RemoveAtSwap(int32 Index) { Items[Index] = Items.back(); Items.pop_back(); }
+	int32 Find(const T& Item) const { for (int32 i = 0; i < Num(); i++) { if (Items[i] == Item) return i; } return INDEX_NONE; }
+
+	/* Bytes allocated, for allocation checks */
+	size_t GetAllocatedSize() const { return Items.capacity() * sizeof(T); }
+
+private:
+
+	std::vector<T> Items;
+};
+
+template<typename KeyType, typename ValueType>
+class TMap
+{
+public:
+
+	int32 Num() const { return (int32)Pairs.size(); }
+	ValueType* Find(const KeyType& Key) { typename std::map<KeyType, ValueType>::iterator It = Pairs.find(Key); return It == Pairs.end() ? NULL : &It->second; }
+	const ValueType* Find(const KeyType& Key) const { typename std::map<KeyType, ValueType>::const_iterator It = Pairs.find(Key); return It == Pairs.end() ? NULL : &It->second; }
+	ValueType& FindOrAdd(const KeyType& Key) { return Pairs[Key]; }
+	ValueType& Add(const KeyType& Key, const ValueType& Value) { return Pairs[Key] = Value; }
+	int32 Remove(const KeyType& Key) { return (int32)Pairs.erase(Key); }
+	void Empty() { Pairs.clear(); }
+
+private:
+
+	std::map<KeyType, ValueType> Pairs;
+};
+
+/* Objects, just enough for ActorPool.  Deleting an object stands in for the engine destroying it: weak pointers to it go invalid. */
+class UObject
+{
+public:
+
+	UObject();
+	virtual ~UObject();
+
+	/* Serial number of a live object, 0 if there is none at Object */
+	static uint64 GetSerialNumber(const UObject* Object);
+};
+
+class UClass : public UObject {};
+
+class UWorld : public UObject {};
+
+class AActor : public UObject
+{
+public:
+
+	explicit AActor(UClass* InClass) : Class(InClass) {}
+
+	UClass* GetClass() const { return Class; }
+
+private:
+
+	UClass* Class;
+};
+
+class APawn : public AActor {};
+
+template<typename T>
+class TWeakObjectPtr
+{
+public:
+
+	TWeakObjectPtr() : Object(NULL), SerialNumber(0) {}
+	TWeakObjectPtr(T* InObject) : Object(InObject), SerialNumber(UObject::GetSerialNumber(InObject)) {}
+
+	T* Get() const { return Object != NULL && SerialNumber != 0 && UObject::GetSerialNumber(Object) == SerialNumber ? Object : NULL; }
+	bool IsValid() const { return Get() != NULL; }
+	bool operator==(const TWeakObjectPtr& Other) const { return Get() == Other.Get(); }
+
+private:
+
+	T* Object;
+	uint64 SerialNumber;
+};
+
+class FString
+{
+public:
+
+	FString() {}
+	FString(const TCHAR* In) : Data(In ? In : "") {}
+	FString(const std::string& In) : Data(In) {}
+
+	const TCHAR* operator*() const { return Data.c_str(); }
+	int32 Len() const { return (int32)Data.size(); }
+	bool IsEmpty() const { return Data.empty(); }
+	bool operator==(const FString& Other) const { return Data == Other.Data; }
+
+	FString operator+(const FString& Other) const { return FString(Data + Other.Data); }
+	FString operator+(const TCHAR* Other) const { return FString(Data + Other); }
+	FString operator/(const FString& Other) const { return FString(Data.empty() || Data[Data.size() - 1] == '/' ? Data + Other.Data : Data + "/" + Other.Data); }
+	FString operator/(const TCHAR* Other) const { return *this / FString(Other); }
+
+	static FString Printf(const TCHAR* Format, ...);
+
+private:
+
+	std::string Data;
+};
+
+struct FPaths
+{
+	/* Directory the test binaries run in, standing in for the project's Saved directory */
+	static FString GameSavedDir();
+
+	static FString ConvertRelativePathToFull(const FString& Path) { return Path; }
+};
+
+enum EFileRead { FILEREAD_None = 0, FILEREAD_Silent = 1 };
+
+struct FFileHelper
+{
+	static bool SaveArrayToFile(const TArray<uint8>& Array, const TCHAR* Filename);
+
+	static bool LoadFileToArray(TArray<uint8>& Result, const TCHAR* Filename, uint32 Flags = 0);
+};
+
+struct FPlatformTime
+{
+	static double Seconds() { return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+};
+
+class FCriticalSection
+{
+public:
+	void Lock() { Mutex.lock(); }
+	void Unlock() { Mutex.unlock(); }
+private:
+	std::mutex Mutex;
+};
+
+class FScopeLock
+{
+public:
+	explicit FScopeLock(FCriticalSection* InSection) : Section(InSection) { Section->Lock(); }
+	~FScopeLock() { Section->Unlock(); }
+private:
+	FCriticalSection* Section;
+};
@@ -0,0 +1,65 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "OculusARPOC.h"
+
+/*
+ Minimal test support: each test executable defines functions registered with AR_TEST and runs them from main with
+ RunTests, which returns the number of failed checks (the exit code ctest looks at).
+ */
+
+typedef void (*TestFunction)();
+
+struct TestRegistry
+{
+	struct Entry { const char* Name; TestFunction Function; };
+
+	static std::vector<Entry>& Tests() { static std::vector<Entry> All; return All; }
+
+	static int32& Failures() { static int32 Count = 0; return Count; }
+
+	TestRegistry(const char* Name, TestFunction Function) { Entry Test = { Name, Function }; Tests().push_back(Test); }
+};
+
+#define AR_TEST(Name) static void Name(); static TestRegistry PREPROCESSOR_JOIN(Register_, Name)(#Name, Name); static void Name()
+
+#define AR_CHECK(Expr) do { if (!(Expr)) { TestRegistry::Failures()++; fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #Expr); } } while (0)
+
+#define AR_CHECK_NEAR(A, B, Tolerance) do { double CheckA = (A), CheckB = (B); if (!(fabs(CheckA - CheckB) <= (Tolerance))) { TestRegistry::Failures()++; fprintf(stderr, "%s:%d: check failed: %s == %s (%g vs %g, tolerance %g)\n", __FILE__, __LINE__, #A, #B, CheckA, CheckB, (double)(Tolerance)); } } while (0)
+
+inline int RunTests()
+{
+	const std::vector<TestRegistry::Entry>& Tests = TestRegistry::Tests();
+	for (size_t i = 0; i < Tests.size(); i++) {
+		int32 Before = TestRegistry::Failures();
+		Tests[i].Function();
+		printf("%s %s\n", TestRegistry::Failures() == Before ? "PASS" : "FAIL", Tests[i].Name);
+	}
+	return TestRegistry::Failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "AllocationCounter.h"
+#include "TextureUploadPool.h"
+
+/*
+ TextureUploadPool against a sink that records the uploads and releases buffers only when the test completes them,
+ standing in for the render thread's fences.
+ */
+
+static const uint32 BufferSize = 64;
+
+class RecordingSink : public ITextureUploadSink
+{
+public:
+
+	RecordingSink() { Uploads.Reserve(64); Pending.Reserve(TextureUploadPool::MaxBuffers); }
+
+	virtual void EnqueueUpload(TextureUploadPool* InPool, int32 BufferIndex) override
+	{
+		Pool = InPool;
+		Upload Uploaded = { BufferIndex, InPool->GetBuffer(BufferIndex)[0] };
+		Uploads.Add(Uploaded);
+		Pending.Add(BufferIndex);
+	}
+
+	/* The oldest upload finished reading its buffer, as the render thread's fence would signal */
+	void CompleteOldest()
+	{
+		check(Pending.Num() > 0);
+		int32 BufferIndex = Pending[0];
+		Pending.RemoveAt(0);
+		Pool->ReleaseBuffer(BufferIndex);
+	}
+
+	struct Upload
+	{
+		int32 BufferIndex;
+		uint8 Frame; // first byte of the buffer when it was submitted
+	};
+
+	TArray<Upload> Uploads;
+
+	TArray<int32> Pending; // submitted and not completed, oldest first
+
+	TextureUploadPool* Pool;
+};
+
+/* Writes frame number Frame into the whole buffer */
+struct FrameWriter
+{
+	uint8 Frame;
+	int32 Calls;
+
+	explicit FrameWriter(uint8 InFrame) : Frame(InFrame), Calls(0) {}
+
+	bool operator()(uint8* Buffer)
+	{
+		Calls++;
+		FMemory::Memset(Buffer, Frame, BufferSize);
+		return true;
+	}
+};
+
+/* The video source has no new frame */
+static bool NoNewFrame(uint8* /*Buffer*/)
+{
+	return false;
+}
+
+static bool BufferHolds(const TextureUploadPool& Pool, int32 BufferIndex, uint8 Frame)
+{
+	const uint8* Buffer = Pool.GetBuffer(BufferIndex);
+	for (uint32 i = 0; i < BufferSize; i++) {
+		if (Buffer[i] != Frame) return false;
+	}
+	return true;
+}
+
+AR_TEST(InitClampsAndAligns)
+{
+	TextureUploadPool Pool;
+	Pool.Init(10, 30);
+	AR_CHECK(Pool.GetNumBuffers() == TextureUploadPool::MaxBuffers);
+	AR_CHECK(Pool.GetBufferSize() == 32);
+	AR_CHECK(((uint64)Pool.GetBuffer(0) & 15) == 0 && ((uint64)Pool.GetBuffer(1) & 15) == 0);
+	AR_CHECK(Pool.GetNumInFlight() == 0);
+	Pool.Init(0, BufferSize);
+	AR_CHECK(Pool.GetNumBuffers() == 1);
+}
+
+AR_TEST(BuffersCycleAcrossFences)
+{
+	TextureUploadPool Pool;
+	RecordingSink Sink;
+	Pool.Init(3, BufferSize);
+	for (uint8 Frame = 1; Frame <= 3; Frame++) {
+		AR_CHECK(Pool.UploadFrame(&Sink, FrameWriter(Frame)));
+	}
+	AR_CHECK(Sink.Uploads.Num() == 3);
+	AR_CHECK(Pool.GetNumInFlight() == 3);
+	for (int32 i = 0; i < 3; i++) {
+		AR_CHECK(Sink.Uploads[i].BufferIndex == i);
+		AR_CHECK(Sink.Uploads[i].Frame == i + 1);
+		AR_CHECK(Pool.GetBufferState(i) == TextureUploadPool::InFlight);
+	}
+
+	// the first upload's fence: its buffer is written next, the others stay with the sink
+	Sink.CompleteOldest();
+	AR_CHECK(Pool.GetBufferState(0) == TextureUploadPool::Free);
+	AR_CHECK(Pool.UploadFrame(&Sink, FrameWriter(4)));
+	AR_CHECK(Sink.Uploads.Last().BufferIndex == 0 && Sink.Uploads.Last().Frame == 4);
+	AR_CHECK(BufferHolds(Pool, 1, 2) && BufferHolds(Pool, 2, 3));
+
+	// in steady state each fence frees exactly the buffer the next frame goes to
+	for (uint8 Frame = 5; Frame < 20; Frame++) {
+		Sink.CompleteOldest();
+		int32 Freed = (Frame - 4) % 3;
+		AR_CHECK(Pool.UploadFrame(&Sink, FrameWriter(Frame)));
+		AR_CHECK(Sink.Uploads.Last().BufferIndex == Freed);
+		AR_CHECK(Pool.GetNumInFlight() == 3);
+	}
+	AR_CHECK(Pool.GetSubmittedCount() == 19);
+	AR_CHECK(Pool.GetStarvedCount() == 0);
+	while (Sink.Pending.Num() > 0) {
+		Sink.CompleteOldest();
+	}
+	AR_CHECK(Pool.GetNumInFlight() == 0);
+}
+
+AR_TEST(NothingIsUploadedWithoutANewFrame)
+{
+	TextureUploadPool Pool;
+	RecordingSink Sink;
+	Pool.Init(3, BufferSize);
+	AR_CHECK(Pool.UploadFrame(&Sink, FrameWriter(1)));
+	Sink.CompleteOldest();
+	for (int32 Tick = 0; Tick < 5; Tick++) {
+		AR_CHECK(!Pool.UploadFrame(&Sink, NoNewFrame));
+	}
+	AR_CHECK(Sink.Uploads.Num() == 1);
+	AR_CHECK(Pool.GetSubmittedCount() == 1);
+	AR_CHECK(Pool.GetStarvedCount() == 0);
+	AR_CHECK(Pool.GetNumInFlight() == 0);
+	for (int32 i = 0; i < Pool.GetNumBuffers(); i++) {
+		AR_CHECK(Pool.GetBufferState(i) == TextureUploadPool::Free); // every acquired buffer was handed back
+	}
+	AR_CHECK(BufferHolds(Pool, 0, 1));
+}
+
+AR_TEST(StarvedPoolSkipsTheFrame)
+{
+	TextureUploadPool Pool;
+	RecordingSink Sink;
+	Pool.Init(2, BufferSize);
+	AR_CHECK(Pool.UploadFrame(&Sink, FrameWriter(1)));
+	AR_CHECK(Pool.UploadFrame(&Sink, FrameWriter(2)));
+
+	// the sink holds both buffers: the frame is skipped without touching either of them
+	FrameWriter Skipped(3);
+	AR_CHECK(!Pool.UploadFrame(&Sink, Skipped));
+	AR_CHECK(Skipped.Calls == 0);
+	AR_CHECK(Pool.AcquireWriteBuffer() == INDEX_NONE);
+	AR_CHECK(Pool.GetStarvedCount() == 2);
+	AR_CHECK(Sink.Uploads.Num() == 2);
+	AR_CHECK(BufferHolds(Pool, 0, 1) && BufferHolds(Pool, 1, 2));
+
+	// once one upload completes, the next frame goes to that buffer and the other one is left alone
+	Sink.CompleteOldest();
+	AR_CHECK(Pool.UploadFrame(&Sink, FrameWriter(4)));
+	AR_CHECK(Sink.Uploads.Last().BufferIndex == 0);
+	AR_CHECK(BufferHolds(Pool, 1, 2));
+}
+
+AR_TEST(NoAllocationAfterInit)
+{
+	TextureUploadPool Pool;
+	RecordingSink Sink;
+	Pool.Init(3, BufferSize);
+	AllocationCounter::StartCounting();
+	for (int32 Frame = 0; Frame < 30; Frame++) {
+		if (Sink.Pending.Num() == 3) {
+			Sink.CompleteOldest();
+		}
+		Pool.UploadFrame(&Sink, FrameWriter((uint8)Frame));
+		Pool.UploadFrame(&Sink, NoNewFrame);
+	}
+	AR_CHECK(AllocationCounter::StopCounting() == 0);
+	AR_CHECK(Pool.GetSubmittedCount() == 30);
+}
+
+int main()
+{
+	return RunTests();
+}
@@ -0,0 +1,169 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TouchReplayHarness.h"
+
+TouchReplayHarness::TouchReplayHarness()
+	: LeapToSurface(FVector(0.2f, 0.f, 0.f), FVector(0.f, -0.2f, 0.f), FVector(0.f, 0.f, 0.2f), FVector(0.f, 50.f, 0.f))
+{
+	ViewWidth = 1000.f;
+	ViewHeight = 1000.f;
+	Hand = LeapHandSample::Right;
+	StepTime = 0.0;
+	Reset();
+}
+
+void TouchReplayHarness::Reset()
+{
+	Touch.Reset();
+	Events.Reset();
+	Inputs.Reset();
+	NumFrames = 0;
+}
+
+FVector2D TouchReplayHarness::GetPixelCoordinates(const float LeapPosition[3], bool* OutTouching) const
+{
+	FVector ActorLocation = LeapToSurface.TransformPosition(FVector(LeapPosition[0], LeapPosition[1], LeapPosition[2]));
+	if (OutTouching) {
+		*OutTouching = ActorLocation.Z <= 0.f;
+	}
+	return GetViewPixelCoordinates(ActorLocation);
+}
+
+FVector2D TouchReplayHarness::GetViewPixelCoordinates(const FVector& ActorLocation) const
+{
+	// AUISurfaceActor::GetViewPixelCoordinatesFromActorLocation
+	return FVector2D((ActorLocation.X + 50.f) / 100.f * ViewWidth, (ActorLocation.Y + 50.f) / 100.f * ViewHeight);
+}
+
+void TouchReplayHarness::LeapFromPixels(const FVector2D& Pixels, float Depth, float OutLeapPosition[3])
+{
+	OutLeapPosition[0] = (Pixels.X - 500.f) / 2.f;
+	OutLeapPosition[1] = (1000.f - Pixels.Y) / 2.f;
+	OutLeapPosition[2] = Depth;
+}
+
+void TouchReplayHarness::Step(const IHandTrackingSource& Source, double Time)
+{
+	LeapHandSample Sample;
+	if (!Source.GetSampleAt(Time, Sample) || !Sample.HasHand(Hand)) return;
+	const LeapHandSample::Hand& Tracked = Sample.Hands[Hand];
+	const float* FingerTip = Tracked.Joints[2][LeapHandSample::TipJoint]; // middle finger
+	FVector Finger = LeapToSurface.TransformPosition(FVector(FingerTip[0], FingerTip[1], FingerTip[2]));
+	FVector Palm = LeapToSurface.TransformPosition(FVector(Tracked.PalmPosition[0], Tracked.PalmPosition[1], Tracked.PalmPosition[2]));
+	StepTime = Time;
+	Touch.AddSample(Time, GetViewPixelCoordinates(Finger), Finger.Z, GetViewPixelCoordinates(Palm), *this);
+	NumFrames++;
+	const TArray<GestureEvent>& Found = Touch.Gestures.GetEvents();
+	for (int32 i = 0; i < Found.Num(); i++) {
+		Events.Add(Found[i]);
+	}
+}
+
+void TouchReplayHarness::Run(const IHandTrackingSource& Source, double StartTime, float Seconds, float FrameRate)
+{
+	int32 Frames = (int32)(Seconds * FrameRate + 0.5f);
+	for (int32 Frame = 0; Frame <= Frames; Frame++) {
+		Step(Source, StartTime + Frame / (double)FrameRate);
+	}
+}
+
+int32 TouchReplayHarness::CountEvents(GestureEvent::EventType Type) const
+{
+	int32 Count = 0;
+	for (int32 i = 0; i < Events.Num(); i++) {
+		if (Events[i].Type == Type) Count++;
+	}
+	return Count;
+}
+
+int32 TouchReplayHarness::FindEvent(GestureEvent::EventType Type, int32 StartIndex) const
+{
+	for (int32 i = StartIndex; i < Events.Num(); i++) {
+		if (Events[i].Type == Type) return i;
+	}
+	return INDEX_NONE;
+}
+
+int32 TouchReplayHarness::CountInputs(ViewInput::InputType Type) const
+{
+	int32 Count = 0;
+	for (int32 i = 0; i < Inputs.Num(); i++) {
+		if (Inputs[i].Type == Type) Count++;
+	}
+	return Count;
+}
+
+int32 TouchReplayHarness::FindInput(ViewInput::InputType Type, int32 StartIndex) const
+{
+	for (int32 i = StartIndex; i < Inputs.Num(); i++) {
+		if (Inputs[i].Type == Type) return i;
+	}
+	return INDEX_NONE;
+}
+
+float TouchReplayHarness::GetWheelTicks() const
+{
+	float Ticks = 0.f;
+	for (int32 i = 0; i < Inputs.Num(); i++) {
+		if (Inputs[i].Type == ViewInput::Wheel) Ticks += Inputs[i].WheelTicksY;
+	}
+	return Ticks;
+}
+
+TouchReplayHarness::ViewInput& TouchReplayHarness::AddInput(ViewInput::InputType Type)
+{
+	ViewInput& Input = Inputs[Inputs.AddZeroed()];
+	Input.Type = Type;
+	Input.Time = StepTime;
+	return Input;
+}
+
+void TouchReplayHarness::MouseMove(const FVector2D& Pixels)
+{
+	AddInput(ViewInput::Move).Position = Pixels;
+}
+
+void TouchReplayHarness::MouseDown(const FVector2D& Pixels)
+{
+	AddInput(ViewInput::Down).Position = Pixels;
+}
+
+void TouchReplayHarness::MouseUp(const FVector2D& Pixels)
+{
+	AddInput(ViewInput::Up).Position = Pixels;
+}
+
+void TouchReplayHarness::MouseWheel(float WheelTicksY)
+{
+	AddInput(ViewInput::Wheel).WheelTicksY = WheelTicksY;
+}
+
+void TouchReplayHarness::Back()
+{
+	AddInput(ViewInput::Back);
+}
@@ -0,0 +1,132 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#pragma once
+
+#include "OculusARPOC.h"
+#include "HandTrackingReplay.h"
+#include "UISurfaceTouchInput.h"
+
+/*
+ Drives a UISurfaceTouchInput from a hand tracking replay the way AUISurfaceActor::HandleVirtualTouchInput does in the
+ game: each frame the middle fingertip and palm of one hand are taken to the surface's actor space and mapped to view
+ pixels, and the fingertip's actor Z is its height above the surface plane.
+ Frames without that hand are skipped, as LeapInputReader reports no valid input for them.
+ The harness is the input sink and records the view input it receives along with the recognized gestures.
+ */
+class TouchReplayHarness : public IUISurfaceInputSink
+{
+public:
+
+	/* View input received from Touch */
+	struct ViewInput
+	{
+		enum InputType
+		{
+			Move,
+			Down,
+			Up,
+			Wheel,
+			Back
+		};
+
+		InputType Type;
+		double Time; // of the sample that generated it
+		FVector2D Position; // mouse inputs only
+		float WheelTicksY; // wheel inputs only
+	};
+
+	/* Leap coordinates (millimeters) to the surface's actor space (the 100x100 plane, Z along its normal) */
+	FMatrix LeapToSurface;
+
+	float ViewWidth;
+	float ViewHeight;
+
+	LeapHandSample::Side Hand;
+
+	UISurfaceTouchInput Touch;
+
+	/* Every event recognized since the last Reset, in order */
+	TArray<GestureEvent> Events;
+
+	/* Every input Touch sent since the last Reset, in order */
+	TArray<ViewInput> Inputs;
+
+	/* Frames that reached the recognizer since the last Reset */
+	int32 NumFrames;
+
+	/*
+	 By default the surface faces the device 1000x1000 pixels in size, 2 pixels per millimeter: pixel X = 500 + 2 x,
+	 pixel Y = 1000 - 2 y, and the finger touches once Leap z <= 0.  See LeapFromPixels.
+	 */
+	TouchReplayHarness();
+
+	void Reset();
+
+	/* Feeds the hand at Time, as one game frame would */
+	void Step(const IHandTrackingSource& Source, double Time);
+
+	/* Feeds frames at FrameRate from StartTime for Seconds */
+	void Run(const IHandTrackingSource& Source, double StartTime, float Seconds, float FrameRate);
+
+	/* Surface pixel coordinates and touch state of a Leap position, as the game computes them */
+	FVector2D GetPixelCoordinates(const float LeapPosition[3], bool* OutTouching) const;
+
+	/* Leap position that the default mapping puts at Pixels, Depth millimeters in front of the surface (<= 0 touches) */
+	static void LeapFromPixels(const FVector2D& Pixels, float Depth, float OutLeapPosition[3]);
+
+	int32 CountEvents(GestureEvent::EventType Type) const;
+
+	/* Index in Events of the first event of Type, INDEX_NONE if there is none */
+	int32 FindEvent(GestureEvent::EventType Type, int32 StartIndex = 0) const;
+
+	int32 CountInputs(ViewInput::InputType Type) const;
+
+	/* Index in Inputs of the first input of Type, INDEX_NONE if there is none */
+	int32 FindInput(ViewInput::InputType Type, int32 StartIndex = 0) const;
+
+	/* Sum of the wheel ticks in Inputs */
+	float GetWheelTicks() const;
+
+	virtual void MouseMove(const FVector2D& Pixels) override;
+
+	virtual void MouseDown(const FVector2D& Pixels) override;
+
+	virtual void MouseUp(const FVector2D& Pixels) override;
+
+	virtual void MouseWheel(float WheelTicksY) override;
+
+	virtual void Back() override;
+
+private:
+
+	ViewInput& AddInput(ViewInput::InputType Type);
+
+	FVector2D GetViewPixelCoordinates(const FVector& ActorLocation) const;
+
+	double StepTime;
+};
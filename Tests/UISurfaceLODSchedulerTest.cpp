@@ -0,0 +1,77 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "OculusARPOC.h"
+#include "UISurfaceLODScheduler.h"
+
+/*
+ Refresh intervals of UI views by screen coverage (see UISurfaceLODScheduler::GetRefreshInterval), mostly with the
+ scheduler's default FullDetailCoverage of 0.25 and MaxRefreshInterval of 15.
+ */
+
+AR_TEST(LargeViewsRefreshEveryFrame)
+{
+	AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(0.25f, 0.25f, 15) == 1);
+	AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(1.f, 0.25f, 15) == 1);
+}
+
+AR_TEST(SmallerViewsRefreshLessOften)
+{
+	const float Full = 0.25f;
+	AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(Full * 0.9f, Full, 15) == 2);
+	AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(Full / 2.f, Full, 15) == 2);
+	AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(Full * 0.3f, Full, 15) == 4);
+	AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(Full / 15.f, Full, 15) == 15);
+	AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(Full / 16.f, Full, 15) == 15);
+	int32 Previous = 1;
+	for (float Coverage = Full; Coverage > 1e-3f; Coverage *= 0.9f) {
+		int32 Interval = UISurfaceLODScheduler::GetRefreshInterval(Coverage, Full, 15);
+		AR_CHECK(Interval >= Previous && Interval <= 15);
+		Previous = Interval;
+	}
+}
+
+AR_TEST(TinyViewsGetTheSlowestRefresh)
+{
+	// 1 / Relative is far beyond an int32 here (or infinite), which must not reach CeilToInt
+	const float Tiny[] = { 1e-9f, 1e-20f, FLT_MIN, 1e-45f };
+	for (int32 i = 0; i < (int32)(sizeof(Tiny) / sizeof(Tiny[0])); i++) {
+		AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(Tiny[i], 0.25f, 15) == 15);
+		AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(Tiny[i], 0.25f, 1) == 1);
+	}
+}
+
+AR_TEST(IntervalIsAtLeastOneFrame)
+{
+	AR_CHECK(UISurfaceLODScheduler::GetRefreshInterval(0.1f, 0.25f, 0) == 1);
+}
+
+int main()
+{
+	return RunTests();
+}
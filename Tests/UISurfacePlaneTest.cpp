@@ -0,0 +1,161 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "OculusARPOC.h"
+#include "UISurfacePlane.h"
+
+/*
+ Ray hits on UI surfaces (see UISurfaceRegistry::Raycast).  The surface stands 100 units down the X axis facing the
+ ray start, with its X axis along world Y and its Y axis along world Z, as the surfaces in front of the player do.
+ */
+
+static UISurfacePlane MakePlane(const FVector& Scale3D)
+{
+	UISurfacePlane Plane;
+	Plane.Set(FVector(100.f, 0.f, 0.f), FVector(0.f, 1.f, 0.f), FVector(0.f, 0.f, 1.f), FVector(-1.f, 0.f, 0.f), Scale3D);
+	return Plane;
+}
+
+static const float Far = 1000.f;
+
+AR_TEST(RayThroughTheCentreHitsAtTheOrigin)
+{
+	UISurfacePlane Plane = MakePlane(FVector(1.f, 1.f, 1.f));
+	float Distance;
+	FVector Local;
+	AR_CHECK(Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.f, 0.f), Far, Distance, Local));
+	AR_CHECK_NEAR(Distance, 100.f, 1e-3f);
+	AR_CHECK_NEAR(Local.X, 0.f, 1e-3f);
+	AR_CHECK_NEAR(Local.Y, 0.f, 1e-3f);
+	AR_CHECK(Local.Z == 0.f);
+}
+
+AR_TEST(LocalLocationIsInTheScaledSurfaceSpace)
+{
+	UISurfacePlane Plane = MakePlane(FVector(2.f, 0.5f, 1.f));
+	float Distance;
+	FVector Local;
+	// reaches the plane at world (100, 60, 10): 60 along the X axis scaled by 2, 10 along the Y axis scaled by 0.5
+	AR_CHECK(Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.6f, 0.1f), Far, Distance, Local));
+	AR_CHECK_NEAR(Distance, 100.f, 1e-3f);
+	AR_CHECK_NEAR(Local.X, 30.f, 1e-3f);
+	AR_CHECK_NEAR(Local.Y, 20.f, 1e-3f);
+}
+
+AR_TEST(ZeroZScaleStillHits)
+{
+	// the surfaces are spawned flat; inverting their transform with scale used to lose every hit
+	UISurfacePlane Flat = MakePlane(FVector(2.f, 0.5f, 0.f));
+	UISurfacePlane Thick = MakePlane(FVector(2.f, 0.5f, 1.f));
+	float FlatDistance, ThickDistance;
+	FVector FlatLocal, ThickLocal;
+	AR_CHECK(Flat.Intersect(FVector::ZeroVector, FVector(1.f, 0.6f, 0.1f), Far, FlatDistance, FlatLocal));
+	AR_CHECK(Thick.Intersect(FVector::ZeroVector, FVector(1.f, 0.6f, 0.1f), Far, ThickDistance, ThickLocal));
+	AR_CHECK(FlatDistance == ThickDistance);
+	AR_CHECK(FlatLocal == ThickLocal);
+}
+
+AR_TEST(ZeroInPlaneScaleNeverHits)
+{
+	float Distance;
+	FVector Local;
+	AR_CHECK(!MakePlane(FVector(0.f, 1.f, 1.f)).Intersect(FVector::ZeroVector, FVector(1.f, 0.f, 0.f), Far, Distance, Local));
+	AR_CHECK(!MakePlane(FVector(1.f, 0.f, 1.f)).Intersect(FVector::ZeroVector, FVector(1.f, 0.f, 0.f), Far, Distance, Local));
+}
+
+AR_TEST(EdgesBoundTheQuad)
+{
+	UISurfacePlane Plane = MakePlane(FVector(2.f, 1.f, 0.f));
+	float Distance;
+	FVector Local;
+	// the scaled quad spans -100..100 on world Y and -50..50 on world Z
+	AR_CHECK(Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.99f, 0.f), Far, Distance, Local));
+	AR_CHECK(!Plane.Intersect(FVector::ZeroVector, FVector(1.f, 1.01f, 0.f), Far, Distance, Local));
+	AR_CHECK(Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.f, -0.49f), Far, Distance, Local));
+	AR_CHECK(!Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.f, -0.51f), Far, Distance, Local));
+}
+
+AR_TEST(ParallelRayMisses)
+{
+	UISurfacePlane Plane = MakePlane(FVector(1.f, 1.f, 0.f));
+	float Distance;
+	FVector Local;
+	AR_CHECK(!Plane.Intersect(FVector(100.f, -200.f, 0.f), FVector(0.f, 1.f, 0.f), Far, Distance, Local));
+}
+
+AR_TEST(SurfaceBehindTheRayMisses)
+{
+	UISurfacePlane Plane = MakePlane(FVector(1.f, 1.f, 0.f));
+	float Distance;
+	FVector Local;
+	AR_CHECK(!Plane.Intersect(FVector::ZeroVector, FVector(-1.f, 0.f, 0.f), Far, Distance, Local));
+}
+
+AR_TEST(HitsFromBehindTheSurface)
+{
+	UISurfacePlane Plane = MakePlane(FVector(1.f, 1.f, 0.f));
+	float Distance;
+	FVector Local;
+	AR_CHECK(Plane.Intersect(FVector(200.f, 10.f, 0.f), FVector(-1.f, 0.f, 0.f), Far, Distance, Local));
+	AR_CHECK_NEAR(Distance, 100.f, 1e-3f);
+	AR_CHECK_NEAR(Local.X, 10.f, 1e-3f);
+}
+
+AR_TEST(HitsOnlyBeforeMaxDistance)
+{
+	// Raycast passes the nearest hit so far as MaxDistance, so a surface at the same distance doesn't replace it
+	UISurfacePlane Plane = MakePlane(FVector(1.f, 1.f, 0.f));
+	float Distance;
+	FVector Local;
+	AR_CHECK(!Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.f, 0.f), 99.f, Distance, Local));
+	AR_CHECK(!Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.f, 0.f), 100.f, Distance, Local));
+	AR_CHECK(Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.f, 0.f), 101.f, Distance, Local));
+	// in units of the direction
+	AR_CHECK(Plane.Intersect(FVector::ZeroVector, FVector(2.f, 0.f, 0.f), 51.f, Distance, Local));
+	AR_CHECK_NEAR(Distance, 50.f, 1e-3f);
+}
+
+AR_TEST(TiltedSurface)
+{
+	// turned 45 degrees about its normal
+	const float S = sqrtf(0.5f);
+	UISurfacePlane Plane;
+	Plane.Set(FVector(100.f, 0.f, 0.f), FVector(0.f, S, S), FVector(0.f, -S, S), FVector(-1.f, 0.f, 0.f), FVector(1.f, 1.f, 0.f));
+	float Distance;
+	FVector Local;
+	AR_CHECK(Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.2f, 0.2f), Far, Distance, Local));
+	AR_CHECK_NEAR(Local.X, 40.f * S, 1e-3f);
+	AR_CHECK_NEAR(Local.Y, 0.f, 1e-3f);
+	// the corner of the untilted quad is outside the tilted one
+	AR_CHECK(!Plane.Intersect(FVector::ZeroVector, FVector(1.f, 0.45f, 0.45f), Far, Distance, Local));
+}
+
+int main()
+{
+	return RunTests();
+}
@@ -0,0 +1,253 @@
+/*****************************
+ Copyright 2015 (c) Leonardo Malave. All rights reserved.
+ 
+ Redistribution and use in source and binary forms, with or without modification, are
+ permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of
+ conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list
+ of conditions and the following disclaimer in the documentation and/or other materials
+ provided with the distribution.
+ 
+ THIS SOFTWARE IS PROVIDED BY Leonardo Malave ''AS IS'' AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Rafael Muñoz Salinas OR
+ CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ 
+ The views and conclusions contained in the software and documentation are those of the
+ authors and should not be interpreted as representing official policies, either expressed
+ or implied, of Leonardo Malave.
+ ********************************/
+#include "TestHarness.h"
+#include "HandStreamFixtures.h"
+#include "TouchReplayHarness.h"
+
+/*
+ View input from touches and gestures: scripted right hand sessions are recorded, replayed and fed through
+ UISurfaceTouchInput by TouchReplayHarness, which records the mouse, wheel and Back input the surface would receive.
+ */
+
+static const float RecordRate = 110.f;
+static const float FrameRate = 90.f;
+static const double Frame = 1.0 / 90.0;
+static const TCHAR* RecordingFile = TEXT("UISurfaceTouchInputTest.hand");
+
+template<typename ScriptType>
+static void RunScript(ScriptType Script, float Seconds, TouchReplayHarness& Harness)
+{
+	TArray<LeapHandSample> Samples;
+	HandStreamFixtures::MakeTouchSession(0.0, Seconds, RecordRate, Script, Samples);
+	AR_CHECK(HandStreamFixtures::SaveSession(Samples, RecordingFile));
+	HandTrackingReplay Replay;
+	AR_CHECK(Replay.Load(RecordingFile));
+	Replay.Looping = false;
+	AR_CHECK(Replay.StartAt(0.0));
+	Harness.Reset();
+	Harness.Run(Replay, 0.0, Seconds, FrameRate);
+}
+
+static float Depth(double T, double TouchStart, double TouchEnd, float Away = 20.f)
+{
+	return T >= TouchStart && T < TouchEnd ? -5.f : Away;
+}
+
+typedef TouchReplayHarness::ViewInput ViewInput;
+
+AR_TEST(CrossingThePlaneClicks)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& /*Palm*/, float& D) {
+		Finger = FVector2D(300.f, 400.f);
+		D = Depth(T, 0.2, 0.35);
+		return true;
+	}, 0.6f, Harness);
+	AR_CHECK(Harness.CountInputs(ViewInput::Down) == 1);
+	AR_CHECK(Harness.CountInputs(ViewInput::Up) == 1);
+	int32 Down = Harness.FindInput(ViewInput::Down);
+	int32 Up = Harness.FindInput(ViewInput::Up);
+	if (Down == INDEX_NONE || Up == INDEX_NONE) return;
+	AR_CHECK(Up == Down + 1); // no moves while touching
+	AR_CHECK_NEAR(Harness.Inputs[Down].Time, 0.2, Frame * 1.5);
+	AR_CHECK_NEAR(Harness.Inputs[Up].Time, 0.35, Frame * 1.5);
+	AR_CHECK_NEAR(Harness.Inputs[Down].Position.X, 300.f, 0.5);
+	AR_CHECK_NEAR(Harness.Inputs[Down].Position.Y, 400.f, 0.5);
+	// hovering just in front of the surface moves the mouse before and after
+	AR_CHECK(Harness.FindInput(ViewInput::Move) < Down);
+	AR_CHECK(Harness.FindInput(ViewInput::Move, Up) != INDEX_NONE);
+	AR_CHECK(!Harness.Touch.IsAcrossPlane());
+	AR_CHECK(Harness.Touch.IsHovering());
+}
+
+AR_TEST(FingerBeyondHoverDistanceDoesNotMove)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& /*Palm*/, float& D) {
+		Finger = FVector2D(300.f, 400.f);
+		D = Depth(T, 0.2, 0.35, 200.f); // 40 actor units in front of the surface, past HoverDistance
+		return true;
+	}, 0.6f, Harness);
+	AR_CHECK(Harness.CountInputs(ViewInput::Move) == 0);
+	AR_CHECK(Harness.CountInputs(ViewInput::Down) == 1);
+	AR_CHECK(Harness.CountInputs(ViewInput::Up) == 1);
+	AR_CHECK(!Harness.Touch.IsHovering());
+}
+
+AR_TEST(PalmScrollTurnsIntoWheelTicks)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& /*Finger*/, FVector2D& Palm, float& D) {
+		Palm = FVector2D(500.f, 600.f + (float)FMath::Clamp(T - 0.3, 0.0, 0.6) * 100.f); // 60 pixels down at 100 per second
+		D = Depth(T, 0.2, 1.2);
+		return true;
+	}, 1.4f, Harness);
+	int32 Scrolls = Harness.CountEvents(GestureEvent::Scroll);
+	AR_CHECK(Scrolls >= 15);
+	AR_CHECK(Harness.CountInputs(ViewInput::Wheel) == Scrolls);
+	// one wheel input per scroll, its pixels over PixelToWheelTickScalingFactor
+	int32 Wheel = -1;
+	for (int32 i = 0; i < Harness.Events.Num(); i++) {
+		Wheel = Harness.FindInput(ViewInput::Wheel, Wheel + 1);
+		if (Wheel == INDEX_NONE) break;
+		AR_CHECK_NEAR(Harness.Inputs[Wheel].WheelTicksY, Harness.Events[i].Delta.Y / Harness.Touch.PixelToWheelTickScalingFactor, 1e-6);
+		AR_CHECK_NEAR(Harness.Inputs[Wheel].Time, Harness.Events[i].Time, 1e-9);
+	}
+	float Step = Harness.Touch.Gestures.ScrollStepPixels / Harness.Touch.PixelToWheelTickScalingFactor;
+	AR_CHECK(Harness.GetWheelTicks() > 0.6f - Step && Harness.GetWheelTicks() <= 0.605f);
+}
+
+AR_TEST(VerticalFlingScrolls)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& /*Palm*/, float& D) {
+		float Moved = (float)FMath::Max(T - 0.3, 0.0) * 1500.f; // keeps moving down as it lifts off at 0.5 s
+		Finger = FVector2D(400.f, 100.f + Moved);
+		D = Depth(T, 0.2, 0.5);
+		return true;
+	}, 0.7f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Fling) == 1);
+	AR_CHECK(Harness.CountInputs(ViewInput::Wheel) == 1); // drags don't scroll, only the fling
+	int32 Wheel = Harness.FindInput(ViewInput::Wheel);
+	if (Wheel == INDEX_NONE) return;
+	AR_CHECK(Wheel > Harness.FindInput(ViewInput::Up));
+	// as far as the release velocity carries it in FlingScrollSeconds
+	float Expected = 1500.f * Harness.Touch.FlingScrollSeconds / Harness.Touch.PixelToWheelTickScalingFactor;
+	AR_CHECK_NEAR(Harness.Inputs[Wheel].WheelTicksY, Expected, Expected * 0.05f);
+}
+
+AR_TEST(HorizontalFlingDoesNotScroll)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& /*Palm*/, float& D) {
+		float Moved = (float)FMath::Max(T - 0.3, 0.0) * 1500.f;
+		Finger = FVector2D(100.f + Moved, 400.f);
+		D = Depth(T, 0.2, 0.5);
+		return true;
+	}, 0.7f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Fling) == 1);
+	AR_CHECK(Harness.CountInputs(ViewInput::Wheel) == 0);
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 0);
+}
+
+AR_TEST(LeftThenRightSwipeGoesBack)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& Palm, float& D) {
+		// left at 1000 pixels per second for 0.2 s, then straight back
+		float Offset = T < 0.3 ? 0.f : (T < 0.5 ? -(float)(T - 0.3) * 1000.f : -200.f + (float)FMath::Min(T - 0.5, 0.2) * 1000.f);
+		Palm = FVector2D(600.f + Offset, 600.f);
+		Finger = Palm - FVector2D(0.f, 100.f);
+		D = Depth(T, 0.2, 0.9);
+		return true;
+	}, 1.f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Swipe) == 2);
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 1);
+	int32 Right = Harness.FindEvent(GestureEvent::Swipe, Harness.FindEvent(GestureEvent::Swipe) + 1);
+	int32 Back = Harness.FindInput(ViewInput::Back);
+	if (Right == INDEX_NONE || Back == INDEX_NONE) return;
+	AR_CHECK_NEAR(Harness.Inputs[Back].Time, Harness.Events[Right].Time, 1e-9); // on the right swipe
+}
+
+AR_TEST(RightSwipesAloneDoNotGoBack)
+{
+	TouchReplayHarness Harness;
+	RunScript([](double T, FVector2D& Finger, FVector2D& Palm, float& D) {
+		Palm = FVector2D(-200.f + (float)FMath::Clamp(T - 0.3, 0.0, 1.2) * 1000.f, 600.f);
+		Finger = Palm - FVector2D(0.f, 100.f);
+		D = Depth(T, 0.2, 1.6);
+		return true;
+	}, 1.8f, Harness);
+	AR_CHECK(Harness.CountEvents(GestureEvent::Swipe) == 3);
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 0);
+}
+
+static GestureEvent MakeSwipe(double Time, float VelocityX)
+{
+	GestureEvent Event;
+	Event.Type = GestureEvent::Swipe;
+	Event.Time = Time;
+	Event.Position = FVector2D(500.f, 600.f);
+	Event.Delta = FVector2D(VelocityX > 0.f ? 50.f : -50.f, 0.f);
+	Event.Velocity = FVector2D(VelocityX, 0.f);
+	return Event;
+}
+
+AR_TEST(SwipesLinkWithinMaxSecondsLinkingSwipes)
+{
+	TouchReplayHarness Harness;
+	UISurfaceTouchInput& Touch = Harness.Touch;
+	double Linking = Touch.MaxSecondsLinkingSwipes;
+	// a right swipe just within the window of a left one goes Back
+	Touch.HandleGestureEvent(MakeSwipe(10.0, -1000.f), Harness);
+	Touch.HandleGestureEvent(MakeSwipe(10.0 + Linking - 0.01, 1000.f), Harness);
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 1);
+	// just past it, it doesn't
+	Harness.Reset();
+	Touch.HandleGestureEvent(MakeSwipe(20.0, -1000.f), Harness);
+	Touch.HandleGestureEvent(MakeSwipe(20.0 + Linking + 0.01, 1000.f), Harness);
+	AR_CHECK(Harness.Inputs.Num() == 0);
+	// the latest left swipe is the one that counts
+	Touch.HandleGestureEvent(MakeSwipe(30.0, -1000.f), Harness);
+	Touch.HandleGestureEvent(MakeSwipe(30.0 + Linking * 0.9, -1000.f), Harness);
+	Touch.HandleGestureEvent(MakeSwipe(30.0 + Linking * 1.5, 1000.f), Harness);
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 1);
+}
+
+AR_TEST(BackUsesUpTheLeftSwipe)
+{
+	TouchReplayHarness Harness;
+	UISurfaceTouchInput& Touch = Harness.Touch;
+	Touch.HandleGestureEvent(MakeSwipe(10.0, -1000.f), Harness);
+	Touch.HandleGestureEvent(MakeSwipe(10.3, 1000.f), Harness);
+	Touch.HandleGestureEvent(MakeSwipe(10.9, 1000.f), Harness); // still within the window of the left swipe
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 1);
+	// as does a reset, as when the surface goes back to its pool
+	Touch.HandleGestureEvent(MakeSwipe(20.0, -1000.f), Harness);
+	Touch.Reset();
+	Touch.HandleGestureEvent(MakeSwipe(20.3, 1000.f), Harness);
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 1);
+}
+
+AR_TEST(LinkingWindowFollowsTheSetting)
+{
+	TouchReplayHarness Harness;
+	UISurfaceTouchInput& Touch = Harness.Touch;
+	Touch.MaxSecondsLinkingSwipes = 0.2; // as AUISurfaceActor sets it from MaxMillisecondsLinkingSwipes = 200
+	Touch.HandleGestureEvent(MakeSwipe(10.0, -1000.f), Harness);
+	Touch.HandleGestureEvent(MakeSwipe(10.3, 1000.f), Harness);
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 0);
+	Touch.HandleGestureEvent(MakeSwipe(11.0, -1000.f), Harness);
+	Touch.HandleGestureEvent(MakeSwipe(11.15, 1000.f), Harness);
+	AR_CHECK(Harness.CountInputs(ViewInput::Back) == 1);
+}
+
+int main()
+{
+	return RunTests();
+}